@@ -1,6 +1,6 @@
 /*
     Sylverant Ship Server
-    Copyright (C) 2009, 2010, 2011, 2012, 2013, 2016, 2020 Lawrence Sebald
+    Copyright (C) 2009, 2010, 2011, 2012, 2013, 2016, 2020, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -26,6 +26,7 @@
 #include "admin.h"
 #include "block.h"
 #include "clients.h"
+#include "epoch.h"
 #include "ship.h"
 #include "ship_packets.h"
 #include "utils.h"
@@ -72,7 +73,7 @@ int kill_guildcard(ship_client_t *c, uint32_t gc, const char *reason) {
                                             "GM."));
                     }
 
-                    i->flags |= CLIENT_FLAG_DISCONNECTED;
+                    client_disconnect(i);
                     pthread_mutex_unlock(&i->mutex);
                     pthread_rwlock_unlock(&b->lock);
                     return 0;
@@ -206,9 +207,9 @@ int refresh_gms(ship_client_t *c, msgfunc f) {
 }
 
 int refresh_limits(ship_client_t *c, msgfunc f) {
-    sylverant_limits_t *l, *def = NULL;
+    sylverant_limits_t *l;
     int i;
-    struct limits_queue lq;
+    ship_limits_t *lq, *old;
     sylverant_ship_t *s = ship->cfg;
     limits_entry_t *ent;
 
@@ -220,7 +221,8 @@ int refresh_limits(ship_client_t *c, msgfunc f) {
     if(!s->limits_count)
         return f(c, "%s", __(c, "\tE\tC7No configured limits."));
 
-    TAILQ_INIT(&lq);
+    if(!(lq = ship_alloc_limits()))
+        return f(c, "%s", __(c, "\tE\tC7Error updating limits."));
 
     /* First, read in all the new files. That way, if something goes wrong, we
        don't clear out existing lists... */
@@ -259,64 +261,60 @@ int refresh_limits(ship_client_t *c, msgfunc f) {
         }
 
         ent->limits = l;
-        TAILQ_INSERT_TAIL(&lq, ent, qentry);
+        TAILQ_INSERT_TAIL(&lq->all, ent, qentry);
 
         if(s->limits[i].enforce)
-            def = l;
+            lq->def = l;
     }
 
     /* If we get here, then everything has at least been read in successfully,
-       go ahead and replace the data in the ship's structure. */
-    pthread_rwlock_wrlock(&ship->llock);
-    ship_free_limits_ex(&ship->all_limits);
-    ship->all_limits = lq;
-    ship->def_limits = def;
-    pthread_rwlock_unlock(&ship->llock);
+       go ahead and swap the new lists in. The old ones can go away once
+       nobody can be looking at them anymore. Anyone that has retained one of
+       the old lists keeps their own reference to it. */
+    old = (ship_limits_t *)epoch_publish((void **)&ship->limits, lq);
+    epoch_synchronize();
+    ship_free_limits_ex(old);
 
     return f(c, "%s", __(c, "\tE\tC7Updated limits."));
 
 err:
-    ship_free_limits_ex(&lq);
+    ship_free_limits_ex(lq);
     return f(c, "%s", __(c, "\tE\tC7Error updating limits."));
 }
 
-int broadcast_message(ship_client_t *c, const char *message, int prefix) {
-    block_t *b;
-    int i;
+/* Send a broadcast message to everyone on a block worker. This runs on the
+   worker's own thread. */
+static void broadcast_worker(block_worker_t *w, block_msg_t *m) {
     ship_client_t *i2;
+    const char *message = (const char *)m->data;
 
-    /* Make sure we don't have anyone trying to escalate their privileges. */
-    if(c && !LOCAL_GM(c)) {
-        return -1;
-    }
-
-    /* Go through each block and send the message to anyone that is alive. */
-    for(i = 0; i < ship->cfg->blocks; ++i) {
-        b = ship->blocks[i];
-
-        if(b && b->run) {
-            pthread_rwlock_rdlock(&b->lock);
-
-            /* Send the message to each player. */
-            TAILQ_FOREACH(i2, b->clients, qentry) {
-                pthread_mutex_lock(&i2->mutex);
-
-                if(i2->pl) {
-                    if(prefix) {
-                        send_txt(i2, "%s", __(i2, "\tE\tC7Global Message:"));
-                    }
+    TAILQ_FOREACH(i2, w->block->clients, qentry) {
+        if(i2->worker != w)
+            continue;
 
-                    send_txt(i2, "%s", message);
-                }
+        pthread_mutex_lock(&i2->mutex);
 
-                pthread_mutex_unlock(&i2->mutex);
+        if(i2->pl) {
+            if(m->arg) {
+                send_txt(i2, "%s", __(i2, "\tE\tC7Global Message:"));
             }
 
-            pthread_rwlock_unlock(&b->lock);
+            send_txt(i2, "%s", message);
         }
+
+        pthread_mutex_unlock(&i2->mutex);
     }
+}
 
-    return 0;
+int broadcast_message(ship_client_t *c, const char *message, int prefix) {
+    /* Make sure we don't have anyone trying to escalate their privileges. */
+    if(c && !LOCAL_GM(c)) {
+        return -1;
+    }
+
+    /* Have each block's workers send the message to anyone that is alive. */
+    return block_msg_broadcast(&broadcast_worker, prefix, message,
+                               strlen(message) + 1);
 }
 
 int schedule_shutdown(ship_client_t *c, uint32_t when, int restart, msgfunc f) {
@@ -476,7 +474,7 @@ int global_ban(ship_client_t *c, uint32_t gc, uint32_t l, const char *reason) {
                                                      "banned by a GM."));
                     }
 
-                    i->flags |= CLIENT_FLAG_DISCONNECTED;
+                    client_disconnect(i);
 
                     /* The ban setter will get a message telling them the ban has been
                        set (or an error happened). */
@@ -0,0 +1,104 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define ARENA_ROUND(x)  (((x) + ARENA_ALIGN - 1) & ~((size_t)ARENA_ALIGN - 1))
+
+void arena_init(arena_t *a, size_t chunk_size) {
+    a->chunks = NULL;
+    a->chunk_size = chunk_size;
+}
+
+static arena_chunk_t *new_chunk(size_t size) {
+    arena_chunk_t *c;
+
+    if(!(c = (arena_chunk_t *)malloc(sizeof(arena_chunk_t) + size)))
+        return NULL;
+
+    c->next = NULL;
+    c->size = size;
+    c->used = 0;
+    return c;
+}
+
+void *arena_alloc(arena_t *a, size_t len) {
+    arena_chunk_t *c = a->chunks;
+    size_t csz = a->chunk_size ? a->chunk_size : ARENA_CHUNK_SIZE;
+    void *rv;
+
+    len = ARENA_ROUND(len);
+
+    /* The common case: there's room left in the current chunk. */
+    if(c && c->size - c->used >= len) {
+        rv = c->data + c->used;
+        c->used += len;
+        return rv;
+    }
+
+    /* Anything big gets a chunk all to itself. It goes behind the current
+       chunk, so that whatever space is left in that one still gets used. */
+    if(len > csz / 4) {
+        if(!(c = new_chunk(len)))
+            return NULL;
+
+        c->used = len;
+
+        if(a->chunks) {
+            c->next = a->chunks->next;
+            a->chunks->next = c;
+        }
+        else {
+            a->chunks = c;
+        }
+
+        return c->data;
+    }
+
+    /* Otherwise, start a new chunk and leave the rest of the old one be. */
+    if(!(c = new_chunk(csz)))
+        return NULL;
+
+    c->next = a->chunks;
+    c->used = len;
+    a->chunks = c;
+
+    return c->data;
+}
+
+void *arena_zalloc(arena_t *a, size_t len) {
+    void *rv;
+
+    if((rv = arena_alloc(a, len)))
+        memset(rv, 0, len);
+
+    return rv;
+}
+
+void arena_destroy(arena_t *a) {
+    arena_chunk_t *c, *next;
+
+    for(c = a->chunks; c; c = next) {
+        next = c->next;
+        free(c);
+    }
+
+    a->chunks = NULL;
+}
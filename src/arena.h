@@ -0,0 +1,62 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* A simple bump allocator for data that all lives and dies together (like the
+   map data for a team). Allocations come out of large chunks and can't be
+   freed individually. Everything gets freed at once with arena_destroy().
+
+   An arena is not thread-safe. Whoever owns the thing it is attached to must
+   take care of serializing access to it. */
+
+/* Everything that comes out of an arena is aligned to this. */
+#define ARENA_ALIGN         16
+
+/* The default size of each chunk, if one isn't given. */
+#define ARENA_CHUNK_SIZE    16384
+
+typedef struct arena_chunk {
+    struct arena_chunk *next;
+    size_t size;
+    size_t used;
+    uint8_t data[] __attribute__((aligned(ARENA_ALIGN)));
+} arena_chunk_t;
+
+typedef struct arena {
+    arena_chunk_t *chunks;
+    size_t chunk_size;
+} arena_t;
+
+/* Set up an arena. Nothing is allocated until the first call to
+   arena_alloc(). A zeroed arena_t is also valid and uses the default chunk
+   size. */
+void arena_init(arena_t *a, size_t chunk_size);
+
+/* Grab some memory from the arena. Returns NULL if we can't allocate more. */
+void *arena_alloc(arena_t *a, size_t len);
+void *arena_zalloc(arena_t *a, size_t len);
+
+/* Free everything that has been allocated from the arena. The arena may be
+   used again afterwards. */
+void arena_destroy(arena_t *a);
+
+#endif /* !ARENA_H */
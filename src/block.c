@@ -1,7 +1,7 @@
 /*
     Sylverant Ship Server
     Copyright (C) 2009, 2010, 2011, 2012, 2013, 2014, 2015, 2017, 2018, 2019,
-                  2020, 2021, 2022, 2023, 2025 Lawrence Sebald
+                  2020, 2021, 2022, 2023, 2025, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -24,7 +24,6 @@
 #include <errno.h>
 #include <time.h>
 #include <sys/socket.h>
-#include <sys/select.h>
 #include <arpa/inet.h>
 
 #include <sylverant/debug.h>
@@ -44,435 +43,638 @@
 #include "scripts.h"
 #include "admin.h"
 #include "smutdata.h"
+#include "gcindex.h"
+#include "mempool.h"
+#include "epoch.h"
 
 extern int enable_ipv6;
+extern int block_workers;
 extern uint32_t ship_ip4;
 extern uint8_t ship_ip6[16];
 
-static void *block_thd(void *d) {
-    block_t *b = (block_t *)d;
+/* Names of each client version, for logging accepted connections. */
+static const char *version_names[CLIENT_VERSION_COUNT] = {
+    "DC", "DCv2", "PC", "GC", "Episode 3", "Blue Burst", "Xbox"
+};
+
+/* The worker (if any) that is running on the current thread. */
+static pthread_key_t worker_key;
+static pthread_once_t worker_key_once = PTHREAD_ONCE_INIT;
+
+/* The listening sockets each worker has, in order of the port offset from the
+   block's base port. */
+static const int listener_versions[6] = {
+    CLIENT_VERSION_DCV1, CLIENT_VERSION_PC, CLIENT_VERSION_GC,
+    CLIENT_VERSION_EP3, CLIENT_VERSION_BB, CLIENT_VERSION_XBOX
+};
+
+static void make_worker_key(void) {
+    pthread_key_create(&worker_key, NULL);
+}
+
+block_worker_t *block_current_worker(void) {
+    pthread_once(&worker_key_once, &make_worker_key);
+    return (block_worker_t *)pthread_getspecific(worker_key);
+}
+
+mtrand_t *block_rng(block_t *b) {
+    block_worker_t *w;
+
+    /* A worker's generator is only ever used by its own thread, so it doesn't
+       matter which block the worker actually belongs to. */
+    if((w = block_current_worker()))
+        return &w->rng;
+
+    return &b->rng;
+}
+
+static void block_accept(block_worker_t *w, block_listener_t *lst) {
+    block_t *b = w->block;
     ship_t *s = b->ship;
-    int nfds, i;
-    struct timeval timeout;
-    fd_set readfds, writefds;
-    ship_client_t *it, *tmp;
     socklen_t len;
     struct sockaddr_storage addr;
     struct sockaddr *addr_p = (struct sockaddr *)&addr;
     char ipstr[INET6_ADDRSTRLEN];
-    char nm[64];
     int sock;
-    ssize_t sent;
-    time_t now;
-    int numsocks = 1;
 
-#ifdef SYLVERANT_ENABLE_IPV6
-    if(enable_ipv6) {
-        numsocks = 2;
+    len = sizeof(struct sockaddr_storage);
+    if((sock = accept(lst->sock, addr_p, &len)) < 0) {
+        perror("accept");
+        return;
     }
-#endif
 
-    debug(DBG_LOG, "%s(%d): Up and running\n", s->cfg->name, b->b);
+    my_ntop(&addr, ipstr);
+    debug(DBG_LOG, "%s(%d): Accepted %s block connection from %s\n",
+          s->cfg->name, b->b, version_names[lst->version], ipstr);
 
-    /* While we're still supposed to run... do it. */
-    while(b->run) {
-        /* Clear the fd_sets so we can use them again. */
-        nfds = 0;
-        FD_ZERO(&readfds);
-        FD_ZERO(&writefds);
-        timeout.tv_sec = 15;
-        timeout.tv_usec = 0;
-        now = time(NULL);
-
-        /* Fill the sockets into the fd_sets so we can use select below. */
-        pthread_rwlock_rdlock(&b->lock);
+    if(!client_create_connection(sock, lst->version, CLIENT_TYPE_BLOCK,
+                                 b->clients, s, w, addr_p, len)) {
+        close(sock);
+    }
+}
 
-        TAILQ_FOREACH(it, b->clients, qentry) {
-            /* If we haven't heard from a client in a minute and a half, it is
-               probably dead. Disconnect it. */
-            if(now > it->last_message + 90) {
-                if(it->bb_pl) {
-                    istrncpy16_raw(ic_utf16_to_utf8, nm,
-                                   &it->pl->bb.character.name[2], 64, 14);
-                    debug(DBG_LOG, "Ping Timeout: %s(%d)\n", nm, it->guildcard);
-                }
-                else if(it->pl) {
-                    debug(DBG_LOG, "Ping Timeout: %s(%d)\n", it->pl->v1.name,
-                          it->guildcard);
-                }
+static void block_client_event(ship_client_t *it, uint32_t events) {
+    pthread_mutex_lock(&it->mutex);
 
-                it->flags |= CLIENT_FLAG_DISCONNECTED;
+    /* Check if this connection was trying to send us something. */
+    if(events & EVLOOP_READ) {
+        if(client_process_pkt(it)) {
+            client_disconnect(it);
+            pthread_mutex_unlock(&it->mutex);
+            return;
+        }
+    }
 
-                /* Make sure that we disconnect the client ASAP! */
-                timeout.tv_sec = 0;
+    /* If we have anything to write, check if we can right now. */
+    if(events & EVLOOP_WRITE) {
+        if(client_send_buffered(it)) {
+            client_disconnect(it);
+        }
+    }
 
-                continue;
-            }
-            /* Otherwise, if we haven't heard from them in half of a minute,
-               ping them. */
-            else if(now > it->last_message + 30 && now > it->last_sent + 10) {
-                if(send_simple(it, PING_TYPE, 0)) {
-                    it->flags |= CLIENT_FLAG_DISCONNECTED;
-                    timeout.tv_sec = 0;
-                    continue;
-                }
+    pthread_mutex_unlock(&it->mutex);
+}
 
-                it->last_sent = now;
-            }
+/* Send out everything that was queued up for the worker's clients during this
+   pass through the loop, in one go for each client. */
+static void block_flush_clients(block_worker_t *w) {
+    ship_client_t *it;
 
-            /* Check if their timeout expired to login after getting a
-               protection message. */
-            if((it->flags & CLIENT_FLAG_GC_PROTECT) &&
-               it->join_time + 60 < now) {
-                it->flags |= CLIENT_FLAG_DISCONNECTED;
-                timeout.tv_sec = 0;
-                continue;
-            }
+    while((it = TAILQ_FIRST(&w->flush_queue))) {
+        TAILQ_REMOVE(&w->flush_queue, it, flush_qentry);
+        it->flush_pending = 0;
 
-            FD_SET(it->sock, &readfds);
+        pthread_mutex_lock(&it->mutex);
 
-            /* Only add to the write fd set if we have something to send out. */
-            if(it->sendbuf_cur) {
-                FD_SET(it->sock, &writefds);
-            }
+        if(client_send_buffered(it)) {
+            client_disconnect(it);
+        }
+
+        pthread_mutex_unlock(&it->mutex);
+    }
+}
+
+/* Top up the keystream rings of any clients that have been using them. This is
+   done after all of the output for the pass has been sent, so that it doesn't
+   hold anything up. */
+static void block_refill_clients(block_worker_t *w) {
+    ship_client_t *it;
+
+    while((it = TAILQ_FIRST(&w->refill_queue))) {
+        TAILQ_REMOVE(&w->refill_queue, it, refill_qentry);
+        it->refill_pending = 0;
+
+        pthread_mutex_lock(&it->mutex);
+        cipher_ks_refill(&it->ckey, &it->ckey_ks);
+        cipher_ks_refill(&it->skey, &it->skey_ks);
+        pthread_mutex_unlock(&it->mutex);
+    }
+}
+
+block_msg_t *block_msg_alloc(block_msg_cb cb, uint32_t gc, int arg,
+                             const void *data, size_t len) {
+    block_msg_t *rv;
+
+    if(!(rv = (block_msg_t *)malloc(sizeof(block_msg_t) + len))) {
+        perror("malloc");
+        return NULL;
+    }
+
+    rv->next = NULL;
+    rv->callback = cb;
+    rv->gc = gc;
+    rv->arg = arg;
+    rv->len = len;
+
+    if(len)
+        memcpy(rv->data, data, len);
+
+    return rv;
+}
 
-            nfds = nfds > it->sock ? nfds : it->sock;
+void block_msg_post(block_worker_t *w, block_msg_t *m) {
+    block_msg_t *head = __atomic_load_n(&w->mailbox, __ATOMIC_RELAXED);
+
+    do {
+        m->next = head;
+    } while(!__atomic_compare_exchange_n(&w->mailbox, &head, m, 1,
+                                         __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    /* If there was already something in there, the worker has already been
+       woken up and hasn't gotten to it yet, so it'll see this one too. */
+    if(!head)
+        write(w->pipes[1], "\x01", 1);
+}
+
+int block_msg_send(block_t *b, uint32_t gc, block_msg_cb cb, int arg,
+                   const void *data, size_t len) {
+    ship_client_t *c;
+    block_msg_t *m;
+
+    if(b) {
+        pthread_rwlock_rdlock(&b->lock);
+
+        if(!(c = gcindex_find(b, gc))) {
+            pthread_rwlock_unlock(&b->lock);
+            return -1;
         }
+    }
+    else if(!(c = gcindex_find_any(gc, &b))) {
+        return -1;
+    }
 
+    /* The client can't go away while we have the lock, so its worker is safe
+       to look at. */
+    if(!(m = block_msg_alloc(cb, gc, arg, data, len))) {
         pthread_rwlock_unlock(&b->lock);
+        return -1;
+    }
 
-        /* Add the listening sockets to the read fd_set. */
-        for(i = 0; i < numsocks; ++i) {
-            FD_SET(b->dcsock[i], &readfds);
-            nfds = nfds > b->dcsock[i] ? nfds : b->dcsock[i];
-            FD_SET(b->pcsock[i], &readfds);
-            nfds = nfds > b->pcsock[i] ? nfds : b->pcsock[i];
-            FD_SET(b->gcsock[i], &readfds);
-            nfds = nfds > b->gcsock[i] ? nfds : b->gcsock[i];
-            FD_SET(b->ep3sock[i], &readfds);
-            nfds = nfds > b->ep3sock[i] ? nfds : b->ep3sock[i];
-            FD_SET(b->bbsock[i], &readfds);
-            nfds = nfds > b->bbsock[i] ? nfds : b->bbsock[i];
-            FD_SET(b->xbsock[i], &readfds);
-            nfds = nfds > b->xbsock[i] ? nfds : b->xbsock[i];
-        }
-
-        FD_SET(b->pipes[1], &readfds);
-        nfds = nfds > b->pipes[1] ? nfds : b->pipes[1];
+    block_msg_post(c->worker, m);
+    pthread_rwlock_unlock(&b->lock);
 
-        /* Wait for some activity... */
-        if(select(nfds + 1, &readfds, &writefds, NULL, &timeout) > 0) {
-            if(FD_ISSET(b->pipes[1], &readfds)) {
-                read(b->pipes[1], &len, 1);
-            }
+    return 0;
+}
 
-            for(i = 0; i < numsocks; ++i) {
-                if(FD_ISSET(b->dcsock[i], &readfds)) {
-                    len = sizeof(struct sockaddr_storage);
-                    if((sock = accept(b->dcsock[i], addr_p, &len)) < 0) {
-                        perror("accept");
-                    }
+int block_msg_broadcast(block_msg_cb cb, int arg, const void *data,
+                        size_t len) {
+    block_t *b;
+    block_msg_t *m;
+    int i, j;
 
-                    my_ntop(&addr, ipstr);
-                    debug(DBG_LOG, "%s(%d): Accepted DC block connection from "
-                          "%s\n", s->cfg->name, b->b, ipstr);
+    for(i = 0; i < ship->cfg->blocks; ++i) {
+        b = ship->blocks[i];
 
-                    if(!client_create_connection(sock, CLIENT_VERSION_DCV1,
-                                                 CLIENT_TYPE_BLOCK, b->clients,
-                                                 s, b, addr_p, len)) {
-                        close(sock);
-                    }
-                }
+        if(!b || !b->run)
+            continue;
 
-                if(FD_ISSET(b->pcsock[i], &readfds)) {
-                    len = sizeof(struct sockaddr_storage);
-                    if((sock = accept(b->pcsock[i], addr_p, &len)) < 0) {
-                        perror("accept");
-                    }
+        for(j = 0; j < b->num_workers; ++j) {
+            if(!(m = block_msg_alloc(cb, 0, arg, data, len)))
+                return -1;
 
-                    my_ntop(&addr, ipstr);
-                    debug(DBG_LOG, "%s(%d): Accepted PC block connection from "
-                          "%s\n", s->cfg->name, b->b, ipstr);
+            block_msg_post(&b->workers[j], m);
+        }
+    }
 
-                    if(!client_create_connection(sock, CLIENT_VERSION_PC,
-                                                 CLIENT_TYPE_BLOCK, b->clients,
-                                                 s, b, addr_p, len)) {
-                        close(sock);
-                    }
-                }
+    return 0;
+}
 
-                if(FD_ISSET(b->gcsock[i], &readfds)) {
-                    len = sizeof(struct sockaddr_storage);
-                    if((sock = accept(b->gcsock[i], addr_p, &len)) < 0) {
-                        perror("accept");
-                    }
+ship_client_t *block_msg_target(block_worker_t *w, block_msg_t *m) {
+    ship_client_t *rv = gcindex_find(w->block, m->gc);
 
-                    my_ntop(&addr, ipstr);
-                    debug(DBG_LOG, "%s(%d): Accepted GC block connection from "
-                          "%s\n", s->cfg->name, b->b, ipstr);
+    if(rv && rv->worker == w)
+        return rv;
 
-                    if(!client_create_connection(sock, CLIENT_VERSION_GC,
-                                                 CLIENT_TYPE_BLOCK, b->clients,
-                                                 s, b, addr_p, len)) {
-                        close(sock);
-                    }
-                }
+    return NULL;
+}
 
-                if(FD_ISSET(b->ep3sock[i], &readfds)) {
-                    len = sizeof(struct sockaddr_storage);
-                    if((sock = accept(b->ep3sock[i], addr_p, &len)) < 0) {
-                        perror("accept");
-                    }
+/* Take everything out of the worker's mailbox. Since it's a stack, the
+   messages come out backwards, so flip them around to keep them in the order
+   they were sent in. */
+static block_msg_t *block_take_mail(block_worker_t *w) {
+    block_msg_t *m, *next, *rv = NULL;
 
-                    my_ntop(&addr, ipstr);
-                    debug(DBG_LOG, "%s(%d): Accepted Episode 3 block "
-                          "connection from %s\n", s->cfg->name, b->b, ipstr);
+    m = __atomic_exchange_n(&w->mailbox, NULL, __ATOMIC_ACQUIRE);
 
-                    if(!client_create_connection(sock, CLIENT_VERSION_EP3,
-                                                 CLIENT_TYPE_BLOCK, b->clients,
-                                                 s, b, addr_p, len)) {
-                        close(sock);
-                    }
-                }
+    while(m) {
+        next = m->next;
+        m->next = rv;
+        rv = m;
+        m = next;
+    }
 
-                if(FD_ISSET(b->bbsock[i], &readfds)) {
-                    len = sizeof(struct sockaddr_storage);
-                    if((sock = accept(b->bbsock[i], addr_p, &len)) < 0) {
-                        perror("accept");
-                    }
+    return rv;
+}
 
-                    my_ntop(&addr, ipstr);
-                    debug(DBG_LOG, "%s(%d): Accepted Blue Burst block "
-                          "connection from %s\n", s->cfg->name, b->b, ipstr);
+/* Deal with anything other threads have asked the worker to do. */
+static void block_run_mailbox(block_worker_t *w) {
+    block_msg_t *m, *next;
 
-                    if(!client_create_connection(sock, CLIENT_VERSION_BB,
-                                                 CLIENT_TYPE_BLOCK, b->clients,
-                                                 s, b, addr_p, len)) {
-                        close(sock);
-                    }
-                }
+    m = block_take_mail(w);
 
-                if(FD_ISSET(b->xbsock[i], &readfds)) {
-                    len = sizeof(struct sockaddr_storage);
-                    if((sock = accept(b->xbsock[i], addr_p, &len)) < 0) {
-                        perror("accept");
-                    }
+    while(m) {
+        next = m->next;
+        m->callback(w, m);
+        free(m);
+        m = next;
+    }
+}
 
-                    my_ntop(&addr, ipstr);
-                    debug(DBG_LOG, "%s(%d): Accepted Xbox block "
-                          "connection from %s\n", s->cfg->name, b->b, ipstr);
+/* Encrypt and queue up what other workers have sent to this worker's
+   clients. */
+static void block_send_pending(block_worker_t *w) {
+    ship_client_t *it, *tmp;
 
-                    if(!client_create_connection(sock, CLIENT_VERSION_XBOX,
-                                                 CLIENT_TYPE_BLOCK, b->clients,
-                                                 s, b, addr_p, len)) {
-                        close(sock);
-                    }
-                }
-            }
+    it = __atomic_exchange_n(&w->pend_list, NULL, __ATOMIC_ACQUIRE);
 
-            pthread_rwlock_rdlock(&b->lock);
+    while(it) {
+        tmp = it->pend_next;
 
-            /* Process client connections. */
-            TAILQ_FOREACH(it, b->clients, qentry) {
-                pthread_mutex_lock(&it->mutex);
+        /* Clear the flag first, so anything queued from here on puts the
+           client back on the list. */
+        __atomic_store_n(&it->pend_queued, 0, __ATOMIC_RELEASE);
 
-                /* Check if this connection was trying to send us something. */
-                if(FD_ISSET(it->sock, &readfds)) {
-                    if(client_process_pkt(it)) {
-                        it->flags |= CLIENT_FLAG_DISCONNECTED;
-                        pthread_mutex_unlock(&it->mutex);
-                        continue;
-                    }
-                }
+        pthread_mutex_lock(&it->mutex);
+        crypt_send_pending(it);
+        pthread_mutex_unlock(&it->mutex);
 
-                /* If we have anything to write, check if we can right now. */
-                if(FD_ISSET(it->sock, &writefds)) {
-                    if(it->sendbuf_cur) {
-                        sent = send(it->sock, it->sendbuf + it->sendbuf_start,
-                                    it->sendbuf_cur - it->sendbuf_start, 0);
-
-                        /* If we fail to send, and the error isn't EAGAIN,
-                           bail. */
-                        if(sent == -1) {
-                            if(errno != EAGAIN) {
-                                it->flags |= CLIENT_FLAG_DISCONNECTED;
-                                pthread_mutex_unlock(&it->mutex);
-                                continue;
-                            }
-                        }
-                        else {
-                            it->sendbuf_start += sent;
-
-                            /* If we've sent everything, free the buffer. */
-                            if(it->sendbuf_start == it->sendbuf_cur) {
-                                free(it->sendbuf);
-                                it->sendbuf = NULL;
-                                it->sendbuf_cur = 0;
-                                it->sendbuf_size = 0;
-                                it->sendbuf_start = 0;
-                            }
-                        }
-                    }
-                }
+        it = tmp;
+    }
+}
 
-                pthread_mutex_unlock(&it->mutex);
-            }
+/* Get rid of the clients on the worker's list of dead ones. */
+static void block_reap_clients(block_worker_t *w) {
+    block_t *b = w->block;
+    ship_client_t *it, *tmp;
+    char ipstr[INET6_ADDRSTRLEN];
+    char nm[64];
 
-            pthread_rwlock_unlock(&b->lock);
+    pthread_rwlock_wrlock(&b->lock);
+
+    /* Nobody else can queue anything up while we hold the write lock, so
+       clear out the pending list to make sure nothing on it goes away. */
+    block_send_pending(w);
+
+    it = __atomic_exchange_n(&w->dead_list, NULL, __ATOMIC_ACQUIRE);
+
+    while(it) {
+        tmp = it->dead_next;
+
+        if(it->bb_pl) {
+            istrncpy16_raw(ic_utf16_to_utf8, nm,
+                           &it->pl->bb.character.name[2], 64, 14);
+            debug(DBG_LOG, "Disconnecting %s(%d)\n", nm, it->guildcard);
+        }
+        else if(it->pl) {
+            debug(DBG_LOG, "Disconnecting %s(%d)\n", it->pl->v1.name,
+                  it->guildcard);
+        }
+        else {
+            my_ntop(&it->cold->ip_addr, ipstr);
+            debug(DBG_LOG, "Disconnecting something (IP: %s).\n", ipstr);
         }
 
-        /* Clean up any dead connections (its not safe to do a TAILQ_REMOVE
-           in the middle of a TAILQ_FOREACH, and client_destroy_connection
-           does indeed use TAILQ_REMOVE). */
-        pthread_rwlock_wrlock(&b->lock);
-        it = TAILQ_FIRST(b->clients);
-        while(it) {
-            tmp = TAILQ_NEXT(it, qentry);
+        /* Remove the player from the lobby before disconnecting them, or else
+           bad things might happen. */
+        lobby_remove_player(it);
+        client_destroy_connection(it, b->clients);
+        --b->num_clients;
 
-            if(it->flags & CLIENT_FLAG_DISCONNECTED) {
-                if(it->bb_pl) {
-                    istrncpy16_raw(ic_utf16_to_utf8, nm,
-                                   &it->pl->bb.character.name[2], 64, 14);
-                    debug(DBG_LOG, "Disconnecting %s(%d)\n", nm, it->guildcard);
-                }
-                else if(it->pl) {
-                    debug(DBG_LOG, "Disconnecting %s(%d)\n", it->pl->v1.name,
-                          it->guildcard);
-                }
-                else {
-                    my_ntop(&it->ip_addr, ipstr);
-                    debug(DBG_LOG, "Disconnecting something (IP: %s).\n",
-                          ipstr);
-                }
+        it = tmp;
+    }
+
+    /* Send out anything the rest of our clients got from all of that, rather
+       than waiting for the next pass. */
+    block_flush_clients(w);
+
+    pthread_rwlock_unlock(&b->lock);
+}
+
+static void *block_thd(void *d) {
+    block_worker_t *w = (block_worker_t *)d;
+    block_t *b = w->block;
+    ship_t *s = b->ship;
+    int n, i, timeout;
+    evloop_event_t evs[EVLOOP_MAX_EVENTS];
+    block_listener_t *lst;
+    uint8_t junk[16];
 
-                /* Remove the player from the lobby before disconnecting
-                   them, or else bad things might happen. */
-                lobby_remove_player(it);
-                client_destroy_connection(it, b->clients);
-                --b->num_clients;
+    pthread_setspecific(worker_key, w);
+
+    if(b->num_workers > 1)
+        debug(DBG_LOG, "%s(%d): Worker %d up and running (%s)\n",
+              s->cfg->name, b->b, w->id, evloop_backend());
+    else
+        debug(DBG_LOG, "%s(%d): Up and running (%s)\n", s->cfg->name, b->b,
+              evloop_backend());
+
+    /* While we're still supposed to run... do it. */
+    while(b->run) {
+        /* Sleep until the next client timer is due, or until another thread
+           wakes us up by sending us a message or flagging one of our clients
+           for disconnection. */
+        timeout = timer_wheel_next(&w->timers, 15);
+
+        /* Wait for some activity... */
+        if((n = evloop_wait(w->evl, evs, EVLOOP_MAX_EVENTS,
+                            timeout * 1000)) < 0) {
+            perror("evloop_wait");
+            n = 0;
+        }
+
+        /* Deal with anything on the worker's own sockets first. Accepting a
+           connection needs the write lock on the client list, so this has to
+           be done before we grab the read lock below. */
+        for(i = 0; i < n; ++i) {
+            lst = (block_listener_t *)evs[i].data;
+
+            if(lst < w->listeners || lst >= w->listeners + w->num_listeners)
+                continue;
+
+            if(lst->version == -1) {
+                /* Clear anything written to the pipe */
+                read(lst->sock, junk, sizeof(junk));
             }
+            else {
+                block_accept(w, lst);
+            }
+
+            evs[i].data = NULL;
+        }
+
+        /* Process client connections that have something going on. */
+        pthread_rwlock_rdlock(&b->lock);
 
-            it = tmp;
+        for(i = 0; i < n; ++i) {
+            if(evs[i].data)
+                block_client_event((ship_client_t *)evs[i].data,
+                                   evs[i].events);
         }
 
+        /* Handle anything that's been sent our way from other threads. */
+        block_run_mailbox(w);
+        block_send_pending(w);
+
+        /* Deal with any pings and timeouts that are due. */
+        timer_wheel_run(&w->timers, time(NULL));
+
+        /* Now that everything for this pass has been handled, send out what
+           it generated. */
+        block_flush_clients(w);
+        block_refill_clients(w);
+
         pthread_rwlock_unlock(&b->lock);
+
+        /* Clean up any of our clients that have been flagged for
+           disconnection. The other workers take care of theirs, so this only
+           needs the write lock on the client list if there's something on our
+           own list. */
+        if(__atomic_load_n(&w->dead_list, __ATOMIC_RELAXED))
+            block_reap_clients(w);
     }
 
     pthread_exit(NULL);
 }
 
-block_t *block_server_start(ship_t *s, int b, uint16_t port) {
-    block_t *rv;
-    int dcsock[2] = { -1, -1 }, pcsock[2] = { -1, -1 };
-    int gcsock[2] = { -1, -1 }, ep3sock[2] = { -1, -1 };
-    int bbsock[2] = { -1, -1 }, xbsock[2] = { -1, -1 }, i;
-    lobby_t *l, *l2;
-    uint32_t rng_seed;
+/* Open the listening sockets for one of a block's workers and register them
+   (and the worker's wakeup pipe) with its event loop. If the block has more
+   than one worker, they all bind their own sockets with SO_REUSEPORT. */
+static int block_open_listeners(block_worker_t *w, uint16_t port) {
+    static const int families[2] = { AF_INET, AF_INET6 };
+    int nfamilies = 1, i, j, sock, val;
+    block_listener_t *lst;
 
-    debug(DBG_LOG, "%s: Starting server for block %d...\n", s->cfg->name, b);
+#ifdef SYLVERANT_ENABLE_IPV6
+    if(enable_ipv6)
+        nfamilies = 2;
+#endif
 
-    /* Create the sockets for listening for connections. */
-    dcsock[0] = open_sock(AF_INET, port);
-    if(dcsock[0] < 0) {
-        return NULL;
+    w->num_listeners = 0;
+
+    for(j = 0; j < nfamilies; ++j) {
+        for(i = 0; i < 6; ++i) {
+            if(w->block->num_workers > 1)
+                sock = open_sock_shared(families[j], port + i);
+            else
+                sock = open_sock(families[j], port + i);
+
+            if(sock < 0)
+                return -1;
+
+            /* Limit receive window size on DC versions to ensure that we don't
+               mistakenly negotiate window scaling. */
+            if(listener_versions[i] == CLIENT_VERSION_DCV1) {
+                val = 32767;
+                if(setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &val,
+                              sizeof(int)) < 0) {
+                    perror("setsockopt");
+                }
+            }
+
+            lst = &w->listeners[w->num_listeners++];
+            lst->sock = sock;
+            lst->version = listener_versions[i];
+
+            if(evloop_add(w->evl, sock, EVLOOP_READ, lst))
+                return -1;
+        }
     }
 
-    /* Limit receive window size on DC versions to ensure that we don't
-       mistakenly negotiate window scaling. */
-    i = 32767;
-    if(setsockopt(dcsock[0], SOL_SOCKET, SO_RCVBUF, &i, sizeof(int)) < 0) {
-        perror("setsockopt");
+    lst = &w->listeners[w->num_listeners++];
+    lst->sock = w->pipes[0];
+    lst->version = -1;
+
+    return evloop_add(w->evl, lst->sock, EVLOOP_READ, lst);
+}
+
+static void block_close_listeners(block_worker_t *w) {
+    int i;
+
+    for(i = 0; i < w->num_listeners; ++i) {
+        if(w->listeners[i].version != -1)
+            close(w->listeners[i].sock);
     }
 
-    pcsock[0] = open_sock(AF_INET, port + 1);
-    if(pcsock[0] < 0) {
-        goto err_close_dc;
+    w->num_listeners = 0;
+}
+
+static int block_worker_start(block_t *b, int id, uint16_t port) {
+    block_worker_t *w = &b->workers[id];
+    ship_t *s = b->ship;
+
+    w->block = b;
+    w->id = id;
+
+    /* Make our pipe */
+    if(pipe(w->pipes) == -1) {
+        debug(DBG_ERROR, "%s(%d): Cannot create pipe!\n", s->cfg->name, b->b);
+        return -1;
     }
 
-    gcsock[0] = open_sock(AF_INET, port + 2);
-    if(gcsock[0] < 0) {
-        goto err_close_pc;
+    /* Create the event loop that all of the worker's sockets will be waited on
+       with. */
+    if(!(w->evl = evloop_create())) {
+        debug(DBG_ERROR, "%s(%d): Cannot create event loop!\n", s->cfg->name,
+              b->b);
+        goto err_pipes;
     }
 
-    ep3sock[0] = open_sock(AF_INET, port + 3);
-    if(ep3sock[0] < 0) {
-        goto err_close_gc;
+    if(block_open_listeners(w, port)) {
+        debug(DBG_ERROR, "%s(%d): Cannot open listening sockets!\n",
+              s->cfg->name, b->b);
+        goto err_listeners;
     }
 
-    bbsock[0] = open_sock(AF_INET, port + 4);
-    if(bbsock[0] < 0) {
-        goto err_close_ep3;
+    /* Initialize the random number generator. The seed value is the current
+       UNIX time, xored with the port and worker number (so that each worker
+       will use a different seed even though they'll probably get the same
+       timestamp). */
+    mtrand_init(&w->rng, (uint32_t)(time(NULL) ^ port ^ (id << 16)));
+
+    /* Set up the timer wheel used for client pings/timeouts. */
+    timer_wheel_init(&w->timers, time(NULL));
+    TAILQ_INIT(&w->flush_queue);
+    TAILQ_INIT(&w->refill_queue);
+
+    /* Start up the thread for this worker. */
+    if(pthread_create(&w->thd, NULL, &block_thd, w)) {
+        debug(DBG_ERROR, "%s(%d): Cannot start block thread!\n",
+              s->cfg->name, b->b);
+        goto err_listeners;
     }
 
-    xbsock[0] = open_sock(AF_INET, port + 5);
-    if(xbsock[0] < 0) {
-        goto err_close_bb;
+    return 0;
+
+err_listeners:
+    block_close_listeners(w);
+    evloop_destroy(w->evl);
+err_pipes:
+    close(w->pipes[0]);
+    close(w->pipes[1]);
+    return -1;
+}
+
+/* Stop the first n workers of a block, disconnect all of its clients, and clean
+   up after the workers. The block's run flag must already be cleared. */
+static void block_stop_workers(block_t *b, int n) {
+    ship_client_t *it, *tmp;
+    block_msg_t *m, *next;
+    int i;
+
+    /* Send a byte to each pipe so that we actually break out of the wait. */
+    for(i = 0; i < n; ++i) {
+        write(b->workers[i].pipes[1], "\xFF", 1);
     }
 
-#ifdef SYLVERANT_ENABLE_IPV6
-    if(enable_ipv6) {
-        dcsock[1] = open_sock(AF_INET6, port);
-        if(dcsock[1] < 0) {
-            goto err_close_xb;
-        }
+    /* Wait for them all to die, then close all the sockets so nobody can
+       connect... */
+    for(i = 0; i < n; ++i) {
+        pthread_join(b->workers[i].thd, NULL);
+        block_close_listeners(&b->workers[i]);
+        close(b->workers[i].pipes[0]);
+        close(b->workers[i].pipes[1]);
+    }
 
-        /* Limit receive window size on DC versions to ensure that we don't
-           mistakenly negotiate window scaling. */
-        i = 32767;
-        if(setsockopt(dcsock[1], SOL_SOCKET, SO_RCVBUF, &i, sizeof(int)) < 0) {
-            perror("setsockopt");
-        }
+    /* Disconnect any clients. */
+    pthread_rwlock_wrlock(&b->lock);
 
-        pcsock[1] = open_sock(AF_INET6, port + 1);
-        if(pcsock[1] < 0) {
-            goto err_close_dc_6;
-        }
+    it = TAILQ_FIRST(b->clients);
+    while(it) {
+        tmp = TAILQ_NEXT(it, qentry);
+        client_destroy_connection(it, b->clients);
+        it = tmp;
+    }
 
-        gcsock[1] = open_sock(AF_INET6, port + 2);
-        if(gcsock[1] < 0) {
-            goto err_close_pc_6;
-        }
+    b->num_clients = 0;
+    pthread_rwlock_unlock(&b->lock);
 
-        ep3sock[1] = open_sock(AF_INET6, port + 3);
-        if(ep3sock[1] < 0) {
-            goto err_close_gc_6;
-        }
+    for(i = 0; i < n; ++i) {
+        evloop_destroy(b->workers[i].evl);
 
-        bbsock[1] = open_sock(AF_INET6, port + 4);
-        if(bbsock[1] < 0) {
-            goto err_close_ep3_6;
-        }
+        /* Throw away anything that was sent too late to be dealt with. */
+        m = block_take_mail(&b->workers[i]);
 
-        xbsock[1] = open_sock(AF_INET6, port + 5);
-        if(xbsock[1] < 0) {
-            goto err_close_bb_6;
+        while(m) {
+            next = m->next;
+            free(m);
+            m = next;
         }
     }
-#endif
+}
+
+block_t *block_server_start(ship_t *s, int b, uint16_t port) {
+    block_t *rv;
+    int i;
+    lobby_t *l, *l2;
+    uint32_t rng_seed;
+
+    debug(DBG_LOG, "%s: Starting server for block %d...\n", s->cfg->name, b);
+
+    pthread_once(&worker_key_once, &make_worker_key);
 
     /* Make space for the block structure. */
     rv = (block_t *)malloc(sizeof(block_t));
 
     if(!rv) {
         debug(DBG_ERROR, "%s(%d): Cannot allocate memory!\n", s->cfg->name, b);
-        goto err_close_all;
+        return NULL;
     }
 
     memset(rv, 0, sizeof(block_t));
 
-    /* Make our pipe */
-    if(pipe(rv->pipes) == -1) {
-        debug(DBG_ERROR, "%s(%d): Cannot create pipe!\n", s->cfg->name, b);
-        goto err_free;
-    }
-
     /* Make room for the client list. */
     rv->clients = (struct client_queue *)malloc(sizeof(struct client_queue));
 
     if(!rv->clients) {
         debug(DBG_ERROR, "%s(%d): Cannot allocate memory for clients!\n",
               s->cfg->name, b);
-        goto err_pipes;
+        goto err_free;
+    }
+
+    /* ...and for the worker threads. */
+    rv->workers = (block_worker_t *)malloc(sizeof(block_worker_t) *
+                                           block_workers);
+
+    if(!rv->workers) {
+        debug(DBG_ERROR, "%s(%d): Cannot allocate memory for workers!\n",
+              s->cfg->name, b);
+        goto err_clients;
+    }
+
+    memset(rv->workers, 0, sizeof(block_worker_t) * block_workers);
+
+    /* ...and for the clients themselves. */
+    if(!(rv->client_pools = client_pools_create(1))) {
+        debug(DBG_ERROR, "%s(%d): Cannot allocate memory for client pools!\n",
+              s->cfg->name, b);
+        goto err_workers_mem;
+    }
+
+    /* Items on the floor in games come and go pretty often, so pool them. */
+    if(!(rv->item_pool = mempool_create(sizeof(lobby_item_t), 64))) {
+        debug(DBG_ERROR, "%s(%d): Cannot allocate memory for item pool!\n",
+              s->cfg->name, b);
+        goto err_client_pools;
     }
 
     /* Fill in the structure. */
@@ -485,51 +687,46 @@ block_t *block_server_start(ship_t *s, int b, uint16_t port) {
     rv->ep3_port = port + 3;
     rv->bb_port = port + 4;
     rv->xb_port = port + 5;
-    rv->dcsock[0] = dcsock[0];
-    rv->pcsock[0] = pcsock[0];
-    rv->gcsock[0] = gcsock[0];
-    rv->ep3sock[0] = ep3sock[0];
-    rv->bbsock[0] = bbsock[0];
-    rv->xbsock[0] = xbsock[0];
-    rv->dcsock[1] = dcsock[1];
-    rv->pcsock[1] = pcsock[1];
-    rv->gcsock[1] = gcsock[1];
-    rv->ep3sock[1] = ep3sock[1];
-    rv->bbsock[1] = bbsock[1];
-    rv->xbsock[1] = xbsock[1];
+    rv->num_workers = block_workers;
     rv->run = 1;
 
     TAILQ_INIT(&rv->lobbies);
+    TAILQ_INIT(&rv->games);
 
     /* Create the first 20 lobbies (the default ones) */
-    for(i = 1; i <= 20; ++i) {
+    for(i = 1; i <= LOBBY_DEFAULT_COUNT; ++i) {
         /* Grab a new lobby. XXXX: Check the return value. */
         l = lobby_create_default(rv, i, s->lobby_event);
 
         /* Add it into our list of lobbies */
-        TAILQ_INSERT_TAIL(&rv->lobbies, l, qentry);
+        block_add_lobby_locked(rv, l);
+        rv->default_lobbies[i - 1] = l;
     }
 
     /* Create the reader-writer locks */
     pthread_rwlock_init(&rv->lock, NULL);
     pthread_rwlock_init(&rv->lobby_lock, NULL);
+    pthread_rwlock_init(&rv->game_list_lock, NULL);
+    rv->game_list_gen = 1;
 
     /* Initialize the random number generator. The seed value is the current
        UNIX time, xored with the port (so that each block will use a different
        seed even though they'll probably get the same timestamp). */
     rng_seed = (uint32_t)(time(NULL) ^ port);
-    mt19937_init(&rv->rng, rng_seed);
+    mtrand_init(&rv->rng, rng_seed);
 
-    /* Start up the thread for this block. */
-    if(pthread_create(&rv->thd, NULL, &block_thd, rv)) {
-        debug(DBG_ERROR, "%s(%d): Cannot start block thread!\n",
-              s->cfg->name, b);
-        goto err_lobbies;
+    /* Start up the threads for this block. */
+    for(i = 0; i < rv->num_workers; ++i) {
+        if(block_worker_start(rv, i, port))
+            goto err_workers;
     }
 
     return rv;
 
-err_lobbies:
+err_workers:
+    rv->run = 0;
+    block_stop_workers(rv, i);
+
     l2 = TAILQ_FIRST(&rv->lobbies);
     while(l2) {
         l = TAILQ_NEXT(l2, qentry);
@@ -539,88 +736,27 @@ err_lobbies:
 
     pthread_rwlock_destroy(&rv->lock);
     pthread_rwlock_destroy(&rv->lobby_lock);
+    pthread_rwlock_destroy(&rv->game_list_lock);
+    mempool_destroy(rv->item_pool);
+err_client_pools:
+    client_pools_destroy(rv->client_pools);
+err_workers_mem:
+    free(rv->workers);
+err_clients:
     free(rv->clients);
-err_pipes:
-    close(rv->pipes[0]);
-    close(rv->pipes[1]);
 err_free:
     free(rv);
-err_close_all:
-#ifdef SYLVERANT_ENABLE_IPV6
-    if(enable_ipv6) {
-        close(xbsock[1]);
-err_close_bb_6:
-        close(bbsock[1]);
-err_close_ep3_6:
-        close(ep3sock[1]);
-err_close_gc_6:
-        close(gcsock[1]);
-err_close_pc_6:
-        close(pcsock[1]);
-err_close_dc_6:
-        close(dcsock[1]);
-    }
-err_close_xb:
-#endif
-    close(xbsock[0]);
-err_close_bb:
-    close(bbsock[0]);
-err_close_ep3:
-    close(ep3sock[0]);
-err_close_gc:
-    close(gcsock[0]);
-err_close_pc:
-    close(pcsock[0]);
-err_close_dc:
-    close(dcsock[0]);
 
     return NULL;
 }
 
 void block_server_stop(block_t *b) {
     lobby_t *it2, *tmp2;
-    ship_client_t *it, *tmp;
+    int i;
 
-    /* Set the flag to kill the block. */
+    /* Set the flag to kill the block, and wait for its threads to die. */
     b->run = 0;
-
-    /* Send a byte to the pipe so that we actually break out of the select. */
-    write(b->pipes[0], "\xFF", 1);
-
-    /* Wait for it to die. */
-    pthread_join(b->thd, NULL);
-
-    /* Close all the sockets so nobody can connect... */
-    close(b->pipes[0]);
-    close(b->pipes[1]);
-    close(b->dcsock[0]);
-    close(b->pcsock[0]);
-    close(b->gcsock[0]);
-    close(b->ep3sock[0]);
-    close(b->bbsock[0]);
-    close(b->xbsock[0]);
-#ifdef SYLVERANT_ENABLE_IPV6
-    if(enable_ipv6) {
-        close(b->dcsock[1]);
-        close(b->pcsock[1]);
-        close(b->gcsock[1]);
-        close(b->ep3sock[1]);
-        close(b->bbsock[1]);
-        close(b->xbsock[1]);
-    }
-#endif
-
-    /* Disconnect any clients. */
-    pthread_rwlock_wrlock(&b->lock);
-
-    it = TAILQ_FIRST(b->clients);
-    while(it) {
-        tmp = TAILQ_NEXT(it, qentry);
-        client_destroy_connection(it, b->clients);
-        it = tmp;
-    }
-
-    pthread_rwlock_unlock(&b->lock);
+    block_stop_workers(b, b->num_workers);
 
     /* Destroy the lobbies that exist. */
     pthread_rwlock_wrlock(&b->lobby_lock);
@@ -635,9 +771,17 @@ void block_server_stop(block_t *b) {
     pthread_rwlock_unlock(&b->lobby_lock);
 
     /* Finish with our cleanup... */
+    for(i = 0; i < BLOCK_GAME_LISTS; ++i) {
+        free(b->game_lists[i].pkt);
+    }
+
+    pthread_rwlock_destroy(&b->game_list_lock);
     pthread_rwlock_destroy(&b->lobby_lock);
     pthread_rwlock_destroy(&b->lock);
 
+    mempool_destroy(b->item_pool);
+    client_pools_destroy(b->client_pools);
+    free(b->workers);
     free(b->clients);
     free(b);
 }
@@ -677,24 +821,71 @@ int block_info_reply(ship_client_t *c, uint32_t block) {
     return send_info_reply(c, string);
 }
 
-lobby_t *block_get_lobby(block_t *b, uint32_t lobby_id) {
-    lobby_t *rv = NULL, *l;
+static inline int lobby_bucket(uint32_t lobby_id) {
+    return (int)(lobby_id & (BLOCK_LOBBY_BUCKETS - 1));
+}
 
-    /* Look through all the lobbies in this block. */
-    TAILQ_FOREACH(l, &b->lobbies, qentry) {
-        pthread_mutex_lock(&l->mutex);
+void block_add_lobby_locked(block_t *b, lobby_t *l) {
+    int bucket = lobby_bucket(l->lobby_id);
 
-        if(l->lobby_id == lobby_id) {
-            rv = l;
-        }
+    TAILQ_INSERT_TAIL(&b->lobbies, l, qentry);
 
-        pthread_mutex_unlock(&l->mutex);
+    l->id_next = b->lobby_table[bucket];
+    b->lobby_table[bucket] = l;
 
-        if(rv) {
+    if(l->type != LOBBY_TYPE_LOBBY) {
+        TAILQ_INSERT_TAIL(&b->games, l, gentry);
+        ++b->num_games;
+        block_game_list_changed(b);
+    }
+}
+
+void block_remove_lobby_locked(block_t *b, lobby_t *l) {
+    lobby_t **i = &b->lobby_table[lobby_bucket(l->lobby_id)];
+
+    TAILQ_REMOVE(&b->lobbies, l, qentry);
+
+    while(*i) {
+        if(*i == l) {
+            *i = l->id_next;
             break;
         }
+
+        i = &(*i)->id_next;
+    }
+
+    l->id_next = NULL;
+
+    if(l->type != LOBBY_TYPE_LOBBY) {
+        TAILQ_REMOVE(&b->games, l, gentry);
+        --b->num_games;
+        block_game_list_changed(b);
+    }
+}
+
+void block_game_list_changed(block_t *b) {
+    __atomic_add_fetch(&b->game_list_gen, 1, __ATOMIC_RELEASE);
+}
+
+lobby_t *block_get_lobby_locked(block_t *b, uint32_t lobby_id) {
+    lobby_t *l = b->lobby_table[lobby_bucket(lobby_id)];
+
+    /* The id of a lobby never changes once it's on the block, so there's no
+       need to lock each one just to look at it. */
+    while(l && l->lobby_id != lobby_id) {
+        l = l->id_next;
     }
 
+    return l;
+}
+
+lobby_t *block_get_lobby(block_t *b, uint32_t lobby_id) {
+    lobby_t *rv;
+
+    pthread_rwlock_rdlock(&b->lobby_lock);
+    rv = block_get_lobby_locked(b, lobby_id);
+    pthread_rwlock_unlock(&b->lobby_lock);
+
     return rv;
 }
 
@@ -814,8 +1005,8 @@ static int join_game(ship_client_t *c, lobby_t *l) {
             id = 0x00010000 | (c->client_id << 21) |
                 (l->highest_item[c->client_id]);
 
-            for(i = 0; i < c->item_count; ++i, ++id) {
-                c->items[i].item_id = LE32(id);
+            for(i = 0; i < c->cold->item_count; ++i, ++id) {
+                c->cold->items[i].item_id = LE32(id);
             }
 
             --id;
@@ -847,26 +1038,26 @@ static int dcnte_process_login(ship_client_t *c, dcnte_login_8b_pkt *pkt) {
     if((ship->cfg->shipgate_flags & SHIPGATE_FLAG_NODCNTE)) {
         send_message_box(c, "%s", __(c, "\tEPSO NTE is not supported on\n"
                                      "this ship.\n\nDisconnecting."));
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         return 0;
     }
 
     /* See if the user is banned */
     if(is_guildcard_banned(ship, c->guildcard, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
-    else if(is_ip_banned(ship, &c->ip_addr, &ban_reason, &ban_end)) {
+    else if(is_ip_banned(ship, &c->cold->ip_addr, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
 
     /* Save what we care about in here. */
-    c->guildcard = LE32(pkt->guildcard);
+    gcindex_set(c, LE32(pkt->guildcard));
     c->language_code = CLIENT_LANG_JAPANESE;
     c->q_lang = CLIENT_LANG_JAPANESE;
     c->flags |= CLIENT_FLAG_IS_NTE;
@@ -887,7 +1078,7 @@ static int dcnte_process_login(ship_client_t *c, dcnte_login_8b_pkt *pkt) {
     }
 
     /* Log the connection. */
-    my_ntop(&c->ip_addr, ipstr);
+    my_ntop(&c->cold->ip_addr, ipstr);
     debug(DBG_LOG, "%s(%d): DC NTE Guild Card %d connected with IP %s\n",
           ship->cfg->name, c->cur_block->b, c->guildcard, ipstr);
 
@@ -909,26 +1100,26 @@ static int dc_process_login(ship_client_t *c, dc_login_93_pkt *pkt) {
     if((ship->cfg->shipgate_flags & SHIPGATE_FLAG_NOV1)) {
         send_message_box(c, "%s", __(c, "\tEPSO Version 1 is not supported on\n"
                                      "this ship.\n\nDisconnecting."));
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         return 0;
     }
 
     /* See if the user is banned */
     if(is_guildcard_banned(ship, c->guildcard, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
-    else if(is_ip_banned(ship, &c->ip_addr, &ban_reason, &ban_end)) {
+    else if(is_ip_banned(ship, &c->cold->ip_addr, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
 
     /* Save what we care about in here. */
-    c->guildcard = LE32(pkt->guildcard);
+    gcindex_set(c, LE32(pkt->guildcard));
     c->language_code = pkt->language_code;
     c->q_lang = pkt->language_code;
 
@@ -944,12 +1135,10 @@ static int dc_process_login(ship_client_t *c, dc_login_93_pkt *pkt) {
         if(menu == MENU_ID_LOBBY) {
             menu = LE32(ext->lobby_id);
 
-            TAILQ_FOREACH(i, &c->cur_block->lobbies, qentry) {
-                if(i->lobby_id == menu && i->type == LOBBY_TYPE_LOBBY) {
-                    c->lobby_req = i;
-                    break;
-                }
-            }
+            i = block_get_lobby(c->cur_block, menu);
+
+            if(i && i->type == LOBBY_TYPE_LOBBY)
+                c->lobby_req = i;
         }
     }
 
@@ -966,7 +1155,7 @@ static int dc_process_login(ship_client_t *c, dc_login_93_pkt *pkt) {
     }
 
     /* Log the connection. */
-    my_ntop(&c->ip_addr, ipstr);
+    my_ntop(&c->cold->ip_addr, ipstr);
     debug(DBG_LOG, "%s(%d): DCv1 Guild Card %d connected with IP %s\n",
           ship->cfg->name, c->cur_block->b, c->guildcard, ipstr);
 
@@ -1001,7 +1190,7 @@ static int dcv2_process_login(ship_client_t *c, dcv2_login_9d_pkt *pkt) {
         if((ship->cfg->shipgate_flags & SHIPGATE_FLAG_NOV2)) {
             send_message_box(c, "%s", __(c, "\tEPSO Version 2 is not supported "
                                          "on\nthis ship.\n\nDisconnecting."));
-            c->flags |= CLIENT_FLAG_DISCONNECTED;
+            client_disconnect(c);
             return 0;
         }
     }
@@ -1009,7 +1198,7 @@ static int dcv2_process_login(ship_client_t *c, dcv2_login_9d_pkt *pkt) {
         if((ship->cfg->shipgate_flags & SHIPGATE_FLAG_NOPC)) {
             send_message_box(c, "%s", __(c, "\tEPSO for PC is not supported "
                                          "on\nthis ship.\n\nDisconnecting."));
-            c->flags |= CLIENT_FLAG_DISCONNECTED;
+            client_disconnect(c);
             return 0;
         }
 
@@ -1021,7 +1210,7 @@ static int dcv2_process_login(ship_client_t *c, dcv2_login_9d_pkt *pkt) {
                 send_message_box(c, "%s", __(c, "\tEPSO for PC Network Trial "
                                              "Edition\nis not supported on "
                                              "this ship.\n\nDisconnecting."));
-                c->flags |= CLIENT_FLAG_DISCONNECTED;
+                client_disconnect(c);
                 return 0;
             }
         }
@@ -1030,19 +1219,19 @@ static int dcv2_process_login(ship_client_t *c, dcv2_login_9d_pkt *pkt) {
     /* See if the user is banned */
     if(is_guildcard_banned(ship, c->guildcard, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
-    else if(is_ip_banned(ship, &c->ip_addr, &ban_reason, &ban_end)) {
+    else if(is_ip_banned(ship, &c->cold->ip_addr, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
 
     /* Save what we care about in here. */
-    c->guildcard = LE32(pkt->guildcard);
+    gcindex_set(c, LE32(pkt->guildcard));
     c->language_code = pkt->language_code;
     c->q_lang = pkt->language_code;
 
@@ -1061,12 +1250,10 @@ static int dcv2_process_login(ship_client_t *c, dcv2_login_9d_pkt *pkt) {
         if(menu == MENU_ID_LOBBY) {
             menu = LE32(extd->lobby_id);
 
-            TAILQ_FOREACH(i, &c->cur_block->lobbies, qentry) {
-                if(i->lobby_id == menu && i->type == LOBBY_TYPE_LOBBY) {
-                    c->lobby_req = i;
-                    break;
-                }
-            }
+            i = block_get_lobby(c->cur_block, menu);
+
+            if(i && i->type == LOBBY_TYPE_LOBBY)
+                c->lobby_req = i;
         }
     }
     else if(c->version == CLIENT_VERSION_PC && len == 0x0150) {
@@ -1076,12 +1263,10 @@ static int dcv2_process_login(ship_client_t *c, dcv2_login_9d_pkt *pkt) {
         if(menu == MENU_ID_LOBBY) {
             menu = LE32(extp->lobby_id);
 
-            TAILQ_FOREACH(i, &c->cur_block->lobbies, qentry) {
-                if(i->lobby_id == menu && i->type == LOBBY_TYPE_LOBBY) {
-                    c->lobby_req = i;
-                    break;
-                }
-            }
+            i = block_get_lobby(c->cur_block, menu);
+
+            if(i && i->type == LOBBY_TYPE_LOBBY)
+                c->lobby_req = i;
         }
     }
 
@@ -1098,7 +1283,7 @@ static int dcv2_process_login(ship_client_t *c, dcv2_login_9d_pkt *pkt) {
     }
 
     /* Log the connection. */
-    my_ntop(&c->ip_addr, ipstr);
+    my_ntop(&c->cold->ip_addr, ipstr);
     if(c->version == CLIENT_VERSION_DCV2)
         debug(DBG_LOG, "%s(%d): DCv2 Guild Card %d connected with IP %s\n",
               ship->cfg->name, c->cur_block->b, c->guildcard, ipstr);
@@ -1129,7 +1314,7 @@ static int gc_process_login(ship_client_t *c, gc_login_9e_pkt *pkt) {
             send_message_box(c, "%s", __(c, "\tEPSO Episode 1 & 2 is not "
                                          "supported on\nthis ship.\n\n"
                                          "Disconnecting."));
-            c->flags |= CLIENT_FLAG_DISCONNECTED;
+            client_disconnect(c);
             return 0;
         }
     }
@@ -1138,7 +1323,7 @@ static int gc_process_login(ship_client_t *c, gc_login_9e_pkt *pkt) {
             send_message_box(c, "%s", __(c, "\tEPSO Episode 3 is not "
                                          "supported on\nthis ship.\n\n"
                                          "Disconnecting."));
-            c->flags |= CLIENT_FLAG_DISCONNECTED;
+            client_disconnect(c);
             return 0;
         }
     }
@@ -1146,19 +1331,19 @@ static int gc_process_login(ship_client_t *c, gc_login_9e_pkt *pkt) {
     /* See if the user is banned */
     if(is_guildcard_banned(ship, c->guildcard, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
-    else if(is_ip_banned(ship, &c->ip_addr, &ban_reason, &ban_end)) {
+    else if(is_ip_banned(ship, &c->cold->ip_addr, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
 
     /* Save what we care about in here. */
-    c->guildcard = LE32(pkt->guildcard);
+    gcindex_set(c, LE32(pkt->guildcard));
     c->language_code = pkt->language_code;
     c->q_lang = pkt->language_code;
 
@@ -1186,12 +1371,10 @@ static int gc_process_login(ship_client_t *c, gc_login_9e_pkt *pkt) {
         if(menu == MENU_ID_LOBBY) {
             menu = LE32(ext->lobby_id);
 
-            TAILQ_FOREACH(i, &c->cur_block->lobbies, qentry) {
-                if(i->lobby_id == menu && i->type == LOBBY_TYPE_LOBBY) {
-                    c->lobby_req = i;
-                    break;
-                }
-            }
+            i = block_get_lobby(c->cur_block, menu);
+
+            if(i && i->type == LOBBY_TYPE_LOBBY)
+                c->lobby_req = i;
         }
     }
 
@@ -1208,7 +1391,7 @@ static int gc_process_login(ship_client_t *c, gc_login_9e_pkt *pkt) {
     }
 
     /* Log the connection. */
-    my_ntop(&c->ip_addr, ipstr);
+    my_ntop(&c->cold->ip_addr, ipstr);
     debug(DBG_LOG, "%s(%d): GC Guild Card %d connected with IP %s\n",
           ship->cfg->name, c->cur_block->b, c->guildcard, ipstr);
 
@@ -1227,26 +1410,26 @@ static int xb_process_login(ship_client_t *c, xb_login_9e_pkt *pkt) {
         send_message_box(c, "%s", __(c, "\tEPSO Episode 1 & 2 for Xbox "
                                      "is not supported on\nthis ship.\n\n"
                                      "Disconnecting."));
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         return 0;
     }
 
     /* See if the user is banned */
     if(is_guildcard_banned(ship, c->guildcard, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
-    else if(is_ip_banned(ship, &c->ip_addr, &ban_reason, &ban_end)) {
+    else if(is_ip_banned(ship, &c->cold->ip_addr, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
 
     /* Save what we care about in here. */
-    c->guildcard = LE32(pkt->guildcard);
+    gcindex_set(c, LE32(pkt->guildcard));
     c->language_code = pkt->language_code;
     c->q_lang = pkt->language_code;
     c->flags |= CLIENT_FLAG_GC_MSG_BOXES;
@@ -1269,7 +1452,7 @@ static int xb_process_login(ship_client_t *c, xb_login_9e_pkt *pkt) {
     }
 
     /* Log the connection. */
-    my_ntop(&c->ip_addr, ipstr);
+    my_ntop(&c->cold->ip_addr, ipstr);
     debug(DBG_LOG, "%s(%d): Xbox Guild Card %d connected with IP %s\n",
           ship->cfg->name, c->cur_block->b, c->guildcard, ipstr);
 
@@ -1287,46 +1470,46 @@ static int bb_process_login(ship_client_t *c, bb_login_93_pkt *pkt) {
         send_message_box(c, "%s", __(c, "\tEPSO Blue Burst is not "
                                         "supported on\nthis ship.\n\n"
                                         "Disconnecting."));
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         return 0;
     }
 
     /* See if the user is banned */
     if(is_guildcard_banned(ship, c->guildcard, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
-    else if(is_ip_banned(ship, &c->ip_addr, &ban_reason, &ban_end)) {
+    else if(is_ip_banned(ship, &c->cold->ip_addr, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
 
-    c->guildcard = LE32(pkt->guildcard);
+    gcindex_set(c, LE32(pkt->guildcard));
     team_id = LE32(pkt->team_id);
 
     /* See if this person is a GM. */
     c->privilege = is_gm(c->guildcard, ship);
 
     /* Copy in the security data */
-    memcpy(&c->sec_data, pkt->security_data, sizeof(bb_security_data_t));
+    memcpy(&c->cold->sec_data, pkt->security_data, sizeof(bb_security_data_t));
 
-    if(c->sec_data.magic != LE32(0xDEADBEEF)) {
+    if(c->cold->sec_data.magic != LE32(0xDEADBEEF)) {
         send_bb_security(c, 0, LOGIN_93BB_FORCED_DISCONNECT, 0, NULL, 0);
         return -1;
     }
 
     /* Send the security data packet */
     if(send_bb_security(c, c->guildcard, LOGIN_93BB_OK, team_id,
-                        &c->sec_data, sizeof(bb_security_data_t))) {
+                        &c->cold->sec_data, sizeof(bb_security_data_t))) {
         return -2;
     }
 
     /* Request the character data from the shipgate */
-    if(shipgate_send_creq(&ship->sg, c->guildcard, c->sec_data.slot)) {
+    if(shipgate_send_creq(&ship->sg, c->guildcard, c->cold->sec_data.slot)) {
         return -3;
     }
 
@@ -1336,7 +1519,7 @@ static int bb_process_login(ship_client_t *c, bb_login_93_pkt *pkt) {
     }
 
     /* Log the connection. */
-    my_ntop(&c->ip_addr, ipstr);
+    my_ntop(&c->cold->ip_addr, ipstr);
     debug(DBG_LOG, "%s(%d): BB Guild Card %d connected with IP %s\n",
           ship->cfg->name, c->cur_block->b, c->guildcard, ipstr);
 
@@ -1406,7 +1589,7 @@ static int dc_process_char(ship_client_t *c, dc_char_data_pkt *pkt) {
         memcpy(c->pl, &pkt->data, sizeof(pc_player_t));
         c->infoboard = NULL;
         c->c_rank = c->pl->pc.c_rank.all;
-        memcpy(c->blacklist, c->pl->pc.blacklist, 30 * sizeof(uint32_t));
+        memcpy(c->cold->blacklist, c->pl->pc.blacklist, 30 * sizeof(uint32_t));
     }
     else if(version == 3) {
         if(pkt->data.v3.autoreply[0]) {
@@ -1418,24 +1601,24 @@ static int dc_process_char(ship_client_t *c, dc_char_data_pkt *pkt) {
         memcpy(c->pl, &pkt->data, sizeof(v3_player_t));
         c->infoboard = c->pl->v3.infoboard;
         c->c_rank = c->pl->v3.c_rank.all;
-        memcpy(c->blacklist, c->pl->v3.blacklist, 30 * sizeof(uint32_t));
+        memcpy(c->cold->blacklist, c->pl->v3.blacklist, 30 * sizeof(uint32_t));
     }
     else if(version == 4) {
         /* XXXX: Not right, but work with it for now. */
         memcpy(c->pl, &pkt->data, sizeof(v3_player_t));
         c->infoboard = c->pl->v3.infoboard;
         c->c_rank = c->pl->v3.c_rank.all;
-        memcpy(c->blacklist, c->pl->v3.blacklist, 30 * sizeof(uint32_t));
+        memcpy(c->cold->blacklist, c->pl->v3.blacklist, 30 * sizeof(uint32_t));
     }
 
     /* Copy out the inventory data */
-    memcpy(c->items, c->pl->v1.inv.items, sizeof(item_t) * 30);
-    c->item_count = (int)c->pl->v1.inv.item_count;
+    memcpy(c->cold->items, c->pl->v1.inv.items, sizeof(item_t) * 30);
+    c->cold->item_count = (int)c->pl->v1.inv.item_count;
 
     /* Renumber the inventory data so we know what's going on later */
-    for(i = 0; i < c->item_count; ++i) {
+    for(i = 0; i < c->cold->item_count; ++i) {
         v = 0x00210000 | i;
-        c->items[i].item_id = LE32(v);
+        c->cold->items[i].item_id = LE32(v);
     }
 
     /* If this packet is coming after the client has left a game, then don't
@@ -1520,16 +1703,16 @@ static int bb_process_char(ship_client_t *c, bb_char_data_pkt *pkt) {
     memcpy(c->pl, &pkt->data, sizeof(sylverant_bb_player_t));
     c->infoboard = (char *)c->pl->bb.infoboard;
     c->c_rank = c->pl->bb.c_rank;
-    memcpy(c->blacklist, c->pl->bb.blacklist, 30 * sizeof(uint32_t));
+    memcpy(c->cold->blacklist, c->pl->bb.blacklist, 30 * sizeof(uint32_t));
 
     /* Copy out the inventory data */
-    memcpy(c->items, c->pl->bb.inv.items, sizeof(item_t) * 30);
-    c->item_count = (int)c->pl->bb.inv.item_count;
+    memcpy(c->cold->items, c->pl->bb.inv.items, sizeof(item_t) * 30);
+    c->cold->item_count = (int)c->pl->bb.inv.item_count;
 
     /* Renumber the inventory data so we know what's going on later */
-    for(i = 0; i < c->item_count; ++i) {
+    for(i = 0; i < c->cold->item_count; ++i) {
         v = 0x00210000 | i;
-        c->items[i].item_id = LE32(v);
+        c->cold->items[i].item_id = LE32(v);
     }
 
     /* If this packet is coming after the client has left a game, then don't
@@ -1588,7 +1771,7 @@ static int bb_process_char(ship_client_t *c, bb_char_data_pkt *pkt) {
 
 /* Process a change lobby packet. */
 static int process_change_lobby(ship_client_t *c, uint32_t item_id) {
-    lobby_t *i, *req = NULL;
+    lobby_t *req;
     int rv;
 
     /* Make sure they don't have the protection flag on */
@@ -1598,26 +1781,16 @@ static int process_change_lobby(ship_client_t *c, uint32_t item_id) {
                                 "lobbies."));
     }
 
-    pthread_rwlock_rdlock(&c->cur_block->lobby_lock);
-
-    TAILQ_FOREACH(i, &c->cur_block->lobbies, qentry) {
-        if(i->lobby_id == item_id) {
-            req = i;
-            break;
-        }
-    }
-
-    /* The requested lobby is non-existant? What to do... */
-    if(req == NULL) {
-        pthread_rwlock_unlock(&c->cur_block->lobby_lock);
+    /* Only the default lobbies show up in the lobby menu, and they never go
+       away, so there's no need to hold the lobby_lock to look them up. */
+    if(item_id < 1 || item_id > LOBBY_DEFAULT_COUNT) {
         return send_message1(c, "%s\n\n%s", __(c, "\tE\tC4Can't change lobby!"),
                              __(c, "\tC7The lobby is non-\nexistant."));
     }
 
+    req = c->cur_block->default_lobbies[item_id - 1];
     rv = lobby_change_lobby(c, req);
 
-    pthread_rwlock_unlock(&c->cur_block->lobby_lock);
-
     if(rv == -1) {
         return send_message1(c, "%s\n\n%s", __(c, "\tE\tC4Can't change lobby!"),
                              __(c, "\tC7The lobby is full."));
@@ -1802,8 +1975,8 @@ static int bb_process_chat(ship_client_t *c, bb_chat_pkt *pkt) {
 
 /* Process a Guild Search request. */
 static int dc_process_guild_search(ship_client_t *c, dc_guild_search_pkt *pkt) {
-    int i;
     ship_client_t *it;
+    block_t *b;
     uint32_t gc = LE32(pkt->gc_target);
     int done = 0, rv = -1;
     uint32_t flags = 0;
@@ -1819,44 +1992,30 @@ static int dc_process_guild_search(ship_client_t *c, dc_guild_search_pkt *pkt) {
         return 0;
 
     /* Search the local ship first. */
-    for(i = 0; i < ship->cfg->blocks && !done; ++i) {
-        if(!ship->blocks[i] || !ship->blocks[i]->run) {
-            continue;
-        }
-
-        pthread_rwlock_rdlock(&ship->blocks[i]->lock);
-
-        /* Look through all clients on that block. */
-        TAILQ_FOREACH(it, ship->blocks[i]->clients, qentry) {
-            /* Check if this is the target and the target has player
-               data. */
-            if(it->guildcard == gc && it->pl) {
-                pthread_mutex_lock(&it->mutex);
+    if((it = gcindex_find_any(gc, &b))) {
+        /* Check if the target has player data. If they're on but don't have
+           data, we're not going to find them anywhere else, so return success
+           either way. */
+        if(it->pl) {
+            pthread_mutex_lock(&it->mutex);
 #ifdef SYLVERANT_ENABLE_IPV6
-                if((c->flags & CLIENT_FLAG_IPV6)) {
-                    rv = send_guild_reply6(c, it);
-                }
-                else {
-                    rv = send_guild_reply(c, it);
-                }
-#else
-                rv = send_guild_reply(c, it);
-#endif
-                done = 1;
-                pthread_mutex_unlock(&it->mutex);
+            if((c->flags & CLIENT_FLAG_IPV6)) {
+                rv = send_guild_reply6(c, it);
             }
-            else if(it->guildcard == gc) {
-                /* If they're on but don't have data, we're not going to
-                   find them anywhere else, return success. */
-                rv = 0;
-                done = 1;
+            else {
+                rv = send_guild_reply(c, it);
             }
-
-            if(done)
-                break;
+#else
+            rv = send_guild_reply(c, it);
+#endif
+            pthread_mutex_unlock(&it->mutex);
+        }
+        else {
+            rv = 0;
         }
 
-        pthread_rwlock_unlock(&ship->blocks[i]->lock);
+        done = 1;
+        pthread_rwlock_unlock(&b->lock);
     }
 
     /* If we get here, we didn't find it locally. Send to the shipgate to
@@ -1875,8 +2034,8 @@ static int dc_process_guild_search(ship_client_t *c, dc_guild_search_pkt *pkt) {
 }
 
 static int bb_process_guild_search(ship_client_t *c, bb_guild_search_pkt *pkt) {
-    int i;
     ship_client_t *it;
+    block_t *b;
     uint32_t gc = LE32(pkt->gc_target);
     int done = 0, rv = -1;
     uint32_t flags = 0;
@@ -1892,44 +2051,30 @@ static int bb_process_guild_search(ship_client_t *c, bb_guild_search_pkt *pkt) {
         return 0;
 
     /* Search the local ship first. */
-    for(i = 0; i < ship->cfg->blocks && !done; ++i) {
-        if(!ship->blocks[i] || !ship->blocks[i]->run) {
-            continue;
-        }
-
-        pthread_rwlock_rdlock(&ship->blocks[i]->lock);
-
-        /* Look through all clients on that block. */
-        TAILQ_FOREACH(it, ship->blocks[i]->clients, qentry) {
-            /* Check if this is the target and the target has player
-               data. */
-            if(it->guildcard == gc && it->pl) {
-                pthread_mutex_lock(&it->mutex);
+    if((it = gcindex_find_any(gc, &b))) {
+        /* Check if the target has player data. If they're on but don't have
+           data, we're not going to find them anywhere else, so return success
+           either way. */
+        if(it->pl) {
+            pthread_mutex_lock(&it->mutex);
 #ifdef SYLVERANT_ENABLE_IPV6
-                if((c->flags & CLIENT_FLAG_IPV6)) {
-                    rv = send_guild_reply6(c, it);
-                }
-                else {
-                    rv = send_guild_reply(c, it);
-                }
-#else
-                rv = send_guild_reply(c, it);
-#endif
-                done = 1;
-                pthread_mutex_unlock(&it->mutex);
+            if((c->flags & CLIENT_FLAG_IPV6)) {
+                rv = send_guild_reply6(c, it);
             }
-            else if(it->guildcard == gc) {
-                /* If they're on but don't have data, we're not going to
-                   find them anywhere else, return success. */
-                rv = 0;
-                done = 1;
+            else {
+                rv = send_guild_reply(c, it);
             }
-
-            if(done)
-                break;
+#else
+            rv = send_guild_reply(c, it);
+#endif
+            pthread_mutex_unlock(&it->mutex);
+        }
+        else {
+            rv = 0;
         }
 
-        pthread_rwlock_unlock(&ship->blocks[i]->lock);
+        done = 1;
+        pthread_rwlock_unlock(&b->lock);
     }
 
     /* If we get here, we didn't find it locally. Send to the shipgate to
@@ -1948,8 +2093,8 @@ static int bb_process_guild_search(ship_client_t *c, bb_guild_search_pkt *pkt) {
 }
 
 static int dc_process_mail(ship_client_t *c, dc_simple_mail_pkt *pkt) {
-    int i;
     ship_client_t *it;
+    block_t *b;
     uint32_t gc = LE32(pkt->gc_dest);
     int done = 0, rv = -1;
 
@@ -1976,50 +2121,34 @@ static int dc_process_mail(ship_client_t *c, dc_simple_mail_pkt *pkt) {
         return 0;
 
     /* Search the local ship first. */
-    for(i = 0; i < ship->cfg->blocks && !done; ++i) {
-        if(!ship->blocks[i] || !ship->blocks[i]->run) {
-            continue;
-        }
-
-        pthread_rwlock_rdlock(&ship->blocks[i]->lock);
-
-        /* Look through all clients on that block. */
-        TAILQ_FOREACH(it, ship->blocks[i]->clients, qentry) {
-            /* Check if this is the target and the target has player
-               data. */
-            if(it->guildcard == gc && it->pl) {
-                pthread_mutex_lock(&it->mutex);
-
-                /* Make sure the user hasn't blacklisted the sender. */
-                if(client_has_blacklisted(it, c->guildcard) ||
-                   client_has_ignored(it, c->guildcard)) {
-                    done = 1;
-                    pthread_mutex_unlock(&it->mutex);
-                    rv = 0;
-                    break;
-                }
-
+    if((it = gcindex_find_any(gc, &b))) {
+        /* Check if the target has player data. If they're on but don't have
+           data, we're not going to find them anywhere else, so return success
+           either way. */
+        if(it->pl) {
+            pthread_mutex_lock(&it->mutex);
+            /* Make sure the user hasn't blacklisted the sender. */
+            if(client_has_blacklisted(it, c->guildcard) ||
+               client_has_ignored(it, c->guildcard)) {
+                rv = 0;
+            }
+            else {
                 /* Check if the user has an autoreply set. */
-                if(it->autoreply_on) {
+                if(it->cold->autoreply_on) {
                     send_mail_autoreply(c, it);
                 }
 
-                /* Send the mail. */
-                rv = send_simple_mail(c->version, it, (dc_pkt_hdr_t *)pkt);
-                pthread_mutex_unlock(&it->mutex);
-                done = 1;
-                break;
-            }
-            else if(it->guildcard == gc) {
-                /* If they're on but don't have data, we're not going to
-                   find them anywhere else, return success. */
-                rv = 0;
-                done = 1;
-                break;
+                rv = send_simple_mail(c->version, it,
+                                      (dc_pkt_hdr_t *)pkt);
             }
+            pthread_mutex_unlock(&it->mutex);
+        }
+        else {
+            rv = 0;
         }
 
-        pthread_rwlock_unlock(&ship->blocks[i]->lock);
+        done = 1;
+        pthread_rwlock_unlock(&b->lock);
     }
 
     if(!done) {
@@ -2032,8 +2161,8 @@ static int dc_process_mail(ship_client_t *c, dc_simple_mail_pkt *pkt) {
 }
 
 static int pc_process_mail(ship_client_t *c, pc_simple_mail_pkt *pkt) {
-    int i;
     ship_client_t *it;
+    block_t *b;
     uint32_t gc = LE32(pkt->gc_dest);
     int done = 0, rv = -1;
 
@@ -2060,49 +2189,34 @@ static int pc_process_mail(ship_client_t *c, pc_simple_mail_pkt *pkt) {
         return 0;
 
     /* Search the local ship first. */
-    for(i = 0; i < ship->cfg->blocks && !done; ++i) {
-        if(!ship->blocks[i] || !ship->blocks[i]->run) {
-            continue;
-        }
-
-        pthread_rwlock_rdlock(&ship->blocks[i]->lock);
-
-        /* Look through all clients on that block. */
-        TAILQ_FOREACH(it, ship->blocks[i]->clients, qentry) {
-            /* Check if this is the target and the target has player
-               data. */
-            if(it->guildcard == gc && it->pl) {
-                pthread_mutex_lock(&it->mutex);
-
-                /* Make sure the user hasn't blacklisted the sender. */
-                if(client_has_blacklisted(it, c->guildcard) ||
-                   client_has_ignored(it, c->guildcard)) {
-                    done = 1;
-                    pthread_mutex_unlock(&it->mutex);
-                    rv = 0;
-                    break;
-                }
-
+    if((it = gcindex_find_any(gc, &b))) {
+        /* Check if the target has player data. If they're on but don't have
+           data, we're not going to find them anywhere else, so return success
+           either way. */
+        if(it->pl) {
+            pthread_mutex_lock(&it->mutex);
+            /* Make sure the user hasn't blacklisted the sender. */
+            if(client_has_blacklisted(it, c->guildcard) ||
+               client_has_ignored(it, c->guildcard)) {
+                rv = 0;
+            }
+            else {
                 /* Check if the user has an autoreply set. */
-                if(it->autoreply_on) {
+                if(it->cold->autoreply_on) {
                     send_mail_autoreply(c, it);
                 }
 
-                rv = send_simple_mail(c->version, it, (dc_pkt_hdr_t *)pkt);
-                pthread_mutex_unlock(&it->mutex);
-                done = 1;
-                break;
-            }
-            else if(it->guildcard == gc) {
-                /* If they're on but don't have data, we're not going to
-                   find them anywhere else, return success. */
-                rv = 0;
-                done = 1;
-                break;
+                rv = send_simple_mail(c->version, it,
+                                      (dc_pkt_hdr_t *)pkt);
             }
+            pthread_mutex_unlock(&it->mutex);
+        }
+        else {
+            rv = 0;
         }
 
-        pthread_rwlock_unlock(&ship->blocks[i]->lock);
+        done = 1;
+        pthread_rwlock_unlock(&b->lock);
     }
 
     if(!done) {
@@ -2115,8 +2229,8 @@ static int pc_process_mail(ship_client_t *c, pc_simple_mail_pkt *pkt) {
 }
 
 static int bb_process_mail(ship_client_t *c, bb_simple_mail_pkt *pkt) {
-    int i;
     ship_client_t *it;
+    block_t *b;
     uint32_t gc = LE32(pkt->gc_dest);
     int done = 0, rv = -1;
 
@@ -2143,49 +2257,33 @@ static int bb_process_mail(ship_client_t *c, bb_simple_mail_pkt *pkt) {
         return 0;
 
     /* Search the local ship first. */
-    for(i = 0; i < ship->cfg->blocks && !done; ++i) {
-        if(!ship->blocks[i] || !ship->blocks[i]->run) {
-            continue;
-        }
-
-        pthread_rwlock_rdlock(&ship->blocks[i]->lock);
-
-        /* Look through all clients on that block. */
-        TAILQ_FOREACH(it, ship->blocks[i]->clients, qentry) {
-            /* Check if this is the target and the target has player
-               data. */
-            if(it->guildcard == gc && it->pl) {
-                pthread_mutex_lock(&it->mutex);
-
-                /* Make sure the user hasn't blacklisted the sender. */
-                if(client_has_blacklisted(it, c->guildcard) ||
-                   client_has_ignored(it, c->guildcard)) {
-                    done = 1;
-                    pthread_mutex_unlock(&it->mutex);
-                    rv = 0;
-                    break;
-                }
-
+    if((it = gcindex_find_any(gc, &b))) {
+        /* Check if the target has player data. If they're on but don't have
+           data, we're not going to find them anywhere else, so return success
+           either way. */
+        if(it->pl) {
+            pthread_mutex_lock(&it->mutex);
+            /* Make sure the user hasn't blacklisted the sender. */
+            if(client_has_blacklisted(it, c->guildcard) ||
+               client_has_ignored(it, c->guildcard)) {
+                rv = 0;
+            }
+            else {
                 /* Check if the user has an autoreply set. */
-                if(it->autoreply_on) {
+                if(it->cold->autoreply_on) {
                     send_mail_autoreply(c, it);
                 }
 
                 rv = send_bb_simple_mail(it, pkt);
-                pthread_mutex_unlock(&it->mutex);
-                done = 1;
-                break;
-            }
-            else if(it->guildcard == gc) {
-                /* If they're on but don't have data, we're not going to
-                   find them anywhere else, return success. */
-                rv = 0;
-                done = 1;
-                break;
             }
+            pthread_mutex_unlock(&it->mutex);
+        }
+        else {
+            rv = 0;
         }
 
-        pthread_rwlock_unlock(&ship->blocks[i]->lock);
+        done = 1;
+        pthread_rwlock_unlock(&b->lock);
     }
 
     if(!done) {
@@ -2907,6 +3005,9 @@ static int process_menu(ship_client_t *c, uint32_t menu_id, uint32_t item_id,
             lobby_t *l = c->create_lobby;
 
             if(l) {
+                /* The game isn't on the block yet, so nothing else can see
+                   these fields. Adding it below bumps the block's game list
+                   generation, which picks them up. */
                 if(item_id == 0) {
                     l->v2 = 0;
                     l->version = CLIENT_VERSION_DCV1;
@@ -2917,9 +3018,8 @@ static int process_menu(ship_client_t *c, uint32_t menu_id, uint32_t item_id,
 
                 /* Add the lobby to the list of lobbies on the block. */
                 pthread_rwlock_wrlock(&c->cur_block->lobby_lock);
-                TAILQ_INSERT_TAIL(&c->cur_block->lobbies, l, qentry);
+                block_add_lobby_locked(c->cur_block, l);
                 ship_inc_games(ship);
-                ++c->cur_block->num_games;
                 pthread_rwlock_unlock(&c->cur_block->lobby_lock);
                 c->create_lobby = NULL;
 
@@ -3089,13 +3189,13 @@ static int process_trade(ship_client_t *c, gc_trade_pkt *pkt) {
 /* Process a blacklist update packet. */
 static int gc_process_blacklist(ship_client_t *c,
                                 gc_blacklist_update_pkt *pkt) {
-    memcpy(c->blacklist, pkt->list, 30 * sizeof(uint32_t));
+    memcpy(c->cold->blacklist, pkt->list, 30 * sizeof(uint32_t));
     return send_txt(c, "%s", __(c, "\tE\tC7Updated blacklist."));
 }
 
 static int bb_process_blacklist(ship_client_t *c,
                                 bb_blacklist_update_pkt *pkt) {
-    memcpy(c->blacklist, pkt->list, 28 * sizeof(uint32_t));
+    memcpy(c->cold->blacklist, pkt->list, 28 * sizeof(uint32_t));
     memcpy(c->pl->bb.blacklist, pkt->list, 28 * sizeof(uint32_t));
     memcpy(c->bb_opts->blocked, pkt->list, 28 * sizeof(uint32_t));
     return send_txt(c, "%s", __(c, "\tE\tC7Updated blacklist."));
@@ -3285,7 +3385,7 @@ static int process_qload_done(ship_client_t *c) {
     for(i = 0; i < l->max_clients; ++i) {
         if((c2 = l->clients[i]) && c2->version >= CLIENT_VERSION_GC) {
             if(send_simple(c2, QUEST_LOAD_DONE_TYPE, 0))
-                c2->flags |= CLIENT_FLAG_DISCONNECTED;
+                client_disconnect(c2);
         }
     }
 
@@ -3405,16 +3505,10 @@ ship_client_t *block_find_client(block_t *b, uint32_t gc) {
     ship_client_t *it;
 
     pthread_rwlock_rdlock(&b->lock);
-
-    TAILQ_FOREACH(it, b->clients, qentry) {
-        if(it->guildcard == gc) {
-            pthread_rwlock_unlock(&b->lock);
-            return it;
-        }
-    }
-
+    it = gcindex_find(b, gc);
     pthread_rwlock_unlock(&b->lock);
-    return NULL;
+
+    return it;
 }
 
 /* Process block commands for a Dreamcast client. */
@@ -3476,9 +3570,9 @@ static int dc_process_pkt(ship_client_t *c, uint8_t *pkt) {
                !(c->flags & CLIENT_FLAG_LEGIT)) {
                 sylverant_limits_t *limits;
 
-                pthread_rwlock_rdlock(&ship->llock);
-                if(!ship->def_limits) {
-                    pthread_rwlock_unlock(&ship->llock);
+                epoch_enter();
+                if(!(limits = EPOCH_DEREF(ship->limits)->def)) {
+                    epoch_exit();
                     c->flags &= ~CLIENT_FLAG_ALWAYS_LEGIT;
                     send_txt(c, "%s", __(c, "\tE\tC7Legit mode not\n"
                                             "available on this\n"
@@ -3486,8 +3580,6 @@ static int dc_process_pkt(ship_client_t *c, uint8_t *pkt) {
                     return 0;
                 }
 
-                limits = ship->def_limits;
-
                 if(client_legit_check(c, limits)) {
                     c->flags &= ~CLIENT_FLAG_ALWAYS_LEGIT;
                     send_txt(c, "%s", __(c, "\tE\tC7You failed the legit "
@@ -3499,7 +3591,7 @@ static int dc_process_pkt(ship_client_t *c, uint8_t *pkt) {
                     c->limits = retain(limits);
                 }
 
-                pthread_rwlock_unlock(&ship->llock);
+                epoch_exit();
             }
 
             if(c->flags & CLIENT_FLAG_WAIT_QPING) {
@@ -3524,7 +3616,7 @@ static int dc_process_pkt(ship_client_t *c, uint8_t *pkt) {
         case TYPE_05:
             /* If we've already gotten one of these, disconnect the client. */
             if(c->flags & CLIENT_FLAG_GOT_05) {
-                c->flags |= CLIENT_FLAG_DISCONNECTED;
+                client_disconnect(c);
             }
 
             c->flags |= CLIENT_FLAG_GOT_05;
@@ -3711,7 +3803,7 @@ static int bb_process_pkt(ship_client_t *c, uint8_t *pkt) {
             return 0;
 
         case TYPE_05:
-            c->flags |= CLIENT_FLAG_DISCONNECTED;
+            client_disconnect(c);
             return 0;
 
         case LOGIN_93_TYPE:
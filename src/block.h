@@ -1,6 +1,6 @@
 /*
     Sylverant Ship Server
-    Copyright (C) 2009, 2010, 2011, 2012, 2017 Lawrence Sebald
+    Copyright (C) 2009, 2010, 2011, 2012, 2017, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -20,17 +20,127 @@
 
 #include <pthread.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <sys/queue.h>
 
 #include <sylverant/config.h>
-#include <sylverant/mtwist.h>
 
 #include "lobby.h"
+#include "evloop.h"
+#include "timers.h"
+#include "mtrand.h"
 
 /* Forward declarations. */
 struct ship;
 struct client_queue;
+struct client_pools;
+struct mempool;
 struct ship_client;
 
+/* Six versions, each potentially listening on both IPv4 and IPv6, plus the
+   pipe used to wake up the worker thread. */
+#define BLOCK_MAX_LISTENERS     13
+
+TAILQ_HEAD(client_flush_queue, ship_client);
+
+/* Number of buckets in each block's table of lobbies by id. Game ids are handed
+   out sequentially, so they spread evenly over the buckets. */
+#define BLOCK_LOBBY_BUCKETS     256
+
+/* The different ways that the list of games on a block gets filtered for the
+   clients looking at it. Each of these gets its own cached packet. */
+#define BLOCK_GAME_LIST_DCV1        0
+#define BLOCK_GAME_LIST_DCV1_NTE    1
+#define BLOCK_GAME_LIST_DCV2        2
+#define BLOCK_GAME_LIST_DCV2_NTE    3
+#define BLOCK_GAME_LIST_PC          4
+#define BLOCK_GAME_LIST_PC_NTE      5
+#define BLOCK_GAME_LIST_GC          6
+#define BLOCK_GAME_LIST_GC_DCPC     7
+#define BLOCK_GAME_LIST_EP3         8
+#define BLOCK_GAME_LIST_BB          9
+#define BLOCK_GAME_LISTS            10
+
+/* A game list packet, ready to be copied out and sent. It is only good as long
+   as gen matches the block's game_list_gen. */
+typedef struct block_game_list {
+    uint8_t *pkt;
+    int len;
+    int size;
+    uint32_t gen;
+} block_game_list_t;
+
+/* The most worker threads a single block may be split across. */
+#define BLOCK_MAX_WORKERS       32
+
+struct block_worker;
+struct block_msg;
+
+typedef void (*block_msg_cb)(struct block_worker *w, struct block_msg *m);
+
+/* Something for a worker to do on behalf of another thread. Rather than
+   reaching into clients that belong to a worker (and fighting it for their
+   locks), other threads put one of these in the worker's mailbox and let the
+   worker take care of it on its own thread. The callback is run with the
+   block's client list read-locked, and the message is freed afterwards. */
+typedef struct block_msg {
+    struct block_msg *next;
+    block_msg_cb callback;
+    uint32_t gc;                        /* Target client, if there is one. */
+    int arg;
+    size_t len;
+    uint8_t data[];
+} block_msg_t;
+
+/* A socket owned by the block itself (rather than a client) that is registered
+   with a worker's event loop. */
+typedef struct block_listener {
+    int sock;
+    int version;                        /* -1 for the wakeup pipe. */
+} block_listener_t;
+
+/* A thread serving a block. When a block has more than one of these, each one
+   has its own set of listening sockets bound with SO_REUSEPORT, so the kernel
+   spreads new connections across them. A worker only does I/O, timers and
+   cleanup for the clients it accepted itself, but the client list and the
+   lobbies are still shared by the whole block (under lock and lobby_lock). */
+typedef struct block_worker {
+    struct block *block;
+    pthread_t thd;
+    int id;
+
+    int pipes[2];
+
+    /* Event loop that all of the worker's sockets are registered with. */
+    evloop_t *evl;
+    block_listener_t listeners[BLOCK_MAX_LISTENERS];
+    int num_listeners;
+
+    /* Ping/timeout timers for the worker's clients. */
+    timer_wheel_t timers;
+
+    /* Clients with output queued up to be sent at the end of this pass through
+       the worker's loop. */
+    struct client_flush_queue flush_queue;
+
+    /* Clients whose keystream should be topped up once the pass is over. */
+    struct client_flush_queue refill_queue;
+
+    /* Random number generator state for anything running on this thread. */
+    mtrand_t rng;
+
+    /* Messages posted by other threads. This is a lock-free stack that other
+       threads push onto and the worker takes everything off of at once. */
+    block_msg_t *mailbox;
+
+    /* The worker's clients that have been flagged for disconnection, pushed on
+       by client_disconnect() the same way as the mailbox. */
+    struct ship_client *dead_list;
+
+    /* The worker's clients that other workers have queued packets for. */
+    struct ship_client *pend_list;
+} block_worker_t;
+
 #ifndef SHIP_CLIENT_DEFINED
 #define SHIP_CLIENT_DEFINED
 typedef struct ship_client ship_client_t;
@@ -44,8 +154,6 @@ typedef struct ship ship_t;
 struct block {
     ship_t *ship;
 
-    pthread_t thd;
-
     /* Reader-writer lock for the client tailqueue */
     pthread_rwlock_t lock;
     struct client_queue *clients;
@@ -53,14 +161,16 @@ struct block {
 
     int b;
     int run;
-    int dcsock[2];
-    int pcsock[2];
-    int gcsock[2];
-    int ep3sock[2];
-    int bbsock[2];
-    int xbsock[2];
 
-    int pipes[2];
+    /* Where memory for this block's clients comes from. */
+    struct client_pools *client_pools;
+
+    /* Where the items on the floor in the block's games come from. */
+    struct mempool *item_pool;
+
+    /* The threads serving this block. */
+    block_worker_t *workers;
+    int num_workers;
 
     uint16_t dc_port;
     uint16_t pc_port;
@@ -69,13 +179,32 @@ struct block {
     uint16_t bb_port;
     uint16_t xb_port;
 
-    /* Reader-writer lock for the lobby tailqueue */
+    /* Reader-writer lock for the lobby tailqueue, the id table and the list of
+       games. This is always taken before any lobby's mutex, never while one is
+       held. */
     pthread_rwlock_t lobby_lock;
     struct lobby_queue lobbies;
+    lobby_t *lobby_table[BLOCK_LOBBY_BUCKETS];
+
+    /* The default lobbies, by id (minus one). These are set up with the block
+       and stick around until it shuts down, so they can be looked at without
+       holding lobby_lock. */
+    lobby_t *default_lobbies[LOBBY_DEFAULT_COUNT];
+
+    /* Just the games (no default lobbies), in the order they were made. This is
+       what gets walked to build game lists. */
+    struct lobby_game_queue games;
     int num_games;
 
-    /* Random number generator state */
-    struct mt19937_state rng;
+    /* Cached game list packets. Anything that changes what would show up in
+       one of them bumps game_list_gen, which marks all of them out of date. */
+    pthread_rwlock_t game_list_lock;
+    uint32_t game_list_gen;
+    block_game_list_t game_lists[BLOCK_GAME_LISTS];
+
+    /* Random number generator state, for use by threads other than the
+       block's own workers. */
+    mtrand_t rng;
 };
 
 #ifndef BLOCK_DEFINED
@@ -85,9 +214,52 @@ typedef struct block block_t;
 
 block_t *block_server_start(ship_t *s, int b, uint16_t port);
 void block_server_stop(block_t *b);
+
+/* Grab the worker running on the calling thread, if there is one. */
+block_worker_t *block_current_worker(void);
+
+/* Grab the random number generator that the calling thread should use with the
+   given block. */
+mtrand_t *block_rng(block_t *b);
+
+/* Allocate a message with a copy of the given data. */
+block_msg_t *block_msg_alloc(block_msg_cb cb, uint32_t gc, int arg,
+                             const void *data, size_t len);
+
+/* Put a message in a worker's mailbox and wake the worker up if need be. The
+   worker takes ownership of the message. Safe to call from any thread. */
+void block_msg_post(block_worker_t *w, block_msg_t *m);
+
+/* Send a message to the worker that owns the client with the given guild card
+   number, on the given block or on any block if b is NULL. Returns -1 if there
+   is no such client. */
+int block_msg_send(block_t *b, uint32_t gc, block_msg_cb cb, int arg,
+                   const void *data, size_t len);
+
+/* Send a copy of a message to every worker of every running block. */
+int block_msg_broadcast(block_msg_cb cb, int arg, const void *data,
+                        size_t len);
+
+/* Find the client a message is targeted at, if it's still connected to the
+   worker running the message. */
+ship_client_t *block_msg_target(block_worker_t *w, block_msg_t *m);
+
 int block_process_pkt(ship_client_t *c, uint8_t *pkt);
 
+/* Look up a lobby on the block by its id. The _locked version requires that
+   the caller hold the block's lobby_lock. */
 lobby_t *block_get_lobby(block_t *b, uint32_t lobby_id);
+lobby_t *block_get_lobby_locked(block_t *b, uint32_t lobby_id);
+
+/* Add a lobby to or remove it from the block's lobby list, id table and list of
+   games. The caller must hold the block's lobby_lock for writing. */
+void block_add_lobby_locked(block_t *b, lobby_t *l);
+void block_remove_lobby_locked(block_t *b, lobby_t *l);
+
+/* Mark the cached game lists for the block as out of date. This should be
+   called after a game is changed in any way that shows up in the list (its
+   name, password, flags or number of players). Safe to call from anywhere. */
+void block_game_list_changed(block_t *b);
 int block_info_reply(ship_client_t *c, uint32_t block);
 
 ship_client_t *block_find_client(block_t *b, uint32_t gc);
@@ -0,0 +1,428 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sylverant/debug.h>
+
+#include "cipher.h"
+#include "mempool.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CIPHER_X86
+#include <immintrin.h>
+#endif
+
+/* How many keystream buffers to allocate at once when the pool runs dry. */
+#define KS_PER_SLAB         32
+
+/* The PC keystream is words 1 through 55 of the key table, remixed every time
+   they run out. The GC keystream is the whole of its table, and each word of
+   the table gets mixed with the one GC_LAG words before it. */
+#define PC_KEYS             56
+#define GC_LAG              32
+
+/* The Blue Burst round function. The key schedule has the 18 round keys first,
+   followed by four 256 entry substitution tables. */
+#define BB_SBOX0            0x012
+#define BB_SBOX1            0x112
+#define BB_SBOX2            0x212
+#define BB_SBOX3            0x312
+
+#define BB_F(k, x) \
+    ((((k)[BB_SBOX0 + ((x) >> 24)] + (k)[BB_SBOX1 + (((x) >> 16) & 0xFF)]) ^ \
+      (k)[BB_SBOX2 + (((x) >> 8) & 0xFF)]) + (k)[BB_SBOX3 + ((x) & 0xFF)])
+
+typedef void (*xor_func_t)(uint8_t *d, const uint8_t *k, int len);
+typedef void (*bb_func_t)(const uint32_t *k, const uint32_t *p, uint8_t *d,
+                          int blocks);
+
+static mempool_t *ks_pool = NULL;
+static xor_func_t xor_func = NULL;
+static const char *xor_name = NULL;
+static int use_keystream = 0;
+static bb_func_t bb_func = NULL;
+static const char *bb_name = NULL;
+
+static void xor_scalar(uint8_t *d, const uint8_t *k, int len) {
+    uint64_t a, b;
+
+    while(len >= 8) {
+        memcpy(&a, d, 8);
+        memcpy(&b, k, 8);
+        a ^= b;
+        memcpy(d, &a, 8);
+        d += 8;
+        k += 8;
+        len -= 8;
+    }
+
+    while(len--) {
+        *d++ ^= *k++;
+    }
+}
+
+#ifdef CIPHER_X86
+__attribute__((target("sse2")))
+static void xor_sse2(uint8_t *d, const uint8_t *k, int len) {
+    __m128i a, b;
+
+    while(len >= 16) {
+        a = _mm_loadu_si128((const __m128i *)d);
+        b = _mm_loadu_si128((const __m128i *)k);
+        _mm_storeu_si128((__m128i *)d, _mm_xor_si128(a, b));
+        d += 16;
+        k += 16;
+        len -= 16;
+    }
+
+    xor_scalar(d, k, len);
+}
+
+__attribute__((target("avx2")))
+static void xor_avx2(uint8_t *d, const uint8_t *k, int len) {
+    __m256i a, b;
+
+    while(len >= 32) {
+        a = _mm256_loadu_si256((const __m256i *)d);
+        b = _mm256_loadu_si256((const __m256i *)k);
+        _mm256_storeu_si256((__m256i *)d, _mm256_xor_si256(a, b));
+        d += 32;
+        k += 32;
+        len -= 32;
+    }
+
+    xor_sse2(d, k, len);
+}
+
+/* Encrypt or decrypt whole 8 byte Blue Burst blocks, one at a time. The round
+   keys in p are in the order they get used, so decrypting is just a matter of
+   passing them in reverse. */
+static void bb_scalar(const uint32_t *k, const uint32_t *p, uint8_t *d,
+                      int blocks) {
+    uint32_t l, r;
+
+    while(blocks--) {
+        memcpy(&l, d, 4);
+        memcpy(&r, d + 4, 4);
+
+        l ^= p[0];
+        r ^= BB_F(k, l) ^ p[1];
+        l ^= BB_F(k, r) ^ p[2];
+        r ^= BB_F(k, l) ^ p[3];
+        l ^= BB_F(k, r) ^ p[4];
+        r ^= p[5];
+
+        memcpy(d, &r, 4);
+        memcpy(d + 4, &l, 4);
+        d += 8;
+    }
+}
+
+__attribute__((target("avx2")))
+static inline __m256i bb_f_avx2(const uint32_t *k, __m256i x) {
+    const __m256i m = _mm256_set1_epi32(0xFF);
+    __m256i a, b, c, d;
+
+    a = _mm256_i32gather_epi32((const int *)(k + BB_SBOX0),
+                               _mm256_srli_epi32(x, 24), 4);
+    b = _mm256_i32gather_epi32((const int *)(k + BB_SBOX1),
+                               _mm256_and_si256(_mm256_srli_epi32(x, 16), m),
+                               4);
+    c = _mm256_i32gather_epi32((const int *)(k + BB_SBOX2),
+                               _mm256_and_si256(_mm256_srli_epi32(x, 8), m),
+                               4);
+    d = _mm256_i32gather_epi32((const int *)(k + BB_SBOX3),
+                               _mm256_and_si256(x, m), 4);
+
+    return _mm256_add_epi32(_mm256_xor_si256(_mm256_add_epi32(a, b), c), d);
+}
+
+/* Do eight blocks at a time, with the left and right halves of the blocks each
+   in their own vector. The order the blocks end up in within the vectors
+   doesn't matter, as long as they're put back the same way. */
+__attribute__((target("avx2")))
+static void bb_avx2(const uint32_t *k, const uint32_t *p, uint8_t *d,
+                    int blocks) {
+    __m256 v0, v1;
+    __m256i l, r;
+
+    while(blocks >= 8) {
+        v0 = _mm256_loadu_ps((const float *)d);
+        v1 = _mm256_loadu_ps((const float *)(d + 32));
+        l = _mm256_castps_si256(_mm256_shuffle_ps(v0, v1, 0x88));
+        r = _mm256_castps_si256(_mm256_shuffle_ps(v0, v1, 0xDD));
+
+        l = _mm256_xor_si256(l, _mm256_set1_epi32((int)p[0]));
+        r = _mm256_xor_si256(r, _mm256_xor_si256(bb_f_avx2(k, l),
+                                                 _mm256_set1_epi32((int)p[1])));
+        l = _mm256_xor_si256(l, _mm256_xor_si256(bb_f_avx2(k, r),
+                                                 _mm256_set1_epi32((int)p[2])));
+        r = _mm256_xor_si256(r, _mm256_xor_si256(bb_f_avx2(k, l),
+                                                 _mm256_set1_epi32((int)p[3])));
+        l = _mm256_xor_si256(l, _mm256_xor_si256(bb_f_avx2(k, r),
+                                                 _mm256_set1_epi32((int)p[4])));
+        r = _mm256_xor_si256(r, _mm256_set1_epi32((int)p[5]));
+
+        _mm256_storeu_si256((__m256i *)d, _mm256_unpacklo_epi32(r, l));
+        _mm256_storeu_si256((__m256i *)(d + 32), _mm256_unpackhi_epi32(r, l));
+        d += 64;
+        blocks -= 8;
+    }
+
+    bb_scalar(k, p, d, blocks);
+}
+#endif
+
+/* The key table mixing, exactly as the library does it. */
+static void pc_mix(uint32_t *k) {
+    int i;
+
+    for(i = 1; i <= 24; ++i) {
+        k[i] -= k[i + 31];
+    }
+
+    for(; i < PC_KEYS; ++i) {
+        k[i] -= k[i - 24];
+    }
+}
+
+static void gc_mix(CRYPT_SETUP *key) {
+    uint32_t *k = key->keys;
+    int n = (int)(key->gc_block_end_ptr - k), i;
+
+    for(i = 0; i < GC_LAG; ++i) {
+        k[i] ^= k[i + n - GC_LAG];
+    }
+
+    for(; i < n; ++i) {
+        k[i] ^= k[i - GC_LAG];
+    }
+
+    key->gc_block_ptr = k;
+}
+
+/* Write the next amt bytes of keystream (which must be a whole number of
+   words) to dst. The library xors each word of the data with the next word of
+   the table, so the keystream is just the table copied out a run at a time,
+   with a remix in between runs. This leaves the key in the same state that the
+   library would have. */
+static void ks_generate(CRYPT_SETUP *key, uint8_t *dst, int amt) {
+    uint32_t *next;
+    int words = amt >> 2, n;
+
+    if(key->type == CRYPT_PC) {
+        while(words) {
+            if(key->pc_posn == PC_KEYS) {
+                pc_mix(key->keys);
+                key->pc_posn = 1;
+            }
+
+            n = PC_KEYS - key->pc_posn;
+
+            if(n > words)
+                n = words;
+
+            memcpy(dst, key->keys + key->pc_posn, n << 2);
+            key->pc_posn += n;
+            dst += n << 2;
+            words -= n;
+        }
+    }
+    else {
+        while(words) {
+            next = key->gc_block_ptr + 1;
+
+            if(next == key->gc_block_end_ptr) {
+                gc_mix(key);
+                next = key->keys;
+            }
+
+            n = (int)(key->gc_block_end_ptr - next);
+
+            if(n > words)
+                n = words;
+
+            memcpy(dst, next, n << 2);
+            key->gc_block_ptr = next + n - 1;
+            dst += n << 2;
+            words -= n;
+        }
+    }
+}
+
+/* Add keystream to the end of what's in the ring until there's at least want
+   bytes of it (or the ring is full). */
+static int ks_fill(CRYPT_SETUP *key, cipher_ks_t *ks, int want) {
+    int tail, amt;
+
+    if(!ks->buf && !(ks->buf = (uint8_t *)mempool_alloc(ks_pool))) {
+        return -1;
+    }
+
+    if(want > CIPHER_KS_SIZE)
+        want = CIPHER_KS_SIZE;
+
+    /* The free space may wrap around the end of the buffer, in which case it
+       takes two goes to fill it all. */
+    while(ks->count < want) {
+        tail = (ks->head + ks->count) & (CIPHER_KS_SIZE - 1);
+        amt = (want - ks->count + 3) & ~3;
+
+        if(amt > CIPHER_KS_SIZE - ks->count)
+            amt = (CIPHER_KS_SIZE - ks->count) & ~3;
+        if(tail + amt > CIPHER_KS_SIZE)
+            amt = CIPHER_KS_SIZE - tail;
+        if(!amt)
+            break;
+
+        ks_generate(key, ks->buf + tail, amt);
+        ks->count += amt;
+    }
+
+    return 0;
+}
+
+int cipher_ks_refill(CRYPT_SETUP *key, cipher_ks_t *ks) {
+    if(!use_keystream ||
+       (key->type != CRYPT_PC && key->type != CRYPT_GAMECUBE)) {
+        return 0;
+    }
+
+    return ks_fill(key, ks, CIPHER_KS_SIZE);
+}
+
+int cipher_ks_low(CRYPT_SETUP *key, cipher_ks_t *ks) {
+    if(!use_keystream ||
+       (key->type != CRYPT_PC && key->type != CRYPT_GAMECUBE)) {
+        return 0;
+    }
+
+    return ks->count < CIPHER_KS_SIZE / 2;
+}
+
+static int ks_crypt(CRYPT_SETUP *key, cipher_ks_t *ks, uint8_t *data,
+                    int len) {
+    int amt;
+
+    while(len > 0) {
+        /* If nothing's been buffered up ahead of time, only make as much as
+           this packet needs. */
+        if(!ks->count && ks_fill(key, ks, len)) {
+            return -1;
+        }
+
+        amt = CIPHER_KS_SIZE - ks->head;
+
+        if(amt > ks->count)
+            amt = ks->count;
+        if(amt > len)
+            amt = len;
+
+        xor_func(data, ks->buf + ks->head, amt);
+        ks->head = (ks->head + amt) & (CIPHER_KS_SIZE - 1);
+        ks->count -= amt;
+        data += amt;
+        len -= amt;
+    }
+
+    return 0;
+}
+
+static void bb_crypt(bb_func_t func, CRYPT_SETUP *key, uint8_t *data, int len,
+                     int enc) {
+    uint32_t p[6];
+    int i;
+
+    for(i = 0; i < 6; ++i) {
+        p[i] = key->keys[enc ? i : 5 - i];
+    }
+
+    func(key->keys, p, data, len >> 3);
+}
+
+int cipher_crypt(CRYPT_SETUP *key, cipher_ks_t *ks, void *data, int len,
+                 int enc) {
+    /* Packets are always padded out to whole blocks for Blue Burst, but just
+       in case something isn't, let the library deal with it. */
+    if(key->type == CRYPT_BLUEBURST) {
+        if(!bb_func || (len & 7)) {
+            return CRYPT_CryptData(key, data, len, enc);
+        }
+
+        bb_crypt(bb_func, key, (uint8_t *)data, len, enc);
+        return 0;
+    }
+
+    if(!use_keystream ||
+       (key->type != CRYPT_PC && key->type != CRYPT_GAMECUBE)) {
+        return CRYPT_CryptData(key, data, len, enc);
+    }
+
+    return ks_crypt(key, ks, (uint8_t *)data, len);
+}
+
+void cipher_ks_clear(cipher_ks_t *ks) {
+    if(ks->buf) {
+        mempool_free(ks_pool, ks->buf);
+    }
+
+    ks->buf = NULL;
+    ks->head = ks->count = 0;
+}
+
+int cipher_init(void) {
+    if(!(ks_pool = mempool_create(CIPHER_KS_SIZE, KS_PER_SLAB))) {
+        return -1;
+    }
+
+    xor_func = &xor_scalar;
+    xor_name = "scalar";
+
+    /* Doing Blue Burst a block at a time here isn't any faster than the
+       library is, so it's only worth it with a vector implementation. */
+    bb_func = NULL;
+    bb_name = "library";
+
+#ifdef CIPHER_X86
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx2")) {
+        xor_func = &xor_avx2;
+        xor_name = "AVX2";
+        bb_func = &bb_avx2;
+        bb_name = "AVX2";
+    }
+    else if(__builtin_cpu_supports("sse2")) {
+        xor_func = &xor_sse2;
+        xor_name = "SSE2";
+    }
+#endif
+
+    use_keystream = 1;
+    debug(DBG_LOG, "Using %s keystream encryption\n", xor_name);
+    debug(DBG_LOG, "Using %s Blue Burst encryption\n", bb_name);
+
+    return 0;
+}
+
+void cipher_shutdown(void) {
+    mempool_destroy(ks_pool);
+    ks_pool = NULL;
+}
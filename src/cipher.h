@@ -0,0 +1,67 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CIPHER_H
+#define CIPHER_H
+
+#include <stdint.h>
+
+#include <sylverant/encryption.h>
+
+/* How much keystream is buffered up for each key. This must be a power of
+   two. */
+#define CIPHER_KS_SIZE      4096
+
+/* The DC, PC and GC ciphers are simple stream ciphers: the data is just xored
+   with a keystream that depends only on the key. So, rather than going through
+   the library a word at a time for every packet, we generate keystream in bulk
+   into a ring buffer and then xor packets against that (with SIMD, where the
+   CPU supports it). The ring can be topped up ahead of time when there's
+   nothing better to do, so that the packet handling path only has to do the
+   xor. Blue Burst uses a block cipher, so there's no keystream to buffer up for
+   it. Instead, where the CPU has AVX2, a packet's blocks are encrypted eight at
+   a time, with the table lookups done as vector gathers. Otherwise, Blue Burst
+   goes through the library directly. */
+typedef struct cipher_ks {
+    uint8_t *buf;
+    int head;
+    int count;
+} cipher_ks_t;
+
+/* Pick the fastest implementations the CPU supports. These are checked against
+   the library's implementation by tests/cipher_test. Returns 0 on success. */
+int cipher_init(void);
+void cipher_shutdown(void);
+
+/* Encrypt or decrypt data with the given key and its keystream buffer. The key
+   must only ever be used through this function once anything has been done
+   with it here, otherwise the two will get out of sync. */
+int cipher_crypt(CRYPT_SETUP *key, cipher_ks_t *ks, void *data, int len,
+                 int enc);
+
+/* Is the key's keystream ring running low enough that it would be worth
+   refilling it ahead of time? This is always false for keys that don't use the
+   ring at all. */
+int cipher_ks_low(CRYPT_SETUP *key, cipher_ks_t *ks);
+
+/* Fill up whatever room there is in a key's keystream ring. */
+int cipher_ks_refill(CRYPT_SETUP *key, cipher_ks_t *ks);
+
+/* Release any keystream buffered up for a key. */
+void cipher_ks_clear(cipher_ks_t *ks);
+
+#endif /* !CIPHER_H */
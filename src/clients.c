@@ -29,7 +29,6 @@
 #include <arpa/inet.h>
 
 #include <sylverant/encryption.h>
-#include <sylverant/mtwist.h>
 #include <sylverant/debug.h>
 #include <sylverant/memory.h>
 
@@ -41,6 +40,9 @@
 #include "subcmd.h"
 #include "mapdata.h"
 #include "items.h"
+#include "gcindex.h"
+#include "epoch.h"
+#include "mtrand.h"
 
 #ifdef ENABLE_LUA
 #include <lua.h>
@@ -54,17 +56,120 @@
 
 #define UNUSED __attribute__((unused))
 
+extern int prefill_keystream;
+
 /* The key for accessing our thread-specific receive buffer. */
 pthread_key_t recvbuf_key;
 
 /* The key for accessing our thread-specific send buffer. */
 pthread_key_t sendbuf_key;
 
+/* The key for accessing our thread-specific buffer for broadcast packets. */
+pthread_key_t fanoutbuf_key;
+
 /* Destructor for the thread-specific receive buffer */
 static void buf_dtor(void *rb) {
     free(rb);
 }
 
+/* How long (in seconds) we'll go without hearing from a client before pinging
+   it and before giving up on it. Clients on the ship itself are only there to
+   pick a block, so they get a bit more slack. */
+#define BLOCK_PING_TIME     30
+#define BLOCK_TIMEOUT       90
+#define SHIP_PING_TIME      60
+#define SHIP_TIMEOUT        120
+#define PING_INTERVAL       10
+#define GC_PROTECT_TIMEOUT  60
+
+/* Work out when the next thing needs to be done for a client and schedule its
+   timer for then. The checks below are all "now > x", so everything is due one
+   second after the limit has been reached. */
+static void client_schedule_timer(ship_client_t *c) {
+    time_t ping_time = BLOCK_PING_TIME, timeout = BLOCK_TIMEOUT;
+    time_t when, ping;
+
+    if(c->flags & CLIENT_FLAG_TYPE_SHIP) {
+        ping_time = SHIP_PING_TIME;
+        timeout = SHIP_TIMEOUT;
+    }
+
+    when = c->last_message + timeout + 1;
+    ping = c->last_message + ping_time + 1;
+
+    if(ping < c->last_sent + PING_INTERVAL + 1)
+        ping = c->last_sent + PING_INTERVAL + 1;
+
+    if(ping < when)
+        when = ping;
+
+    if((c->flags & CLIENT_FLAG_GC_PROTECT) &&
+       c->join_time + GC_PROTECT_TIMEOUT + 1 < when)
+        when = c->join_time + GC_PROTECT_TIMEOUT + 1;
+
+    timer_schedule(c->timers, &c->timer, when);
+}
+
+/* Called from the owning thread's timer wheel when a client's timer expires.
+   Since last_message gets updated on every packet without touching the timer,
+   this will often find that there's nothing to do yet, in which case it just
+   pushes the timer back. */
+static void client_timer_expired(timer_entry_t *t, time_t now) {
+    ship_client_t *c = (ship_client_t *)t->data;
+    time_t ping_time = BLOCK_PING_TIME, timeout = BLOCK_TIMEOUT;
+    char nm[64];
+
+    if(c->flags & CLIENT_FLAG_DISCONNECTED)
+        return;
+
+    if(c->flags & CLIENT_FLAG_TYPE_SHIP) {
+        ping_time = SHIP_PING_TIME;
+        timeout = SHIP_TIMEOUT;
+    }
+
+    pthread_mutex_lock(&c->mutex);
+
+    /* If we haven't heard from the client in a while, it is probably dead.
+       Disconnect it. */
+    if(now > c->last_message + timeout) {
+        if(c->bb_pl) {
+            istrncpy16_raw(ic_utf16_to_utf8, nm, &c->pl->bb.character.name[2],
+                           64, 14);
+            debug(DBG_LOG, "Ping Timeout: %s(%d)\n", nm, c->guildcard);
+        }
+        else if(c->pl) {
+            debug(DBG_LOG, "Ping Timeout: %s(%d)\n", c->pl->v1.name,
+                  c->guildcard);
+        }
+
+        client_disconnect(c);
+        goto out;
+    }
+    /* Otherwise, if it's been quiet for a bit, ping them. */
+    else if(now > c->last_message + ping_time &&
+            now > c->last_sent + PING_INTERVAL) {
+        if(send_simple(c, PING_TYPE, 0)) {
+            client_disconnect(c);
+            goto out;
+        }
+
+        c->last_sent = now;
+    }
+
+    /* Check if their timeout expired to login after getting a protection
+       message. */
+    if((c->flags & CLIENT_FLAG_GC_PROTECT) &&
+       c->join_time + GC_PROTECT_TIMEOUT < now) {
+        client_disconnect(c);
+        goto out;
+    }
+
+    client_schedule_timer(c);
+
+out:
+    pthread_mutex_unlock(&c->mutex);
+}
+
 /* Initialize the clients system, allocating any thread specific keys */
 int client_init(sylverant_ship_t *cfg) {
     if(pthread_key_create(&recvbuf_key, &buf_dtor)) {
@@ -77,6 +182,26 @@ int client_init(sylverant_ship_t *cfg) {
         return -1;
     }
 
+    if(pthread_key_create(&fanoutbuf_key, &buf_dtor)) {
+        perror("pthread_key_create");
+        return -1;
+    }
+
+    if(sendq_init()) {
+        debug(DBG_ERROR, "Cannot create output queue pool\n");
+        return -1;
+    }
+
+    if(cipher_init()) {
+        debug(DBG_ERROR, "Cannot set up encryption\n");
+        return -1;
+    }
+
+    if(gcindex_init()) {
+        debug(DBG_ERROR, "Cannot create guild card index\n");
+        return -1;
+    }
+
     return 0;
 }
 
@@ -84,19 +209,106 @@ int client_init(sylverant_ship_t *cfg) {
 void client_shutdown(void) {
     pthread_key_delete(recvbuf_key);
     pthread_key_delete(sendbuf_key);
+    pthread_key_delete(fanoutbuf_key);
+    sendq_shutdown();
+    cipher_shutdown();
+    gcindex_shutdown();
+}
+
+/* The parts of a block client that don't get looked at all the time, in one
+   piece. The cold part has to come first, so that a pointer to it is also a
+   pointer to the whole thing. */
+typedef struct client_mem {
+    client_cold_t cold;
+    player_t pl;
+    uint32_t enemy_kills[0x60];
+} client_mem_t;
+
+/* Blue Burst clients also need these. */
+typedef struct client_bb_mem {
+    sylverant_bb_db_char_t pl;
+    sylverant_bb_db_opts_t opts;
+} client_bb_mem_t;
+
+client_pools_t *client_pools_create(int block) {
+    client_pools_t *rv;
+
+    if(!(rv = (client_pools_t *)malloc(sizeof(client_pools_t)))) {
+        perror("malloc");
+        return NULL;
+    }
+
+    memset(rv, 0, sizeof(client_pools_t));
+
+    if(block) {
+        rv->clients = mempool_create(sizeof(ship_client_t), 16);
+        rv->cold = mempool_create(sizeof(client_mem_t), 16);
+        rv->bb = mempool_create(sizeof(client_bb_mem_t), 16);
+        rv->xbox = mempool_create(sizeof(xbox_ip_t), 64);
+
+        if(!rv->clients || !rv->cold || !rv->bb || !rv->xbox) {
+            client_pools_destroy(rv);
+            return NULL;
+        }
+    }
+    else {
+        rv->clients = mempool_create(sizeof(ship_client_t), 32);
+        rv->cold = mempool_create(sizeof(client_cold_t), 32);
+
+        if(!rv->clients || !rv->cold) {
+            client_pools_destroy(rv);
+            return NULL;
+        }
+    }
+
+    return rv;
+}
+
+void client_pools_destroy(client_pools_t *p) {
+    mempool_destroy(p->clients);
+    mempool_destroy(p->cold);
+    mempool_destroy(p->bb);
+    mempool_destroy(p->xbox);
+    free(p);
+}
+
+/* Give a client's memory back to the pools it came from. */
+static void client_free_mem(ship_client_t *c) {
+    client_pools_t *p = c->pools;
+
+    /* The Blue Burst options are in the same piece as the character. */
+    if(c->bb_pl) {
+        mempool_free(p->bb, c->bb_pl);
+    }
+
+    if(c->xbl_ip) {
+        mempool_free(p->xbox, c->xbl_ip);
+    }
+
+    /* On a block client, this has the player data in it too. */
+    if(c->cold) {
+        mempool_free(p->cold, c->cold);
+    }
+
+    mempool_free(p->clients, c);
 }
 
 /* Create a new connection, storing it in the list of clients. */
 ship_client_t *client_create_connection(int sock, int version, int type,
                                         struct client_queue *clients,
-                                        ship_t *ship, block_t *block,
+                                        ship_t *ship,
+                                        block_worker_t *worker,
                                         struct sockaddr *ip, socklen_t size) {
-    ship_client_t *rv = (ship_client_t *)malloc(sizeof(ship_client_t));
+    ship_client_t *rv;
+    block_t *block = worker ? worker->block : NULL;
+    client_pools_t *pools = block ? block->client_pools : ship->client_pools;
+    client_mem_t *mem;
+    client_bb_mem_t *bbmem;
     uint32_t client_seed_dc, server_seed_dc;
     uint8_t client_seed_bb[48], server_seed_bb[48];
     int i;
     pthread_mutexattr_t attr;
-    struct mt19937_state *rng;
+    mtrand_t *rng;
 
     /* Disable Nagle's algorithm */
     i = 1;
@@ -119,71 +331,51 @@ ship_client_t *client_create_connection(int sock, int version, int type,
         perror("setsockopt - SO_SNDBUF");
     }
 
-    if(!rv) {
-        perror("malloc");
+    if(!(rv = (ship_client_t *)mempool_zalloc(pools->clients))) {
+        debug(DBG_ERROR, "Cannot allocate memory for client\n");
         return NULL;
     }
 
-    memset(rv, 0, sizeof(ship_client_t));
+    rv->pools = pools;
 
     if(type == CLIENT_TYPE_BLOCK) {
-        rv->pl = (player_t *)malloc(sizeof(player_t));
-
-        if(!rv->pl) {
-            perror("malloc");
-            free(rv);
+        if(!(mem = (client_mem_t *)mempool_zalloc(pools->cold))) {
+            debug(DBG_ERROR, "Cannot allocate memory for client\n");
+            client_free_mem(rv);
             close(sock);
             return NULL;
         }
 
-        memset(rv->pl, 0, sizeof(player_t));
-
-        if(!(rv->enemy_kills = (uint32_t *)malloc(sizeof(uint32_t) * 0x60))) {
-            perror("malloc");
-            free(rv->pl);
-            free(rv);
-            close(sock);
-            return NULL;
-        }
+        rv->cold = &mem->cold;
+        rv->pl = &mem->pl;
+        rv->enemy_kills = mem->enemy_kills;
 
         if(version == CLIENT_VERSION_BB) {
-            rv->bb_pl =
-                (sylverant_bb_db_char_t *)malloc(sizeof(sylverant_bb_db_char_t));
-
-            if(!rv->bb_pl) {
-                perror("malloc");
-                free(rv->pl);
-                free(rv);
+            if(!(bbmem = (client_bb_mem_t *)mempool_zalloc(pools->bb))) {
+                debug(DBG_ERROR, "Cannot allocate memory for client\n");
+                client_free_mem(rv);
                 close(sock);
                 return NULL;
             }
 
-            rv->bb_opts =
-                (sylverant_bb_db_opts_t *)malloc(sizeof(sylverant_bb_db_opts_t));
-
-            if(!rv->bb_opts) {
-                perror("malloc");
-                free(rv->bb_pl);
-                free(rv->pl);
-                free(rv);
-                close(sock);
-                return NULL;
-            }
-
-            memset(rv->bb_pl, 0, sizeof(sylverant_bb_db_char_t));
-            memset(rv->bb_opts, 0, sizeof(sylverant_bb_db_opts_t));
+            rv->bb_pl = &bbmem->pl;
+            rv->bb_opts = &bbmem->opts;
         }
         else if(version == CLIENT_VERSION_XBOX) {
-            if(!(rv->xbl_ip = (xbox_ip_t *)malloc(sizeof(xbox_ip_t)))) {
-                perror("malloc");
-                free(rv->enemy_kills);
-                free(rv->pl);
-                free(rv);
+            if(!(rv->xbl_ip = (xbox_ip_t *)mempool_alloc(pools->xbox))) {
+                debug(DBG_ERROR, "Cannot allocate memory for client\n");
+                client_free_mem(rv);
                 close(sock);
                 return NULL;
             }
         }
     }
+    else if(!(rv->cold = (client_cold_t *)mempool_zalloc(pools->cold))) {
+        debug(DBG_ERROR, "Cannot allocate memory for client\n");
+        client_free_mem(rv);
+        close(sock);
+        return NULL;
+    }
 
     /* Store basic parameters in the client structure. */
     rv->sock = sock;
@@ -198,8 +390,9 @@ ship_client_t *client_create_connection(int sock, int version, int type,
     pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
     pthread_mutex_init(&rv->mutex, &attr);
     pthread_mutexattr_destroy(&attr);
+    pthread_mutex_init(&rv->pend_mutex, NULL);
 
-    memcpy(&rv->ip_addr, ip, size);
+    memcpy(&rv->cold->ip_addr, ip, size);
 
     if(ip->sa_family == AF_INET6) {
         rv->flags |= CLIENT_FLAG_IPV6;
@@ -214,13 +407,13 @@ ship_client_t *client_create_connection(int sock, int version, int type,
         rng = &ship->rng;
     }
     else {
-        rng = &block->rng;
+        rng = &worker->rng;
     }
 
 #ifdef ENABLE_LUA
     /* Initialize the script table */
     lua_newtable(ship->lstate);
-    rv->script_ref = luaL_ref(ship->lstate, LUA_REGISTRYINDEX);
+    rv->cold->script_ref = luaL_ref(ship->lstate, LUA_REGISTRYINDEX);
 #endif
 
     switch(version) {
@@ -228,8 +421,8 @@ ship_client_t *client_create_connection(int sock, int version, int type,
         case CLIENT_VERSION_DCV2:
         case CLIENT_VERSION_PC:
             /* Generate the encryption keys for the client and server. */
-            client_seed_dc = mt19937_genrand_int32(rng);
-            server_seed_dc = mt19937_genrand_int32(rng);
+            client_seed_dc = mtrand_int32(rng);
+            server_seed_dc = mtrand_int32(rng);
 
             CRYPT_CreateKeys(&rv->skey, &server_seed_dc, CRYPT_PC);
             CRYPT_CreateKeys(&rv->ckey, &client_seed_dc, CRYPT_PC);
@@ -245,8 +438,8 @@ ship_client_t *client_create_connection(int sock, int version, int type,
         case CLIENT_VERSION_EP3:
         case CLIENT_VERSION_XBOX:
             /* Generate the encryption keys for the client and server. */
-            client_seed_dc = mt19937_genrand_int32(rng);
-            server_seed_dc = mt19937_genrand_int32(rng);
+            client_seed_dc = mtrand_int32(rng);
+            server_seed_dc = mtrand_int32(rng);
 
             CRYPT_CreateKeys(&rv->skey, &server_seed_dc, CRYPT_GAMECUBE);
             CRYPT_CreateKeys(&rv->ckey, &client_seed_dc, CRYPT_GAMECUBE);
@@ -261,8 +454,8 @@ ship_client_t *client_create_connection(int sock, int version, int type,
         case CLIENT_VERSION_BB:
             /* Generate the encryption keys for the client and server. */
             for(i = 0; i < 48; i += 4) {
-                client_seed_dc = mt19937_genrand_int32(rng);
-                server_seed_dc = mt19937_genrand_int32(rng);
+                client_seed_dc = mtrand_int32(rng);
+                server_seed_dc = mtrand_int32(rng);
 
                 client_seed_bb[i + 0] = (uint8_t)(client_seed_dc >>  0);
                 client_seed_bb[i + 1] = (uint8_t)(client_seed_dc >>  8);
@@ -288,15 +481,38 @@ ship_client_t *client_create_connection(int sock, int version, int type,
 
     /* Insert it at the end of our list, and we're done. */
     if(type == CLIENT_TYPE_BLOCK) {
+        /* Register the socket with the worker's event loop. If the welcome
+           packet couldn't be sent in its entirety, we need to know when we can
+           write the rest. */
+        rv->ev_write = SENDQ_EMPTY(&rv->sendq) ? 0 : 1;
+
+        if(evloop_add(worker->evl, sock, EVLOOP_READ |
+                      (rv->ev_write ? EVLOOP_WRITE : 0), rv)) {
+            goto err;
+        }
+
+        rv->worker = worker;
+        rv->evl = worker->evl;
+        rv->timers = &worker->timers;
+
         pthread_rwlock_wrlock(&block->lock);
         TAILQ_INSERT_TAIL(clients, rv, qentry);
         ++block->num_clients;
         pthread_rwlock_unlock(&block->lock);
     }
     else {
+        rv->timers = &ship->timers;
         TAILQ_INSERT_TAIL(clients, rv, qentry);
     }
 
+    /* Start the clock on pinging/timing out the client. */
+    timer_init(&rv->timer, &client_timer_expired, rv);
+    client_schedule_timer(rv);
+
+    /* Now that the keys are set up, get some keystream ready before the
+       client starts talking to us. */
+    client_queue_refill(rv);
+
     ship_inc_clients(ship);
 
     return rv;
@@ -304,23 +520,18 @@ ship_client_t *client_create_connection(int sock, int version, int type,
 err:
 #ifdef ENABLE_LUA
     /* Remove the table from the registry */
-    luaL_unref(ship->lstate, LUA_REGISTRYINDEX, rv->script_ref);
+    luaL_unref(ship->lstate, LUA_REGISTRYINDEX, rv->cold->script_ref);
 #endif
 
     close(sock);
 
-    if(type == CLIENT_TYPE_BLOCK) {
-        if(version == CLIENT_VERSION_XBOX) {
-            free(rv->xbl_ip);
-        }
-
-        free(rv->enemy_kills);
-        free(rv->pl);
-    }
-
+    sendq_clear(&rv->sendq);
+    cipher_ks_clear(&rv->ckey_ks);
+    cipher_ks_clear(&rv->skey_ks);
+    pthread_mutex_destroy(&rv->pend_mutex);
     pthread_mutex_destroy(&rv->mutex);
 
-    free(rv);
+    client_free_mem(rv);
     return NULL;
 }
 
@@ -336,12 +547,22 @@ void client_destroy_connection(ship_client_t *c,
         action = ScriptActionClientBlockLogout;
 
     TAILQ_REMOVE(clients, c, qentry);
+    gcindex_remove(c);
+
+    if(c->timers)
+        timer_cancel(c->timers, &c->timer);
+
+    if(c->flush_pending)
+        TAILQ_REMOVE(&c->worker->flush_queue, c, flush_qentry);
+
+    if(c->refill_pending)
+        TAILQ_REMOVE(&c->worker->refill_queue, c, refill_qentry);
 
     /* If the client was on Blue Burst, update their db character */
     if(c->version == CLIENT_VERSION_BB &&
        !(c->flags & CLIENT_FLAG_TYPE_SHIP)) {
         c->bb_pl->character.play_time += now - c->login_time;
-        shipgate_send_cdata(&ship->sg, c->guildcard, c->sec_data.slot,
+        shipgate_send_cdata(&ship->sg, c->guildcard, c->cold->sec_data.slot,
                             c->bb_pl, sizeof(sylverant_bb_db_char_t),
                             c->cur_block->b);
         shipgate_send_bb_opts(&ship->sg, c);
@@ -351,7 +572,7 @@ void client_destroy_connection(ship_client_t *c,
 
 #ifdef ENABLE_LUA
     /* Remove the table from the registry */
-    luaL_unref(ship->lstate, LUA_REGISTRYINDEX, c->script_ref);
+    luaL_unref(ship->lstate, LUA_REGISTRYINDEX, c->cold->script_ref);
 #endif
 
     /* If the user was on a block, notify the shipgate */
@@ -377,14 +598,25 @@ void client_destroy_connection(ship_client_t *c,
     }
 
     /* If we were logging the user, close the file */
-    if(c->logfile) {
+    if(c->cold->logfile) {
         ctime_r(&now, tstr);
         tstr[strlen(tstr) - 1] = 0;
-        fprintf(c->logfile, "[%s] Connection closed\n", tstr);
-        fclose(c->logfile);
+        fprintf(c->cold->logfile, "[%s] Connection closed\n", tstr);
+        fclose(c->cold->logfile);
     }
 
     if(c->sock >= 0) {
+        /* Make one last attempt at getting out anything that's still waiting
+           to be sent (like a message explaining why they're being
+           disconnected). */
+        if(!SENDQ_EMPTY(&c->sendq)) {
+            sendq_flush(&c->sendq, c->sock);
+        }
+
+        if(c->evl) {
+            evloop_remove(c->evl, c->sock);
+        }
+
         close(c->sock);
     }
 
@@ -395,87 +627,55 @@ void client_destroy_connection(ship_client_t *c,
         free(c->recvbuf);
     }
 
-    if(c->sendbuf) {
-        free(c->sendbuf);
-    }
+    sendq_clear(&c->sendq);
+    sendq_clear(&c->pendq);
+    cipher_ks_clear(&c->ckey_ks);
+    cipher_ks_clear(&c->skey_ks);
 
-    if(c->autoreply) {
-        free(c->autoreply);
-    }
-
-    if(c->enemy_kills) {
-        free(c->enemy_kills);
-    }
-
-    if(c->pl) {
-        free(c->pl);
-    }
-
-    if(c->bb_pl) {
-        free(c->bb_pl);
-    }
-
-    if(c->bb_opts) {
-        free(c->bb_opts);
+    if(c->cold->autoreply) {
+        free(c->cold->autoreply);
     }
 
     if(c->next_maps) {
         free(c->next_maps);
     }
 
-    if(c->xbl_ip) {
-        free(c->xbl_ip);
-    }
-
+    pthread_mutex_destroy(&c->pend_mutex);
     pthread_mutex_destroy(&c->mutex);
 
-    free(c);
+    client_free_mem(c);
 }
 
-/* Read data from a client that is connected to any port. */
-int client_process_pkt(ship_client_t *c) {
-    ssize_t sz;
+/* Run through whatever complete packets are sitting in the client's receive
+   buffer and pass them off to their handlers. Any partial packet at the end is
+   left where it is for next time.
+
+   All of the ciphers the clients use work on fixed-size units that don't
+   depend on where packets begin and end (4 byte words of keystream for
+   DC/PC/GC, 8 byte blocks for Blue Burst), so everything that has arrived is
+   decrypted in place in one go, up to the last whole unit. The packets are
+   then handed off right where they sit in the buffer. */
+static int client_handle_pkts(ship_client_t *c) {
     uint16_t pkt_sz;
-    int rv = 0;
+    int rv = 0, sz;
     unsigned char *rbp;
-    void *tmp;
-    uint8_t *recvbuf = get_recvbuf();
+    pkt_header_t *hdr;
     int hsz = c->hdr_size;
 
-    /* Make sure we got the recvbuf, otherwise, bail. */
-    if(!recvbuf) {
-        return -1;
-    }
-
-    /* If we've got anything buffered, copy it out to the main buffer to make
-       the rest of this a bit easier. */
-    if(c->recvbuf_cur) {
-        memcpy(recvbuf, c->recvbuf, c->recvbuf_cur);
-    }
-
-    /* Attempt to read, and if we don't get anything, punt. */
-    if((sz = recv(c->sock, recvbuf + c->recvbuf_cur, 65536 - c->recvbuf_cur,
-                  0)) <= 0) {
-        if(sz == -1) {
-            perror("recv");
-        }
+    /* Decrypt whatever has come in since last time. */
+    sz = (c->recvbuf_cur - c->recvbuf_dec) & ~(hsz - 1);
 
-        return -1;
+    if(sz) {
+        cipher_crypt(&c->ckey, &c->ckey_ks, c->recvbuf + c->recvbuf_dec, sz,
+                     0);
+        c->recvbuf_dec += sz;
     }
 
-    sz += c->recvbuf_cur;
-    c->recvbuf_cur = 0;
-    rbp = recvbuf;
+    rbp = c->recvbuf + c->recvbuf_start;
+    sz = c->recvbuf_dec - c->recvbuf_start;
 
-    /* As long as what we have is long enough, decrypt it. */
     while(sz >= hsz && rv == 0) {
-        /* Decrypt the packet header so we know what exactly we're looking
-           for, in terms of packet length. */
-        if(!(c->flags & CLIENT_FLAG_HDR_READ)) {
-            memcpy(&c->pkt, rbp, hsz);
-            CRYPT_CryptData(&c->ckey, &c->pkt, hsz, 0);
-            c->flags |= CLIENT_FLAG_HDR_READ;
-        }
+        hdr = (pkt_header_t *)rbp;
 
         /* Read the packet size to see how much we're expecting. */
         switch(c->version) {
@@ -484,15 +684,15 @@ int client_process_pkt(ship_client_t *c) {
             case CLIENT_VERSION_GC:
             case CLIENT_VERSION_EP3:
             case CLIENT_VERSION_XBOX:
-                pkt_sz = LE16(c->pkt.dc.pkt_len);
+                pkt_sz = LE16(hdr->dc.pkt_len);
                 break;
 
             case CLIENT_VERSION_PC:
-                pkt_sz = LE16(c->pkt.pc.pkt_len);
+                pkt_sz = LE16(hdr->pc.pkt_len);
                 break;
 
             case CLIENT_VERSION_BB:
-                pkt_sz = LE16(c->pkt.bb.pkt_len);
+                pkt_sz = LE16(hdr->bb.pkt_len);
                 break;
 
             default:
@@ -518,64 +718,206 @@ int client_process_pkt(ship_client_t *c) {
             pkt_sz = (pkt_sz & (0x10000 - hsz)) + hsz;
         }
 
-        /* Do we have the whole packet? */
-        if(sz >= (ssize_t)pkt_sz) {
-            /* Yes, we do, decrypt it. */
-            CRYPT_CryptData(&c->ckey, rbp + hsz, pkt_sz - hsz, 0);
-            memcpy(rbp, &c->pkt, hsz);
-            c->last_message = time(NULL);
-
-            /* If we're logging the client, write into the log */
-            if(c->logfile) {
-                fprint_packet(c->logfile, rbp, pkt_sz, 1);
-            }
+        /* Do we have the whole packet? If not, leave the rest in the buffer
+           until the rest of it shows up. */
+        if(sz < (int)pkt_sz) {
+            break;
+        }
 
-            /* Pass it onto the correct handler. */
-            if(c->flags & CLIENT_FLAG_TYPE_SHIP) {
-                rv = ship_process_pkt(c, rbp);
-            }
-            else {
-                rv = block_process_pkt(c, rbp);
-            }
+        c->last_message = time(NULL);
 
-            rbp += pkt_sz;
-            sz -= pkt_sz;
+        /* If we're logging the client, write into the log */
+        if(c->cold->logfile) {
+            fprint_packet(c->cold->logfile, rbp, pkt_sz, 1);
+        }
 
-            c->flags &= ~CLIENT_FLAG_HDR_READ;
+        /* Pass it onto the correct handler. */
+        if(c->flags & CLIENT_FLAG_TYPE_SHIP) {
+            rv = ship_process_pkt(c, rbp);
         }
         else {
-            /* Nope, we're missing part, break out of the loop, and buffer
-               the remaining data. */
-            break;
+            rv = block_process_pkt(c, rbp);
         }
+
+        rbp += pkt_sz;
+        sz -= pkt_sz;
+        c->recvbuf_start += pkt_sz;
     }
 
-    /* If we've still got something left here, buffer it for the next pass. */
-    if(sz && rv == 0) {
-        /* Reallocate the recvbuf for the client if its too small. */
-        if(c->recvbuf_size < sz) {
-            tmp = realloc(c->recvbuf, sz);
+    /* If the buffer's empty now, start over at the front of it. */
+    if(c->recvbuf_start == c->recvbuf_cur) {
+        c->recvbuf_start = c->recvbuf_cur = c->recvbuf_dec = 0;
+    }
 
-            if(!tmp) {
-                perror("realloc");
-                return -1;
+    return rv;
+}
+
+/* Make sure there's some room at the end of the client's receive buffer. The
+   only time anything actually gets moved is when a partial packet is sitting
+   at the very end of a full buffer. */
+static int client_recvbuf_space(ship_client_t *c) {
+    void *tmp;
+    int size;
+
+    if(c->recvbuf_cur < c->recvbuf_size) {
+        return 0;
+    }
+
+    if(c->recvbuf_start) {
+        memmove(c->recvbuf, c->recvbuf + c->recvbuf_start,
+                c->recvbuf_cur - c->recvbuf_start);
+        c->recvbuf_cur -= c->recvbuf_start;
+        c->recvbuf_dec -= c->recvbuf_start;
+        c->recvbuf_start = 0;
+        return 0;
+    }
+
+    /* The buffer is full of a single packet (or its the first read), so we
+       need more space. No packet can be bigger than CLIENT_RECVBUF_MAX. */
+    if(c->recvbuf_size >= CLIENT_RECVBUF_MAX) {
+        return -1;
+    }
+
+    size = c->recvbuf_size ? c->recvbuf_size << 1 : CLIENT_RECVBUF_INIT;
+
+    if(size > CLIENT_RECVBUF_MAX) {
+        size = CLIENT_RECVBUF_MAX;
+    }
+
+    if(!(tmp = realloc(c->recvbuf, size))) {
+        perror("realloc");
+        return -1;
+    }
+
+    c->recvbuf = (unsigned char *)tmp;
+    c->recvbuf_size = size;
+    return 0;
+}
+
+/* Read data from a client that is connected to any port. */
+int client_process_pkt(ship_client_t *c) {
+    ssize_t sz;
+    int rv, space, budget = CLIENT_READ_BUDGET;
+
+    /* Read as much as the client has sent us, up to the budget so that one
+       busy client can't starve out everyone else on the thread. Anything left
+       over will get picked up the next time through the event loop. */
+    while(budget--) {
+        if(client_recvbuf_space(c)) {
+            return -1;
+        }
+
+        space = c->recvbuf_size - c->recvbuf_cur;
+
+        if((sz = recv(c->sock, c->recvbuf + c->recvbuf_cur, space,
+                      MSG_DONTWAIT)) <= 0) {
+            if(sz == -1) {
+                if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                else if(errno == EINTR) {
+                    continue;
+                }
+
+                perror("recv");
             }
 
-            c->recvbuf = (unsigned char *)tmp;
-            c->recvbuf_size = sz;
+            return -1;
         }
 
-        memcpy(c->recvbuf, rbp, sz);
-        c->recvbuf_cur = sz;
+        c->recvbuf_cur += sz;
+
+        if((rv = client_handle_pkts(c))) {
+            return rv;
+        }
+
+        /* If we didn't fill up the space we had, there's nothing more to
+           read right now. */
+        if(sz < space) {
+            break;
+        }
     }
-    else if(c->recvbuf) {
-        /* Free the buffer, if we've got nothing in it. */
-        free(c->recvbuf);
-        c->recvbuf = NULL;
-        c->recvbuf_size = 0;
+
+    client_queue_refill(c);
+    return 0;
+}
+
+/* Attempt to send any data that has been buffered up for the client. */
+int client_send_buffered(ship_client_t *c) {
+    if(SENDQ_EMPTY(&c->sendq)) {
+        return 0;
     }
 
-    return rv;
+    if(sendq_flush(&c->sendq, c->sock)) {
+        return -1;
+    }
+
+    /* Wait for the socket to be writable if there's anything left over, or
+       stop waiting if we got it all out. */
+    client_update_events(c);
+
+    return 0;
+}
+
+/* Update the events the client is waited on for in its event loop. This must
+   be called with the client's mutex held. */
+void client_update_events(ship_client_t *c) {
+    int want = SENDQ_EMPTY(&c->sendq) ? 0 : 1;
+
+    /* Ship clients aren't registered with an event loop, and there's no need
+       to make a system call if nothing has changed. */
+    if(!c->evl || want == c->ev_write) {
+        return;
+    }
+
+    c->ev_write = want;
+    evloop_modify(c->evl, c->sock, EVLOOP_READ | (want ? EVLOOP_WRITE : 0),
+                  c);
+}
+
+void client_disconnect(ship_client_t *c) {
+    block_worker_t *w = c->worker;
+    ship_client_t *head;
+
+    c->flags |= CLIENT_FLAG_DISCONNECTED;
+
+    /* The ship looks at all of its clients on every pass anyway, so the flag
+       is all that ship clients need. Block clients only go on the list once,
+       no matter how many times they get flagged. */
+    if(!w || __atomic_exchange_n(&c->dead_queued, 1, __ATOMIC_ACQ_REL))
+        return;
+
+    head = __atomic_load_n(&w->dead_list, __ATOMIC_RELAXED);
+
+    do {
+        c->dead_next = head;
+    } while(!__atomic_compare_exchange_n(&w->dead_list, &head, c, 1,
+                                         __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    /* The worker checks the list at the end of every pass, so it only needs to
+       be woken up if this isn't coming from the worker itself. */
+    if(!head && w != block_current_worker())
+        write(w->pipes[1], "\x01", 1);
+}
+
+void client_queue_flush(ship_client_t *c) {
+    if(!c->flush_pending) {
+        c->flush_pending = 1;
+        TAILQ_INSERT_TAIL(&c->worker->flush_queue, c, flush_qentry);
+    }
+}
+
+void client_queue_refill(ship_client_t *c) {
+    if(!prefill_keystream || c->refill_pending || !c->worker ||
+       c->worker != block_current_worker()) {
+        return;
+    }
+
+    if(cipher_ks_low(&c->ckey, &c->ckey_ks) ||
+       cipher_ks_low(&c->skey, &c->skey_ks)) {
+        c->refill_pending = 1;
+        TAILQ_INSERT_TAIL(&c->worker->refill_queue, c, refill_qentry);
+    }
 }
 
 /* Retrieve the thread-specific recvbuf for the current thread. */
@@ -618,28 +960,28 @@ int client_set_autoreply(ship_client_t *c, void *buf, uint16_t len) {
     switch(c->version) {
         case CLIENT_VERSION_PC:
             c->pl->pc.autoreply_enabled = LE32(1);
-            c->autoreply_on = 1;
+            c->cold->autoreply_on = 1;
             break;
 
         case CLIENT_VERSION_GC:
         case CLIENT_VERSION_EP3:
         case CLIENT_VERSION_XBOX:
             c->pl->v3.autoreply_enabled = LE32(1);
-            c->autoreply_on = 1;
+            c->cold->autoreply_on = 1;
             break;
 
         case CLIENT_VERSION_BB:
             c->pl->bb.autoreply_enabled = LE32(1);
-            c->autoreply_on = 1;
+            c->cold->autoreply_on = 1;
             memcpy(c->bb_pl->autoreply, buf, len);
             memset(((uint8_t *)c->bb_pl->autoreply) + len, 0, 0x158 - len);
             break;
     }
 
     /* Clean up and set the new autoreply in place */
-    free(c->autoreply);
-    c->autoreply = tmp;
-    c->autoreply_len = (int)len;
+    free(c->cold->autoreply);
+    c->cold->autoreply = tmp;
+    c->cold->autoreply_len = (int)len;
 
     return 0;
 }
@@ -649,19 +991,19 @@ int client_disable_autoreply(ship_client_t *c) {
     switch(c->version) {
         case CLIENT_VERSION_PC:
             c->pl->pc.autoreply_enabled = 0;
-            c->autoreply_on = 0;
+            c->cold->autoreply_on = 0;
             break;
 
         case CLIENT_VERSION_GC:
         case CLIENT_VERSION_EP3:
         case CLIENT_VERSION_XBOX:
             c->pl->v3.autoreply_enabled = 0;
-            c->autoreply_on = 0;
+            c->cold->autoreply_on = 0;
             break;
 
         case CLIENT_VERSION_BB:
             c->pl->bb.autoreply_enabled = 0;
-            c->autoreply_on = 0;
+            c->cold->autoreply_on = 0;
             break;
     }
 
@@ -679,7 +1021,7 @@ int client_has_blacklisted(ship_client_t *c, uint32_t gc) {
 
     /* Look through each blacklist entry. */
     for(i = 0; i < 30; ++i) {
-        if(c->blacklist[i] == rgc) {
+        if(c->cold->blacklist[i] == rgc) {
             return 1;
         }
     }
@@ -694,7 +1036,7 @@ int client_has_ignored(ship_client_t *c, uint32_t gc) {
 
     /* Look through the ignore list... */
     for(i = 0; i < CLIENT_IGNORE_LIST_SIZE; ++i) {
-        if(c->ignore_list[i] == gc) {
+        if(c->cold->ignore_list[i] == gc) {
             return 1;
         }
     }
@@ -1112,7 +1454,7 @@ static int client_disconnect_lua(lua_State *l) {
 
     if(lua_islightuserdata(l, 1)) {
         c = (ship_client_t *)lua_touserdata(l, 1);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
     }
 
     return 0;
@@ -1126,7 +1468,7 @@ static int client_addr_lua(lua_State *l) {
         c = (ship_client_t *)lua_touserdata(l, 1);
 
         if(c->version != CLIENT_VERSION_XBOX) {
-            my_ntop(&c->ip_addr, str);
+            my_ntop(&c->cold->ip_addr, str);
         }
         else if(!c->xbl_ip) {
             lua_pushliteral(l, "");
@@ -1304,7 +1646,7 @@ static int client_getTable_lua(lua_State *l) {
 
     if(lua_islightuserdata(l, 1)) {
         c = (ship_client_t *)lua_touserdata(l, 1);
-        lua_rawgeti(l, LUA_REGISTRYINDEX, c->script_ref);
+        lua_rawgeti(l, LUA_REGISTRYINDEX, c->cold->script_ref);
     }
     else {
         lua_pushnil(l);
@@ -1670,7 +2012,9 @@ static int client_legitCheck_lua(lua_State *l) {
     if(lua_islightuserdata(l, 1)) {
         c = (ship_client_t *)lua_touserdata(l, 1);
 
-        rv = client_legit_check(c, ship->def_limits);
+        epoch_enter();
+        rv = client_legit_check(c, EPOCH_DEREF(ship->limits)->def);
+        epoch_exit();
         lua_pushboolean(l, !rv);
         return 1;
     }
@@ -1721,7 +2065,10 @@ static int client_legitCheckItem_lua(lua_State *l) {
                 return 1;
         }
 
-        rv = sylverant_limits_check_item(ship->def_limits, &item, v);
+        epoch_enter();
+        rv = sylverant_limits_check_item(EPOCH_DEREF(ship->limits)->def, &item,
+                                         v);
+        epoch_exit();
 
         if(!rv) {
             debug(DBG_LOG, "legitCheckItem failed for GC %" PRIu32 " with "
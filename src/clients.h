@@ -1,7 +1,7 @@
 /*
     Sylverant Ship Server
     Copyright (C) 2009, 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018,
-                  2019, 2020, 2021, 2022, 2025 Lawrence Sebald
+                  2019, 2020, 2021, 2022, 2025, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -40,6 +40,9 @@
 #include "ship.h"
 #include "block.h"
 #include "player.h"
+#include "sendq.h"
+#include "cipher.h"
+#include "mempool.h"
 
 /* Pull in the packet header types. */
 #define PACKETS_H_HEADERS_ONLY
@@ -57,6 +60,22 @@ typedef struct lobby lobby_t;
 #endif
 
 #define CLIENT_IGNORE_LIST_SIZE     10
+
+/* Sizes of the per-client receive buffer. It starts out fairly small and grows
+   as needed, up to the size of the largest possible packet. */
+#define CLIENT_RECVBUF_INIT         8192
+#define CLIENT_RECVBUF_MAX          65536
+
+/* The most reads done for one client each time its socket is readable. */
+#define CLIENT_READ_BUDGET          4
+
+/* How much output can be queued up for a client before we decide that it has
+   stopped reading and give up on it. */
+#define CLIENT_SENDQ_MAX            (1024 * 1024)
+
+/* How much output can be held back for a client until the end of its worker's
+   loop before we go ahead and send it anyway. */
+#define CLIENT_FLUSH_THRESHOLD      (SENDQ_CHUNK_SIZE * SENDQ_MAX_IOV)
 #define CLIENT_BLACKLIST_SIZE       30
 #define CLIENT_MAX_QSTACK           32
 
@@ -81,32 +100,119 @@ typedef struct client_blocklist_entry {
     uint32_t flags;
 } client_blocklist_t;
 
-/* Ship server client structure. */
-struct ship_client {
-    TAILQ_ENTRY(ship_client) qentry;
+/* Pools that a block (or the ship itself) hands out memory for its clients
+   from, so that connections coming and going all the time don't have to keep
+   going back to malloc. Block clients get their player data and enemy kill
+   counts in the same object as the client structure itself. */
+typedef struct client_pools {
+    mempool_t *clients;
+    mempool_t *cold;
+    mempool_t *bb;
+    mempool_t *xbox;
+} client_pools_t;
+
+/* The parts of a client that only a few kinds of packets or commands ever look
+   at: the player's inventory, quest script state, ignore lists, logging and so
+   on. These are kept in their own piece, away from the client structure, so
+   that the rest of it stays small. Every client has one. */
+typedef struct client_cold {
+    struct sockaddr_storage ip_addr;
 
-    pthread_mutex_t mutex;
-    pkt_header_t pkt;
+    uint32_t ignore_list[CLIENT_IGNORE_LIST_SIZE];
+    uint32_t blacklist[CLIENT_BLACKLIST_SIZE];
+    client_blocklist_t *blocklist;
+    uint32_t blocklist_size;
 
-    CRYPT_SETUP ckey;
-    CRYPT_SETUP skey;
+    uint32_t last_info_req;
+
+    void *autoreply;
+    int autoreply_len;
+    uint8_t autoreply_on;
+
+    FILE *logfile;
 
+    int item_count;
+    uint32_t next_item[4];
+    item_t items[30];
+
+    float drop_x;
+    float drop_z;
+    uint32_t drop_area;
+    uint32_t drop_item;
+    uint32_t drop_amt;
+
+    uint32_t p2_drops[30];
+    uint32_t p2_drops_max;
+
+    bb_security_data_t sec_data;
+
+    int script_ref;
+    uint64_t aoe_timer;
+
+    uint32_t q_stack[CLIENT_MAX_QSTACK];
+    int q_stack_top;
+} client_cold_t;
+
+/* Ship server client structure. */
+struct ship_client {
+    /* Everything that gets looked at on most passes through a block's loop or
+       for most packets is kept together up here, so that walking the client
+       list and handling a packet only pull in the first few cache lines. The
+       bulky and rarely touched stuff follows after. */
+    TAILQ_ENTRY(ship_client) qentry;
+    uint32_t flags;
     int version;
     int sock;
     int hdr_size;
     int client_id;
+    uint32_t guildcard;
 
-    int language_code;
-    int cur_area;
+    struct block_worker *worker;        /* NULL for ship clients. */
+    block_t *cur_block;
+    struct ship_client *gc_next;        /* Guild card index chain. */
+    int gc_indexed;
+    lobby_t *cur_lobby;
+    player_t *pl;
+
+    time_t last_message;
+    time_t last_sent;
+
+    unsigned char *recvbuf;
     int recvbuf_cur;
     int recvbuf_size;
+    int recvbuf_start;
+    int recvbuf_dec;
+    sendq_t sendq;
+    cipher_ks_t ckey_ks;
+    cipher_ks_t skey_ks;
+
+    evloop_t *evl;
+    int ev_write;
+    int flush_pending;
+    int refill_pending;
+    int dead_queued;
+    struct ship_client *dead_next;
+
+    /* Packets other workers have sent the client, not yet encrypted. These are
+       only touched with pend_mutex held, and the owning worker moves them over
+       to sendq at the end of its pass (or before anything else is sent). */
+    sendq_t pendq;
+    pthread_mutex_t pend_mutex;
+    int pend_queued;
+    struct ship_client *pend_next;
+    TAILQ_ENTRY(ship_client) flush_qentry;
+    TAILQ_ENTRY(ship_client) refill_qentry;
+    timer_wheel_t *timers;
+    timer_entry_t timer;
 
-    int sendbuf_cur;
-    int sendbuf_size;
-    int sendbuf_start;
-    int item_count;
+    pthread_mutex_t mutex;
+    client_pools_t *pools;
 
-    int autoreply_len;
+    /* Less frequently used stuff from here on. */
+    client_cold_t *cold;
+
+    int language_code;
+    int cur_area;
     int lobby_id;
 
     float x;
@@ -114,42 +220,10 @@ struct ship_client {
     float z;
     float w;
 
-    struct sockaddr_storage ip_addr;
-
-    uint32_t guildcard;
-    uint32_t flags;
     uint32_t arrow;
-    uint32_t blocklist_size;
-
-    uint32_t next_item[4];
-    uint32_t ignore_list[CLIENT_IGNORE_LIST_SIZE];
-    uint32_t blacklist[CLIENT_BLACKLIST_SIZE];
-
-    client_blocklist_t *blocklist;
-
-    uint32_t last_info_req;
-
-    float drop_x;
-    float drop_z;
-    uint32_t drop_area;
-    uint32_t drop_item;
-    uint32_t drop_amt;
-
     uint32_t privilege;
     uint8_t cc_char;
     uint8_t q_lang;
-    uint8_t autoreply_on;
-
-    item_t items[30];
-
-    block_t *cur_block;
-    lobby_t *cur_lobby;
-    player_t *pl;
-
-    unsigned char *recvbuf;
-    unsigned char *sendbuf;
-    void *autoreply;
-    FILE *logfile;
 
     char *infoboard;                    /* Points into the player struct. */
     uint8_t *c_rank;                    /* Points into the player struct. */
@@ -160,26 +234,19 @@ struct ship_client {
     sylverant_limits_t *limits;
     xbox_ip_t *xbl_ip;
 
-    time_t last_message;
-    time_t last_sent;
     time_t join_time;
     time_t login_time;
 
-    bb_security_data_t sec_data;
     sylverant_bb_db_char_t *bb_pl;
     sylverant_bb_db_opts_t *bb_opts;
 
-    int script_ref;
-    uint64_t aoe_timer;
-
-    uint32_t q_stack[CLIENT_MAX_QSTACK];
-    int q_stack_top;
-
-    uint32_t p2_drops[30];
-    uint32_t p2_drops_max;
-
     lobby_t *lobby_req;
 
+    /* The cipher state is big, and with the keystream rings above it's only
+       needed when generating more keystream (or for Blue Burst). */
+    CRYPT_SETUP ckey;
+    CRYPT_SETUP skey;
+
 #ifdef DEBUG
     uint8_t sdrops_ver;
     uint8_t sdrops_ep;
@@ -232,6 +299,10 @@ extern pthread_key_t recvbuf_key;
 /* The key used for the thread-specific send buffer. */
 extern pthread_key_t sendbuf_key;
 
+/* The key used for the thread-specific buffer for packets sent to a bunch of
+   clients at once. */
+extern pthread_key_t fanoutbuf_key;
+
 /* Possible values for the type field of ship_client_t */
 #define CLIENT_TYPE_SHIP        0
 #define CLIENT_TYPE_BLOCK       1
@@ -255,7 +326,6 @@ extern pthread_key_t sendbuf_key;
 #define CLIENT_LANG_CHINESE_TRAD    6
 #define CLIENT_LANG_KOREAN          7
 
-#define CLIENT_FLAG_HDR_READ        0x00000001
 #define CLIENT_FLAG_GOT_05          0x00000002
 #define CLIENT_FLAG_INVULNERABLE    0x00000004
 #define CLIENT_FLAG_INFINITE_TP     0x00000008
@@ -330,10 +400,19 @@ int client_init(sylverant_ship_t *cfg);
 /* Clean up the clients system. */
 void client_shutdown(void);
 
+/* Create the pools for clients of a block (if block is non-zero) or for the
+   clients connected to the ship itself. */
+client_pools_t *client_pools_create(int block);
+
+/* Destroy a set of client pools. Every client allocated from them must have
+   already been destroyed. */
+void client_pools_destroy(client_pools_t *p);
+
 /* Create a new connection, storing it in the list of clients. */
 ship_client_t *client_create_connection(int sock, int version, int type,
                                         struct client_queue *clients,
-                                        ship_t *ship, block_t *block,
+                                        ship_t *ship,
+                                        struct block_worker *worker,
                                         struct sockaddr *ip, socklen_t size);
 
 /* Destroy a connection, closing the socket and removing it from the list. */
@@ -342,6 +421,30 @@ void client_destroy_connection(ship_client_t *c, struct client_queue *clients);
 /* Read data from a client that is connected to any port. */
 int client_process_pkt(ship_client_t *c);
 
+/* Attempt to send any data that has been buffered up for the client. */
+int client_send_buffered(ship_client_t *c);
+
+/* Update the events the client is waited on for in its event loop, based on
+   whether or not it has anything buffered to send. */
+void client_update_events(ship_client_t *c);
+
+/* Flag a client to be disconnected. A block client is also put on its worker's
+   list of clients to clean up, so that the worker doesn't have to go looking
+   through every client on the block for them. Safe to call from any thread
+   that can safely look at the client. */
+void client_disconnect(ship_client_t *c);
+
+/* Put a client on its worker's list of clients to flush output for at the end
+   of the current pass through the loop. Must only be called on the worker's
+   own thread. */
+void client_queue_flush(ship_client_t *c);
+
+/* If keystream prefilling is enabled and either of the client's keystream
+   rings is running low, put the client on its worker's list of clients to top
+   them up for once everything else in the current pass through the loop is
+   done. This does nothing when not called on the client's own worker. */
+void client_queue_refill(ship_client_t *c);
+
 /* Retrieve the thread-specific recvbuf for the current thread. */
 uint8_t *get_recvbuf(void);
 
@@ -1,7 +1,7 @@
 /*
     Sylverant Ship Server
     Copyright (C) 2009, 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018,
-                  2019, 2020, 2021, 2022, 2023 Lawrence Sebald
+                  2019, 2020, 2021, 2022, 2023, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -44,6 +44,7 @@
 #include "rtdata.h"
 #include "scripts.h"
 #include "version.h"
+#include "epoch.h"
 
 int handle_dc_gcsend(ship_client_t *s, ship_client_t *d,
                      subcmd_dc_gcsend_t *pkt);
@@ -450,10 +451,10 @@ static int handle_item(ship_client_t *c, const char *params) {
         return send_txt(c, "%s", __(c, "\tE\tC7Invalid item code."));
     }
 
-    c->next_item[0] = item[0];
-    c->next_item[1] = item[1];
-    c->next_item[2] = item[2];
-    c->next_item[3] = item[3];
+    c->cold->next_item[0] = item[0];
+    c->cold->next_item[1] = item[1];
+    c->cold->next_item[2] = item[2];
+    c->cold->next_item[3] = item[3];
 
     return send_txt(c, "%s", __(c, "\tE\tC7Next item set successfully."));
 }
@@ -475,7 +476,7 @@ static int handle_item4(ship_client_t *c, const char *params) {
         return send_txt(c, "%s", __(c, "\tE\tC7Invalid item code."));
     }
 
-    c->next_item[3] = item;
+    c->cold->next_item[3] = item;
 
     return send_txt(c, "%s", __(c, "\tE\tC7Next item set successfully."));
 }
@@ -535,6 +536,7 @@ static int handle_passwd(ship_client_t *c, const char *params) {
 
     /* Copy the new password in. */
     strcpy(l->passwd, params);
+    block_game_list_changed(l->block);
 
     pthread_mutex_unlock(&l->mutex);
 
@@ -565,6 +567,7 @@ static int handle_lname(ship_client_t *c, const char *params) {
 
     /* Copy the new name in. */
     strcpy(l->name, params);
+    block_game_list_changed(l->block);
 
     pthread_mutex_unlock(&l->mutex);
 
@@ -626,7 +629,7 @@ static int handle_clinfo(ship_client_t *c, const char *params) {
     }
 
     /* Fill in the client's info. */
-    my_ntop(&cl->ip_addr, ip);
+    my_ntop(&cl->cold->ip_addr, ip);
     return send_txt(c, "\tE\tC7Name: %s\nIP: %s\nGC: %u\n%s Lv.%d",
                     cl->pl->v1.name, ip, cl->guildcard,
                     classes[cl->pl->v1.ch_class], cl->pl->v1.level + 1);
@@ -804,16 +807,14 @@ static int handle_legit(ship_client_t *c, const char *params) {
     }
 
     /* XXXX: Select the appropriate limits file. */
-    pthread_rwlock_rdlock(&ship->llock);
-    if(!ship->def_limits) {
-        pthread_rwlock_unlock(&ship->llock);
+    epoch_enter();
+    if(!(limits = EPOCH_DEREF(ship->limits)->def)) {
+        epoch_exit();
         return send_txt(c, "%s", __(c, "\tE\tC7Legit mode not\n"
                                     "available on this\n"
                                     "ship."));
     }
 
-    limits = ship->def_limits;
-
     /* Make sure the player qualifies for legit mode... */
     for(j = 0; j < c->pl->v1.inv.item_count; ++j) {
         item = (sylverant_iitem_t *)&c->pl->v1.inv.items[j];
@@ -824,7 +825,7 @@ static int handle_legit(ship_client_t *c, const char *params) {
                   "%08x %08x %08x %08x\n", LE32(item->data_l[0]),
                   LE32(item->data_l[1]), LE32(item->data_l[2]),
                   LE32(item->data2_l));
-            pthread_rwlock_unlock(&ship->llock);
+            epoch_exit();
             return send_txt(c, "%s", __(c, "\tE\tC7You failed the legit "
                                            "check."));
         }
@@ -834,7 +835,7 @@ static int handle_legit(ship_client_t *c, const char *params) {
     c->flags |= CLIENT_FLAG_LEGIT;
     c->limits = retain(limits);
 
-    pthread_rwlock_unlock(&ship->llock);
+    epoch_exit();
 
     return send_txt(c, "%s", __(c, "\tE\tC7Legit mode on\n"
                                 "for your next team."));
@@ -1083,6 +1084,7 @@ static int handle_dconly(ship_client_t *c, const char *params) {
     /* See if we're turning the flag off. */
     if(!strcmp(params, "off")) {
         l->flags &= ~LOBBY_FLAG_DCONLY;
+        block_game_list_changed(l->block);
         pthread_mutex_unlock(&l->mutex);
         return send_txt(c, "%s", __(c, "\tE\tC7Dreamcast-only mode off."));
     }
@@ -1102,6 +1104,7 @@ static int handle_dconly(ship_client_t *c, const char *params) {
 
     /* We passed the check, set the flag and unlock the lobby. */
     l->flags |= LOBBY_FLAG_DCONLY;
+    block_game_list_changed(l->block);
     pthread_mutex_unlock(&l->mutex);
 
     /* Tell the leader that the command has been activated. */
@@ -1132,6 +1135,7 @@ static int handle_v1only(ship_client_t *c, const char *params) {
     /* See if we're turning the flag off. */
     if(!strcmp(params, "off")) {
         l->flags &= ~LOBBY_FLAG_V1ONLY;
+        block_game_list_changed(l->block);
         pthread_mutex_unlock(&l->mutex);
         return send_txt(c, "%s", __(c, "\tE\tC7V1-only mode off."));
     }
@@ -1150,6 +1154,7 @@ static int handle_v1only(ship_client_t *c, const char *params) {
 
     /* We passed the check, set the flag and unlock the lobby. */
     l->flags |= LOBBY_FLAG_V1ONLY;
+    block_game_list_changed(l->block);
     pthread_mutex_unlock(&l->mutex);
 
     /* Tell the leader that the command has been activated. */
@@ -1331,14 +1336,14 @@ static int handle_makeitem(ship_client_t *c, const char *params) {
     }
 
     /* Make sure there's something set with /item */
-    if(!c->next_item[0]) {
+    if(!c->cold->next_item[0]) {
         pthread_mutex_unlock(&l->mutex);
         return send_txt(c, "%s", __(c, "\tE\tC7Need to set an item first."));
     }
 
     /* If we're on Blue Burst, add the item to the lobby's inventory first. */
     if(l->version == CLIENT_VERSION_BB) {
-        item = lobby_add_item_locked(l, c->next_item);
+        item = lobby_add_item_locked(l, c->cold->next_item);
 
         if(!item) {
             pthread_mutex_unlock(&l->mutex);
@@ -1361,18 +1366,18 @@ static int handle_makeitem(ship_client_t *c, const char *params) {
     p2.unk = LE16(0);
     p2.x = c->x;
     p2.z = c->z;
-    p2.item[0] = LE32(c->next_item[0]);
-    p2.item[1] = LE32(c->next_item[1]);
-    p2.item[2] = LE32(c->next_item[2]);
+    p2.item[0] = LE32(c->cold->next_item[0]);
+    p2.item[1] = LE32(c->cold->next_item[1]);
+    p2.item[2] = LE32(c->cold->next_item[2]);
     p2.item_id = LE32((l->item_id - 1));
-    p2.item2 = LE32(c->next_item[3]);
+    p2.item2 = LE32(c->cold->next_item[3]);
     p2.two = LE32(0x00000002);
 
     /* Clear the set item */
-    c->next_item[0] = 0;
-    c->next_item[1] = 0;
-    c->next_item[2] = 0;
-    c->next_item[3] = 0;
+    c->cold->next_item[0] = 0;
+    c->cold->next_item[1] = 0;
+    c->cold->next_item[2] = 0;
+    c->cold->next_item[3] = 0;
 
     /* Send the packet to everyone in the lobby */
     pthread_mutex_unlock(&l->mutex);
@@ -1454,11 +1459,11 @@ static void dumpinv_internal(ship_client_t *c) {
         debug(DBG_LOG, "Inventory dump for %s (%d)\n", c->pl->v1.name,
               c->guildcard);
 
-        for(i = 0; i < c->item_count; ++i) {
+        for(i = 0; i < c->cold->item_count; ++i) {
             debug(DBG_LOG, "%d (%08x): %08x %08x %08x %08x: %s\n", i,
-                   LE32(c->items[i].item_id), LE32(c->items[i].data_l[0]),
-                   LE32(c->items[i].data_l[1]), LE32(c->items[i].data_l[2]),
-                   LE32(c->items[i].data2_l), item_get_name(&c->items[i], v));
+                   LE32(c->cold->items[i].item_id), LE32(c->cold->items[i].data_l[0]),
+                   LE32(c->cold->items[i].data_l[1]), LE32(c->cold->items[i].data_l[2]),
+                   LE32(c->cold->items[i].data2_l), item_get_name(&c->cold->items[i], v));
         }
     }
     else {
@@ -1487,7 +1492,7 @@ static int handle_dumpinv(ship_client_t *c, const char *params) {
     lobby_t *l = c->cur_lobby;
     lobby_item_t *j;
     int do_lobby;
-    uint32_t client;
+    uint32_t client, k;
 
     /* Make sure the requester is a GM. */
     if(!LOCAL_GM(c)) {
@@ -1508,7 +1513,7 @@ static int handle_dumpinv(ship_client_t *c, const char *params) {
         debug(DBG_LOG, "Inventory dump for lobby %s (%" PRIu32 ")\n", l->name,
               l->lobby_id);
 
-        TAILQ_FOREACH(j, &l->item_queue, qentry) {
+        LOBBY_ITEM_FOREACH(l, k, j) {
             debug(DBG_LOG, "%08x: %08x %08x %08x %08x: %s\n",
                   LE32(j->d.item_id), LE32(j->d.data_l[0]),
                   LE32(j->d.data_l[1]), LE32(j->d.data_l[2]),
@@ -1618,6 +1623,7 @@ static int handle_allowgc(ship_client_t *c, const char *params) {
     /* See if we're turning the flag off. */
     if(!strcmp(params, "off")) {
         l->flags &= ~LOBBY_FLAG_GC_ALLOWED;
+        block_game_list_changed(l->block);
         pthread_mutex_unlock(&l->mutex);
         return send_txt(c, "%s", __(c, "\tE\tC7Gamecube disallowed."));
     }
@@ -1631,6 +1637,7 @@ static int handle_allowgc(ship_client_t *c, const char *params) {
 
     /* We passed the check, set the flag and unlock the lobby. */
     l->flags |= LOBBY_FLAG_GC_ALLOWED;
+    block_game_list_changed(l->block);
     pthread_mutex_unlock(&l->mutex);
 
     /* Tell the leader that the command has been activated. */
@@ -1839,6 +1846,7 @@ static int handle_npc(ship_client_t *c, const char *params) {
 
     /* This command, for now anyway, locks us down to one player mode. */
     l->flags |= LOBBY_FLAG_SINGLEPLAYER | LOBBY_FLAG_HAS_NPC;
+    block_game_list_changed(l->block);
 
     /* We're done with the lobby data now... */
     pthread_mutex_unlock(&l->mutex);
@@ -1955,8 +1963,8 @@ static int handle_ignore(ship_client_t *c, const char *params) {
 
     /* Find an empty spot to put this in. */
     for(i = 0; i < CLIENT_IGNORE_LIST_SIZE; ++i) {
-        if(!c->ignore_list[i]) {
-            c->ignore_list[i] = cl->guildcard;
+        if(!c->cold->ignore_list[i]) {
+            c->cold->ignore_list[i] = cl->guildcard;
             pthread_mutex_unlock(&l->mutex);
             return send_txt(c, "%s %s\n%s %d", __(c, "\tE\tC7Ignoring"),
                             cl->pl->v1.name, __(c, "Entry"), i);
@@ -1986,14 +1994,14 @@ static int handle_unignore(ship_client_t *c, const char *params) {
     }
 
     /* Clear that entry of the ignore list */
-    c->ignore_list[id] = 0;
+    c->cold->ignore_list[id] = 0;
 
     return send_txt(c, "%s", __(c, "\tE\tC7Ignore list entry cleared."));
 }
 
 /* Usage: /quit */
 static int handle_quit(ship_client_t *c, const char *params) {
-    c->flags |= CLIENT_FLAG_DISCONNECTED;
+    client_disconnect(c);
     return 0;
 }
 
@@ -2067,7 +2075,7 @@ static int handle_ban_d(ship_client_t *c, const char *params) {
                                          __(i, "1 day"));
                     }
 
-                    i->flags |= CLIENT_FLAG_DISCONNECTED;
+                    client_disconnect(i);
                 }
             }
 
@@ -2127,7 +2135,7 @@ static int handle_ban_w(ship_client_t *c, const char *params) {
                                          __(i, "1 week"));
                     }
 
-                    i->flags |= CLIENT_FLAG_DISCONNECTED;
+                    client_disconnect(i);
                 }
             }
 
@@ -2188,7 +2196,7 @@ static int handle_ban_m(ship_client_t *c, const char *params) {
                                          __(i, "30 days"));
                     }
 
-                    i->flags |= CLIENT_FLAG_DISCONNECTED;
+                    client_disconnect(i);
                 }
             }
 
@@ -2248,7 +2256,7 @@ static int handle_ban_p(ship_client_t *c, const char *params) {
                                          __(i, "Forever"));
                     }
 
-                    i->flags |= CLIENT_FLAG_DISCONNECTED;
+                    client_disconnect(i);
                 }
             }
 
@@ -3233,9 +3241,9 @@ static int handle_autolegit(ship_client_t *c, const char *params) {
 
     /* Check them now, since they shouldn't have to re-connect to get the
        flag set... */
-    pthread_rwlock_rdlock(&ship->llock);
-    if(!ship->def_limits) {
-        pthread_rwlock_unlock(&ship->llock);
+    epoch_enter();
+    if(!(limits = EPOCH_DEREF(ship->limits)->def)) {
+        epoch_exit();
         c->flags &= ~CLIENT_FLAG_ALWAYS_LEGIT;
         send_txt(c, "%s", __(c, "\tE\tC7Legit mode not\n"
                                 "available on this\n"
@@ -3243,8 +3251,6 @@ static int handle_autolegit(ship_client_t *c, const char *params) {
         return 0;
     }
 
-    limits = ship->def_limits;
-
     if(client_legit_check(c, limits)) {
         c->flags &= ~CLIENT_FLAG_ALWAYS_LEGIT;
         send_txt(c, "%s", __(c, "\tE\tC7You failed the legit "
@@ -3257,7 +3263,7 @@ static int handle_autolegit(ship_client_t *c, const char *params) {
         send_txt(c, "%s", __(c, "\tE\tC7Legit check passed."));
     }
 
-    pthread_rwlock_unlock(&ship->llock);
+    epoch_exit();
     return 0;
 }
 
@@ -3399,7 +3405,7 @@ static int handle_ib(ship_client_t *c, const char *params) {
 
             TAILQ_FOREACH(i, b->clients, qentry) {
                 /* Disconnect them if we find them */
-                nm = (struct sockaddr_in *)&i->ip_addr;
+                nm = (struct sockaddr_in *)&i->cold->ip_addr;
                 if(nm->sin_family == AF_INET &&
                    ip->sin_addr.s_addr == nm->sin_addr.s_addr) {
                     if(reason && strlen(reason)) {
@@ -3414,7 +3420,7 @@ static int handle_ib(ship_client_t *c, const char *params) {
                                             "this ship."));
                     }
 
-                    i->flags |= CLIENT_FLAG_DISCONNECTED;
+                    client_disconnect(i);
                 }
             }
 
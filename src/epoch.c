@@ -0,0 +1,146 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <sylverant/debug.h>
+
+#include "epoch.h"
+
+/* Each thread that has ever entered a read section has one of these. The epoch
+   is the value of the global epoch when the thread entered its outermost read
+   section, or zero when it isn't in one. Records are never freed, but they are
+   reused once the thread that owned one exits. */
+typedef struct epoch_rec {
+    struct epoch_rec *next;
+    uint64_t epoch;
+    int nest;
+    int in_use;
+} epoch_rec_t;
+
+static uint64_t global_epoch = 1;
+
+static epoch_rec_t *recs = NULL;
+static pthread_mutex_t recs_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_key_t rec_key;
+static pthread_once_t rec_key_once = PTHREAD_ONCE_INIT;
+
+static void release_rec(void *d) {
+    epoch_rec_t *r = (epoch_rec_t *)d;
+
+    pthread_mutex_lock(&recs_mutex);
+    __atomic_store_n(&r->epoch, 0, __ATOMIC_RELEASE);
+    r->nest = 0;
+    r->in_use = 0;
+    pthread_mutex_unlock(&recs_mutex);
+}
+
+static void make_rec_key(void) {
+    pthread_key_create(&rec_key, &release_rec);
+}
+
+static epoch_rec_t *get_rec(void) {
+    epoch_rec_t *r;
+
+    pthread_once(&rec_key_once, &make_rec_key);
+
+    if((r = (epoch_rec_t *)pthread_getspecific(rec_key)))
+        return r;
+
+    pthread_mutex_lock(&recs_mutex);
+
+    /* Reuse a record left behind by a thread that's gone, if there is one. */
+    for(r = recs; r; r = r->next) {
+        if(!r->in_use)
+            break;
+    }
+
+    if(!r) {
+        /* If this fails, there's really nothing sensible that can be done about
+           it, so just bail out. */
+        if(!(r = (epoch_rec_t *)malloc(sizeof(epoch_rec_t)))) {
+            debug(DBG_ERROR, "Cannot allocate epoch record!\n");
+            abort();
+        }
+
+        memset(r, 0, sizeof(epoch_rec_t));
+        r->next = recs;
+        recs = r;
+    }
+
+    r->in_use = 1;
+    pthread_mutex_unlock(&recs_mutex);
+
+    pthread_setspecific(rec_key, r);
+    return r;
+}
+
+void epoch_enter(void) {
+    epoch_rec_t *r = get_rec();
+
+    if(r->nest++)
+        return;
+
+    /* Announce which epoch we're in before looking at anything. The fence makes
+       sure that a writer scanning the records sees this before we read any of
+       the pointers that it might be replacing. */
+    __atomic_store_n(&r->epoch, __atomic_load_n(&global_epoch,
+                                                __ATOMIC_RELAXED),
+                     __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void epoch_exit(void) {
+    epoch_rec_t *r = get_rec();
+
+    if(--r->nest)
+        return;
+
+    __atomic_store_n(&r->epoch, 0, __ATOMIC_RELEASE);
+}
+
+void *epoch_publish(void **slot, void *val) {
+    return __atomic_exchange_n(slot, val, __ATOMIC_SEQ_CST);
+}
+
+void epoch_synchronize(void) {
+    struct timespec ts = { 0, 1000000 };
+    uint64_t target, e;
+    epoch_rec_t *r;
+
+    /* Anyone that enters a read section after this will see the new epoch (and
+       any pointers published before it). Anyone that has an older epoch might
+       still be looking at old data, so wait for them to get out. */
+    target = __atomic_add_fetch(&global_epoch, 1, __ATOMIC_SEQ_CST);
+
+    pthread_mutex_lock(&recs_mutex);
+
+    for(r = recs; r; r = r->next) {
+        while((e = __atomic_load_n(&r->epoch, __ATOMIC_ACQUIRE)) &&
+              e < target) {
+            nanosleep(&ts, NULL);
+        }
+    }
+
+    pthread_mutex_unlock(&recs_mutex);
+}
@@ -0,0 +1,52 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EPOCH_H
+#define EPOCH_H
+
+/* Epoch-based protection for read-mostly data that gets replaced wholesale
+   (the GM list and the limits lists, for instance).
+
+   Readers bracket their use of the data with epoch_enter() and epoch_exit()
+   and grab the current version with EPOCH_DEREF(). Neither of those touch any
+   shared lock word, they only write to the calling thread's own record.
+   Read sections may nest, but should be kept short and must not block waiting
+   on anything that a writer might be holding.
+
+   Writers build a completely new version of the data, put it in place with
+   epoch_publish(), and then call epoch_synchronize() before freeing the old
+   version. That waits until every thread that might still be looking at the
+   old version has left its read section. Writers must not be inside a read
+   section themselves when they do this. */
+
+/* Start or finish a read section on the calling thread. */
+void epoch_enter(void);
+void epoch_exit(void);
+
+/* Grab the current version of a published pointer. Only valid inside a read
+   section (or on the thread that publishes the pointer). */
+#define EPOCH_DEREF(p)  __atomic_load_n(&(p), __ATOMIC_ACQUIRE)
+
+/* Replace a published pointer, returning the old version. The old version may
+   still be in use until epoch_synchronize() returns. */
+void *epoch_publish(void **slot, void *val);
+
+/* Wait until every read section that was running when this was called has
+   finished. */
+void epoch_synchronize(void);
+
+#endif /* !EPOCH_H */
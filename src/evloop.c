@@ -0,0 +1,304 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#else
+#include <sys/time.h>
+#include <sys/select.h>
+#endif
+
+#include <sylverant/debug.h>
+
+#include "evloop.h"
+
+#ifdef HAVE_SYS_EPOLL_H
+
+/* Linux epoll backend. Descriptors are registered once and the kernel keeps
+   track of them, so waiting costs time proportional to the number of ready
+   descriptors, not the number of registered ones. */
+struct evloop {
+    int epfd;
+    struct epoll_event evs[EVLOOP_MAX_EVENTS];
+};
+
+static uint32_t to_epoll(uint32_t events) {
+    uint32_t rv = 0;
+
+    if(events & EVLOOP_READ)
+        rv |= EPOLLIN;
+    if(events & EVLOOP_WRITE)
+        rv |= EPOLLOUT;
+
+    return rv;
+}
+
+evloop_t *evloop_create(void) {
+    evloop_t *rv = (evloop_t *)malloc(sizeof(evloop_t));
+
+    if(!rv) {
+        debug(DBG_ERROR, "Cannot allocate memory for event loop: %s\n",
+              strerror(errno));
+        return NULL;
+    }
+
+    if((rv->epfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+        debug(DBG_ERROR, "Cannot create epoll instance: %s\n",
+              strerror(errno));
+        free(rv);
+        return NULL;
+    }
+
+    return rv;
+}
+
+void evloop_destroy(evloop_t *l) {
+    close(l->epfd);
+    free(l);
+}
+
+int evloop_add(evloop_t *l, int fd, uint32_t events, void *data) {
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = to_epoll(events);
+    ev.data.ptr = data;
+
+    if(epoll_ctl(l->epfd, EPOLL_CTL_ADD, fd, &ev)) {
+        debug(DBG_WARN, "Cannot add fd %d to event loop: %s\n", fd,
+              strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+int evloop_modify(evloop_t *l, int fd, uint32_t events, void *data) {
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = to_epoll(events);
+    ev.data.ptr = data;
+
+    if(epoll_ctl(l->epfd, EPOLL_CTL_MOD, fd, &ev)) {
+        debug(DBG_WARN, "Cannot modify fd %d in event loop: %s\n", fd,
+              strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+int evloop_remove(evloop_t *l, int fd) {
+    struct epoll_event ev;
+
+    /* Kernels before 2.6.9 require a non-NULL event here, even though it is
+       ignored. */
+    if(epoll_ctl(l->epfd, EPOLL_CTL_DEL, fd, &ev))
+        return -1;
+
+    return 0;
+}
+
+int evloop_wait(evloop_t *l, evloop_event_t *evs, int max, int timeout) {
+    int i, n;
+    uint32_t e;
+
+    if(max > EVLOOP_MAX_EVENTS)
+        max = EVLOOP_MAX_EVENTS;
+
+    n = epoll_wait(l->epfd, l->evs, max, timeout);
+
+    if(n < 0) {
+        if(errno == EINTR)
+            return 0;
+
+        return -1;
+    }
+
+    for(i = 0; i < n; ++i) {
+        e = l->evs[i].events;
+        evs[i].data = l->evs[i].data.ptr;
+        evs[i].events = 0;
+
+        if(e & (EPOLLIN | EPOLLHUP))
+            evs[i].events |= EVLOOP_READ;
+        if(e & EPOLLOUT)
+            evs[i].events |= EVLOOP_WRITE;
+        if(e & EPOLLERR)
+            evs[i].events |= EVLOOP_ERROR | EVLOOP_READ;
+    }
+
+    return n;
+}
+
+const char *evloop_backend(void) {
+    return "epoll";
+}
+
+#else /* !HAVE_SYS_EPOLL_H */
+
+/* Portable select() backend. This keeps master copies of the fd_sets so that
+   they don't have to be rebuilt by the caller every time through the loop, but
+   it is still limited to FD_SETSIZE descriptors and is O(n) per wakeup. */
+struct evloop {
+    pthread_mutex_t mutex;
+    fd_set readfds;
+    fd_set writefds;
+    int maxfd;
+    void *data[FD_SETSIZE];
+};
+
+evloop_t *evloop_create(void) {
+    evloop_t *rv = (evloop_t *)malloc(sizeof(evloop_t));
+
+    if(!rv) {
+        debug(DBG_ERROR, "Cannot allocate memory for event loop: %s\n",
+              strerror(errno));
+        return NULL;
+    }
+
+    memset(rv, 0, sizeof(evloop_t));
+    FD_ZERO(&rv->readfds);
+    FD_ZERO(&rv->writefds);
+    rv->maxfd = -1;
+    pthread_mutex_init(&rv->mutex, NULL);
+
+    return rv;
+}
+
+void evloop_destroy(evloop_t *l) {
+    pthread_mutex_destroy(&l->mutex);
+    free(l);
+}
+
+static void set_events(evloop_t *l, int fd, uint32_t events, void *data) {
+    if(events & EVLOOP_READ)
+        FD_SET(fd, &l->readfds);
+    else
+        FD_CLR(fd, &l->readfds);
+
+    if(events & EVLOOP_WRITE)
+        FD_SET(fd, &l->writefds);
+    else
+        FD_CLR(fd, &l->writefds);
+
+    l->data[fd] = data;
+}
+
+int evloop_add(evloop_t *l, int fd, uint32_t events, void *data) {
+    if(fd < 0 || fd >= FD_SETSIZE) {
+        debug(DBG_WARN, "Cannot add fd %d to event loop: out of range\n", fd);
+        return -1;
+    }
+
+    pthread_mutex_lock(&l->mutex);
+    set_events(l, fd, events, data);
+
+    if(fd > l->maxfd)
+        l->maxfd = fd;
+
+    pthread_mutex_unlock(&l->mutex);
+    return 0;
+}
+
+int evloop_modify(evloop_t *l, int fd, uint32_t events, void *data) {
+    if(fd < 0 || fd >= FD_SETSIZE)
+        return -1;
+
+    pthread_mutex_lock(&l->mutex);
+    set_events(l, fd, events, data);
+    pthread_mutex_unlock(&l->mutex);
+    return 0;
+}
+
+int evloop_remove(evloop_t *l, int fd) {
+    if(fd < 0 || fd >= FD_SETSIZE)
+        return -1;
+
+    pthread_mutex_lock(&l->mutex);
+    FD_CLR(fd, &l->readfds);
+    FD_CLR(fd, &l->writefds);
+    l->data[fd] = NULL;
+
+    while(l->maxfd >= 0 && !FD_ISSET(l->maxfd, &l->readfds) &&
+          !FD_ISSET(l->maxfd, &l->writefds))
+        --l->maxfd;
+
+    pthread_mutex_unlock(&l->mutex);
+    return 0;
+}
+
+int evloop_wait(evloop_t *l, evloop_event_t *evs, int max, int timeout) {
+    fd_set readfds, writefds;
+    struct timeval tv, *tvp = NULL;
+    int i, n, nfds, rv = 0;
+
+    pthread_mutex_lock(&l->mutex);
+    readfds = l->readfds;
+    writefds = l->writefds;
+    nfds = l->maxfd + 1;
+    pthread_mutex_unlock(&l->mutex);
+
+    if(timeout >= 0) {
+        tv.tv_sec = timeout / 1000;
+        tv.tv_usec = (timeout % 1000) * 1000;
+        tvp = &tv;
+    }
+
+    if((n = select(nfds, &readfds, &writefds, NULL, tvp)) < 0) {
+        if(errno == EINTR)
+            return 0;
+
+        return -1;
+    }
+
+    for(i = 0; i < nfds && n > 0 && rv < max; ++i) {
+        if(!FD_ISSET(i, &readfds) && !FD_ISSET(i, &writefds))
+            continue;
+
+        evs[rv].data = l->data[i];
+        evs[rv].events = 0;
+
+        if(FD_ISSET(i, &readfds)) {
+            evs[rv].events |= EVLOOP_READ;
+            --n;
+        }
+
+        if(FD_ISSET(i, &writefds)) {
+            evs[rv].events |= EVLOOP_WRITE;
+            --n;
+        }
+
+        ++rv;
+    }
+
+    return rv;
+}
+
+const char *evloop_backend(void) {
+    return "select";
+}
+
+#endif /* HAVE_SYS_EPOLL_H */
@@ -0,0 +1,70 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EVLOOP_H
+#define EVLOOP_H
+
+#include <stdint.h>
+
+/* Event bits that can be waited on/returned for a file descriptor. */
+#define EVLOOP_READ     0x00000001
+#define EVLOOP_WRITE    0x00000002
+#define EVLOOP_ERROR    0x00000004
+
+/* The maximum number of events returned from one call to evloop_wait(). */
+#define EVLOOP_MAX_EVENTS   256
+
+/* A single readiness event. The data pointer is whatever was passed in when
+   the file descriptor was registered. */
+typedef struct evloop_event {
+    void *data;
+    uint32_t events;
+} evloop_event_t;
+
+/* Opaque event loop structure. The backend used (epoll or select) is chosen at
+   build time, based on what the system supports. */
+struct evloop;
+
+#ifndef EVLOOP_DEFINED
+#define EVLOOP_DEFINED
+typedef struct evloop evloop_t;
+#endif
+
+/* Create a new event loop. */
+evloop_t *evloop_create(void);
+
+/* Destroy an event loop. This does not close any registered descriptors. */
+void evloop_destroy(evloop_t *l);
+
+/* Register a file descriptor with the event loop. */
+int evloop_add(evloop_t *l, int fd, uint32_t events, void *data);
+
+/* Change the set of events being waited on for a registered descriptor. This
+   is safe to call from threads other than the one waiting on the loop. */
+int evloop_modify(evloop_t *l, int fd, uint32_t events, void *data);
+
+/* Unregister a file descriptor. This must be done before closing it. */
+int evloop_remove(evloop_t *l, int fd);
+
+/* Wait for events. The timeout is in milliseconds, with -1 meaning to wait
+   forever. Returns the number of events filled in, or -1 on error. */
+int evloop_wait(evloop_t *l, evloop_event_t *evs, int max, int timeout);
+
+/* Retrieve the name of the backend in use (for logging). */
+const char *evloop_backend(void);
+
+#endif /* !EVLOOP_H */
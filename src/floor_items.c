@@ -0,0 +1,119 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "floor_items.h"
+
+/* Where an item id would ideally sit in the table. */
+static inline uint32_t item_home(const lobby_item_table_t *t,
+                                 uint32_t item_id) {
+    uint32_t h = item_id * 0x9E3779B1;
+
+    return (h ^ (h >> 16)) & (t->size - 1);
+}
+
+int floor_items_insert(lobby_item_table_t *t, lobby_item_t *item) {
+    lobby_item_t **old = t->slots, **slots;
+    uint32_t i, j, size = t->size;
+
+    /* Keep the table at most three quarters full. */
+    if((t->count + 1) * 4 > size * 3) {
+        size = size ? size << 1 : 64;
+
+        if(!(slots = (lobby_item_t **)calloc(size, sizeof(lobby_item_t *))))
+            return -1;
+
+        t->slots = slots;
+        t->size = size;
+
+        for(i = 0; i < size >> 1 && old; ++i) {
+            if(!old[i])
+                continue;
+
+            j = item_home(t, old[i]->d.item_id);
+
+            while(slots[j])
+                j = (j + 1) & (size - 1);
+
+            slots[j] = old[i];
+        }
+
+        free(old);
+    }
+
+    i = item_home(t, item->d.item_id);
+
+    while(t->slots[i])
+        i = (i + 1) & (t->size - 1);
+
+    t->slots[i] = item;
+    ++t->count;
+    return 0;
+}
+
+/* Take the item in the given slot out of the table, moving anything after it
+   back as needed so that there's no gap left in the middle of a probe run. */
+static void remove_slot(lobby_item_table_t *t, uint32_t i) {
+    uint32_t mask = t->size - 1, j = i, k;
+
+    for(;;) {
+        j = (j + 1) & mask;
+
+        if(!t->slots[j])
+            break;
+
+        /* If the item at j belongs somewhere in (i, j], it can stay put. */
+        k = item_home(t, t->slots[j]->d.item_id);
+
+        if((i <= j) ? (i < k && k <= j) : (i < k || k <= j))
+            continue;
+
+        t->slots[i] = t->slots[j];
+        i = j;
+    }
+
+    t->slots[i] = NULL;
+    --t->count;
+}
+
+lobby_item_t *floor_items_remove(lobby_item_table_t *t, uint32_t item_id) {
+    lobby_item_t *item;
+    uint32_t i;
+
+    if(!t->count)
+        return NULL;
+
+    i = item_home(t, item_id);
+
+    while((item = t->slots[i])) {
+        if(item->d.item_id == item_id) {
+            remove_slot(t, i);
+            return item;
+        }
+
+        i = (i + 1) & (t->size - 1);
+    }
+
+    return NULL;
+}
+
+void floor_items_reset(lobby_item_table_t *t) {
+    free(t->slots);
+    memset(t, 0, sizeof(lobby_item_table_t));
+}
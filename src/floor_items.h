@@ -0,0 +1,60 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FLOOR_ITEMS_H
+#define FLOOR_ITEMS_H
+
+#include <stdint.h>
+
+#include "player.h"
+
+typedef struct lobby_item {
+    item_t d;
+} lobby_item_t;
+
+/* The items on the floor in a game, in an open-addressed (linear probing) table
+   keyed by item id. The table only holds pointers to the items; whoever puts
+   them in is responsible for their memory. Lobbies get theirs from the block's
+   item pool, so pointers to them stay good until they're removed.
+
+   A table that is all zeroes is a valid empty table. The table is not
+   thread-safe; the lobby's mutex protects it. */
+typedef struct lobby_item_table {
+    lobby_item_t **slots;
+    uint32_t size;                      /* Always zero or a power of two. */
+    uint32_t count;
+} lobby_item_table_t;
+
+/* Add an item to the table, growing it if need be. Returns 0 on success or -1
+   if the table couldn't be grown. */
+int floor_items_insert(lobby_item_table_t *t, lobby_item_t *item);
+
+/* Take the item with the given id out of the table. Returns the item, or NULL
+   if there isn't one with that id. */
+lobby_item_t *floor_items_remove(lobby_item_table_t *t, uint32_t item_id);
+
+/* Free the table's slots, leaving it empty. This doesn't do anything with the
+   items themselves. */
+void floor_items_reset(lobby_item_table_t *t);
+
+/* Go through each item in the table. Items must not be added or removed while
+   doing this. */
+#define FLOOR_ITEMS_FOREACH(t, i, it) \
+    for((i) = 0; (i) < (t)->size; ++(i)) \
+        if(((it) = (t)->slots[(i)]))
+
+#endif /* !FLOOR_ITEMS_H */
@@ -0,0 +1,176 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <pthread.h>
+
+#include "gcindex.h"
+#include "clients.h"
+#include "block.h"
+
+/* Each shard is a plain chained hash table, with the chains running through
+   the clients themselves. */
+typedef struct gcindex_shard {
+    pthread_rwlock_t lock;
+    ship_client_t *buckets[GCINDEX_BUCKETS];
+} __attribute__((aligned(64))) gcindex_shard_t;
+
+static gcindex_shard_t shards[GCINDEX_SHARDS];
+
+/* Guild card numbers are handed out sequentially, so mix them up a bit before
+   picking where they go. */
+static inline uint32_t gc_hash(uint32_t gc) {
+    return gc * 0x9E3779B1;
+}
+
+static inline gcindex_shard_t *gc_shard(uint32_t h) {
+    return &shards[h >> (32 - GCINDEX_SHARD_BITS)];
+}
+
+static inline ship_client_t **gc_bucket(gcindex_shard_t *s, uint32_t h) {
+    return &s->buckets[(h >> (32 - GCINDEX_SHARD_BITS - GCINDEX_BUCKET_BITS)) &
+                       (GCINDEX_BUCKETS - 1)];
+}
+
+int gcindex_init(void) {
+    int i;
+
+    for(i = 0; i < GCINDEX_SHARDS; ++i) {
+        if(pthread_rwlock_init(&shards[i].lock, NULL)) {
+            while(i--) {
+                pthread_rwlock_destroy(&shards[i].lock);
+            }
+
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void gcindex_shutdown(void) {
+    int i;
+
+    for(i = 0; i < GCINDEX_SHARDS; ++i) {
+        pthread_rwlock_destroy(&shards[i].lock);
+    }
+}
+
+/* Unlink a client from its chain. Must be called with the shard's lock held
+   for writing. */
+static void unlink_client(gcindex_shard_t *s, ship_client_t *c) {
+    ship_client_t **it = gc_bucket(s, gc_hash(c->guildcard));
+
+    while(*it) {
+        if(*it == c) {
+            *it = c->gc_next;
+            break;
+        }
+
+        it = &(*it)->gc_next;
+    }
+
+    c->gc_next = NULL;
+    c->gc_indexed = 0;
+}
+
+void gcindex_set(ship_client_t *c, uint32_t gc) {
+    gcindex_shard_t *s;
+    ship_client_t **b;
+    uint32_t h;
+
+    gcindex_remove(c);
+
+    h = gc_hash(gc);
+    s = gc_shard(h);
+    b = gc_bucket(s, h);
+
+    pthread_rwlock_wrlock(&s->lock);
+    c->guildcard = gc;
+    c->gc_next = *b;
+    c->gc_indexed = 1;
+    *b = c;
+    pthread_rwlock_unlock(&s->lock);
+}
+
+void gcindex_remove(ship_client_t *c) {
+    gcindex_shard_t *s;
+
+    if(!c->gc_indexed)
+        return;
+
+    s = gc_shard(gc_hash(c->guildcard));
+    pthread_rwlock_wrlock(&s->lock);
+    unlink_client(s, c);
+    pthread_rwlock_unlock(&s->lock);
+}
+
+ship_client_t *gcindex_find(block_t *b, uint32_t gc) {
+    uint32_t h = gc_hash(gc);
+    gcindex_shard_t *s = gc_shard(h);
+    ship_client_t *it;
+
+    pthread_rwlock_rdlock(&s->lock);
+
+    for(it = *gc_bucket(s, h); it; it = it->gc_next) {
+        if(it->guildcard == gc && it->cur_block == b)
+            break;
+    }
+
+    pthread_rwlock_unlock(&s->lock);
+    return it;
+}
+
+ship_client_t *gcindex_find_any(uint32_t gc, block_t **b) {
+    uint32_t h = gc_hash(gc);
+    gcindex_shard_t *s = gc_shard(h);
+    ship_client_t *c, *it;
+    block_t *blk;
+
+    for(;;) {
+        pthread_rwlock_rdlock(&s->lock);
+
+        for(c = *gc_bucket(s, h); c; c = c->gc_next) {
+            if(c->guildcard == gc)
+                break;
+        }
+
+        blk = c ? c->cur_block : NULL;
+        pthread_rwlock_unlock(&s->lock);
+
+        if(!c)
+            return NULL;
+
+        /* Lock the client's block so that it can't go away, then make sure
+           that it didn't already go away before we got the lock. */
+        pthread_rwlock_rdlock(&blk->lock);
+        pthread_rwlock_rdlock(&s->lock);
+
+        for(it = *gc_bucket(s, h); it; it = it->gc_next) {
+            if(it == c)
+                break;
+        }
+
+        if(it && it->guildcard == gc && it->cur_block == blk) {
+            pthread_rwlock_unlock(&s->lock);
+            *b = blk;
+            return it;
+        }
+
+        pthread_rwlock_unlock(&s->lock);
+        pthread_rwlock_unlock(&blk->lock);
+    }
+}
@@ -0,0 +1,65 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GCINDEX_H
+#define GCINDEX_H
+
+#include <stdint.h>
+
+/* Ship-wide index of the clients connected to the blocks, by guild card
+   number. The index is split into shards, each with its own lock, so that
+   lookups from one thread don't hold up logins and disconnects on the others.
+
+   A client's pointer in the index is only good for as long as its block's
+   client list lock is held, since that is what keeps it from being destroyed.
+   The index lock itself is never held while waiting on any other lock. */
+#define GCINDEX_SHARD_BITS      6
+#define GCINDEX_SHARDS          (1 << GCINDEX_SHARD_BITS)
+#define GCINDEX_BUCKET_BITS     8
+#define GCINDEX_BUCKETS         (1 << GCINDEX_BUCKET_BITS)
+
+#ifndef SHIP_CLIENT_DEFINED
+#define SHIP_CLIENT_DEFINED
+typedef struct ship_client ship_client_t;
+#endif
+
+#ifndef BLOCK_DEFINED
+#define BLOCK_DEFINED
+typedef struct block block_t;
+#endif
+
+int gcindex_init(void);
+void gcindex_shutdown(void);
+
+/* Set the guild card number of a block client and (re-)index it under that
+   number. The client's cur_block must already be set. */
+void gcindex_set(ship_client_t *c, uint32_t gc);
+
+/* Take a client out of the index, if it's in there. This must be done before
+   the client is destroyed, with its block's client list write-locked. */
+void gcindex_remove(ship_client_t *c);
+
+/* Look for a client with the given guild card number on a given block. The
+   caller must hold the block's client list lock. */
+ship_client_t *gcindex_find(block_t *b, uint32_t gc);
+
+/* Look for a client with the given guild card number on any block. If one is
+   found, its block's client list is read-locked and the block is stored in b,
+   and the caller must unlock it when done with the client. */
+ship_client_t *gcindex_find_any(uint32_t gc, block_t **b);
+
+#endif /* !GCINDEX_H */
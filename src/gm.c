@@ -1,6 +1,6 @@
 /*
     Sylverant Ship Server
-    Copyright (C) 2009, 2010, 2011, 2013 Lawrence Sebald
+    Copyright (C) 2009, 2010, 2011, 2013, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -27,6 +27,7 @@
 
 #include "gm.h"
 #include "ship.h"
+#include "epoch.h"
 #include "clients.h"
 
 #ifndef LIBXML_TREE_ENABLED
@@ -40,18 +41,20 @@ int gm_list_read(const char *fn, ship_t *s) {
     xmlDoc *doc;
     xmlNode *n;
     xmlChar *guildcard, *root;
-    local_gm_t *oldlist = NULL;
-    int oldcount = 0, rv = 0;
+    gm_list_t *list, *old;
+    int rv = 0;
     void *tmp;
 
-    /* If we're reloading, save the old list. */
-    if(s->gm_list) {
-        oldlist = s->gm_list;
-        oldcount = s->gm_count;
-        s->gm_list = NULL;
-        s->gm_count = 0;
+    /* Start out with an empty list. The old one (if any) stays in place until
+       the new one has been read in completely. */
+    if(!(list = (gm_list_t *)malloc(sizeof(gm_list_t)))) {
+        debug(DBG_ERROR, "Couldn't allocate GM List\n");
+        perror("malloc");
+        return -1;
     }
 
+    list->count = 0;
+
     /* Create an XML Parsing context */
     cxt = xmlNewParserCtxt();
     if(!cxt) {
@@ -113,7 +116,8 @@ int gm_list_read(const char *fn, ship_t *s) {
             }
         
             /* We've got everything, make space for the new GM. */
-            tmp = realloc(s->gm_list, (s->gm_count + 1) * sizeof(local_gm_t));
+            tmp = realloc(list, sizeof(gm_list_t) +
+                          (list->count + 1) * sizeof(local_gm_t));
 
             if(!tmp) {
                 debug(DBG_WARN, "Couldn't make space for GM\n");
@@ -121,25 +125,24 @@ int gm_list_read(const char *fn, ship_t *s) {
                 xmlFree(guildcard);
                 xmlFree(root);
                 rv = -6;
-                free(s->gm_list);
                 goto err_doc;
             }
 
-            s->gm_list = (local_gm_t *)tmp;
+            list = (gm_list_t *)tmp;
 
             /* Clear it */
-            memset(&s->gm_list[s->gm_count], 0, sizeof(local_gm_t));
-            s->gm_list[s->gm_count].flags = CLIENT_PRIV_LOCAL_GM;
+            memset(&list->gms[list->count], 0, sizeof(local_gm_t));
+            list->gms[list->count].flags = CLIENT_PRIV_LOCAL_GM;
 
-            s->gm_list[s->gm_count].guildcard =
+            list->gms[list->count].guildcard =
                 (uint32_t)strtoul((char *)guildcard, NULL, 0);
 
             /* See if the user is a root user */
             if(root && !xmlStrcmp(root, XC"true")) {
-                s->gm_list[s->gm_count].flags |= CLIENT_PRIV_LOCAL_ROOT;
+                list->gms[list->count].flags |= CLIENT_PRIV_LOCAL_ROOT;
             }
 
-            ++s->gm_count;
+            ++list->count;
 
 next:
             /* Free the memory we allocated here... */
@@ -150,9 +153,14 @@ next:
         n = n->next;
     }
 
-    /* If we have an old list, we're clear to free it now... */
-    if(oldlist) {
-        free(oldlist);
+    /* Swap the new list in, and once nobody can be looking at the old one
+       anymore, get rid of it. */
+    old = (gm_list_t *)epoch_publish((void **)&s->gm_list, list);
+    list = NULL;
+
+    if(old) {
+        epoch_synchronize();
+        free(old);
     }
 
     /* Cleanup/error handling below... */
@@ -161,24 +169,29 @@ err_doc:
 err_cxt:
     xmlFreeParserCtxt(cxt);
 err:
-    if(rv) {
-        s->gm_list = oldlist;
-        s->gm_count = oldcount;
-    }
+    free(list);
 
     return rv;
 }
 
 int is_gm(uint32_t guildcard, ship_t *s) {
-    int i;
+    gm_list_t *list;
+    int i, rv = 0;
+
+    epoch_enter();
 
     /* Look through the list for this person. */
-    for(i = 0; i < s->gm_count; ++i) {
-        if(guildcard == s->gm_list[i].guildcard) {
-            return s->gm_list[i].flags;
+    if((list = EPOCH_DEREF(s->gm_list))) {
+        for(i = 0; i < list->count; ++i) {
+            if(guildcard == list->gms[i].guildcard) {
+                rv = list->gms[i].flags;
+                break;
+            }
         }
     }
 
-    /* Didn't find them, they're not a GM. */
-    return 0;
+    epoch_exit();
+
+    /* If we didn't find them, they're not a GM. */
+    return rv;
 }
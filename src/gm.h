@@ -1,6 +1,6 @@
 /*
     Sylverant Ship Server
-    Copyright (C) 2009, 2010, 2011, 2013 Lawrence Sebald
+    Copyright (C) 2009, 2010, 2011, 2013, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -31,6 +31,13 @@ typedef struct local_gm {
     uint32_t flags;
 } local_gm_t;
 
+/* The whole list of local GMs. This never changes once it has been published,
+   reloading the list builds a new one and swaps it in (see epoch.h). */
+typedef struct gm_list {
+    int count;
+    local_gm_t gms[];
+} gm_list_t;
+
 int gm_list_read(const char *fn, ship_t *s);
 int is_gm(uint32_t guildcard, ship_t *s);
 
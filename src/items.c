@@ -1,6 +1,6 @@
 /*
     Sylverant Ship Server
-    Copyright (C) 2010, 2012, 2018 Lawrence Sebald
+    Copyright (C) 2010, 2012, 2018, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -17,6 +17,8 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <pthread.h>
 
 #include "items.h"
 
@@ -605,22 +607,62 @@ static item_map_t item_list[] = {
     { Item_NoSuchItem, "" }
 };
 
+/* Hash table of the items in the list above, by code. Each bucket holds the
+   position of an item in the list plus one, or zero if the bucket is empty.
+   Collisions are handled by just moving on to the next bucket. The table is
+   kept at less than a third full, so lookups rarely have to look at more than
+   one or two buckets. */
+#define ITEM_INDEX_BITS     11
+#define ITEM_INDEX_SIZE     (1 << ITEM_INDEX_BITS)
+#define ITEM_INDEX_MASK     (ITEM_INDEX_SIZE - 1)
+
+static uint16_t item_index[ITEM_INDEX_SIZE];
+static pthread_once_t item_index_once = PTHREAD_ONCE_INIT;
+
+static inline uint32_t item_hash(uint32_t code) {
+    return (code * 0x9E3779B1U) >> (32 - ITEM_INDEX_BITS);
+}
+
+static void build_item_index(void) {
+    uint32_t i, h;
+
+    for(i = 0; item_list[i].code != Item_NoSuchItem; ++i) {
+        h = item_hash((uint32_t)item_list[i].code);
+
+        /* If an item shows up in the list more than once, the first one wins,
+           just like it always has. */
+        while(item_index[h]) {
+            if(item_list[item_index[h] - 1].code == item_list[i].code)
+                break;
+
+            h = (h + 1) & ITEM_INDEX_MASK;
+        }
+
+        if(!item_index[h])
+            item_index[h] = (uint16_t)(i + 1);
+    }
+}
+
 const char *item_get_name_by_code(item_code_t code, int version) {
-    item_map_t *cur = &item_list[0];
+    uint32_t h;
+    item_map_t *cur;
     (void)version;
 
+    pthread_once(&item_index_once, &build_item_index);
+
     /* Take care of mags so that we'll match them properly... */
     if((code & 0xFF) == 0x02) {
         code &= 0xFFFF;
     }
 
-    /* Look through the list for the one we want */
-    while(cur->code != Item_NoSuchItem) {
+    /* Look through the index for the one we want */
+    for(h = item_hash((uint32_t)code); item_index[h];
+        h = (h + 1) & ITEM_INDEX_MASK) {
+        cur = &item_list[item_index[h] - 1];
+
         if(cur->code == code) {
             return cur->name;
         }
-
-        ++cur;
     }
 
     /* No item found... */
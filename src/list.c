@@ -90,7 +90,7 @@ static int pllist_ship(ship_client_t *c, const char *name, int first,
 
             /* If we're on the right page, add the client to the message */
             if(count >= first) {
-                my_ntop(&c2->ip_addr, ip);
+                my_ntop(&c2->cold->ip_addr, ip);
 
                 if(c2->cur_lobby) {
                     sprintf(&str[len], "%s  %s  Lv.%d  GC: %d\n"
@@ -180,7 +180,7 @@ static int pllist_block(ship_client_t *c, const char *name, int first,
 
         /* If we're on the right page, add the client to the message */
         if(count >= first) {
-            my_ntop(&c2->ip_addr, ip);
+            my_ntop(&c2->cold->ip_addr, ip);
 
             if(c2->cur_lobby) {
                 sprintf(&str[len], "%s  %s  Lv.%d  GC: %d\n"
@@ -269,7 +269,7 @@ static int pllist_lobby(ship_client_t *c, const char *name, int first,
 
             /* If we're on the right page, add the client to the message */
             if(count >= first) {
-                my_ntop(&c2->ip_addr, ip);
+                my_ntop(&c2->cold->ip_addr, ip);
 
                 if(c2->cur_lobby) {
                     sprintf(&str[len], "%s  %s  Lv.%d  GC: %d\n"
@@ -1,7 +1,7 @@
 /*
     Sylverant Ship Server
     Copyright (C) 2009, 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018,
-                  2019, 2020, 2021, 2022, 2023, 2025 Lawrence Sebald
+                  2019, 2020, 2021, 2022, 2023, 2025, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -22,7 +22,6 @@
 #include <string.h>
 #include <pthread.h>
 
-#include <sylverant/mtwist.h>
 #include <sylverant/debug.h>
 #include <sylverant/checksum.h>
 #include <sylverant/memory.h>
@@ -41,6 +40,8 @@
 #include "rtdata.h"
 #include "scripts.h"
 #include "quest_functions.h"
+#include "mempool.h"
+#include "mtrand.h"
 
 #ifdef ENABLE_LUA
 #include <lua.h>
@@ -57,6 +58,14 @@ static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
 #endif
 
 static int td(ship_client_t *c, lobby_t *l, void *req);
+static void lobby_clear_items(lobby_t *l);
+
+/* Let the block know that something about a game that shows up in the game
+   list has changed. */
+static void lobby_list_changed(lobby_t *l) {
+    if(l->type != LOBBY_TYPE_LOBBY)
+        block_game_list_changed(l->block);
+}
 
 lobby_t *lobby_create_default(block_t *block, uint32_t lobby_id, uint8_t ev) {
     lobby_t *l = (lobby_t *)malloc(sizeof(lobby_t));
@@ -331,7 +340,6 @@ lobby_t *lobby_create_game(block_t *block, char *name, char *passwd,
 
     /* Initialize the packet queue */
     STAILQ_INIT(&l->pkt_queue);
-    TAILQ_INIT(&l->item_queue);
     STAILQ_INIT(&l->burst_queue);
 
     /* Initialize the lobby mutex. */
@@ -350,7 +358,7 @@ lobby_t *lobby_create_game(block_t *block, char *name, char *passwd,
            (c->flags & CLIENT_FLAG_IS_NTE)) {
             for(i = 0; i < 0x20; ++i) {
                 if(dcnte_maps[i] != 1) {
-                    l->maps[i] = mt19937_genrand_int32(&block->rng) %
+                    l->maps[i] = mtrand_int32(block_rng(block)) %
                         dcnte_maps[i];
                 }
             }
@@ -358,7 +366,7 @@ lobby_t *lobby_create_game(block_t *block, char *name, char *passwd,
         else if(!single_player) {
             for(i = 0; i < 0x20; ++i) {
                 if(maps[episode - 1][i] != 1) {
-                    l->maps[i] = mt19937_genrand_int32(&block->rng) %
+                    l->maps[i] = mtrand_int32(block_rng(block)) %
                         maps[episode - 1][i];
                 }
             }
@@ -366,7 +374,7 @@ lobby_t *lobby_create_game(block_t *block, char *name, char *passwd,
         else {
             for(i = 0; i < 0x20; ++i) {
                 if(sp_maps[episode - 1][i] != 1) {
-                    l->maps[i] = mt19937_genrand_int32(&block->rng) %
+                    l->maps[i] = mtrand_int32(block_rng(block)) %
                         sp_maps[episode - 1][i];
                 }
             }
@@ -380,7 +388,7 @@ lobby_t *lobby_create_game(block_t *block, char *name, char *passwd,
                     l->maps[i] = c->next_maps[i];
                 }
                 else {
-                    l->maps[i] = mt19937_genrand_int32(&block->rng) %
+                    l->maps[i] = mtrand_int32(block_rng(block)) %
                         dcnte_maps[i];
                 }
             }
@@ -391,7 +399,7 @@ lobby_t *lobby_create_game(block_t *block, char *name, char *passwd,
                     l->maps[i] = c->next_maps[i];
                 }
                 else {
-                    l->maps[i] = mt19937_genrand_int32(&block->rng) %
+                    l->maps[i] = mtrand_int32(block_rng(block)) %
                         maps[episode - 1][i];
                 }
             }
@@ -402,7 +410,7 @@ lobby_t *lobby_create_game(block_t *block, char *name, char *passwd,
                     l->maps[i] = c->next_maps[i];
                 }
                 else {
-                    l->maps[i] = mt19937_genrand_int32(&block->rng) %
+                    l->maps[i] = mtrand_int32(block_rng(block)) %
                         sp_maps[episode - 1][i];
                 }
             }
@@ -420,6 +428,7 @@ lobby_t *lobby_create_game(block_t *block, char *name, char *passwd,
             release(l->limits_list);
 
         pthread_mutex_destroy(&l->mutex);
+        arena_destroy(&l->arena);
         free(l);
         return NULL;
     }
@@ -431,6 +440,7 @@ lobby_t *lobby_create_game(block_t *block, char *name, char *passwd,
             release(l->limits_list);
 
         pthread_mutex_destroy(&l->mutex);
+        arena_destroy(&l->arena);
         free(l);
         return NULL;
     }
@@ -442,6 +452,7 @@ lobby_t *lobby_create_game(block_t *block, char *name, char *passwd,
             release(l->limits_list);
 
         pthread_mutex_destroy(&l->mutex);
+        arena_destroy(&l->arena);
         free(l);
         return NULL;
     }
@@ -450,14 +461,13 @@ lobby_t *lobby_create_game(block_t *block, char *name, char *passwd,
     if(version != CLIENT_VERSION_PC || battle || chal || difficulty == 3 ||
        (c->flags & CLIENT_FLAG_IS_NTE)) {
         pthread_rwlock_wrlock(&block->lobby_lock);
-        TAILQ_INSERT_TAIL(&block->lobbies, l, qentry);
-        ++block->num_games;
+        block_add_lobby_locked(block, l);
         pthread_rwlock_unlock(&block->lobby_lock);
 
         ship_inc_games(block->ship);
     }
 
-    l->rand_seed = mt19937_genrand_int32(&block->rng);
+    l->rand_seed = mtrand_int32(block_rng(block));
 
     if(!chal && !battle)
         lobby_setup_drops(c, l, sylverant_crc32((uint8_t *)l->name, 16));
@@ -547,7 +557,7 @@ lobby_t *lobby_create_ep3_game(block_t *block, char *name, char *passwd,
     l->section = section;
     l->min_level = 1;
     l->max_level = 200;
-    l->rand_seed = mt19937_genrand_int32(&block->rng);
+    l->rand_seed = mtrand_int32(block_rng(block));
     l->create_time = time(NULL);
     l->flags |= LOBBY_FLAG_EP3;
 
@@ -566,8 +576,7 @@ lobby_t *lobby_create_ep3_game(block_t *block, char *name, char *passwd,
 
     /* Add it to the list of lobbies, and increment the game count. */
     pthread_rwlock_wrlock(&block->lobby_lock);
-    TAILQ_INSERT_TAIL(&block->lobbies, l, qentry);
-    ++block->num_games;
+    block_add_lobby_locked(block, l);
     pthread_rwlock_unlock(&block->lobby_lock);
     ship_inc_games(block->ship);
 
@@ -611,7 +620,6 @@ static void lobby_empty_pkt_queue(lobby_t *l) {
 
 static void lobby_destroy_locked(lobby_t *l, int remove) {
     pthread_mutex_t m = l->mutex;
-    lobby_item_t *i, *tmp;
 
 #ifdef DEBUG
     pthread_mutex_lock(&log_mutex);
@@ -648,13 +656,11 @@ static void lobby_destroy_locked(lobby_t *l, int remove) {
     /* TAILQ_REMOVE may or may not be safe to use if the item was never actually
        inserted in a list, so don't remove it if it wasn't. */
     if(remove) {
-        TAILQ_REMOVE(&l->block->lobbies, l, qentry);
+        block_remove_lobby_locked(l->block, l);
 
         /* Decrement the game count if it got incremented for this lobby */
-        if(l->type != LOBBY_TYPE_LOBBY) {
-            --l->block->num_games;
+        if(l->type != LOBBY_TYPE_LOBBY)
             ship_dec_games(l->block->ship);
-        }
     }
 
     lobby_empty_pkt_queue(l);
@@ -664,24 +670,44 @@ static void lobby_destroy_locked(lobby_t *l, int remove) {
         release(l->limits_list);
 
     /* Free up any items left in the lobby for Blue Burst. */
-    i = TAILQ_FIRST(&l->item_queue);
-    while(i) {
-        tmp = TAILQ_NEXT(i, qentry);
-        free(i);
-        i = tmp;
-    }
+    lobby_clear_items(l);
 
     /* Free up the enemy data */
     if(l->map_enemies) {
         free_game_enemies(l);
     }
 
+    /* And everything else that was allocated for the team along the way. */
+    arena_destroy(&l->quest_arena);
+    arena_destroy(&l->arena);
+    free(l->syncregs);
+    free(l->regvals);
     free(l);
 
     pthread_mutex_unlock(&m);
     pthread_mutex_destroy(&m);
 }
 
+/* Get rid of a team that has been emptied out, after the caller has let go of
+   its mutex. The block's lobby_lock can't be taken while holding a lobby's
+   mutex, so once it is held, the team needs to be looked at again: someone may
+   have joined it in the meantime, or another thread may have already gotten
+   rid of it. */
+static void lobby_destroy_empty(block_t *b, lobby_t *l, uint32_t lobby_id) {
+    pthread_rwlock_wrlock(&b->lobby_lock);
+
+    if(block_get_lobby_locked(b, lobby_id) == l) {
+        pthread_mutex_lock(&l->mutex);
+
+        if(!l->num_clients)
+            lobby_destroy_locked(l, 1);
+        else
+            pthread_mutex_unlock(&l->mutex);
+    }
+
+    pthread_rwlock_unlock(&b->lobby_lock);
+}
+
 void lobby_destroy(lobby_t *l) {
     pthread_mutex_lock(&l->mutex);
     lobby_destroy_locked(l, 1);
@@ -762,14 +788,14 @@ static uint8_t lobby_find_max_challenge(lobby_t *l) {
 }
 
 static int td(ship_client_t *c, lobby_t *l, void *req) {
-    uint32_t r = mt19937_genrand_int32(&c->cur_block->rng);
+    uint32_t r = mtrand_int32(block_rng(c->cur_block));
     uint32_t i[4] = { 4, 0, 0, 0 };
 
     if((r & 15) != 2) {
         return 0;
     }
 
-    r = mt19937_genrand_int32(&c->cur_block->rng);
+    r = mtrand_int32(block_rng(c->cur_block));
 
     switch(l->difficulty) {
         case 0:
@@ -827,6 +853,7 @@ static int lobby_add_client_locked(ship_client_t *c, lobby_t *l) {
         c->arrow = 0;
         c->join_time = time(NULL);
         nc = (uint32_t)++l->num_clients;
+        lobby_list_changed(l);
 
         /* Update the challenge level as needed. */
         if(l->challenge)
@@ -859,6 +886,7 @@ static int lobby_add_client_locked(ship_client_t *c, lobby_t *l) {
             c->arrow = 0;
             c->join_time = time(NULL);
             nc = (uint32_t)++l->num_clients;
+            lobby_list_changed(l);
 
             /* Update the challenge level as needed. */
             if(l->challenge)
@@ -913,6 +941,7 @@ static int lobby_elect_leader_cross_locked(lobby_t *l) {
         l->flags &= ~LOBBY_FLAG_GC_ALLOWED;
         l->version = CLIENT_VERSION_GC;
         l->episode = 1;
+        lobby_list_changed(l);
 
         /* Same loop as above, but without the requirement of not on Gamecube.
            If we're here, everyone's obviously on Gamecube, if anyone's even
@@ -988,6 +1017,7 @@ static int lobby_remove_client_locked(ship_client_t *c, int client_id,
     /* Remove the client from our list, and we're done. */
     l->clients[client_id] = NULL;
     --l->num_clients;
+    lobby_list_changed(l);
 
     /* Make sure the maximum challenge level available hasn't changed... */
     if(l->challenge)
@@ -1028,6 +1058,7 @@ static int lobby_remove_client_locked(ship_client_t *c, int client_id,
 int lobby_add_to_any(ship_client_t *c, lobby_t *req) {
     block_t *b = c->cur_block;
     lobby_t *l;
+    uint32_t id;
     int added = 0;
 
     /* If a specific lobby was requested, try that one first. */
@@ -1048,13 +1079,15 @@ int lobby_add_to_any(ship_client_t *c, lobby_t *req) {
         pthread_mutex_unlock(&req->mutex);
     }
 
-    /* Add to the first available default lobby. */
-    TAILQ_FOREACH(l, &b->lobbies, qentry) {
+    /* Add to the first available default lobby. Those never go away, so there
+       is no need for the block's lobby_lock here. */
+    for(id = 1; id <= LOBBY_DEFAULT_COUNT && !added; ++id) {
         /* Don't look at lobbies we can't see. */
-        if(c->version == CLIENT_VERSION_DCV1 && l->lobby_id > 10) {
-            continue;
+        if(c->version == CLIENT_VERSION_DCV1 && id > 10) {
+            break;
         }
 
+        l = b->default_lobbies[id - 1];
         pthread_mutex_lock(&l->mutex);
 
         if(l->type == LOBBY_TYPE_LOBBY && l->num_clients < l->max_clients) {
@@ -1066,10 +1099,6 @@ int lobby_add_to_any(ship_client_t *c, lobby_t *req) {
         }
 
         pthread_mutex_unlock(&l->mutex);
-
-        if(added) {
-            break;
-        }
     }
 
     return !added;
@@ -1081,6 +1110,7 @@ int lobby_change_lobby(ship_client_t *c, lobby_t *req) {
     int old_cid = c->client_id;
     int delete_lobby = 0;
     int override = (c->flags & CLIENT_FLAG_OVERRIDE_GAME);
+    uint32_t old_id;
 
     /* Clear the override flag */
     c->flags &= ~CLIENT_FLAG_OVERRIDE_GAME;
@@ -1113,6 +1143,7 @@ int lobby_change_lobby(ship_client_t *c, lobby_t *req) {
 
     /* Swap the data out on the server end before we do anything rash. */
     pthread_mutex_lock(&l->mutex);
+    old_id = l->lobby_id;
 
     if(l != req) {
         pthread_mutex_lock(&req->mutex);
@@ -1230,26 +1261,19 @@ int lobby_change_lobby(ship_client_t *c, lobby_t *req) {
     }
     else {
         memset(c->enemy_kills, 0, sizeof(uint32_t) * 0x60);
-        memset(c->q_stack, 0, sizeof(uint32_t) * CLIENT_MAX_QSTACK);
-        c->q_stack_top = 0;
+        memset(c->cold->q_stack, 0, sizeof(uint32_t) * CLIENT_MAX_QSTACK);
+        c->cold->q_stack_top = 0;
         send_game_join(c, c->cur_lobby);
         c->cur_lobby->flags |= LOBBY_FLAG_BURSTING;
         c->flags |= CLIENT_FLAG_BURSTING;
         c->flags &= ~CLIENT_FLAG_SHOPPING;
-        memset(c->p2_drops, 0, sizeof(c->p2_drops));
-        c->p2_drops_max = 0;
+        memset(c->cold->p2_drops, 0, sizeof(c->cold->p2_drops));
+        c->cold->p2_drops_max = 0;
     }
 
     /* ...and let his/her new lobby know that he/she has arrived. */
     send_lobby_add_player(c->cur_lobby, c);
 
-    /* If the old lobby is empty (and not a default lobby), remove it. */
-    if(delete_lobby) {
-        pthread_rwlock_wrlock(&c->cur_block->lobby_lock);
-        lobby_destroy_locked(l, 1);
-        pthread_rwlock_unlock(&c->cur_block->lobby_lock);
-    }
-
     /* Send the message to the shipgate */
     shipgate_send_lobby_chg(&ship->sg, c->guildcard, c->cur_lobby->lobby_id,
                             c->cur_lobby->name);
@@ -1260,8 +1284,11 @@ out:
         pthread_mutex_unlock(&req->mutex);
     }
 
-    if(delete_lobby < 1) {
-        pthread_mutex_unlock(&l->mutex);
+    pthread_mutex_unlock(&l->mutex);
+
+    /* If the old lobby is empty (and not a default lobby), remove it. */
+    if(delete_lobby > 0) {
+        lobby_destroy_empty(c->cur_block, l, old_id);
     }
 
     return rv;
@@ -1272,6 +1299,7 @@ out:
 int lobby_remove_player(ship_client_t *c) {
     lobby_t *l = c->cur_lobby;
     int rv = 0, delete_lobby, client_id;
+    uint32_t lobby_id;
 
     /* They're not in a lobby, so we're done. */
     if(!l) {
@@ -1280,6 +1308,7 @@ int lobby_remove_player(ship_client_t *c) {
 
     /* Lock the mutex before we try anything funny. */
     pthread_mutex_lock(&l->mutex);
+    lobby_id = l->lobby_id;
 
     /* If they were bursting, unlock the lobby... */
     if((c->flags & CLIENT_FLAG_BURSTING)) {
@@ -1306,18 +1335,14 @@ int lobby_remove_player(ship_client_t *c) {
        so that they know the requester has gone. */
     send_lobby_leave(l, c, client_id);
 
-    if(delete_lobby) {
-        pthread_rwlock_wrlock(&c->cur_block->lobby_lock);
-        lobby_destroy_locked(l, 1);
-        pthread_rwlock_unlock(&c->cur_block->lobby_lock);
-    }
-
     c->cur_lobby = NULL;
 
 out:
     /* We're done, clean up. */
-    if(delete_lobby < 1) {
-        pthread_mutex_unlock(&l->mutex);
+    pthread_mutex_unlock(&l->mutex);
+
+    if(delete_lobby > 0) {
+        lobby_destroy_empty(c->cur_block, l, lobby_id);
     }
 
     return rv;
@@ -1326,8 +1351,19 @@ out:
 int lobby_send_pkt_dcnte(lobby_t *l, ship_client_t *c, void *h, void *h2,
                          int igcheck) {
     dc_pkt_hdr_t *hdr = (dc_pkt_hdr_t *)h, *hdr2 = (dc_pkt_hdr_t *)h2;
+    pkt_fanout_t f;
     int i;
 
+    /* Which version of the packet gets sent depends only on the sender, so
+       prepare it once for everyone. */
+    if(c->version == CLIENT_VERSION_DCV1 && (c->flags & CLIENT_FLAG_IS_NTE)) {
+        if(pkt_fanout_init_dc(&f, hdr))
+            return -1;
+    }
+    else if(pkt_fanout_init_dc(&f, hdr2)) {
+        return -1;
+    }
+
     /* Send the packet to every connected client. */
     for(i = 0; i < l->max_clients; ++i) {
         if(l->clients[i] && l->clients[i] != c) {
@@ -1337,11 +1373,7 @@ int lobby_send_pkt_dcnte(lobby_t *l, ship_client_t *c, void *h, void *h2,
                 continue;
             }
 
-            if(c->version == CLIENT_VERSION_DCV1 &&
-               (c->flags & CLIENT_FLAG_IS_NTE))
-                send_pkt_dc(l->clients[i], hdr);
-            else
-                send_pkt_dc(l->clients[i], hdr2);
+            send_pkt_fanout(l->clients[i], &f);
         }
     }
 
@@ -1349,9 +1381,12 @@ int lobby_send_pkt_dcnte(lobby_t *l, ship_client_t *c, void *h, void *h2,
 }
 
 int lobby_send_pkt_dc(lobby_t *l, ship_client_t *c, void *h, int igcheck) {
-    dc_pkt_hdr_t *hdr = (dc_pkt_hdr_t *)h;
+    pkt_fanout_t f;
     int i;
 
+    if(pkt_fanout_init_dc(&f, (dc_pkt_hdr_t *)h))
+        return -1;
+
     /* Send the packet to every connected client. */
     for(i = 0; i < l->max_clients; ++i) {
         if(l->clients[i] && l->clients[i] != c) {
@@ -1361,7 +1396,7 @@ int lobby_send_pkt_dc(lobby_t *l, ship_client_t *c, void *h, int igcheck) {
                 continue;
             }
 
-            send_pkt_dc(l->clients[i], hdr);
+            send_pkt_fanout(l->clients[i], &f);
         }
     }
 
@@ -1369,9 +1404,12 @@ int lobby_send_pkt_dc(lobby_t *l, ship_client_t *c, void *h, int igcheck) {
 }
 
 int lobby_send_pkt_bb(lobby_t *l, ship_client_t *c, void *h, int igcheck) {
-    bb_pkt_hdr_t *hdr = (bb_pkt_hdr_t *)h;
+    pkt_fanout_t f;
     int i;
 
+    if(pkt_fanout_init_bb(&f, (bb_pkt_hdr_t *)h))
+        return -1;
+
     /* Send the packet to every connected client. */
     for(i = 0; i < l->max_clients; ++i) {
         if(l->clients[i] && l->clients[i] != c) {
@@ -1381,7 +1419,7 @@ int lobby_send_pkt_bb(lobby_t *l, ship_client_t *c, void *h, int igcheck) {
                 continue;
             }
 
-            send_pkt_bb(l->clients[i], hdr);
+            send_pkt_fanout(l->clients[i], &f);
         }
     }
 
@@ -1389,14 +1427,17 @@ int lobby_send_pkt_bb(lobby_t *l, ship_client_t *c, void *h, int igcheck) {
 }
 
 int lobby_send_pkt_ep3(lobby_t *l, ship_client_t *c, void *h) {
-    dc_pkt_hdr_t *hdr = (dc_pkt_hdr_t *)h;
+    pkt_fanout_t f;
     int i;
 
+    if(pkt_fanout_init_dc(&f, (dc_pkt_hdr_t *)h))
+        return -1;
+
     /* Send the packet to every connected Episode 3 client. */
     for(i = 0; i < l->max_clients; ++i) {
         if(l->clients[i] && l->clients[i] != c &&
            l->version == CLIENT_VERSION_EP3) {
-            send_pkt_dc(l->clients[i], hdr);
+            send_pkt_fanout(l->clients[i], &f);
         }
     }
 
@@ -1428,7 +1469,7 @@ int lobby_info_reply(ship_client_t *c, uint32_t lobby) {
     msg[511] = 0;
 
     /* Check if we should be on page 2 of the info or on the first page. */
-    if(c->last_info_req == lobby) {
+    if(c->cold->last_info_req == lobby) {
         /* Calculate any statistics we want for this */
         t = time(NULL) - l->create_time;
         h = t / 3600;
@@ -1553,17 +1594,17 @@ int lobby_info_reply(ship_client_t *c, uint32_t lobby) {
 
         /* We might have a third page... */
         if(ship->cfg->limits_count && legit)
-            c->last_info_req |= 0x80000000;
+            c->cold->last_info_req |= 0x80000000;
         else
-            c->last_info_req = 0;
+            c->cold->last_info_req = 0;
     }
-    else if(c->last_info_req == (lobby | 0x80000000)) {
+    else if(c->cold->last_info_req == (lobby | 0x80000000)) {
         snprintf(msg, 511, "%s:\n%s", __(c, "\tELegit Mode"),
                  l->limits_list->name ? l->limits_list->name : "Default");
-        c->last_info_req = 0;
+        c->cold->last_info_req = 0;
     }
     else {
-        c->last_info_req = lobby;
+        c->cold->last_info_req = lobby;
 
         /* Build up the information string */
         for(i = 0; i < l->max_clients; ++i) {
@@ -1789,6 +1830,10 @@ int lobby_enqueue_burst(lobby_t *l, ship_client_t *c, dc_pkt_hdr_t *p) {
     return lobby_enqueue_pkt_ex(l, c, p, 1);
 }
 
+static lobby_item_t *item_alloc(lobby_t *l) {
+    return (lobby_item_t *)mempool_zalloc(l->block->item_pool);
+}
+
 /* Add an item to the lobby's inventory. The caller must hold the lobby's mutex
    before calling this. Returns NULL if there is no space in the lobby's
    inventory for the new item. */
@@ -1799,11 +1844,9 @@ item_t *lobby_add_item_locked(lobby_t *l, uint32_t item_data[4]) {
     if(l->version != CLIENT_VERSION_BB)
         return NULL;
 
-    if(!(item = (lobby_item_t *)malloc(sizeof(lobby_item_t))))
+    if(!(item = item_alloc(l)))
         return NULL;
 
-    memset(item, 0, sizeof(lobby_item_t));
-
     /* Copy the item data in. */
     item->d.item_id = LE32(l->item_id);
     item->d.data_l[0] = LE32(item_data[0]);
@@ -1811,9 +1854,13 @@ item_t *lobby_add_item_locked(lobby_t *l, uint32_t item_data[4]) {
     item->d.data_l[2] = LE32(item_data[2]);
     item->d.data2_l = LE32(item_data[3]);
 
-    /* Increment the item ID, add it to the queue, and return the new item */
+    /* Add it to the table, increment the item ID, and return the new item */
+    if(floor_items_insert(&l->items, item)) {
+        mempool_free(l->block->item_pool, item);
+        return NULL;
+    }
+
     ++l->item_id;
-    TAILQ_INSERT_HEAD(&l->item_queue, item, qentry);
     return &item->d;
 }
 
@@ -1824,21 +1871,23 @@ item_t *lobby_add_item2_locked(lobby_t *l, item_t *it) {
     if(l->version != CLIENT_VERSION_BB)
         return NULL;
 
-    if(!(item = (lobby_item_t *)malloc(sizeof(lobby_item_t))))
+    if(!(item = item_alloc(l)))
         return NULL;
 
-    memset(item, 0, sizeof(lobby_item_t));
-
     /* Copy the item data in. */
     memcpy(&item->d, it, sizeof(item_t));
 
-    /* Add it to the queue, and return the new item */
-    TAILQ_INSERT_HEAD(&l->item_queue, item, qentry);
+    /* Add it to the table, and return the new item */
+    if(floor_items_insert(&l->items, item)) {
+        mempool_free(l->block->item_pool, item);
+        return NULL;
+    }
+
     return &item->d;
 }
 
 int lobby_remove_item_locked(lobby_t *l, uint32_t item_id, item_t *rv) {
-    lobby_item_t *i, *tmp;
+    lobby_item_t *item;
 
     if(l->version != CLIENT_VERSION_BB)
         return -1;
@@ -1846,21 +1895,24 @@ int lobby_remove_item_locked(lobby_t *l, uint32_t item_id, item_t *rv) {
     memset(rv, 0, sizeof(item_t));
     rv->data_l[0] = LE32(Item_NoSuchItem);
 
-    i = TAILQ_FIRST(&l->item_queue);
-    while(i) {
-        tmp = TAILQ_NEXT(i, qentry);
+    if(!(item = floor_items_remove(&l->items, item_id)))
+        return 1;
 
-        if(i->d.item_id == item_id) {
-            memcpy(rv, &i->d, sizeof(item_t));
-            TAILQ_REMOVE(&l->item_queue, i, qentry);
-            free(i);
-            return 0;
-        }
+    memcpy(rv, &item->d, sizeof(item_t));
+    mempool_free(l->block->item_pool, item);
+    return 0;
+}
+
+/* Get rid of everything in the lobby's inventory. */
+static void lobby_clear_items(lobby_t *l) {
+    lobby_item_t *item;
+    uint32_t i;
 
-        i = tmp;
+    LOBBY_ITEM_FOREACH(l, i, item) {
+        mempool_free(l->block->item_pool, item);
     }
 
-    return 1;
+    floor_items_reset(&l->items);
 }
 
 void lobby_send_kill_counts(lobby_t *l) {
@@ -1981,8 +2033,13 @@ int lobby_setup_quest(lobby_t *l, ship_client_t *c, uint32_t qid, int lang) {
             }
 
             /* Update the lobby's episode, just in case it doesn't
-               match up with what's already there. */
-            l->episode = q->episode;
+               match up with what's already there. The episode decides which
+               clients see the game in the list, so let the block know if it
+               changed. */
+            if(l->episode != q->episode) {
+                l->episode = q->episode;
+                lobby_list_changed(l);
+            }
         }
 
         l->flags |= LOBBY_FLAG_QUESTING;
@@ -2039,6 +2096,11 @@ int lobby_setup_quest(lobby_t *l, ship_client_t *c, uint32_t qid, int lang) {
                 if((q->flags & SYLVERANT_QUEST_SYNC_REGS)) {
                     l->q_flags |= LOBBY_QFLAG_SYNC_REGS;
 
+                    /* Get rid of any from a quest the team already did. */
+                    free(l->syncregs);
+                    free(l->regvals);
+                    l->regvals = NULL;
+
                     l->num_syncregs = q->num_sync;
                     if(!(l->syncregs = (uint8_t *)malloc(q->num_sync))) {
                         debug(DBG_ERROR, "Error allocating syncregs!\n");
@@ -2391,7 +2453,7 @@ static int lobby_randInt_lua(lua_State *l) {
 
     if(lua_islightuserdata(l, 1)) {
         lb = (lobby_t *)lua_touserdata(l, 1);
-        rn = mt19937_genrand_int32(&lb->block->rng);
+        rn = mtrand_int32(block_rng(lb->block));
         lua_pushinteger(l, (lua_Integer)rn);
     }
     else {
@@ -2407,7 +2469,7 @@ static int lobby_randFloat_lua(lua_State *l) {
 
     if(lua_islightuserdata(l, 1)) {
         lb = (lobby_t *)lua_touserdata(l, 1);
-        rn = mt19937_genrand_real1(&lb->block->rng);
+        rn = mtrand_real1(block_rng(lb->block));
         lua_pushnumber(l, (lua_Number)rn);
     }
     else {
@@ -2427,6 +2489,7 @@ static int lobby_setSinglePlayer_lua(lua_State *l) {
 
         if(lb->num_clients == 1) {
             lb->flags |= LOBBY_FLAG_SINGLEPLAYER;
+            lobby_list_changed(lb);
             lua_pushboolean(l, 1);
         }
         else {
@@ -1,7 +1,7 @@
 /*
     Sylverant Ship Server
     Copyright (C) 2009, 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018,
-                  2019, 2020, 2021, 2025 Lawrence Sebald
+                  2019, 2020, 2021, 2025, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -34,6 +34,8 @@
 
 #include "player.h"
 #include "mapdata.h"
+#include "arena.h"
+#include "floor_items.h"
 
 #define LOBBY_MAX_CLIENTS   12
 #define LOBBY_MAX_IN_TEAM   4
@@ -71,14 +73,6 @@ typedef struct lobby_pkt {
 
 STAILQ_HEAD(lobby_pkt_queue, lobby_pkt);
 
-typedef struct lobby_item {
-    TAILQ_ENTRY(lobby_item) qentry;
-
-    item_t d;
-} lobby_item_t;
-
-TAILQ_HEAD(lobby_item_queue, lobby_item);
-
 typedef struct lobby_qfunc {
     SLIST_ENTRY(lobby_qfunc) entry;
 
@@ -92,6 +86,8 @@ SLIST_HEAD(lobby_qfunc_list, lobby_qfunc);
 
 struct lobby {
     TAILQ_ENTRY(lobby) qentry;
+    TAILQ_ENTRY(lobby) gentry;          /* Block's list of games. */
+    struct lobby *id_next;              /* Block's table of lobbies by id. */
 
     pthread_mutex_t mutex;
 
@@ -134,12 +130,22 @@ struct lobby {
     ship_client_t *clients[LOBBY_MAX_CLIENTS];
 
     struct lobby_pkt_queue pkt_queue;
-    struct lobby_item_queue item_queue;
+    lobby_item_table_t items;
     struct lobby_pkt_queue burst_queue;
     time_t create_time;
 
-    game_enemies_t *map_enemies;
-    game_objs_t *map_objs;
+    /* Where everything that lives as long as the team does comes from (the
+       random map data). It all gets freed in one go when the team is
+       destroyed. Nothing is taken from it until a team loads map data, so
+       lobbies and teams without any don't pay for it. */
+    arena_t arena;
+
+    /* The same, but for the map data and monster lists of the quest the team
+       is on. This is thrown away as a whole when another quest replaces it. */
+    arena_t quest_arena;
+
+    team_enemies_t *map_enemies;
+    team_objs_t *map_objs;
     bb_battle_param_t *bb_params;
 
     int num_mtypes;
@@ -183,6 +189,10 @@ typedef struct lobby lobby_t;
 #endif
 
 TAILQ_HEAD(lobby_queue, lobby);
+TAILQ_HEAD(lobby_game_queue, lobby);
+
+/* The default lobbies on each block have ids from 1 up to this. */
+#define LOBBY_DEFAULT_COUNT     20
 
 /* Possible values for the type parameter. */
 #define LOBBY_TYPE_LOBBY        0x00000001
@@ -301,6 +311,10 @@ item_t *lobby_add_item2_locked(lobby_t *l, item_t *item);
 
 int lobby_remove_item_locked(lobby_t *l, uint32_t item_id, item_t *rv);
 
+/* Go through each item in the lobby's inventory. The caller must hold the
+   lobby's mutex and must not add or remove items while doing this. */
+#define LOBBY_ITEM_FOREACH(l, i, it) FLOOR_ITEMS_FOREACH(&(l)->items, i, it)
+
 /* Send the kill counts for all clients in the lobby that have kill tracking
    enabled. */
 void lobby_send_kill_counts(lobby_t *l);
@@ -1,6 +1,6 @@
 /*
     Sylverant Ship Server
-    Copyright (C) 2012, 2013, 2014, 2015, 2017, 2018, 2019 Lawrence Sebald
+    Copyright (C) 2012, 2013, 2014, 2015, 2017, 2018, 2019, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -1483,141 +1483,85 @@ void gc_free_params(void) {
     }
 }
 
-int bb_load_game_enemies(lobby_t *l) {
-    game_enemies_t *en;
-    game_objs_t *ob;
-    int solo = (l->flags & LOBBY_FLAG_SINGLEPLAYER) ? 1 : 0, i;
-    uint32_t enemies = 0, index, objects = 0, index2;
-    parsed_map_t *maps;
-    parsed_objs_t *objs;
-    game_enemies_t *sets[0x10];
-    game_objs_t *osets[0x10];
-
-    /* Figure out the parameter set that will be in use first... */
-    l->bb_params = battle_params[solo][l->episode - 1][l->difficulty];
-
-    /* Figure out the total number of enemies that the game will have... */
-    for(i = 0; i < 0x20; i += 2) {
-        maps = &bb_parsed_maps[solo][l->episode - 1][i >> 1];
-        objs = &bb_parsed_objs[solo][l->episode - 1][i >> 1];
-
-        /* If we hit zeroes, then we're done already... */
-        if(maps->map_count == 0 && maps->variation_count == 0) {
-            sets[i >> 1] = NULL;
-            break;
-        }
-
-        /* Sanity Check! */
-        if(l->maps[i] > maps->map_count ||
-           l->maps[i + 1] > maps->variation_count) {
-            debug(DBG_ERROR, "Invalid map set generated for level %d (ep %d): "
-                  "(%d %d)\n", i, l->episode, l->maps[i], l->maps[i + 1]);
-            return -1;
-        }
-
-        index = l->maps[i] * maps->variation_count + l->maps[i + 1];
-        enemies += maps->data[index].count;
-        objects += objs->data[index].count;
-        sets[i >> 1] = &maps->data[index];
-        osets[i >> 1] = &objs->data[index];
+/* What the special Rappies turn into for the team's event. */
+static uint8_t event_rappy_rt(lobby_t *l) {
+    switch(l->event) {
+        case LOBBY_EVENT_CHRISTMAS:
+            return 79;
+        case LOBBY_EVENT_EASTER:
+            return 81;
+        case LOBBY_EVENT_HALLOWEEN:
+            return 80;
+        default:
+            return 51;
     }
+}
+
+/* Allocate a team's view of its enemies and objects out of the given arena.
+   Only the per-team state is allocated here, the enemy and object data itself
+   is filled in by the caller. */
+static int alloc_team_enemies(lobby_t *l, arena_t *a, uint32_t enemies,
+                              uint32_t objects, team_enemies_t **enp,
+                              team_objs_t **obp) {
+    team_enemies_t *en;
+    team_objs_t *ob;
 
-    /* Allocate space for the enemy set and the enemies therein. */
-    if(!(en = (game_enemies_t *)malloc(sizeof(game_enemies_t)))) {
+    if(!(en = (team_enemies_t *)arena_zalloc(a, sizeof(team_enemies_t)))) {
         debug(DBG_ERROR, "Error allocating enemy set: %s\n", strerror(errno));
-        return -2;
+        return -1;
     }
 
-    if(!(en->enemies = (game_enemy_t *)malloc(sizeof(game_enemy_t) *
-                                              enemies))) {
+    if(!(en->state = (game_enemy_state_t *)
+         arena_zalloc(a, sizeof(game_enemy_state_t) * enemies))) {
         debug(DBG_ERROR, "Error allocating enemies: %s\n", strerror(errno));
-        free(en);
-        return -3;
+        return -1;
     }
 
-    /* Allocate space for the object set and the objects therein. */
-    if(!(ob = (game_objs_t *)malloc(sizeof(game_objs_t)))) {
+    if(!(ob = (team_objs_t *)arena_zalloc(a, sizeof(team_objs_t)))) {
         debug(DBG_ERROR, "Error allocating object set: %s\n", strerror(errno));
-        free(en->enemies);
-        free(en);
-        return -4;
+        return -1;
     }
 
-    if(!(ob->objs = (game_object_t *)malloc(sizeof(game_object_t) * objects))) {
+    if(!(ob->flags = (uint8_t *)arena_zalloc(a, objects))) {
         debug(DBG_ERROR, "Error allocating objects: %s\n", strerror(errno));
-        free(ob);
-        free(en->enemies);
-        free(en);
-        return -5;
+        return -1;
     }
 
     en->count = enemies;
     ob->count = objects;
-    index = index2 = 0;
-
-    /* Copy in the enemy data. */
-    for(i = 0; i < 0x10; ++i) {
-        if(!sets[i] || !osets[i])
-            break;
 
-        memcpy(&en->enemies[index], sets[i]->enemies,
-               sizeof(game_enemy_t) * sets[i]->count);
-        index += sets[i]->count;
-        memcpy(&ob->objs[index2], osets[i]->objs,
-               sizeof(game_object_t) * osets[i]->count);
-        index2 += osets[i]->count;
-    }
+    /* Fixup Dark Falz' data for difficulties other than normal. */
+    en->falz_bp = l->difficulty ? 0x38 : 0x37;
+    en->rappy_rt = (uint8_t)-1;
 
-    /* Fixup Dark Falz' data for difficulties other than normal and the special
-       Rappy data too... */
-    for(i = 0; i < en->count; ++i) {
-        if(en->enemies[i].bp_entry == 0x37 && l->difficulty) {
-            en->enemies[i].bp_entry = 0x38;
-        }
-        else if(en->enemies[i].rt_index == (uint8_t)-1) {
-            switch(l->event) {
-                case LOBBY_EVENT_CHRISTMAS:
-                    en->enemies[i].rt_index = 79;
-                    break;
-                case LOBBY_EVENT_EASTER:
-                    en->enemies[i].rt_index = 81;
-                    break;
-                case LOBBY_EVENT_HALLOWEEN:
-                    en->enemies[i].rt_index = 80;
-                    break;
-                default:
-                    en->enemies[i].rt_index = 51;
-                    break;
-            }
-        }
-    }
-
-    /* Done! */
-    l->map_enemies = en;
-    l->map_objs = ob;
+    *enp = en;
+    *obp = ob;
     return 0;
 }
 
-int v2_load_game_enemies(lobby_t *l) {
-    game_enemies_t *en;
-    game_objs_t *ob;
-    int i;
-    uint32_t enemies = 0, index, objects = 0, index2;
+/* Set up a team's enemies and objects from the preparsed map data. Rather than
+   copying all of it for each team, the team just points at the variations in
+   use. The parsed data is never modified after it is loaded, so this is safe to
+   share between any number of teams. */
+static int setup_game_enemies(lobby_t *l, parsed_map_t *pmaps,
+                              parsed_objs_t *pobjs, int fix_rappies) {
+    team_enemies_t *en;
+    team_objs_t *ob;
+    int i, nsets = 0;
+    uint32_t enemies = 0, index, objects = 0;
     parsed_map_t *maps;
     parsed_objs_t *objs;
-    game_enemies_t *sets[0x10];
-    game_objs_t *osets[0x10];
+    game_enemies_t *sets[TEAM_MAX_SETS];
+    game_objs_t *osets[TEAM_MAX_SETS];
 
     /* Figure out the total number of enemies that the game will have... */
     for(i = 0; i < 0x20; i += 2) {
-        maps = &v2_parsed_maps[i >> 1];
-        objs = &v2_parsed_objs[i >> 1];
+        maps = &pmaps[i >> 1];
+        objs = &pobjs[i >> 1];
 
         /* If we hit zeroes, then we're done already... */
-        if(maps->map_count == 0 && maps->variation_count == 0) {
-            sets[i >> 1] = NULL;
+        if(maps->map_count == 0 && maps->variation_count == 0)
             break;
-        }
 
         /* Sanity Check! */
         if(l->maps[i] > maps->map_count ||
@@ -1630,65 +1574,31 @@ int v2_load_game_enemies(lobby_t *l) {
         index = l->maps[i] * maps->variation_count + l->maps[i + 1];
         enemies += maps->data[index].count;
         objects += objs->data[index].count;
-        sets[i >> 1] = &maps->data[index];
-        osets[i >> 1] = &objs->data[index];
+        sets[nsets] = &maps->data[index];
+        osets[nsets++] = &objs->data[index];
     }
 
-    /* Allocate space for the enemy set and the enemies therein. */
-    if(!(en = (game_enemies_t *)malloc(sizeof(game_enemies_t)))) {
-        debug(DBG_ERROR, "Error allocating enemy set: %s\n", strerror(errno));
+    /* Allocate space for the team's state. */
+    if(alloc_team_enemies(l, &l->arena, enemies, objects, &en, &ob))
         return -2;
-    }
 
-    if(!(en->enemies = (game_enemy_t *)malloc(sizeof(game_enemy_t) *
-                                              enemies))) {
-        debug(DBG_ERROR, "Error allocating enemies: %s\n", strerror(errno));
-        free(en);
-        return -3;
-    }
+    /* Point at the shared data. */
+    en->num_sets = ob->num_sets = nsets;
+    enemies = objects = 0;
 
-    /* Allocate space for the object set and the objects therein. */
-    if(!(ob = (game_objs_t *)malloc(sizeof(game_objs_t)))) {
-        debug(DBG_ERROR, "Error allocating object set: %s\n", strerror(errno));
-        free(en->enemies);
-        free(en);
-        return -4;
-    }
+    for(i = 0; i < nsets; ++i) {
+        en->start[i] = enemies;
+        en->sets[i] = sets[i]->enemies;
+        enemies += sets[i]->count;
 
-    if(!(ob->objs = (game_object_t *)malloc(sizeof(game_object_t) * objects))) {
-        debug(DBG_ERROR, "Error allocating objects: %s\n", strerror(errno));
-        free(ob);
-        free(en->enemies);
-        free(en);
-        return -5;
+        ob->start[i] = objects;
+        ob->sets[i] = osets[i]->objs;
+        objects += osets[i]->count;
     }
 
-    en->count = enemies;
-    ob->count = objects;
-    index = index2 = 0;
-
-    /* Copy in the enemy data. */
-    for(i = 0; i < 0x10; ++i) {
-        if(!sets[i] || !osets[i])
-            break;
-
-        memcpy(&en->enemies[index], sets[i]->enemies,
-               sizeof(game_enemy_t) * sets[i]->count);
-        index += sets[i]->count;
-
-        memcpy(&ob->objs[index2], osets[i]->objs,
-               sizeof(game_object_t) * osets[i]->count);
-        index2 += osets[i]->count;
-    }
-
-    /* Fixup Dark Falz' data for difficulties other than normal... */
-    if(l->difficulty) {
-        for(i = 0; i < en->count; ++i) {
-            if(en->enemies[i].bp_entry == 0x37) {
-                en->enemies[i].bp_entry = 0x38;
-            }
-        }
-    }
+    /* The special Rappy data gets filled in based on the event. */
+    if(fix_rappies)
+        en->rappy_rt = event_rappy_rt(l);
 
     /* Done! */
     l->map_enemies = en;
@@ -1696,130 +1606,28 @@ int v2_load_game_enemies(lobby_t *l) {
     return 0;
 }
 
-int gc_load_game_enemies(lobby_t *l) {
-    game_enemies_t *en;
-    game_objs_t *ob;
-    int i;
-    uint32_t enemies = 0, index, objects = 0, index2;
-    parsed_map_t *maps;
-    parsed_objs_t *objs;
-    game_enemies_t *sets[0x10];
-    game_objs_t *osets[0x10];
-
-    /* Figure out the total number of enemies that the game will have... */
-    for(i = 0; i < 0x20; i += 2) {
-        maps = &gc_parsed_maps[l->episode - 1][i >> 1];
-        objs = &gc_parsed_objs[l->episode - 1][i >> 1];
-
-        /* If we hit zeroes, then we're done already... */
-        if(maps->map_count == 0 && maps->variation_count == 0) {
-            sets[i >> 1] = NULL;
-            break;
-        }
-
-        /* Sanity Check! */
-        if(l->maps[i] > maps->map_count ||
-           l->maps[i + 1] > maps->variation_count) {
-            debug(DBG_ERROR, "Invalid map set generated for level %d (ep %d): "
-                  "(%d %d)\n", i, l->episode, l->maps[i], l->maps[i + 1]);
-            return -1;
-        }
-
-        index = l->maps[i] * maps->variation_count + l->maps[i + 1];
-        enemies += maps->data[index].count;
-        objects += objs->data[index].count;
-        sets[i >> 1] = &maps->data[index];
-        osets[i >> 1] = &objs->data[index];
-    }
-
-    /* Allocate space for the enemy set and the enemies therein. */
-    if(!(en = (game_enemies_t *)malloc(sizeof(game_enemies_t)))) {
-        debug(DBG_ERROR, "Error allocating enemy set: %s\n", strerror(errno));
-        return -2;
-    }
-
-    if(!(en->enemies = (game_enemy_t *)malloc(sizeof(game_enemy_t) *
-                                              enemies))) {
-        debug(DBG_ERROR, "Error allocating enemies: %s\n", strerror(errno));
-        free(en);
-        return -3;
-    }
-
-    /* Allocate space for the object set and the objects therein. */
-    if(!(ob = (game_objs_t *)malloc(sizeof(game_objs_t)))) {
-        debug(DBG_ERROR, "Error allocating object set: %s\n", strerror(errno));
-        free(en->enemies);
-        free(en);
-        return -4;
-    }
-
-    if(!(ob->objs = (game_object_t *)malloc(sizeof(game_object_t) * objects))) {
-        debug(DBG_ERROR, "Error allocating objects: %s\n", strerror(errno));
-        free(ob);
-        free(en->enemies);
-        free(en);
-        return -5;
-    }
-
-    en->count = enemies;
-    ob->count = objects;
-    index = index2 = 0;
-
-    /* Copy in the enemy data. */
-    for(i = 0; i < 0x10; ++i) {
-        if(!sets[i] || !osets[i])
-            break;
+int bb_load_game_enemies(lobby_t *l) {
+    int solo = (l->flags & LOBBY_FLAG_SINGLEPLAYER) ? 1 : 0;
 
-        memcpy(&en->enemies[index], sets[i]->enemies,
-               sizeof(game_enemy_t) * sets[i]->count);
-        index += sets[i]->count;
+    /* Figure out the parameter set that will be in use first... */
+    l->bb_params = battle_params[solo][l->episode - 1][l->difficulty];
 
-        memcpy(&ob->objs[index2], osets[i]->objs,
-               sizeof(game_object_t) * osets[i]->count);
-        index2 += osets[i]->count;
-    }
+    return setup_game_enemies(l, bb_parsed_maps[solo][l->episode - 1],
+                              bb_parsed_objs[solo][l->episode - 1], 1);
+}
 
-    /* Fixup Dark Falz' data for difficulties other than normal and the special
-       Rappy data too... */
-    for(i = 0; i < en->count; ++i) {
-        if(en->enemies[i].bp_entry == 0x37 && l->difficulty) {
-            en->enemies[i].bp_entry = 0x38;
-        }
-        else if(en->enemies[i].rt_index == (uint8_t)-1) {
-            switch(l->event) {
-                case LOBBY_EVENT_CHRISTMAS:
-                    en->enemies[i].rt_index = 79;
-                    break;
-                case LOBBY_EVENT_EASTER:
-                    en->enemies[i].rt_index = 81;
-                    break;
-                case LOBBY_EVENT_HALLOWEEN:
-                    en->enemies[i].rt_index = 80;
-                    break;
-                default:
-                    en->enemies[i].rt_index = 51;
-                    break;
-            }
-        }
-    }
+int v2_load_game_enemies(lobby_t *l) {
+    return setup_game_enemies(l, v2_parsed_maps, v2_parsed_objs, 0);
+}
 
-    /* Done! */
-    l->map_enemies = en;
-    l->map_objs = ob;
-    return 0;
+int gc_load_game_enemies(lobby_t *l) {
+    return setup_game_enemies(l, gc_parsed_maps[l->episode - 1],
+                              gc_parsed_objs[l->episode - 1], 1);
 }
 
 void free_game_enemies(lobby_t *l) {
-    if(l->map_enemies) {
-        free(l->map_enemies->enemies);
-        free(l->map_enemies);
-    }
-
-    if(l->map_objs) {
-        free(l->map_objs->objs);
-        free(l->map_objs);
-    }
-
+    /* The data itself lives in the team's arenas, so it goes away when the
+       team does. All we can do here is forget about it. */
     l->map_enemies = NULL;
     l->map_objs = NULL;
     l->bb_params = NULL;
@@ -1985,14 +1793,16 @@ int load_quest_enemies(lobby_t *l, uint32_t qid, int ver) {
     FILE *fp;
     size_t dlen = strlen(ship->cfg->quests_dir);
     char fn[dlen + 40];
-    void *tmp;
-    uint32_t cnt, i;
+    uint32_t cnt, ocnt, i;
     sylverant_quest_t *q;
     quest_map_elem_t *el;
     uint32_t flags = l->flags;
-    game_enemies_t *newen;
-    game_objs_t *newob;
+    team_enemies_t *newen;
+    team_objs_t *newob;
+    game_enemy_t *ens;
+    game_object_t *objs;
     ssize_t amt;
+    arena_t qa;
 
     /* Cowardly refuse to do this on challenge or battle mode. */
     if(l->challenge || l->battle)
@@ -2021,43 +1831,26 @@ int load_quest_enemies(lobby_t *l, uint32_t qid, int ver) {
         return -2;
     }
 
-    /* Allocate the storage for the new enemy/object arrays. */
-    if(!(newen = (game_enemies_t *)malloc(sizeof(game_enemies_t)))) {
-        debug(DBG_WARN, "Cannot allocate enemies for quest: %s\n",
-              strerror(errno));
-        fclose(fp);
-        return -10;
-    }
-
-    if(!(newob = (game_objs_t *)malloc(sizeof(game_objs_t)))) {
-        debug(DBG_WARN, "Cannot allocate objects for quest: %s\n",
-              strerror(errno));
-        free(newen);
-        fclose(fp);
-        return -11;
-    }
-
-    memset(newen, 0, sizeof(game_enemies_t));
-    memset(newob, 0, sizeof(game_objs_t));
-
-    /* Allocate the objects array. */
-    newob->count = cnt = LE32(cnt);
-    if(!(tmp = malloc(cnt * sizeof(game_object_t)))) {
+    /* Allocate the objects array. Everything for the quest comes out of an
+       arena of its own, which replaces the team's quest arena once it's all
+       loaded. Unlike the random maps, none of this is shared with anyone
+       else. */
+    arena_init(&qa, 0);
+    ocnt = cnt = LE32(cnt);
+    if(!(objs = (game_object_t *)arena_zalloc(&qa, cnt *
+                                              sizeof(game_object_t)))) {
         debug(DBG_WARN, "Cannot allocate object array for quest: %s\n",
               strerror(errno));
         debug(DBG_WARN, "Quest ID: %" PRIu32 " Version: %d\n", qid, ver);
         debug(DBG_WARN, "Object count: %" PRIu32 "\n", cnt);
-        free(newob);
-        free(newen);
         fclose(fp);
+        arena_destroy(&qa);
         return -3;
     }
 
-    newob->objs = (game_object_t *)tmp;
-
     /* Read the objects in from the cache file. */
     for(i = 0; i < cnt; ++i) {
-        if((amt = fread(&newob->objs[i].data, 1, sizeof(map_object_t),
+        if((amt = fread(&objs[i].data, 1, sizeof(map_object_t),
                         fp)) != sizeof(map_object_t)) {
             if(amt < 0) {
                 debug(DBG_WARN, "Cannot read cached map objects at object id "
@@ -2071,90 +1864,70 @@ int load_quest_enemies(lobby_t *l, uint32_t qid, int ver) {
 
             debug(DBG_WARN, "Quest ID: %" PRIu32 " Version: %d\n", qid, ver);
             debug(DBG_WARN, "Object count: %" PRIu32 "\n", cnt);
-            free(newob->objs);
-            free(newob);
-            free(newen);
             fclose(fp);
+            arena_destroy(&qa);
             return -4;
         }
-
-        newob->objs[i].flags = 0;
     }
 
     if(fread(&cnt, 1, 4, fp) != 4) {
         debug(DBG_WARN, "Cannot read file \"%s\": %s\n", fn, strerror(errno));
-        free(newob->objs);
-        free(newob);
-        free(newen);
         fclose(fp);
+        arena_destroy(&qa);
         return -5;
     }
 
     /* Allocate the enemies array. */
-    newen->count = cnt = LE32(cnt);
-    if(!(tmp = malloc(cnt * sizeof(game_enemy_t)))) {
+    cnt = LE32(cnt);
+    if(!(ens = (game_enemy_t *)arena_alloc(&qa,
+                                           cnt * sizeof(game_enemy_t)))) {
         debug(DBG_WARN, "Cannot allocate enemies array for quest: %s\n",
               strerror(errno));
         debug(DBG_WARN, "Quest ID: %" PRIu32 " Version: %d\n", qid, ver);
         debug(DBG_WARN, "Enemy count: %" PRIu32 "\n", cnt);
-        free(newob->objs);
-        free(newob);
-        free(newen);
         fclose(fp);
+        arena_destroy(&qa);
         return -6;
     }
 
-    newen->enemies = (game_enemy_t *)tmp;
-
     /* Read the enemies in from the cache file. */
-    if(fread(newen->enemies, sizeof(game_enemy_t), cnt, fp) != cnt) {
+    if(fread(ens, sizeof(game_enemy_t), cnt, fp) != cnt) {
         debug(DBG_WARN, "Cannot read map cache: %s\n", strerror(errno));
         debug(DBG_WARN, "Quest ID: %" PRIu32 " Version: %d\n", qid, ver);
-        debug(DBG_WARN, "Object count: %" PRIu32 "\n", newob->count);
-        debug(DBG_WARN, "Enemy count: %" PRIu32 "\n", newen->count);
-        free(newen->enemies);
-        free(newob->objs);
-        free(newob);
-        free(newen);
+        debug(DBG_WARN, "Object count: %" PRIu32 "\n", ocnt);
+        debug(DBG_WARN, "Enemy count: %" PRIu32 "\n", cnt);
         fclose(fp);
+        arena_destroy(&qa);
         return -7;
     }
 
     /* We're done with the file now, so close it. */
     fclose(fp);
 
-    /* It should be safe to swap things out now, so do it. */
-    free(l->map_enemies->enemies);
-    free(l->map_objs->objs);
-    free(l->map_enemies);
-    free(l->map_objs);
+    /* Set up the team's view of the new enemies and objects. */
+    if(alloc_team_enemies(l, &qa, cnt, ocnt, &newen, &newob)) {
+        debug(DBG_WARN, "Cannot allocate enemies for quest %" PRIu32 "\n",
+              qid);
+        arena_destroy(&qa);
+        return -10;
+    }
+
+    newen->num_sets = newob->num_sets = 1;
+    newen->sets[0] = ens;
+    newob->sets[0] = objs;
+    newen->rappy_rt = event_rappy_rt(l);
 
+    /* It should be safe to swap things out now, so do it. If the old data was
+       from another quest, it goes away along with the rest of that quest's
+       arena (including its monster lists). The random map data stays in the
+       team's arena until the team goes away, but there's only ever one set of
+       that. */
     l->map_enemies = newen;
     l->map_objs = newob;
-
-    /* Fixup Dark Falz' data for difficulties other than normal and the special
-       Rappy data too... */
-    for(i = 0; i < cnt; ++i) {
-        if(l->map_enemies->enemies[i].bp_entry == 0x37 && l->difficulty) {
-            l->map_enemies->enemies[i].bp_entry = 0x38;
-        }
-        else if(l->map_enemies->enemies[i].rt_index == (uint8_t)-1) {
-            switch(l->event) {
-                case LOBBY_EVENT_CHRISTMAS:
-                    l->map_enemies->enemies[i].rt_index = 79;
-                    break;
-                case LOBBY_EVENT_EASTER:
-                    l->map_enemies->enemies[i].rt_index = 81;
-                    break;
-                case LOBBY_EVENT_HALLOWEEN:
-                    l->map_enemies->enemies[i].rt_index = 80;
-                    break;
-                default:
-                    l->map_enemies->enemies[i].rt_index = 51;
-                    break;
-            }
-        }
-    }
+    l->mtypes = l->mids = NULL;
+    l->num_mtypes = l->num_mids = 0;
+    arena_destroy(&l->quest_arena);
+    l->quest_arena = qa;
 
     /* Find the quest since we need to check the enemies later for drops... */
     if(!(el = quest_lookup(&ship->qmap, qid))) {
@@ -2180,16 +1953,18 @@ int load_quest_enemies(lobby_t *l, uint32_t qid, int ver) {
 
     /* Make a copy of the monster data from the quest. */
     l->num_mtypes = q->num_monster_types;
-    if(!(l->mtypes = (qenemy_t *)malloc(sizeof(qenemy_t) * l->num_mtypes))) {
+    if(!(l->mtypes = (qenemy_t *)arena_alloc(&l->quest_arena,
+                                             sizeof(qenemy_t) *
+                                             l->num_mtypes))) {
         debug(DBG_WARN, "Cannot allocate monster types: %s\n", strerror(errno));
         l->num_mtypes = 0;
         goto done;
     }
 
     l->num_mids = q->num_monster_ids;
-    if(!(l->mids = (qenemy_t *)malloc(sizeof(qenemy_t) * l->num_mids))) {
+    if(!(l->mids = (qenemy_t *)arena_alloc(&l->quest_arena,
+                                           sizeof(qenemy_t) * l->num_mids))) {
         debug(DBG_WARN, "Cannot allocate monster ids: %s\n", strerror(errno));
-        free(l->mtypes);
         l->mtypes = NULL;
         l->num_mtypes = 0;
         l->num_mids = 0;
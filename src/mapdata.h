@@ -1,6 +1,6 @@
 /*
     Sylverant Ship Server
-    Copyright (C) 2012, 2013, 2015, 2017, 2018 Lawrence Sebald
+    Copyright (C) 2012, 2013, 2015, 2017, 2018, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -114,7 +114,10 @@ typedef struct map_object {
     };
 } PACKED map_object_t;
 
-/* Enemy data as used in the game. */
+/* Enemy data as used in the game. This is also the format of the enemy data in
+   the quest map cache, so the layout can't change. The clients_hit, last_client
+   and drop_done fields are unused here, the per-team copies of them are in the
+   team's game_enemy_state_t array. */
 typedef struct game_enemy {
     uint32_t bp_entry;
     uint8_t rt_index;
@@ -135,7 +138,8 @@ typedef struct parsed_map {
     game_enemies_t *data;
 } parsed_map_t;
 
-/* Object data as used in the game. */
+/* Object data as used in the game. As with the enemies, the flags here are
+   unused and the per-team flags are kept separately. */
 typedef struct game_object {
     map_object_t data;
     uint32_t flags;
@@ -153,6 +157,50 @@ typedef struct parsed_objects {
     game_objs_t *data;
 } parsed_objs_t;
 
+/* The most sets of map data (one per area) that a team's map can be made up
+   of. */
+#define TEAM_MAX_SETS               0x10
+
+/* The state of an enemy that is specific to one team. */
+typedef struct game_enemy_state {
+    uint8_t clients_hit;
+    uint8_t last_client;
+    uint8_t drop_done;
+} game_enemy_state_t;
+
+/* A team's enemies. The enemy data itself is made up of a set for each area,
+   which point at the preparsed map data (shared by every team that has that map
+   variation) or at the quest's data in the team's arena. Either way, it is not
+   modified once it is set up. The few things that differ between teams are
+   handled by team_enemy_bp() and team_enemy_rt(), and everything that changes
+   as the team plays is in the state array. */
+typedef struct team_enemies {
+    uint32_t count;
+    int num_sets;
+    uint32_t start[TEAM_MAX_SETS];
+    const game_enemy_t *sets[TEAM_MAX_SETS];
+
+    uint32_t falz_bp;                   /* What Dark Falz' bp_entry becomes. */
+    uint8_t rappy_rt;                   /* What special Rappies' rt_index
+                                           becomes. */
+
+    game_enemy_state_t *state;
+} team_enemies_t;
+
+/* Values for the per-team object flags. */
+#define TEAM_OBJ_FLAG_DROPPED       0x01    /* Box has already dropped. */
+#define TEAM_OBJ_FLAG_HIT           0x02    /* Object has already been hit. */
+
+/* A team's objects, set up in the same way as its enemies. */
+typedef struct team_objects {
+    uint32_t count;
+    int num_sets;
+    uint32_t start[TEAM_MAX_SETS];
+    const game_object_t *sets[TEAM_MAX_SETS];
+
+    uint8_t *flags;
+} team_objs_t;
+
 #undef PACKED
 
 /* Object types */
@@ -187,6 +235,59 @@ int v2_load_game_enemies(lobby_t *l);
 int gc_load_game_enemies(lobby_t *l);
 void free_game_enemies(lobby_t *l);
 
+/* Figure out which set an enemy or object id falls in. There are only ever a
+   handful of sets, so just look from the end. */
+static inline int team_find_set(const uint32_t *start, int nsets, uint32_t id) {
+    int i = nsets - 1;
+
+    while(i > 0 && id < start[i])
+        --i;
+
+    return i;
+}
+
+/* Look up an enemy or object in a team's map by its id. These return NULL if
+   the id is out of range. */
+static inline const game_enemy_t *team_enemy(const team_enemies_t *e,
+                                             uint32_t mid) {
+    int i;
+
+    if(mid >= e->count)
+        return NULL;
+
+    i = team_find_set(e->start, e->num_sets, mid);
+    return &e->sets[i][mid - e->start[i]];
+}
+
+static inline const game_object_t *team_object(const team_objs_t *o,
+                                               uint32_t id) {
+    int i;
+
+    if(id >= o->count)
+        return NULL;
+
+    i = team_find_set(o->start, o->num_sets, id);
+    return &o->sets[i][id - o->start[i]];
+}
+
+/* Grab the battle parameter entry and rare table index of an enemy, with any
+   changes for the team's difficulty and event applied. */
+static inline uint32_t team_enemy_bp(const team_enemies_t *e,
+                                     const game_enemy_t *en) {
+    if(en->bp_entry == 0x37)
+        return e->falz_bp;
+
+    return en->bp_entry;
+}
+
+static inline uint8_t team_enemy_rt(const team_enemies_t *e,
+                                    const game_enemy_t *en) {
+    if(en->rt_index == (uint8_t)-1)
+        return e->rappy_rt;
+
+    return en->rt_index;
+}
+
 int map_have_v2_maps(void);
 int map_have_gc_maps(void);
 int map_have_bb_maps(void);
@@ -0,0 +1,154 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "mempool.h"
+
+/* Header at the front of each slab. This is padded out to the alignment of the
+   objects so that the first object in the slab is aligned properly. */
+typedef struct mempool_slab {
+    struct mempool_slab *next;
+} mempool_slab_t;
+
+#define SLAB_HDR_SIZE \
+    ((sizeof(mempool_slab_t) + MEMPOOL_ALIGN - 1) & ~(MEMPOOL_ALIGN - 1))
+
+/* Free objects are kept in a singly linked list, threaded through the first
+   few bytes of each object. */
+typedef struct mempool_obj {
+    struct mempool_obj *next;
+} mempool_obj_t;
+
+struct mempool {
+    pthread_mutex_t mutex;
+    size_t obj_size;
+    int per_slab;
+
+    mempool_obj_t *free_list;
+    mempool_slab_t *slabs;
+};
+
+mempool_t *mempool_create(size_t obj_size, int per_slab) {
+    mempool_t *rv;
+
+    if(!(rv = (mempool_t *)malloc(sizeof(mempool_t)))) {
+        perror("malloc");
+        return NULL;
+    }
+
+    if(obj_size < sizeof(mempool_obj_t))
+        obj_size = sizeof(mempool_obj_t);
+
+    rv->obj_size = (obj_size + MEMPOOL_ALIGN - 1) & ~(MEMPOOL_ALIGN - 1);
+    rv->per_slab = per_slab > 0 ? per_slab : 1;
+    rv->free_list = NULL;
+    rv->slabs = NULL;
+    pthread_mutex_init(&rv->mutex, NULL);
+
+    return rv;
+}
+
+void mempool_destroy(mempool_t *p) {
+    mempool_slab_t *i, *tmp;
+
+    if(!p)
+        return;
+
+    i = p->slabs;
+    while(i) {
+        tmp = i->next;
+        free(i);
+        i = tmp;
+    }
+
+    pthread_mutex_destroy(&p->mutex);
+    free(p);
+}
+
+/* Add a new slab to the pool. Must be called with the pool's mutex held. */
+static int mempool_grow(mempool_t *p) {
+    mempool_slab_t *slab;
+    mempool_obj_t *obj;
+    uint8_t *ptr;
+    int i;
+    void *mem;
+
+    if(posix_memalign(&mem, MEMPOOL_ALIGN,
+                      SLAB_HDR_SIZE + p->obj_size * p->per_slab)) {
+        perror("posix_memalign");
+        return -1;
+    }
+
+    slab = (mempool_slab_t *)mem;
+    slab->next = p->slabs;
+    p->slabs = slab;
+
+    /* Put all of the new objects on the free list, in order. */
+    ptr = (uint8_t *)mem + SLAB_HDR_SIZE + p->obj_size * (p->per_slab - 1);
+
+    for(i = 0; i < p->per_slab; ++i) {
+        obj = (mempool_obj_t *)ptr;
+        obj->next = p->free_list;
+        p->free_list = obj;
+        ptr -= p->obj_size;
+    }
+
+    return 0;
+}
+
+void *mempool_alloc(mempool_t *p) {
+    mempool_obj_t *rv;
+
+    pthread_mutex_lock(&p->mutex);
+
+    if(!p->free_list && mempool_grow(p)) {
+        pthread_mutex_unlock(&p->mutex);
+        return NULL;
+    }
+
+    rv = p->free_list;
+    p->free_list = rv->next;
+    pthread_mutex_unlock(&p->mutex);
+
+    return rv;
+}
+
+void *mempool_zalloc(mempool_t *p) {
+    void *rv = mempool_alloc(p);
+
+    if(rv)
+        memset(rv, 0, p->obj_size);
+
+    return rv;
+}
+
+void mempool_free(mempool_t *p, void *ptr) {
+    mempool_obj_t *obj = (mempool_obj_t *)ptr;
+
+    if(!ptr)
+        return;
+
+    pthread_mutex_lock(&p->mutex);
+    obj->next = p->free_list;
+    p->free_list = obj;
+    pthread_mutex_unlock(&p->mutex);
+}
@@ -0,0 +1,56 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MEMPOOL_H
+#define MEMPOOL_H
+
+#include <stddef.h>
+
+/* Fixed-size object pool. Objects are carved out of larger slabs as needed, and
+   freed objects are kept around on a free list to be handed out again, rather
+   than going back through malloc/free every time. Slabs are only released when
+   the pool itself is destroyed.
+
+   Every object is aligned to MEMPOOL_ALIGN bytes (a cache line). Pools are
+   safe to use from multiple threads at once. */
+#define MEMPOOL_ALIGN   64
+
+struct mempool;
+
+#ifndef MEMPOOL_DEFINED
+#define MEMPOOL_DEFINED
+typedef struct mempool mempool_t;
+#endif
+
+/* Create a pool of objects of the given size, allocating per_slab of them at a
+   time when the pool runs dry. */
+mempool_t *mempool_create(size_t obj_size, int per_slab);
+
+/* Destroy a pool and all of the memory it owns, whether or not the objects in
+   it are still in use. */
+void mempool_destroy(mempool_t *p);
+
+/* Grab an object from the pool. The contents are not initialized. */
+void *mempool_alloc(mempool_t *p);
+
+/* Grab an object from the pool, zeroing it out first. */
+void *mempool_zalloc(mempool_t *p);
+
+/* Return an object to the pool. NULL is ignored. */
+void mempool_free(mempool_t *p, void *ptr);
+
+#endif /* !MEMPOOL_H */
@@ -0,0 +1,77 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdint.h>
+
+#include "mtrand.h"
+
+#define M                   397
+#define MATRIX_A            0x9908B0DFU
+#define UPPER_MASK          0x80000000U
+#define LOWER_MASK          0x7FFFFFFFU
+
+/* Combine the top bit of one state word with the rest of the next one, and
+   scramble the result. This is the same as the table lookup in the reference
+   code, but without any branches or memory accesses. */
+#define TWIST(u, v) \
+    (((((u) & UPPER_MASK) | ((v) & LOWER_MASK)) >> 1) ^ \
+     (-((v) & 1U) & MATRIX_A))
+
+void mtrand_init(mtrand_t *rng, uint32_t s) {
+    int i;
+
+    rng->mt[0] = s;
+
+    for(i = 1; i < MTRAND_N; ++i) {
+        rng->mt[i] = 1812433253U * (rng->mt[i - 1] ^ (rng->mt[i - 1] >> 30)) +
+            (uint32_t)i;
+    }
+
+    /* Don't bother generating anything until something actually needs it. */
+    rng->idx = MTRAND_N;
+}
+
+void mtrand_refill(mtrand_t *rng) {
+    uint32_t *mt = rng->mt, *buf = rng->buf;
+    uint32_t y;
+    int i;
+
+    /* The first N - M values only depend on the old state... */
+    for(i = 0; i < MTRAND_N - M; ++i) {
+        mt[i] = mt[i + M] ^ TWIST(mt[i], mt[i + 1]);
+    }
+
+    /* ...the rest depend on ones that were just generated, but always at least
+       N - M back, so this still works fine a bunch at a time. */
+    for(; i < MTRAND_N - 1; ++i) {
+        mt[i] = mt[i + M - MTRAND_N] ^ TWIST(mt[i], mt[i + 1]);
+    }
+
+    mt[MTRAND_N - 1] = mt[M - 1] ^ TWIST(mt[MTRAND_N - 1], mt[0]);
+
+    /* Temper everything in one go. */
+    for(i = 0; i < MTRAND_N; ++i) {
+        y = mt[i];
+        y ^= (y >> 11);
+        y ^= (y << 7) & 0x9D2C5680U;
+        y ^= (y << 15) & 0xEFC60000U;
+        y ^= (y >> 18);
+        buf[i] = y;
+    }
+
+    rng->idx = 0;
+}
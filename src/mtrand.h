@@ -0,0 +1,61 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MTRAND_H
+#define MTRAND_H
+
+#include <stdint.h>
+
+/* Mersenne Twister (MT19937) random number generator. This gives exactly the
+   same sequence of numbers for a given seed as the mt19937_* functions in
+   libsylverant, but instead of regenerating the state and tempering one value
+   at a time, it works on the whole block of 624 values at once and keeps the
+   tempered results in a buffer. Each of the loops that does this is a straight
+   pass over the arrays without any branches in it, so the compiler is free to
+   vectorize them. Drawing a number is then just a read from the buffer.
+
+   Like the generator it replaces, one of these is not thread-safe. Each block
+   worker, block and the ship has its own. */
+#define MTRAND_N            624
+
+typedef struct mtrand {
+    uint32_t mt[MTRAND_N];
+    uint32_t buf[MTRAND_N];
+    int idx;
+} mtrand_t;
+
+/* Seed the generator. */
+void mtrand_init(mtrand_t *rng, uint32_t s);
+
+/* Regenerate the state and fill the buffer. This is called automatically when
+   the buffer runs dry. */
+void mtrand_refill(mtrand_t *rng);
+
+/* Grab a random number in the range [0, 0xFFFFFFFF]. */
+static inline uint32_t mtrand_int32(mtrand_t *rng) {
+    if(rng->idx >= MTRAND_N)
+        mtrand_refill(rng);
+
+    return rng->buf[rng->idx++];
+}
+
+/* Grab a random number in the range [0, 1]. */
+static inline double mtrand_real1(mtrand_t *rng) {
+    return mtrand_int32(rng) * (1.0 / 4294967295.0);
+}
+
+#endif /* !MTRAND_H */
@@ -1,6 +1,6 @@
 /*
     Sylverant Ship Server
-    Copyright (C) 2012, 2013, 2014, 2015 Lawrence Sebald
+    Copyright (C) 2012, 2013, 2014, 2015, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -24,7 +24,6 @@
 #include <arpa/inet.h>
 
 #include <sylverant/debug.h>
-#include <sylverant/mtwist.h>
 
 #include <psoarchive/PRS.h>
 
@@ -32,6 +31,7 @@
 #include "utils.h"
 #include "packets.h"
 #include "items.h"
+#include "mtrand.h"
 
 /* PSOv1/PSOv2 data. */
 static pmt_weapon_v2_t **weapons = NULL;
@@ -104,6 +104,27 @@ static int have_v2_pmt = 0;
 static int have_gc_pmt = 0;
 static int have_bb_pmt = 0;
 
+/* Index of all the weapons, armors, shields and units in a version's PMT data
+   by item code. Each (first byte, second byte) pair of the code gets a range of
+   entries, and the third byte picks the entry within that range. Each entry
+   points right at the item's data in the tables above and has the item's star
+   value stored alongside it, so looking anything up by code is just a couple
+   of loads. */
+typedef struct pmt_entry {
+    const void *data;
+    uint8_t stars;
+} pmt_entry_t;
+
+typedef struct pmt_index {
+    uint32_t start[2][256];
+    uint32_t count[2][256];
+    pmt_entry_t *entries;
+} pmt_index_t;
+
+static pmt_index_t index_v2;
+static pmt_index_t index_gc;
+static pmt_index_t index_bb;
+
 /* The parsing code in here is based on some code/information from Lee. Thanks
    again! */
 static int read_ptr_tbl(const uint8_t *pmt, uint32_t sz, uint32_t ptrs[21]) {
@@ -1158,6 +1179,151 @@ static int build_bb_units(int norestrict) {
     return 0;
 }
 
+/* Each byte of the code can only pick out 256 things. Guard types are numbered
+   from 1, and number 3 is taken up by units, so there can only be 2 of them. */
+#define INDEX_LIMIT(n)      ((n) < 256 ? (n) : 256)
+#define INDEX_GUARDS(n)     ((n) < 2 ? (n) : 2)
+
+static int alloc_index(pmt_index_t *idx, uint32_t count) {
+    memset(idx, 0, sizeof(pmt_index_t));
+
+    if(!(idx->entries = (pmt_entry_t *)malloc(sizeof(pmt_entry_t) * count))) {
+        debug(DBG_ERROR, "Cannot allocate PMT index: %s\n", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Add one table of items to an index. Every item structure starts with the
+   item's index in the star table (offset by the lowest index in the file). */
+static void index_items(pmt_index_t *idx, uint32_t *pos, int p0, int p1,
+                        const void *data, uint32_t count, size_t size,
+                        const uint8_t *stars, uint32_t nstars,
+                        uint32_t lowest) {
+    const uint8_t *ptr = (const uint8_t *)data;
+    pmt_entry_t *ent;
+    uint32_t i, sidx;
+
+    count = INDEX_LIMIT(count);
+    idx->start[p0][p1] = *pos;
+    idx->count[p0][p1] = count;
+
+    for(i = 0; i < count; ++i, ptr += size) {
+        ent = &idx->entries[(*pos)++];
+        memcpy(&sidx, ptr, sizeof(uint32_t));
+        sidx -= lowest;
+
+        ent->data = ptr;
+        ent->stars = sidx < nstars ? stars[sidx] : (uint8_t)-1;
+    }
+}
+
+static const pmt_entry_t *index_lookup(const pmt_index_t *idx, uint32_t code) {
+    uint32_t p0 = code & 0xFF, p1 = (code >> 8) & 0xFF;
+    uint32_t p2 = (code >> 16) & 0xFF;
+
+    if(p0 > 1 || p2 >= idx->count[p0][p1])
+        return NULL;
+
+    return &idx->entries[idx->start[p0][p1] + p2];
+}
+
+static int build_v2_index(void) {
+    uint32_t i, count = INDEX_LIMIT(num_units), pos = 0;
+
+    for(i = 0; i < INDEX_LIMIT(num_weapon_types); ++i) {
+        count += INDEX_LIMIT(num_weapons[i]);
+    }
+
+    for(i = 0; i < INDEX_GUARDS(num_guard_types); ++i) {
+        count += INDEX_LIMIT(num_guards[i]);
+    }
+
+    if(alloc_index(&index_v2, count))
+        return -1;
+
+    for(i = 0; i < INDEX_LIMIT(num_weapon_types); ++i) {
+        index_items(&index_v2, &pos, 0, i, weapons[i], num_weapons[i],
+                    sizeof(pmt_weapon_v2_t), star_table, star_max,
+                    weapon_lowest);
+    }
+
+    for(i = 0; i < INDEX_GUARDS(num_guard_types); ++i) {
+        index_items(&index_v2, &pos, 1, i + 1, guards[i], num_guards[i],
+                    sizeof(pmt_guard_v2_t), star_table, star_max,
+                    weapon_lowest);
+    }
+
+    index_items(&index_v2, &pos, 1, 3, units, num_units,
+                sizeof(pmt_unit_v2_t), star_table, star_max, weapon_lowest);
+    return 0;
+}
+
+static int build_gc_index(void) {
+    uint32_t i, count = INDEX_LIMIT(num_units_gc), pos = 0;
+
+    for(i = 0; i < INDEX_LIMIT(num_weapon_types_gc); ++i) {
+        count += INDEX_LIMIT(num_weapons_gc[i]);
+    }
+
+    for(i = 0; i < INDEX_GUARDS(num_guard_types_gc); ++i) {
+        count += INDEX_LIMIT(num_guards_gc[i]);
+    }
+
+    if(alloc_index(&index_gc, count))
+        return -1;
+
+    for(i = 0; i < INDEX_LIMIT(num_weapon_types_gc); ++i) {
+        index_items(&index_gc, &pos, 0, i, weapons_gc[i], num_weapons_gc[i],
+                    sizeof(pmt_weapon_gc_t), star_table_gc, star_max_gc,
+                    weapon_lowest_gc);
+    }
+
+    for(i = 0; i < INDEX_GUARDS(num_guard_types_gc); ++i) {
+        index_items(&index_gc, &pos, 1, i + 1, guards_gc[i], num_guards_gc[i],
+                    sizeof(pmt_guard_gc_t), star_table_gc, star_max_gc,
+                    weapon_lowest_gc);
+    }
+
+    index_items(&index_gc, &pos, 1, 3, units_gc, num_units_gc,
+                sizeof(pmt_unit_gc_t), star_table_gc, star_max_gc,
+                weapon_lowest_gc);
+    return 0;
+}
+
+static int build_bb_index(void) {
+    uint32_t i, count = INDEX_LIMIT(num_units_bb), pos = 0;
+
+    for(i = 0; i < INDEX_LIMIT(num_weapon_types_bb); ++i) {
+        count += INDEX_LIMIT(num_weapons_bb[i]);
+    }
+
+    for(i = 0; i < INDEX_GUARDS(num_guard_types_bb); ++i) {
+        count += INDEX_LIMIT(num_guards_bb[i]);
+    }
+
+    if(alloc_index(&index_bb, count))
+        return -1;
+
+    for(i = 0; i < INDEX_LIMIT(num_weapon_types_bb); ++i) {
+        index_items(&index_bb, &pos, 0, i, weapons_bb[i], num_weapons_bb[i],
+                    sizeof(pmt_weapon_bb_t), star_table_bb, star_max_bb,
+                    weapon_lowest_bb);
+    }
+
+    for(i = 0; i < INDEX_GUARDS(num_guard_types_bb); ++i) {
+        index_items(&index_bb, &pos, 1, i + 1, guards_bb[i], num_guards_bb[i],
+                    sizeof(pmt_guard_bb_t), star_table_bb, star_max_bb,
+                    weapon_lowest_bb);
+    }
+
+    index_items(&index_bb, &pos, 1, 3, units_bb, num_units_bb,
+                sizeof(pmt_unit_bb_t), star_table_bb, star_max_bb,
+                weapon_lowest_bb);
+    return 0;
+}
+
 int pmt_read_v2(const char *fn, int norestrict) {
     int ucsz;
     uint8_t *ucbuf;
@@ -1207,6 +1373,11 @@ int pmt_read_v2(const char *fn, int norestrict) {
         return -14;
     }
 
+    /* Index everything by item code. */
+    if(build_v2_index()) {
+        return -15;
+    }
+
     have_v2_pmt = 1;
 
     return 0;
@@ -1261,6 +1432,11 @@ int pmt_read_gc(const char *fn, int norestrict) {
         return -14;
     }
 
+    /* Index everything by item code. */
+    if(build_gc_index()) {
+        return -15;
+    }
+
     have_gc_pmt = 1;
 
     return 0;
@@ -1315,6 +1491,11 @@ int pmt_read_bb(const char *fn, int norestrict) {
         return -14;
     }
 
+    /* Index everything by item code. */
+    if(build_bb_index()) {
+        return -15;
+    }
+
     have_bb_pmt = 1;
 
     return 0;
@@ -1388,6 +1569,9 @@ void pmt_cleanup(void) {
 
     free(guards_bb);
     free(num_guards_bb);
+    free(index_v2.entries);
+    free(index_gc.entries);
+    free(index_bb.entries);
 
     weapons = NULL;
     num_weapons = NULL;
@@ -1430,445 +1614,166 @@ void pmt_cleanup(void) {
     unit_max_stars = 0;
     unit_max_stars_gc = 0;
     unit_max_stars_bb = 0;
+    memset(&index_v2, 0, sizeof(pmt_index_t));
+    memset(&index_gc, 0, sizeof(pmt_index_t));
+    memset(&index_bb, 0, sizeof(pmt_index_t));
     have_v2_pmt = have_gc_pmt = have_bb_pmt = 0;
 }
 
-int pmt_lookup_weapon_v2(uint32_t code, pmt_weapon_v2_t *rv) {
-    uint8_t parts[3];
+const pmt_weapon_v2_t *pmt_lookup_weapon_v2(uint32_t code) {
+    const pmt_entry_t *ent;
 
-    /* Make sure we loaded the PMT stuff to start with and that there is a place
-       to put the returned value */
-    if(!have_v2_pmt || !rv) {
-        return -1;
-    }
+    /* Make sure we loaded the PMT stuff to start with and that we're looking
+       up a weapon. */
+    if(!have_v2_pmt || (code & 0xFF) != 0x00)
+        return NULL;
 
-    parts[0] = (uint8_t)(code & 0xFF);
-    parts[1] = (uint8_t)((code >> 8) & 0xFF);
-    parts[2] = (uint8_t)((code >> 16) & 0xFF);
-
-    /* Make sure we're looking up a weapon */
-    if(parts[0] != 0x00) {
-        return -2;
-    }
-
-    /* Make sure that we don't go out of bounds anywhere */
-    if(parts[1] > num_weapon_types) {
-        return -3;
-    }
-
-    if(parts[2] >= num_weapons[parts[1]]) {
-        return -4;
-    }
+    if(!(ent = index_lookup(&index_v2, code)))
+        return NULL;
 
-    /* Grab the data and copy it out */
-    memcpy(rv, &weapons[parts[1]][parts[2]], sizeof(pmt_weapon_v2_t));
-    return 0;
+    return (const pmt_weapon_v2_t *)ent->data;
 }
 
-int pmt_lookup_guard_v2(uint32_t code, pmt_guard_v2_t *rv) {
-    uint8_t parts[3];
-
-    /* Make sure we loaded the PMT stuff to start with and that there is a place
-       to put the returned value */
-    if(!have_v2_pmt || !rv) {
-        return -1;
-    }
+const pmt_guard_v2_t *pmt_lookup_guard_v2(uint32_t code) {
+    const pmt_entry_t *ent;
 
-    parts[0] = (uint8_t)(code & 0xFF);
-    parts[1] = (uint8_t)((code >> 8) & 0xFF);
-    parts[2] = (uint8_t)((code >> 16) & 0xFF);
-
-    /* Make sure we're looking up a guard item */
-    if(parts[0] != 0x01) {
-        return -2;
-    }
-
-    /* Make sure its not a unit */
-    if(parts[1] == 0x03) {
-        return -3;
-    }
-
-    /* Make sure that we don't go out of bounds anywhere */
-    if(parts[1] > num_guard_types) {
-        return -4;
-    }
+    /* Make sure we loaded the PMT stuff to start with and that we're looking
+       up a guard item (that isn't a unit). */
+    if(!have_v2_pmt || (code & 0xFF) != 0x01 || (code & 0xFF00) == 0x0300)
+        return NULL;
 
-    if(parts[2] >= num_guards[parts[1] - 1]) {
-        return -5;
-    }
+    if(!(ent = index_lookup(&index_v2, code)))
+        return NULL;
 
-    /* Grab the data and copy it out */
-    memcpy(rv, &guards[parts[1] - 1][parts[2]], sizeof(pmt_guard_v2_t));
-    return 0;
+    return (const pmt_guard_v2_t *)ent->data;
 }
 
-int pmt_lookup_unit_v2(uint32_t code, pmt_unit_v2_t *rv) {
-    uint8_t parts[3];
+const pmt_unit_v2_t *pmt_lookup_unit_v2(uint32_t code) {
+    const pmt_entry_t *ent;
 
-    /* Make sure we loaded the PMT stuff to start with and that there is a place
-       to put the returned value */
-    if(!have_v2_pmt || !rv) {
-        return -1;
-    }
+    /* Make sure we loaded the PMT stuff to start with and that we're looking
+       up a unit. */
+    if(!have_v2_pmt || (code & 0xFFFF) != 0x0301)
+        return NULL;
 
-    parts[0] = (uint8_t)(code & 0xFF);
-    parts[1] = (uint8_t)((code >> 8) & 0xFF);
-    parts[2] = (uint8_t)((code >> 16) & 0xFF);
-
-    /* Make sure we're looking up a unit */
-    if(parts[0] != 0x01 || parts[1] != 0x03) {
-        return -2;
-    }
+    if(!(ent = index_lookup(&index_v2, code)))
+        return NULL;
 
-    if(parts[2] >= num_units) {
-        return -3;
-    }
-
-    /* Grab the data and copy it out */
-    memcpy(rv, &units[parts[2]], sizeof(pmt_unit_v2_t));
-    return 0;
+    return (const pmt_unit_v2_t *)ent->data;
 }
 
 uint8_t pmt_lookup_stars_v2(uint32_t code) {
-    uint8_t parts[3];
-    pmt_weapon_v2_t weap;
-    pmt_guard_v2_t guard;
-    pmt_unit_v2_t unit;
+    const pmt_entry_t *ent;
 
     /* Make sure we loaded the PMT stuff to start with. */
-    if(!have_v2_pmt)
+    if(!have_v2_pmt || !(ent = index_lookup(&index_v2, code)))
         return (uint8_t)-1;
 
-    parts[0] = (uint8_t)(code & 0xFF);
-    parts[1] = (uint8_t)((code >> 8) & 0xFF);
-    parts[2] = (uint8_t)((code >> 16) & 0xFF);
-
-    switch(parts[0]) {
-        case 0x00:                      /* Weapons */
-            if(pmt_lookup_weapon_v2(code, &weap))
-                return (uint8_t)-1;
-
-            if(weap.index - weapon_lowest > star_max)
-                return (uint8_t)-1;
-
-            return star_table[weap.index - weapon_lowest];
-
-        case 0x01:                      /* Guards */
-            switch(parts[1]) {
-                case 0x01:              /* Armors */
-                case 0x02:              /* Shields */
-                    if(pmt_lookup_guard_v2(code, &guard))
-                        return (uint8_t)-1;
-
-                    if(guard.index - weapon_lowest > star_max)
-                        return (uint8_t)-1;
-
-                    return star_table[guard.index - weapon_lowest];
-
-                case 0x03:              /* Units */
-                    if(pmt_lookup_unit_v2(code, &unit))
-                        return (uint8_t)-1;
-
-                    if(unit.index - weapon_lowest > star_max)
-                        return (uint8_t)-1;
-
-                    return star_table[unit.index - weapon_lowest];
-            }
-    }
-
-    return (uint8_t)-1;
+    return ent->stars;
 }
 
-int pmt_lookup_weapon_gc(uint32_t code, pmt_weapon_gc_t *rv) {
-    uint8_t parts[3];
-
-    /* Make sure we loaded the PMT stuff to start with and that there is a place
-       to put the returned value */
-    if(!have_gc_pmt || !rv) {
-        return -1;
-    }
-
-    parts[0] = (uint8_t)(code & 0xFF);
-    parts[1] = (uint8_t)((code >> 8) & 0xFF);
-    parts[2] = (uint8_t)((code >> 16) & 0xFF);
+const pmt_weapon_gc_t *pmt_lookup_weapon_gc(uint32_t code) {
+    const pmt_entry_t *ent;
 
-    /* Make sure we're looking up a weapon */
-    if(parts[0] != 0x00) {
-        return -2;
-    }
+    /* Make sure we loaded the PMT stuff to start with and that we're looking
+       up a weapon. */
+    if(!have_gc_pmt || (code & 0xFF) != 0x00)
+        return NULL;
 
-    /* Make sure that we don't go out of bounds anywhere */
-    if(parts[1] > num_weapon_types_gc) {
-        return -3;
-    }
+    if(!(ent = index_lookup(&index_gc, code)))
+        return NULL;
 
-    if(parts[2] >= num_weapons_gc[parts[1]]) {
-        return -4;
-    }
-
-    /* Grab the data and copy it out */
-    memcpy(rv, &weapons_gc[parts[1]][parts[2]], sizeof(pmt_weapon_gc_t));
-    return 0;
+    return (const pmt_weapon_gc_t *)ent->data;
 }
 
-int pmt_lookup_guard_gc(uint32_t code, pmt_guard_gc_t *rv) {
-    uint8_t parts[3];
-
-    /* Make sure we loaded the PMT stuff to start with and that there is a place
-       to put the returned value */
-    if(!have_gc_pmt || !rv) {
-        return -1;
-    }
-
-    parts[0] = (uint8_t)(code & 0xFF);
-    parts[1] = (uint8_t)((code >> 8) & 0xFF);
-    parts[2] = (uint8_t)((code >> 16) & 0xFF);
+const pmt_guard_gc_t *pmt_lookup_guard_gc(uint32_t code) {
+    const pmt_entry_t *ent;
 
-    /* Make sure we're looking up a guard item */
-    if(parts[0] != 0x01) {
-        return -2;
-    }
+    /* Make sure we loaded the PMT stuff to start with and that we're looking
+       up a guard item (that isn't a unit). */
+    if(!have_gc_pmt || (code & 0xFF) != 0x01 || (code & 0xFF00) == 0x0300)
+        return NULL;
 
-    /* Make sure its not a unit */
-    if(parts[1] == 0x03) {
-        return -3;
-    }
-
-    /* Make sure that we don't go out of bounds anywhere */
-    if(parts[1] > num_guard_types_gc) {
-        return -4;
-    }
+    if(!(ent = index_lookup(&index_gc, code)))
+        return NULL;
 
-    if(parts[2] >= num_guards_gc[parts[1] - 1]) {
-        return -5;
-    }
-
-    /* Grab the data and copy it out */
-    memcpy(rv, &guards_gc[parts[1] - 1][parts[2]], sizeof(pmt_guard_gc_t));
-    return 0;
+    return (const pmt_guard_gc_t *)ent->data;
 }
 
-int pmt_lookup_unit_gc(uint32_t code, pmt_unit_gc_t *rv) {
-    uint8_t parts[3];
-
-    /* Make sure we loaded the PMT stuff to start with and that there is a place
-       to put the returned value */
-    if(!have_gc_pmt || !rv) {
-        return -1;
-    }
-
-    parts[0] = (uint8_t)(code & 0xFF);
-    parts[1] = (uint8_t)((code >> 8) & 0xFF);
-    parts[2] = (uint8_t)((code >> 16) & 0xFF);
+const pmt_unit_gc_t *pmt_lookup_unit_gc(uint32_t code) {
+    const pmt_entry_t *ent;
 
-    /* Make sure we're looking up a unit */
-    if(parts[0] != 0x01 || parts[1] != 0x03) {
-        return -2;
-    }
+    /* Make sure we loaded the PMT stuff to start with and that we're looking
+       up a unit. */
+    if(!have_gc_pmt || (code & 0xFFFF) != 0x0301)
+        return NULL;
 
-    if(parts[2] >= num_units_gc) {
-        return -3;
-    }
+    if(!(ent = index_lookup(&index_gc, code)))
+        return NULL;
 
-    /* Grab the data and copy it out */
-    memcpy(rv, &units_gc[parts[2]], sizeof(pmt_unit_gc_t));
-    return 0;
+    return (const pmt_unit_gc_t *)ent->data;
 }
 
 uint8_t pmt_lookup_stars_gc(uint32_t code) {
-    uint8_t parts[3];
-    pmt_weapon_gc_t weap;
-    pmt_guard_gc_t guard;
-    pmt_unit_gc_t unit;
+    const pmt_entry_t *ent;
 
     /* Make sure we loaded the PMT stuff to start with. */
-    if(!have_gc_pmt)
+    if(!have_gc_pmt || !(ent = index_lookup(&index_gc, code)))
         return (uint8_t)-1;
 
-    parts[0] = (uint8_t)(code & 0xFF);
-    parts[1] = (uint8_t)((code >> 8) & 0xFF);
-    parts[2] = (uint8_t)((code >> 16) & 0xFF);
-
-    switch(parts[0]) {
-        case 0x00:                      /* Weapons */
-            if(pmt_lookup_weapon_gc(code, &weap))
-                return (uint8_t)-1;
-
-            if(weap.index - weapon_lowest_gc > star_max_gc)
-                return (uint8_t)-1;
-
-            return star_table_gc[weap.index - weapon_lowest_gc];
-
-        case 0x01:                      /* Guards */
-            switch(parts[1]) {
-                case 0x01:              /* Armors */
-                case 0x02:              /* Shields */
-                    if(pmt_lookup_guard_gc(code, &guard))
-                        return (uint8_t)-1;
-
-                    if(guard.index - weapon_lowest_gc > star_max_gc)
-                        return (uint8_t)-1;
-
-                    return star_table_gc[guard.index - weapon_lowest_gc];
-
-                case 0x03:              /* Units */
-                    if(pmt_lookup_unit_gc(code, &unit))
-                        return (uint8_t)-1;
-
-                    if(unit.index - weapon_lowest_gc > star_max_gc)
-                        return (uint8_t)-1;
-
-                    return star_table_gc[unit.index - weapon_lowest_gc];
-            }
-    }
-
-    return (uint8_t)-1;
+    return ent->stars;
 }
 
-int pmt_lookup_weapon_bb(uint32_t code, pmt_weapon_bb_t *rv) {
-    uint8_t parts[3];
+const pmt_weapon_bb_t *pmt_lookup_weapon_bb(uint32_t code) {
+    const pmt_entry_t *ent;
 
-    /* Make sure we loaded the PMT stuff to start with and that there is a place
-       to put the returned value */
-    if(!have_bb_pmt || !rv) {
-        return -1;
-    }
-
-    parts[0] = (uint8_t)(code & 0xFF);
-    parts[1] = (uint8_t)((code >> 8) & 0xFF);
-    parts[2] = (uint8_t)((code >> 16) & 0xFF);
-
-    /* Make sure we're looking up a weapon */
-    if(parts[0] != 0x00) {
-        return -2;
-    }
-
-    /* Make sure that we don't go out of bounds anywhere */
-    if(parts[1] > num_weapon_types_bb) {
-        return -3;
-    }
+    /* Make sure we loaded the PMT stuff to start with and that we're looking
+       up a weapon. */
+    if(!have_bb_pmt || (code & 0xFF) != 0x00)
+        return NULL;
 
-    if(parts[2] >= num_weapons_bb[parts[1]]) {
-        return -4;
-    }
+    if(!(ent = index_lookup(&index_bb, code)))
+        return NULL;
 
-    /* Grab the data and copy it out */
-    memcpy(rv, &weapons_bb[parts[1]][parts[2]], sizeof(pmt_weapon_bb_t));
-    return 0;
+    return (const pmt_weapon_bb_t *)ent->data;
 }
 
-int pmt_lookup_guard_bb(uint32_t code, pmt_guard_bb_t *rv) {
-    uint8_t parts[3];
-
-    /* Make sure we loaded the PMT stuff to start with and that there is a place
-       to put the returned value */
-    if(!have_bb_pmt || !rv) {
-        return -1;
-    }
-
-    parts[0] = (uint8_t)(code & 0xFF);
-    parts[1] = (uint8_t)((code >> 8) & 0xFF);
-    parts[2] = (uint8_t)((code >> 16) & 0xFF);
-
-    /* Make sure we're looking up a guard item */
-    if(parts[0] != 0x01) {
-        return -2;
-    }
-
-    /* Make sure its not a unit */
-    if(parts[1] == 0x03) {
-        return -3;
-    }
+const pmt_guard_bb_t *pmt_lookup_guard_bb(uint32_t code) {
+    const pmt_entry_t *ent;
 
-    /* Make sure that we don't go out of bounds anywhere */
-    if(parts[1] > num_guard_types_bb) {
-        return -4;
-    }
+    /* Make sure we loaded the PMT stuff to start with and that we're looking
+       up a guard item (that isn't a unit). */
+    if(!have_bb_pmt || (code & 0xFF) != 0x01 || (code & 0xFF00) == 0x0300)
+        return NULL;
 
-    if(parts[2] >= num_guards_bb[parts[1] - 1]) {
-        return -5;
-    }
+    if(!(ent = index_lookup(&index_bb, code)))
+        return NULL;
 
-    /* Grab the data and copy it out */
-    memcpy(rv, &guards_bb[parts[1] - 1][parts[2]], sizeof(pmt_guard_bb_t));
-    return 0;
+    return (const pmt_guard_bb_t *)ent->data;
 }
 
-int pmt_lookup_unit_bb(uint32_t code, pmt_unit_bb_t *rv) {
-    uint8_t parts[3];
+const pmt_unit_bb_t *pmt_lookup_unit_bb(uint32_t code) {
+    const pmt_entry_t *ent;
 
-    /* Make sure we loaded the PMT stuff to start with and that there is a place
-       to put the returned value */
-    if(!have_bb_pmt || !rv) {
-        return -1;
-    }
+    /* Make sure we loaded the PMT stuff to start with and that we're looking
+       up a unit. */
+    if(!have_bb_pmt || (code & 0xFFFF) != 0x0301)
+        return NULL;
 
-    parts[0] = (uint8_t)(code & 0xFF);
-    parts[1] = (uint8_t)((code >> 8) & 0xFF);
-    parts[2] = (uint8_t)((code >> 16) & 0xFF);
-
-    /* Make sure we're looking up a unit */
-    if(parts[0] != 0x01 || parts[1] != 0x03) {
-        return -2;
-    }
-
-    if(parts[2] >= num_units_bb) {
-        return -3;
-    }
+    if(!(ent = index_lookup(&index_bb, code)))
+        return NULL;
 
-    /* Grab the data and copy it out */
-    memcpy(rv, &units_bb[parts[2]], sizeof(pmt_unit_bb_t));
-    return 0;
+    return (const pmt_unit_bb_t *)ent->data;
 }
 
 uint8_t pmt_lookup_stars_bb(uint32_t code) {
-    uint8_t parts[3];
-    pmt_weapon_bb_t weap;
-    pmt_guard_bb_t guard;
-    pmt_unit_bb_t unit;
+    const pmt_entry_t *ent;
 
     /* Make sure we loaded the PMT stuff to start with. */
-    if(!have_bb_pmt)
+    if(!have_bb_pmt || !(ent = index_lookup(&index_bb, code)))
         return (uint8_t)-1;
 
-    parts[0] = (uint8_t)(code & 0xFF);
-    parts[1] = (uint8_t)((code >> 8) & 0xFF);
-    parts[2] = (uint8_t)((code >> 16) & 0xFF);
-
-    switch(parts[0]) {
-        case 0x00:                      /* Weapons */
-            if(pmt_lookup_weapon_bb(code, &weap))
-                return (uint8_t)-1;
-
-            if(weap.index - weapon_lowest_bb > star_max_bb)
-                return (uint8_t)-1;
-
-            return star_table_bb[weap.index - weapon_lowest_bb];
-
-        case 0x01:                      /* Guards */
-            switch(parts[1]) {
-                case 0x01:              /* Armors */
-                case 0x02:              /* Shields */
-                    if(pmt_lookup_guard_bb(code, &guard))
-                        return (uint8_t)-1;
-
-                    if(guard.index - weapon_lowest_bb > star_max_bb)
-                        return (uint8_t)-1;
-
-                    return star_table_bb[guard.index - weapon_lowest_bb];
-
-                case 0x03:              /* Units */
-                    if(pmt_lookup_unit_bb(code, &unit))
-                        return (uint8_t)-1;
-
-                    if(unit.index - weapon_lowest_bb > star_max_bb)
-                        return (uint8_t)-1;
-
-                    return star_table_bb[unit.index - weapon_lowest_bb];
-            }
-    }
-
-    return (uint8_t)-1;
+    return ent->stars;
 }
 
 /*
@@ -1895,9 +1800,9 @@ uint8_t pmt_lookup_stars_bb(uint32_t code) {
    is actually defined as a 0 increment anyway).
 */
 int pmt_random_unit_v2(uint8_t max, uint32_t item[4],
-                       struct mt19937_state *rng, lobby_t *l) {
+                       mtrand_t *rng, lobby_t *l) {
     uint64_t unit;
-    uint32_t rnd = mt19937_genrand_int32(rng);
+    uint32_t rnd = mtrand_int32(rng);
 
 #ifdef DEBUG
     if(l->flags & LOBBY_FLAG_DBG_SDROPS)
@@ -1925,9 +1830,9 @@ int pmt_random_unit_v2(uint8_t max, uint32_t item[4],
 }
 
 int pmt_random_unit_gc(uint8_t max, uint32_t item[4],
-                       struct mt19937_state *rng, lobby_t *l) {
+                       mtrand_t *rng, lobby_t *l) {
     uint64_t unit;
-    uint32_t rnd = mt19937_genrand_int32(rng);
+    uint32_t rnd = mtrand_int32(rng);
 
 #ifdef DEBUG
     if(l->flags & LOBBY_FLAG_DBG_SDROPS)
@@ -1955,9 +1860,9 @@ int pmt_random_unit_gc(uint8_t max, uint32_t item[4],
 }
 
 int pmt_random_unit_bb(uint8_t max, uint32_t item[4],
-                       struct mt19937_state *rng, lobby_t *l) {
+                       mtrand_t *rng, lobby_t *l) {
     uint64_t unit;
-    uint32_t rnd = mt19937_genrand_int32(rng);
+    uint32_t rnd = mtrand_int32(rng);
 
 #ifdef DEBUG
     if(l->flags & LOBBY_FLAG_DBG_SDROPS)
@@ -1,6 +1,6 @@
 /*
     Sylverant Ship Server
-    Copyright (C) 2012, 2013, 2015 Lawrence Sebald
+    Copyright (C) 2012, 2013, 2015, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -20,9 +20,8 @@
 
 #include <stdint.h>
 
-#include <sylverant/mtwist.h>
-
 #include "lobby.h"
+#include "mtrand.h"
 
 #ifdef PACKED
 #undef PACKED
@@ -265,28 +264,32 @@ int pmt_bb_enabled(void);
 
 void pmt_cleanup(void);
 
-int pmt_lookup_weapon_v2(uint32_t code, pmt_weapon_v2_t *rv);
-int pmt_lookup_guard_v2(uint32_t code, pmt_guard_v2_t *rv);
-int pmt_lookup_unit_v2(uint32_t code, pmt_unit_v2_t *rv);
+/* Look up the PMT data for an item by its code. These return a pointer right
+   into the PMT data, which stays good until pmt_cleanup() is called, or NULL if
+   there is no such item. The star lookups return 0xFF if there is no such
+   item. */
+const pmt_weapon_v2_t *pmt_lookup_weapon_v2(uint32_t code);
+const pmt_guard_v2_t *pmt_lookup_guard_v2(uint32_t code);
+const pmt_unit_v2_t *pmt_lookup_unit_v2(uint32_t code);
 
 uint8_t pmt_lookup_stars_v2(uint32_t code);
 int pmt_random_unit_v2(uint8_t max, uint32_t item[4],
-                       struct mt19937_state *rng, lobby_t *l);
+                       mtrand_t *rng, lobby_t *l);
 
-int pmt_lookup_weapon_gc(uint32_t code, pmt_weapon_gc_t *rv);
-int pmt_lookup_guard_gc(uint32_t code, pmt_guard_gc_t *rv);
-int pmt_lookup_unit_gc(uint32_t code, pmt_unit_gc_t *rv);
+const pmt_weapon_gc_t *pmt_lookup_weapon_gc(uint32_t code);
+const pmt_guard_gc_t *pmt_lookup_guard_gc(uint32_t code);
+const pmt_unit_gc_t *pmt_lookup_unit_gc(uint32_t code);
 
 uint8_t pmt_lookup_stars_gc(uint32_t code);
 int pmt_random_unit_gc(uint8_t max, uint32_t item[4],
-                       struct mt19937_state *rng, lobby_t *l);
+                       mtrand_t *rng, lobby_t *l);
 
-int pmt_lookup_weapon_bb(uint32_t code, pmt_weapon_bb_t *rv);
-int pmt_lookup_guard_bb(uint32_t code, pmt_guard_bb_t *rv);
-int pmt_lookup_unit_bb(uint32_t code, pmt_unit_bb_t *rv);
+const pmt_weapon_bb_t *pmt_lookup_weapon_bb(uint32_t code);
+const pmt_guard_bb_t *pmt_lookup_guard_bb(uint32_t code);
+const pmt_unit_bb_t *pmt_lookup_unit_bb(uint32_t code);
 
 int pmt_random_unit_bb(uint8_t max, uint32_t item[4],
-                       struct mt19937_state *rng, lobby_t *l);
+                       mtrand_t *rng, lobby_t *l);
 uint8_t pmt_lookup_stars_bb(uint32_t code);
 
 #endif /* !PMTDATA_H */
@@ -0,0 +1,131 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include "ptalias.h"
+
+#define MIN(x, y) (x < y ? x : y)
+#define MAX(x, y) (x > y ? x : y)
+
+/* Build an alias table that gives the same results as scanning through a list
+   of weights the way that the drop code always has: take a random number in
+   [0, mod), subtract each weight from it in turn (as an unsigned value), and
+   pick the first one where the result goes above mod. Weights can be negative
+   and need not add up to mod, so figure out exactly how many of the possible
+   random numbers end up at each entry (with anything that falls off the end
+   picking nothing at all) and build the table from those counts. */
+void pt_alias_build(pt_alias_t *a, const int *w, int n, int mod) {
+    int cnt[PT_ALIAS_MAX], val[PT_ALIAS_MAX];
+    int small[PT_ALIAS_MAX], large[PT_ALIAS_MAX];
+    int i, k = 0, c = 0, lo = 0, hi = mod, x, ns = 0, nl = 0, s, g;
+
+    memset(a, 0, sizeof(pt_alias_t));
+
+    if(mod <= 0)
+        return;
+
+    /* The numbers that have already been picked by an earlier entry are always
+       [0, lo) and [hi, mod). A running total that is positive picks anything
+       below it, a negative one picks anything above mod plus it. */
+    for(i = 0; i < n && lo < hi; ++i) {
+        c += w[i];
+
+        if(c >= 0) {
+            x = MIN(c, hi);
+
+            if(x > lo) {
+                cnt[k] = x - lo;
+                val[k++] = i;
+                lo = x;
+            }
+        }
+        else {
+            x = mod + c + 1;
+            x = MAX(x, lo);
+
+            if(x < hi) {
+                cnt[k] = hi - x;
+                val[k++] = i;
+                hi = x;
+            }
+        }
+    }
+
+    /* Whatever is left over doesn't pick anything. */
+    if(lo < hi) {
+        cnt[k] = hi - lo;
+        val[k++] = 0xFF;
+    }
+
+    /* Vose's method, scaled up so everything stays in integers. Each column
+       holds mod worth of weight. */
+    for(i = 0; i < k; ++i) {
+        cnt[i] *= k;
+        a->keep[i] = (uint8_t)val[i];
+
+        if(cnt[i] < mod)
+            small[ns++] = i;
+        else
+            large[nl++] = i;
+    }
+
+    while(ns && nl) {
+        s = small[--ns];
+        g = large[--nl];
+
+        a->prob[s] = (uint16_t)cnt[s];
+        a->other[s] = a->keep[g];
+        cnt[g] -= mod - cnt[s];
+
+        if(cnt[g] < mod)
+            small[ns++] = g;
+        else
+            large[nl++] = g;
+    }
+
+    while(nl) {
+        g = large[--nl];
+        a->prob[g] = (uint16_t)mod;
+        a->other[g] = a->keep[g];
+    }
+
+    while(ns) {
+        s = small[--ns];
+        a->prob[s] = (uint16_t)mod;
+        a->other[s] = a->keep[s];
+    }
+
+    a->n = (uint8_t)k;
+    a->sum = (uint32_t)mod;
+    a->total = (uint32_t)(k * mod);
+}
+
+/* Make a choice with an alias table, using the given random number. */
+int pt_alias_pick_rnd(const pt_alias_t *a, uint32_t rnd) {
+    uint32_t x, col;
+    uint8_t rv;
+
+    if(!a->n)
+        return PT_ALIAS_NONE;
+
+    x = rnd % a->total;
+    col = x / a->sum;
+    rv = (x % a->sum) < a->prob[col] ? a->keep[col] : a->other[col];
+
+    return rv == 0xFF ? PT_ALIAS_NONE : rv;
+}
@@ -0,0 +1,46 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PTALIAS_H
+#define PTALIAS_H
+
+#include <stdint.h>
+
+/* Walker alias table for making a weighted choice with a single random number.
+   These are built from the ItemPT data as it is read in, and give exactly the
+   same odds as scanning through the raw data would. */
+#define PT_ALIAS_MAX        32
+#define PT_ALIAS_NONE       -1
+
+typedef struct pt_alias {
+    uint32_t total;                         /* Number of columns * sum. */
+    uint32_t sum;                           /* Sum of all the weights. */
+    uint8_t n;                              /* Number of columns. */
+    uint16_t prob[PT_ALIAS_MAX];
+    uint8_t keep[PT_ALIAS_MAX];
+    uint8_t other[PT_ALIAS_MAX];
+} pt_alias_t;
+
+/* Build an alias table for the n weights in w, picking the same way as
+   scanning through them with a random number in [0, mod) always has. */
+void pt_alias_build(pt_alias_t *a, const int *w, int n, int mod);
+
+/* Make a choice with an alias table, using the given random number. Returns
+   the index of the weight picked, or PT_ALIAS_NONE if nothing was. */
+int pt_alias_pick_rnd(const pt_alias_t *a, uint32_t rnd);
+
+#endif /* !PTALIAS_H */
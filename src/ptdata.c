@@ -1,6 +1,7 @@
 /*
     Sylverant Ship Server
-    Copyright (C) 2012, 2013, 2014, 2015, 2016, 2020, 2022 Lawrence Sebald
+    Copyright (C) 2012, 2013, 2014, 2015, 2016, 2020, 2022,
+                  2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -24,7 +25,6 @@
 
 #include <sylverant/items.h>
 #include <sylverant/debug.h>
-#include <sylverant/mtwist.h>
 
 #include <psoarchive/AFS.h>
 #include <psoarchive/GSL.h>
@@ -36,6 +36,8 @@
 #include "items.h"
 #include "utils.h"
 #include "quests.h"
+#include "mtrand.h"
+#include "ptalias.h"
 
 #define PACKED __attribute__((packed))
 
@@ -110,6 +112,7 @@ typedef struct fpt_v2_entry {
 #define LOGV(team, ...) team_log_write(team, TLOG_DROPSV, __VA_ARGS__)
 
 #define MIN(x, y) (x < y ? x : y)
+#define MAX(x, y) (x > y ? x : y)
 
 static int have_v2pt = 0;
 static int have_gcpt = 0;
@@ -166,6 +169,194 @@ static const int attr_count[4] = { 8, 10, 12, 12 };
 
 #define EPSILON 0.001f
 
+static int alias_pick(const pt_alias_t *a, mtrand_t *rng) {
+    if(!a->n)
+        return PT_ALIAS_NONE;
+
+    return pt_alias_pick_rnd(a, mtrand_int32(rng));
+}
+
+/* Figure out which weapons can be made on each floor, what rank each one will
+   be, and which grind pattern it will use. */
+static void compile_weapons(pt_tables_t *t, const int8_t ratio[12],
+                            const int8_t minrank[12],
+                            const int8_t upgfloor[12]) {
+    int area, i, warea, rank, w[12];
+
+    for(area = 0; area < 10; ++area) {
+        t->weapon_bad[area] = -1;
+
+        for(i = 0; i < 12; ++i) {
+            w[i] = 0;
+
+            if((minrank[i] + area) < 0 || ratio[i] <= 0)
+                continue;
+
+            w[i] = ratio[i];
+
+            if(minrank[i] >= 0) {
+                warea = area;
+                rank = minrank[i];
+            }
+            else {
+                warea = minrank[i] + area;
+                rank = 0;
+            }
+
+            /* The generator will complain about this if it ever gets asked to
+               make a weapon on this floor. */
+            if(upgfloor[i] <= 0) {
+                if(t->weapon_bad[area] == -1)
+                    t->weapon_bad[area] = i;
+
+                continue;
+            }
+
+            while((warea - upgfloor[i]) >= 0) {
+                ++rank;
+                warea -= upgfloor[i];
+            }
+
+            t->weapon_rank[area][i] = (uint8_t)rank;
+            t->weapon_grind[area][i] = (uint8_t)MIN(warea, 3);
+        }
+
+        /* Weapons are picked out of the total of the ratios of the ones that
+           are available, rather than out of 100. */
+        for(i = 0, warea = 0; i < 12; ++i) {
+            warea += w[i];
+        }
+
+        pt_alias_build(&t->weapon[area], w, 12, warea);
+    }
+}
+
+static void compile_v2(pt_v2_entry_t *ent) {
+    pt_tables_t *t = &ent->tables;
+    int i, j, w[28];
+
+    compile_weapons(t, ent->weapon_ratio, ent->weapon_minrank,
+                    ent->weapon_upgfloor);
+
+    for(j = 0; j < 4; ++j) {
+        for(i = 0; i < 9; ++i) {
+            w[i] = ent->power_pattern[i][j];
+        }
+
+        pt_alias_build(&t->power[j], w, 9, 100);
+    }
+
+    for(j = 0; j < 5; ++j) {
+        for(i = 0; i < 23; ++i) {
+            w[i] = ent->percent_pattern[i][j];
+        }
+
+        pt_alias_build(&t->percent[j], w, 23, 100);
+    }
+
+    for(i = 0; i < 5; ++i) {
+        w[i] = ent->armor_ranking[i];
+    }
+
+    pt_alias_build(&t->armor, w, 5, 100);
+
+    for(i = 0; i < 5; ++i) {
+        w[i] = ent->slot_ranking[i];
+    }
+
+    pt_alias_build(&t->slot, w, 5, 100);
+
+    for(j = 0; j < 10; ++j) {
+        for(i = 0; i < 6; ++i) {
+            w[i] = ent->percent_attachment[i][j];
+        }
+
+        pt_alias_build(&t->attachment[j], w, 6, 100);
+
+        for(i = 0; i < 28; ++i) {
+            w[i] = LE16(ent->tool_frequency[i][j]);
+        }
+
+        pt_alias_build(&t->tool[j], w, 28, 10000);
+
+        for(i = 0; i < 19; ++i) {
+            w[i] = ent->tech_frequency[i][j];
+        }
+
+        pt_alias_build(&t->tech[j], w, 19, 1000);
+
+        /* The last box type is "nothing", which is what happens if none of the
+           others are picked anyway. */
+        for(i = 0; i < 6; ++i) {
+            w[i] = ent->box_drop[i][j];
+        }
+
+        pt_alias_build(&t->box[j], w, 6, 100);
+    }
+}
+
+static void compile_v3(pt_v3_entry_t *ent) {
+    pt_tables_t *t = &ent->tables;
+    int i, j, w[28];
+
+    compile_weapons(t, ent->weapon_ratio, ent->weapon_minrank,
+                    ent->weapon_upgfloor);
+
+    for(j = 0; j < 4; ++j) {
+        for(i = 0; i < 9; ++i) {
+            w[i] = ent->power_pattern[i][j];
+        }
+
+        pt_alias_build(&t->power[j], w, 9, 100);
+    }
+
+    for(j = 0; j < 6; ++j) {
+        for(i = 0; i < 23; ++i) {
+            w[i] = ent->percent_pattern[i][j];
+        }
+
+        pt_alias_build(&t->percent[j], w, 23, 10000);
+    }
+
+    for(i = 0; i < 5; ++i) {
+        w[i] = ent->armor_ranking[i];
+    }
+
+    pt_alias_build(&t->armor, w, 5, 100);
+
+    for(i = 0; i < 5; ++i) {
+        w[i] = ent->slot_ranking[i];
+    }
+
+    pt_alias_build(&t->slot, w, 5, 100);
+
+    for(j = 0; j < 10; ++j) {
+        for(i = 0; i < 6; ++i) {
+            w[i] = ent->percent_attachment[i][j];
+        }
+
+        pt_alias_build(&t->attachment[j], w, 6, 100);
+
+        for(i = 0; i < 28; ++i) {
+            w[i] = LE16(ent->tool_frequency[i][j]);
+        }
+
+        pt_alias_build(&t->tool[j], w, 28, 10000);
+
+        for(i = 0; i < 19; ++i) {
+            w[i] = ent->tech_frequency[i][j];
+        }
+
+        pt_alias_build(&t->tech[j], w, 19, 1000);
+
+        for(i = 0; i < 6; ++i) {
+            w[i] = ent->box_drop[i][j];
+        }
+
+        pt_alias_build(&t->box[j], w, 6, 100);
+    }
+}
+
 int pt_read_v2(const char *fn) {
     pso_afs_read_t *a;
     pso_error_t err;
@@ -279,6 +470,9 @@ int pt_read_v2(const char *fn) {
                 ent->box_meseta[k][1] = LE16(ent->box_meseta[k][1]);
 #endif
             }
+
+            /* Build the tables that the drop generators actually use. */
+            compile_v2(ent);
         }
     }
 
@@ -416,6 +610,9 @@ int pt_read_v3(const char *fn, int bb) {
                     ent->box_meseta[l][0] = ntohs(buf->box_meseta[l][0]);
                     ent->box_meseta[l][1] = ntohs(buf->box_meseta[l][1]);
                 }
+
+                /* Build the tables that the drop generators actually use. */
+                compile_v3(ent);
             }
         }
     }
@@ -527,11 +724,10 @@ int pt_bb_enabled(void) {
    below. :P
 */
 static int generate_weapon_v2(pt_v2_entry_t *ent, int area, uint32_t item[4],
-                              struct mt19937_state *rng, int picked, int v1,
+                              mtrand_t *rng, int picked, int v1,
                               lobby_t *l) {
     uint32_t rnd, upcts = 0;
-    int i, j = 0, k, wchance = 0, warea = 0, npcts = 0;
-    int wtypes[12] = { 0 }, wranks[12] = { 0 }, gptrn[12] = { 0 };
+    int i, j, k, warea = 0, npcts = 0;
     uint8_t *item_b = (uint8_t *)item;
     int semirare = 0, rare = 0;
 
@@ -552,67 +748,29 @@ static int generate_weapon_v2(pt_v2_entry_t *ent, int area, uint32_t item[4],
 
     item[0] = item[1] = item[2] = item[3] = 0;
 
-    /* Go through each weapon type to see what ones we actually will have to
-       work with right now... */
-    for(i = 0; i < 12; ++i) {
-        if((ent->weapon_minrank[i] + area) >= 0 && ent->weapon_ratio[i] > 0) {
-            wtypes[j] = i;
-            wchance += ent->weapon_ratio[i];
-
-            if(ent->weapon_minrank[i] >= 0) {
-                warea = area;
-                wranks[j] = ent->weapon_minrank[i];
-            }
-            else {
-                warea = ent->weapon_minrank[i] + area;
-                wranks[j] = 0;
-            }
-
-            /* Sanity check... Make sure this is sane before we go to the loop
-               below, since it will end up being an infinite loop if its not
-               sane... */
-            if(ent->weapon_upgfloor[i] <= 0) {
-                debug(DBG_WARN, "Invalid v2 weapon upgrade floor value for "
-                      "floor %d, weapon type %d. Please check your ItemPT.afs "
-                      "file for validity!\n", area, i);
-                return -1;
-            }
-
-            while((warea - ent->weapon_upgfloor[i]) >= 0) {
-                ++wranks[j];
-                warea -= ent->weapon_upgfloor[i];
-            }
-
-            gptrn[j] = MIN(warea, 3);
-            ++j;
-        }
+    /* Sanity check... Make sure none of the weapon types that could be made on
+       this floor have an invalid upgrade floor value. */
+    if(ent->tables.weapon_bad[area] != -1) {
+        debug(DBG_WARN, "Invalid v2 weapon upgrade floor value for "
+              "floor %d, weapon type %d. Please check your ItemPT.afs "
+              "file for validity!\n", area, ent->tables.weapon_bad[area]);
+        return -1;
     }
 
+    /* Roll the dice! */
+    i = alias_pick(&ent->tables.weapon[area], rng);
+
     /* Sanity check... This shouldn't happen! */
-    if(!j) {
+    if(i == PT_ALIAS_NONE) {
         debug(DBG_WARN, "No v2 weapon to generate on floor %d, please check "
               "your ItemPT.afs file for validity!\n", area);
         return -1;
     }
 
-    /* Roll the dice! */
-    rnd = mt19937_genrand_int32(rng) % wchance;
-    for(i = 0; i < j; ++i) {
-        if((rnd -= ent->weapon_ratio[wtypes[i]]) > wchance) {
-            item[0] = ((wtypes[i] + 1) << 8) | (wranks[i] << 16);
+    item[0] = ((i + 1) << 8) | (ent->tables.weapon_rank[area][i] << 16);
 
-            /* Save off the grind pattern to use... */
-            warea = gptrn[i];
-            break;
-        }
-    }
-
-    /* Sanity check... Once again, this shouldn't happen! */
-    if(!item[0]) {
-        debug(DBG_WARN, "Generated invalid v2 weapon. Please report this "
-              "error!\n");
-        return -1;
-    }
+    /* Save off the grind pattern to use... */
+    warea = ent->tables.weapon_grind[area][i];
 
     /* See if we made a "semi-rare" item. */
     if((item_b[1] >= 10 && item_b[2] > 3) || item_b[2] > 4)
@@ -620,22 +778,18 @@ static int generate_weapon_v2(pt_v2_entry_t *ent, int area, uint32_t item[4],
 
 already_picked:
     /* Next up, determine the grind value. */
-    rnd = mt19937_genrand_int32(rng) % 100;
-    for(i = 0; i < 9; ++i) {
-        if((rnd -= ent->power_pattern[i][warea]) > 100) {
-            item[0] |= (i << 24);
-            break;
-        }
-    }
+    i = alias_pick(&ent->tables.power[warea], rng);
 
     /* Sanity check... */
-    if(i >= 9) {
+    if(i == PT_ALIAS_NONE) {
         debug(DBG_WARN, "Invalid power pattern for floor %d, pattern "
               "number %d. Please check your ItemPT.afs for validity!\n",
               area, warea);
         return -1;
     }
 
+    item[0] |= (i << 24);
+
     /* Let's generate us some percentages, shall we? This isn't necessarily the
        way I would have designed this, but based on the way the data is laid
        out in the PT file, this is the implied structure of it... */
@@ -643,44 +797,34 @@ already_picked:
         if(ent->area_pattern[i][area] < 0)
             continue;
 
-        rnd = mt19937_genrand_int32(rng) % 100;
         warea = ent->area_pattern[i][area];
+        if(warea >= 5)
+            continue;
 
-        for(j = 0; j < 23; ++j) {
-            /* See if we're going to generate this one... */
-            if((rnd -= ent->percent_pattern[j][warea]) > 100) {
-                /* If it would be 0%, don't bother... */
-                if(j == 2) {
-                    break;
-                }
+        /* See if we're going to generate this one... If it would be 0%, don't
+           bother... */
+        j = alias_pick(&ent->tables.percent[warea], rng);
+        if(j == PT_ALIAS_NONE || j == 2)
+            continue;
 
-                /* Lets see what type we'll generate now... */
-                rnd = mt19937_genrand_int32(rng) % 100;
-                for(k = 0; k < 6; ++k) {
-                    if((rnd -= ent->percent_attachment[k][area]) > 100) {
-                        if(k == 0 || (upcts & (1 << k)))
-                            break;
-
-                        j = (j - 2) * 5;
-                        item_b[(npcts << 1) + 6] = k;
-                        item_b[(npcts << 1) + 7] = (uint8_t)j;
-                        ++npcts;
-                        upcts |= 1 << k;
-                        break;
-                    }
-                }
+        /* Lets see what type we'll generate now... */
+        k = alias_pick(&ent->tables.attachment[area], rng);
+        if(k == PT_ALIAS_NONE || k == 0 || (upcts & (1 << k)))
+            continue;
 
-                break;
-            }
-        }
+        j = (j - 2) * 5;
+        item_b[(npcts << 1) + 6] = k;
+        item_b[(npcts << 1) + 7] = (uint8_t)j;
+        ++npcts;
+        upcts |= 1 << k;
     }
 
     /* Finally, lets see if there's going to be an elemental attribute applied
        to this weapon, or if its rare and we need to set the flag. */
     if(!semirare && ent->element_ranking[area]) {
-        rnd = mt19937_genrand_int32(rng) % 100;
+        rnd = mtrand_int32(rng) % 100;
         if(rnd < ent->element_probability[area]) {
-            rnd = mt19937_genrand_int32(rng) %
+            rnd = mtrand_int32(rng) %
                 attr_count[ent->element_ranking[area] - 1];
             item[1] = 0x80 | attr_list[ent->element_ranking[area] - 1][rnd];
         }
@@ -693,11 +837,10 @@ already_picked:
 }
 
 static int generate_weapon_v3(pt_v3_entry_t *ent, int area, uint32_t item[4],
-                              struct mt19937_state *rng, int picked, int bb,
+                              mtrand_t *rng, int picked, int bb,
                               lobby_t *l) {
     uint32_t rnd, upcts = 0;
-    int i, j = 0, k, wchance = 0, warea = 0, npcts = 0;
-    int wtypes[12] = { 0 }, wranks[12] = { 0 }, gptrn[12] = { 0 };
+    int i, j, k, warea = 0, npcts = 0;
     uint8_t *item_b = (uint8_t *)item;
     int semirare = 0, rare = 0;
 
@@ -718,68 +861,31 @@ static int generate_weapon_v3(pt_v3_entry_t *ent, int area, uint32_t item[4],
 
     item[0] = item[1] = item[2] = item[3] = 0;
 
-    /* Go through each weapon type to see what ones we actually will have to
-       work with right now... */
-    for(i = 0; i < 12; ++i) {
-        if((ent->weapon_minrank[i] + area) >= 0 && ent->weapon_ratio[i] > 0) {
-            wtypes[j] = i;
-            wchance += ent->weapon_ratio[i];
-
-            if(ent->weapon_minrank[i] >= 0) {
-                warea = area;
-                wranks[j] = ent->weapon_minrank[i];
-            }
-            else {
-                warea = ent->weapon_minrank[i] + area;
-                wranks[j] = 0;
-            }
-
-            /* Sanity check... Make sure this is sane before we go to the loop
-               below, since it will end up being an infinite loop if its not
-               sane... */
-            if(ent->weapon_upgfloor[i] <= 0) {
-                debug(DBG_WARN, "Invalid v3 weapon upgrade floor value for "
-                      "floor %d, weapon type %d. Please check your ItemPT.gsl "
-                      "file (%s) for validity!\n", area, i, bb ? "BB" : "GC");
-                return -1;
-            }
-
-            while((warea - ent->weapon_upgfloor[i]) >= 0) {
-                ++wranks[j];
-                warea -= ent->weapon_upgfloor[i];
-            }
-
-            gptrn[j] = MIN(warea, 3);
-            ++j;
-        }
+    /* Sanity check... Make sure none of the weapon types that could be made on
+       this floor have an invalid upgrade floor value. */
+    if(ent->tables.weapon_bad[area] != -1) {
+        debug(DBG_WARN, "Invalid v3 weapon upgrade floor value for "
+              "floor %d, weapon type %d. Please check your ItemPT.gsl "
+              "file (%s) for validity!\n", area,
+              ent->tables.weapon_bad[area], bb ? "BB" : "GC");
+        return -1;
     }
 
+    /* Roll the dice! */
+    i = alias_pick(&ent->tables.weapon[area], rng);
+
     /* Sanity check... This shouldn't happen! */
-    if(!j) {
+    if(i == PT_ALIAS_NONE) {
         debug(DBG_WARN, "No v3 weapon to generate on floor %d, please check "
               "your ItemPT.gsl file (%s) for validity!\n", area,
               bb ? "BB" : "GC");
         return -1;
     }
 
-    /* Roll the dice! */
-    rnd = mt19937_genrand_int32(rng) % wchance;
-    for(i = 0; i < j; ++i) {
-        if((rnd -= ent->weapon_ratio[wtypes[i]]) > wchance) {
-            item[0] = ((wtypes[i] + 1) << 8) | (wranks[i] << 16);
+    item[0] = ((i + 1) << 8) | (ent->tables.weapon_rank[area][i] << 16);
 
-            /* Save off the grind pattern to use... */
-            warea = gptrn[i];
-            break;
-        }
-    }
-
-    /* Sanity check... Once again, this shouldn't happen! */
-    if(!item[0]) {
-        debug(DBG_WARN, "Generated invalid v3 weapon. Please report this "
-              "error!\n");
-        return -1;
-    }
+    /* Save off the grind pattern to use... */
+    warea = ent->tables.weapon_grind[area][i];
 
     /* See if we made a "semi-rare" item. */
     if((item_b[1] >= 10 && item_b[2] > 3) || item_b[2] > 4)
@@ -787,22 +893,18 @@ static int generate_weapon_v3(pt_v3_entry_t *ent, int area, uint32_t item[4],
 
 already_picked:
     /* Next up, determine the grind value. */
-    rnd = mt19937_genrand_int32(rng) % 100;
-    for(i = 0; i < 9; ++i) {
-        if((rnd -= ent->power_pattern[i][warea]) > 100) {
-            item[0] |= (i << 24);
-            break;
-        }
-    }
+    i = alias_pick(&ent->tables.power[warea], rng);
 
     /* Sanity check... */
-    if(i >= 9) {
+    if(i == PT_ALIAS_NONE) {
         debug(DBG_WARN, "Invalid power pattern for floor %d, pattern "
               "number %d. Please check your ItemPT.gsl (%s) for validity!\n",
               area, warea, bb ? "BB" : "GC");
         return -1;
     }
 
+    item[0] |= (i << 24);
+
     /* Let's generate us some percentages, shall we? This isn't necessarily the
        way I would have designed this, but based on the way the data is laid
        out in the PT file, this is the implied structure of it... */
@@ -810,44 +912,34 @@ already_picked:
         if(ent->area_pattern[i][area] < 0)
             continue;
 
-        rnd = mt19937_genrand_int32(rng) % 10000;
         warea = ent->area_pattern[i][area];
+        if(warea >= 6)
+            continue;
 
-        for(j = 0; j < 23; ++j) {
-            /* See if we're going to generate this one... */
-            if((rnd -= ent->percent_pattern[j][warea]) > 10000) {
-                /* If it would be 0%, don't bother... */
-                if(j == 2) {
-                    break;
-                }
+        /* See if we're going to generate this one... If it would be 0%, don't
+           bother... */
+        j = alias_pick(&ent->tables.percent[warea], rng);
+        if(j == PT_ALIAS_NONE || j == 2)
+            continue;
 
-                /* Lets see what type we'll generate now... */
-                rnd = mt19937_genrand_int32(rng) % 100;
-                for(k = 0; k < 6; ++k) {
-                    if((rnd -= ent->percent_attachment[k][area]) > 100) {
-                        if(k == 0 || (upcts & (1 << k)))
-                            break;
-
-                        j = (j - 2) * 5;
-                        item_b[(npcts << 1) + 6] = k;
-                        item_b[(npcts << 1) + 7] = (uint8_t)j;
-                        ++npcts;
-                        upcts |= 1 << k;
-                        break;
-                    }
-                }
+        /* Lets see what type we'll generate now... */
+        k = alias_pick(&ent->tables.attachment[area], rng);
+        if(k == PT_ALIAS_NONE || k == 0 || (upcts & (1 << k)))
+            continue;
 
-                break;
-            }
-        }
+        j = (j - 2) * 5;
+        item_b[(npcts << 1) + 6] = k;
+        item_b[(npcts << 1) + 7] = (uint8_t)j;
+        ++npcts;
+        upcts |= 1 << k;
     }
 
     /* Finally, lets see if there's going to be an elemental attribute applied
        to this weapon, or if its rare and we need to set the flag. */
     if(!semirare && ent->element_ranking[area]) {
-        rnd = mt19937_genrand_int32(rng) % 100;
+        rnd = mtrand_int32(rng) % 100;
         if(rnd < ent->element_probability[area]) {
-            rnd = mt19937_genrand_int32(rng) %
+            rnd = mtrand_int32(rng) %
                 attr_count[ent->element_ranking[area] - 1];
             item[1] = 0x80 | attr_list[ent->element_ranking[area] - 1][rnd];
         }
@@ -894,46 +986,33 @@ already_picked:
    evp range defined in the PMT data.
 */
 static int generate_armor_v2(pt_v2_entry_t *ent, int area, uint32_t item[4],
-                             struct mt19937_state *rng, int picked,
+                             mtrand_t *rng, int picked,
                              lobby_t *l) {
     uint32_t rnd;
-    int i, armor = -1;
+    int i, armor;
     uint8_t *item_b = (uint8_t *)item;
     uint16_t *item_w = (uint16_t *)item;
-    pmt_guard_v2_t guard;
+    const pmt_guard_v2_t *guard;
 
     if(!picked) {
         /* Go through each slot in the armor rankings to figure out which one
            that we'll be generating. */
-        rnd = mt19937_genrand_int32(rng) % 100;
+        i = alias_pick(&ent->tables.armor, rng);
 
 #ifdef DEBUG
         if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-            debug(DBG_LOG, "generate_armor_v2: RNG picked %" PRIu32 "\n", rnd);
+            debug(DBG_LOG, "generate_armor_v2: Picked slot %d\n", i);
 #endif
 
-        for(i = 0; i < 5; ++i) {
-#ifdef DEBUG
-            if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-                debug(DBG_LOG, "    Index %d, value: %" PRId8 ", left: %"
-                      PRIu32 "\n", i, ent->armor_ranking[i], rnd);
-#endif
-
-            if((rnd -= ent->armor_ranking[i]) > 100) {
-                armor = i;
-                break;
-            }
-        }
-
         /* Sanity check... */
-        if(armor == -1) {
+        if(i == PT_ALIAS_NONE) {
             debug(DBG_WARN, "Couldn't find a v2 armor to generate. Please "
                   "check your ItemPT.afs file for validity!\n");
             return -1;
         }
 
         /* Figure out what the byte we'll use is */
-        armor = ((int)ent->armor_level) - 3 + area + armor;
+        armor = ((int)ent->armor_level) - 3 + area + i;
 
         if(armor < 0)
             armor = 0;
@@ -950,30 +1029,19 @@ static int generate_armor_v2(pt_v2_entry_t *ent, int area, uint32_t item[4],
     item[1] = item[2] = item[3] = 0;
 
     /* Pick a number of unit slots */
-    rnd = mt19937_genrand_int32(rng) % 100;
+    i = alias_pick(&ent->tables.slot, rng);
 
 #ifdef DEBUG
     if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-        debug(DBG_LOG, "generate_armor_v2: RNG picked %" PRIu32 " for slots\n",
-              rnd);
+        debug(DBG_LOG, "generate_armor_v2: Picked %d unit slots\n", i);
 #endif
 
-    for(i = 0; i < 5; ++i) {
-#ifdef DEBUG
-        if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-            debug(DBG_LOG, "    Index %d, value: %" PRId8 ", left: %"
-                  PRIu32 "\n", i, ent->slot_ranking[i], rnd);
-#endif
-
-        if((rnd -= ent->slot_ranking[i]) > 100) {
-            item_b[5] = i;
-            break;
-        }
-    }
+    if(i != PT_ALIAS_NONE)
+        item_b[5] = i;
 
     /* Look up the item in the ItemPMT data so we can see what boosts we might
        apply... */
-    if(pmt_lookup_guard_v2(item[0], &guard)) {
+    if(!(guard = pmt_lookup_guard_v2(item[0]))) {
         debug(DBG_WARN, "ItemPMT.prs file for v2 seems to be missing an armor "
               "type item (code %08x).\n", item[0]);
         return -2;
@@ -982,16 +1050,16 @@ static int generate_armor_v2(pt_v2_entry_t *ent, int area, uint32_t item[4],
 #ifdef DEBUG
     if(l->flags & LOBBY_FLAG_DBG_SDROPS)
         debug(DBG_LOG, "generate_armor_v2: DFP Range: %d, EVP Range: %d\n",
-              guard.dfp_range, guard.evp_range);
+              guard->dfp_range, guard->evp_range);
 #endif
 
-    if(guard.dfp_range) {
-        rnd = mt19937_genrand_int32(rng) % (guard.dfp_range + 1);
+    if(guard->dfp_range) {
+        rnd = mtrand_int32(rng) % (guard->dfp_range + 1);
         item_w[3] = (uint16_t)rnd;
     }
 
-    if(guard.evp_range) {
-        rnd = mt19937_genrand_int32(rng) % (guard.evp_range + 1);
+    if(guard->evp_range) {
+        rnd = mtrand_int32(rng) % (guard->evp_range + 1);
         item_w[4] = (uint16_t)rnd;
     }
 
@@ -1005,41 +1073,28 @@ static int generate_armor_v2(pt_v2_entry_t *ent, int area, uint32_t item[4],
 }
 
 static int generate_armor_v3(pt_v3_entry_t *ent, int area, uint32_t item[4],
-                             struct mt19937_state *rng, int picked, int bb,
+                             mtrand_t *rng, int picked, int bb,
                              lobby_t *l) {
     uint32_t rnd;
-    int i, armor = -1;
+    int i, armor;
     uint8_t *item_b = (uint8_t *)item;
     uint16_t *item_w = (uint16_t *)item;
-    pmt_guard_gc_t gcg;
-    pmt_guard_bb_t bbg;
+    const pmt_guard_gc_t *gcg;
+    const pmt_guard_bb_t *bbg;
     uint8_t dfp, evp;
 
     if(!picked) {
         /* Go through each slot in the armor rankings to figure out which one
            that we'll be generating. */
-        rnd = mt19937_genrand_int32(rng) % 100;
+        i = alias_pick(&ent->tables.armor, rng);
 
 #ifdef DEBUG
         if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-            debug(DBG_LOG, "generate_armor_v3: RNG picked %" PRIu32 "\n", rnd);
-#endif
-
-        for(i = 0; i < 5; ++i) {
-#ifdef DEBUG
-            if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-                debug(DBG_LOG, "    Index %d, value: %" PRId8 ", left: %"
-                      PRIu32 "\n", i, ent->armor_ranking[i], rnd);
+            debug(DBG_LOG, "generate_armor_v3: Picked slot %d\n", i);
 #endif
 
-            if((rnd -= ent->armor_ranking[i]) > 100) {
-                armor = i;
-                break;
-            }
-        }
-
         /* Sanity check... */
-        if(armor == -1) {
+        if(i == PT_ALIAS_NONE) {
             debug(DBG_WARN, "Couldn't find a %s armor to generate. Please "
                   "check your ItemPT.gsl file for validity!\n",
                   bb ? "BB" : "GC");
@@ -1047,7 +1102,7 @@ static int generate_armor_v3(pt_v3_entry_t *ent, int area, uint32_t item[4],
         }
 
         /* Figure out what the byte we'll use is */
-        armor = ((int)ent->armor_level) - 3 + area + armor;
+        armor = ((int)ent->armor_level) - 3 + area + i;
 
         if(armor < 0)
             armor = 0;
@@ -1064,47 +1119,37 @@ static int generate_armor_v3(pt_v3_entry_t *ent, int area, uint32_t item[4],
     item[1] = item[2] = item[3] = 0;
 
     /* Pick a number of unit slots */
-    rnd = mt19937_genrand_int32(rng) % 100;
-#ifdef DEBUG
-    if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-        debug(DBG_LOG, "generate_armor_v3: RNG picked %" PRIu32 " for slots\n",
-              rnd);
-#endif
+    i = alias_pick(&ent->tables.slot, rng);
 
-    for(i = 0; i < 5; ++i) {
 #ifdef DEBUG
-        if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-            debug(DBG_LOG, "    Index %d, value: %" PRId8 ", left: %"
-                  PRIu32 "\n", i, ent->slot_ranking[i], rnd);
+    if(l->flags & LOBBY_FLAG_DBG_SDROPS)
+        debug(DBG_LOG, "generate_armor_v3: Picked %d unit slots\n", i);
 #endif
 
-        if((rnd -= ent->slot_ranking[i]) > 100) {
-            item_b[5] = i;
-            break;
-        }
-    }
+    if(i != PT_ALIAS_NONE)
+        item_b[5] = i;
 
     /* Look up the item in the ItemPMT data so we can see what boosts we might
        apply... */
     if(!bb) {
-        if(pmt_lookup_guard_gc(item[0], &gcg)) {
+        if(!(gcg = pmt_lookup_guard_gc(item[0]))) {
             debug(DBG_WARN, "ItemPMT.prs file for GC seems to be missing an "
                   "armor type item (code %08x).\n", item[0]);
             return -2;
         }
 
-        dfp = gcg.dfp_range;
-        evp = gcg.evp_range;
+        dfp = gcg->dfp_range;
+        evp = gcg->evp_range;
     }
     else {
-        if(pmt_lookup_guard_bb(item[0], &bbg)) {
+        if(!(bbg = pmt_lookup_guard_bb(item[0]))) {
             debug(DBG_WARN, "ItemPMT.prs file for BB seems to be missing an "
                   "armor type item (code %08x).\n", item[0]);
             return -2;
         }
 
-        dfp = bbg.dfp_range;
-        evp = bbg.evp_range;
+        dfp = bbg->dfp_range;
+        evp = bbg->evp_range;
     }
 
 #ifdef DEBUG
@@ -1114,12 +1159,12 @@ static int generate_armor_v3(pt_v3_entry_t *ent, int area, uint32_t item[4],
 #endif
 
     if(dfp) {
-        rnd = mt19937_genrand_int32(rng) % (dfp + 1);
+        rnd = mtrand_int32(rng) % (dfp + 1);
         item_w[3] = (uint16_t)rnd;
     }
 
     if(evp) {
-        rnd = mt19937_genrand_int32(rng) % (evp + 1);
+        rnd = mtrand_int32(rng) % (evp + 1);
         item_w[4] = (uint16_t)rnd;
     }
 
@@ -1135,45 +1180,32 @@ static int generate_armor_v3(pt_v3_entry_t *ent, int area, uint32_t item[4],
 /* Generate a random shield, based on data for PSOv2. This is exactly the same
    as the armor version, but without unit slots. */
 static int generate_shield_v2(pt_v2_entry_t *ent, int area, uint32_t item[4],
-                              struct mt19937_state *rng, int picked,
+                              mtrand_t *rng, int picked,
                               lobby_t *l) {
     uint32_t rnd;
-    int i, armor = -1;
+    int i, armor;
     uint16_t *item_w = (uint16_t *)item;
-    pmt_guard_v2_t guard;
+    const pmt_guard_v2_t *guard;
 
     if(!picked) {
         /* Go through each slot in the armor rankings to figure out which one
            that we'll be generating. */
-        rnd = mt19937_genrand_int32(rng) % 100;
+        i = alias_pick(&ent->tables.armor, rng);
 
 #ifdef DEBUG
         if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-            debug(DBG_LOG, "generate_shield_v2: RNG picked %" PRIu32 "\n", rnd);
+            debug(DBG_LOG, "generate_shield_v2: Picked slot %d\n", i);
 #endif
 
-        for(i = 0; i < 5; ++i) {
-#ifdef DEBUG
-            if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-                debug(DBG_LOG, "    Index %d, value: %" PRId8 ", left: %"
-                      PRIu32 "\n", i, ent->armor_ranking[i], rnd);
-#endif
-
-            if((rnd -= ent->armor_ranking[i]) > 100) {
-                armor = i;
-                break;
-            }
-        }
-
         /* Sanity check... */
-        if(armor == -1) {
+        if(i == PT_ALIAS_NONE) {
             debug(DBG_WARN, "Couldn't find a v2 shield to generate. Please "
                   "check your ItemPT.afs file for validity!\n");
             return -1;
         }
 
         /* Figure out what the byte we'll use is */
-        armor = ((int)ent->armor_level) - 3 + area + armor;
+        armor = ((int)ent->armor_level) - 3 + area + i;
 
         if(armor < 0)
             armor = 0;
@@ -1191,7 +1223,7 @@ static int generate_shield_v2(pt_v2_entry_t *ent, int area, uint32_t item[4],
 
     /* Look up the item in the ItemPMT data so we can see what boosts we might
        apply... */
-    if(pmt_lookup_guard_v2(item[0], &guard)) {
+    if(!(guard = pmt_lookup_guard_v2(item[0]))) {
         debug(DBG_WARN, "ItemPMT.prs file for v2 seems to be missing a shield "
               "type item (code %08x).\n", item[0]);
         return -2;
@@ -1200,16 +1232,16 @@ static int generate_shield_v2(pt_v2_entry_t *ent, int area, uint32_t item[4],
 #ifdef DEBUG
     if(l->flags & LOBBY_FLAG_DBG_SDROPS)
         debug(DBG_LOG, "generate_shield_v2: DFP Range: %d, EVP Range: %d\n",
-              guard.dfp_range, guard.evp_range);
+              guard->dfp_range, guard->evp_range);
 #endif
 
-    if(guard.dfp_range) {
-        rnd = mt19937_genrand_int32(rng) % (guard.dfp_range + 1);
+    if(guard->dfp_range) {
+        rnd = mtrand_int32(rng) % (guard->dfp_range + 1);
         item_w[3] = (uint16_t)rnd;
     }
 
-    if(guard.evp_range) {
-        rnd = mt19937_genrand_int32(rng) % (guard.evp_range + 1);
+    if(guard->evp_range) {
+        rnd = mtrand_int32(rng) % (guard->evp_range + 1);
         item_w[4] = (uint16_t)rnd;
     }
 
@@ -1223,40 +1255,27 @@ static int generate_shield_v2(pt_v2_entry_t *ent, int area, uint32_t item[4],
 }
 
 static int generate_shield_v3(pt_v3_entry_t *ent, int area, uint32_t item[4],
-                              struct mt19937_state *rng, int picked, int bb,
+                              mtrand_t *rng, int picked, int bb,
                               lobby_t *l) {
     uint32_t rnd;
-    int i, armor = -1;
+    int i, armor;
     uint16_t *item_w = (uint16_t *)item;
-    pmt_guard_gc_t gcg;
-    pmt_guard_bb_t bbg;
+    const pmt_guard_gc_t *gcg;
+    const pmt_guard_bb_t *bbg;
     uint8_t dfp, evp;
 
     if(!picked) {
         /* Go through each slot in the armor rankings to figure out which one
            that we'll be generating. */
-        rnd = mt19937_genrand_int32(rng) % 100;
+        i = alias_pick(&ent->tables.armor, rng);
 
 #ifdef DEBUG
         if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-            debug(DBG_LOG, "generate_shield_v3: RNG picked %" PRIu32 "\n", rnd);
+            debug(DBG_LOG, "generate_shield_v3: Picked slot %d\n", i);
 #endif
 
-        for(i = 0; i < 5; ++i) {
-#ifdef DEBUG
-            if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-                debug(DBG_LOG, "    Index %d, value: %" PRId8 ", left: %"
-                      PRIu32 "\n", i, ent->armor_ranking[i], rnd);
-#endif
-
-            if((rnd -= ent->armor_ranking[i]) > 100) {
-                armor = i;
-                break;
-            }
-        }
-
         /* Sanity check... */
-        if(armor == -1) {
+        if(i == PT_ALIAS_NONE) {
             debug(DBG_WARN, "Couldn't find a %s shield to generate. Please "
                   "check your ItemPT.gsl file for validity!\n",
                   bb ? "BB" : "GC");
@@ -1264,7 +1283,7 @@ static int generate_shield_v3(pt_v3_entry_t *ent, int area, uint32_t item[4],
         }
 
         /* Figure out what the byte we'll use is */
-        armor = ((int)ent->armor_level) - 3 + area + armor;
+        armor = ((int)ent->armor_level) - 3 + area + i;
 
         if(armor < 0)
             armor = 0;
@@ -1283,24 +1302,24 @@ static int generate_shield_v3(pt_v3_entry_t *ent, int area, uint32_t item[4],
     /* Look up the item in the ItemPMT data so we can see what boosts we might
        apply... */
     if(!bb) {
-        if(pmt_lookup_guard_gc(item[0], &gcg)) {
+        if(!(gcg = pmt_lookup_guard_gc(item[0]))) {
             debug(DBG_WARN, "ItemPMT.prs file for GC seems to be missing a "
                   "shield type item (code %08x).\n", item[0]);
             return -2;
         }
 
-        dfp = gcg.dfp_range;
-        evp = gcg.evp_range;
+        dfp = gcg->dfp_range;
+        evp = gcg->evp_range;
     }
     else {
-        if(pmt_lookup_guard_bb(item[0], &bbg)) {
+        if(!(bbg = pmt_lookup_guard_bb(item[0]))) {
             debug(DBG_WARN, "ItemPMT.prs file for BB seems to be missing a "
                   "shield type item (code %08x).\n", item[0]);
             return -2;
         }
 
-        dfp = bbg.dfp_range;
-        evp = bbg.evp_range;
+        dfp = bbg->dfp_range;
+        evp = bbg->evp_range;
     }
 
 #ifdef DEBUG
@@ -1310,12 +1329,12 @@ static int generate_shield_v3(pt_v3_entry_t *ent, int area, uint32_t item[4],
 #endif
 
     if(dfp) {
-        rnd = mt19937_genrand_int32(rng) % (dfp + 1);
+        rnd = mtrand_int32(rng) % (dfp + 1);
         item_w[3] = (uint16_t)rnd;
     }
 
     if(evp) {
-        rnd = mt19937_genrand_int32(rng) % (evp + 1);
+        rnd = mtrand_int32(rng) % (evp + 1);
         item_w[4] = (uint16_t)rnd;
     }
 
@@ -1328,32 +1347,24 @@ static int generate_shield_v3(pt_v3_entry_t *ent, int area, uint32_t item[4],
     return 0;
 }
 
-static uint32_t generate_tool_base(uint16_t freqs[28][10], int area,
-                                   struct mt19937_state *rng, lobby_t *l) {
-    uint32_t rnd = mt19937_genrand_int32(rng) % 10000;
-    int i;
+static uint32_t generate_tool_base(const pt_alias_t *freqs,
+                                   mtrand_t *rng, lobby_t *l) {
+    int i = alias_pick(freqs, rng);
 
 #ifdef DEBUG
     if(l->flags & LOBBY_FLAG_DBG_SDROPS) {
-        debug(DBG_LOG, "generate_tool_base: RNG picked %" PRIu32 "\n", rnd);
+        debug(DBG_LOG, "generate_tool_base: Picked index %d\n", i);
     }
 #endif
 
-    for(i = 0; i < 28; ++i) {
+    if(i != PT_ALIAS_NONE) {
 #ifdef DEBUG
         if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-            debug(DBG_LOG, "    index: %d, code %08" PRIx32 " chance: %" PRIu16
-                  " left: %" PRIu32 "\n", i, tool_base[i], LE16(freqs[i][area]),
-                  rnd);
-#endif
-        if((rnd -= LE16(freqs[i][area])) > 10000) {
-#ifdef DEBUG
-            if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-                debug(DBG_LOG, "    Generating item.\n");
+            debug(DBG_LOG, "    Generating item %08" PRIx32 ".\n",
+                  tool_base[i]);
 #endif
 
-            return tool_base[i];
-        }
+        return tool_base[i];
     }
 
 #ifdef DEBUG
@@ -1365,75 +1376,69 @@ static uint32_t generate_tool_base(uint16_t freqs[28][10], int area,
 }
 
 /* XXXX: There's something afoot here generating invalid techs. */
-static int generate_tech(uint8_t freqs[19][10], int8_t levels[19][20],
+static int generate_tech(const pt_alias_t *freqs, int8_t levels[19][20],
                          int area, uint32_t item[4],
-                         struct mt19937_state *rng, lobby_t *l) {
-    uint32_t rnd, tech, level;
+                         mtrand_t *rng, lobby_t *l) {
+    uint32_t rnd, level;
     int8_t t1, t2;
     int i;
 
-    rnd = mt19937_genrand_int32(rng);
-    tech = rnd % 1000;
+    /* The technique is picked with the bottom part of the random number and
+       the level with what's left over. */
+    rnd = mtrand_int32(rng);
+    i = pt_alias_pick_rnd(freqs, rnd);
 
 #ifdef DEBUG
     if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-        debug(DBG_LOG, "generate_tech: RNG generated %" PRIu32 " tech part: %"
-              PRIu32 "\n", rnd, tech);
+        debug(DBG_LOG, "generate_tech: RNG generated %" PRIu32 " tech: %d\n",
+              rnd, i);
 #endif
 
-    rnd /= 1000;
+    if(i != PT_ALIAS_NONE) {
+        rnd /= freqs->total;
 
-    for(i = 0; i < 19; ++i) {
 #ifdef DEBUG
         if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-            debug(DBG_LOG, "    index: %d, chance: %" PRIu8 " left: %" PRIu32
-                  "\n", i, freqs[i][area], tech);
-#endif
-
-        if((tech -= freqs[i][area]) > 1000) {
-#ifdef DEBUG
-            if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-                debug(DBG_LOG, "    Generating tech.\n");
+            debug(DBG_LOG, "    Generating tech.\n");
 #endif
 
-            t1 = levels[i][area << 1];
-            t2 = levels[i][(area << 1) + 1];
+        t1 = levels[i][area << 1];
+        t2 = levels[i][(area << 1) + 1];
 
 #ifdef DEBUG
-            if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-                debug(DBG_LOG, "    Min: %" PRId8 " Max: " PRId8 "\n", t1, t2);
+        if(l->flags & LOBBY_FLAG_DBG_SDROPS)
+            debug(DBG_LOG, "    Min: %" PRId8 " Max: " PRId8 "\n", t1, t2);
 #endif
 
-            /* Make sure that the minimum level isn't -1 and that the minimum is
-               actually less than the maximum. */
-            if(t1 == -1 || t1 > t2) {
-                debug(DBG_WARN, "Invalid tech level set for area %d, tech %d\n",
-                      area, i);
-                return -1;
-            }
+        /* Make sure that the minimum level isn't -1 and that the minimum is
+           actually less than the maximum. */
+        if(t1 == -1 || t1 > t2) {
+            debug(DBG_WARN, "Invalid tech level set for area %d, tech %d\n",
+                  area, i);
+            return -1;
+        }
 
-            /* Cap the levels from the ItemPT data, since Sega's files sometimes
-               have stupid values here. */
-            if(t1 >= 30)
-                t1 = 29;
+        /* Cap the levels from the ItemPT data, since Sega's files sometimes
+           have stupid values here. */
+        if(t1 >= 30)
+            t1 = 29;
 
-            if(t2 >= 30)
-                t2 = 29;
+        if(t2 >= 30)
+            t2 = 29;
 
-            if(t1 < t2)
-                level = (rnd % ((t2 + 1) - t1)) + t1;
-            else
-                level = t1;
+        if(t1 < t2)
+            level = (rnd % ((t2 + 1) - t1)) + t1;
+        else
+            level = t1;
 
 #ifdef DEBUG
-            if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-                debug(DBG_LOG, "    Level selected: %" PRIu32 "\n", level);
+        if(l->flags & LOBBY_FLAG_DBG_SDROPS)
+            debug(DBG_LOG, "    Level selected: %" PRIu32 "\n", level);
 #endif
 
-            item[1] = i;
-            item[0] |= (level << 16);
-            return 0;
-        }
+        item[1] = i;
+        item[0] |= (level << 16);
+        return 0;
     }
 
     /* Shouldn't get here... */
@@ -1442,8 +1447,8 @@ static int generate_tech(uint8_t freqs[19][10], int8_t levels[19][20],
 }
 
 static int generate_tool_v2(pt_v2_entry_t *ent, int area, uint32_t item[4],
-                            struct mt19937_state *rng, lobby_t *l) {
-    item[0] = generate_tool_base(ent->tool_frequency, area, rng, l);
+                            mtrand_t *rng, lobby_t *l) {
+    item[0] = generate_tool_base(&ent->tables.tool[area], rng, l);
 
     /* Neither of these should happen, but just in case... */
     if(item[0] == Item_Photon_Drop || item[0] == Item_NoSuchItem) {
@@ -1471,7 +1476,7 @@ static int generate_tool_v2(pt_v2_entry_t *ent, int area, uint32_t item[4],
             debug(DBG_LOG, "Item is technique disk. Picking technique.\n");
 #endif
 
-        if(generate_tech(ent->tech_frequency, ent->tech_levels, area,
+        if(generate_tech(&ent->tables.tech[area], ent->tech_levels, area,
                          item, rng, l)) {
             debug(DBG_WARN, "Generated invalid technique! Please check "
                   "your ItemPT.afs file for validity!\n");
@@ -1483,8 +1488,8 @@ static int generate_tool_v2(pt_v2_entry_t *ent, int area, uint32_t item[4],
 }
 
 static int generate_tool_v3(pt_v3_entry_t *ent, int area, uint32_t item[4],
-                            struct mt19937_state *rng, lobby_t *l) {
-    item[0] = generate_tool_base(ent->tool_frequency, area, rng, l);
+                            mtrand_t *rng, lobby_t *l) {
+    item[0] = generate_tool_base(&ent->tables.tool[area], rng, l);
 
     /* This shouldn't happen happen, but just in case... */
     if(item[0] == Item_NoSuchItem) {
@@ -1512,7 +1517,7 @@ static int generate_tool_v3(pt_v3_entry_t *ent, int area, uint32_t item[4],
             debug(DBG_LOG, "Item is technique disk. Picking technique.\n");
 #endif
 
-        if(generate_tech(ent->tech_frequency, ent->tech_levels, area,
+        if(generate_tech(&ent->tables.tech[area], ent->tech_levels, area,
                          item, rng, l)) {
             debug(DBG_WARN, "Generated invalid technique! Please check "
                   "your ItemPT.gsl file for validity!\n");
@@ -1524,11 +1529,11 @@ static int generate_tool_v3(pt_v3_entry_t *ent, int area, uint32_t item[4],
 }
 
 static int generate_meseta(int min, int max, uint32_t item[4],
-                           struct mt19937_state *rng, lobby_t *l) {
+                           mtrand_t *rng, lobby_t *l) {
     uint32_t rnd;
 
     if(min < max)
-        rnd = (mt19937_genrand_int32(rng) % ((max + 1) - min)) + min;
+        rnd = (mtrand_int32(rng) % ((max + 1) - min)) + min;
     else
         rnd = min;
 
@@ -1672,9 +1677,9 @@ int pt_generate_v2_drop(ship_client_t *c, lobby_t *l, void *r) {
     uint32_t rnd;
     uint32_t item[4];
     int area, rarea, do_rare = 1;
-    struct mt19937_state *rng = &c->cur_block->rng;
+    mtrand_t *rng = block_rng(c->cur_block);
     uint16_t mid;
-    game_enemy_t *enemy;
+    game_enemy_state_t *enemy;
     int csr = 0;
     uint32_t qdrop = 0xFFFFFFFF;
 
@@ -1725,7 +1730,7 @@ int pt_generate_v2_drop(ship_client_t *c, lobby_t *l, void *r) {
 
     /* Make sure the enemy's id is sane... */
     mid = LE16(req->req);
-    if(mid > l->map_enemies->count) {
+    if(mid >= l->map_enemies->count) {
 #ifdef DEBUG
         debug(DBG_WARN, "Guildcard %" PRIu32 " requested v2 drop for invalid "
               "enemy (%d -- max: %d, quest=%" PRIu32 ")!\n", c->guildcard,
@@ -1739,13 +1744,14 @@ int pt_generate_v2_drop(ship_client_t *c, lobby_t *l, void *r) {
     }
 
     /* Grab the map enemy to make sure it hasn't already dropped something. */
-    enemy = &l->map_enemies->enemies[mid];
+    enemy = &l->map_enemies->state[mid];
 
     LOG(l, "Guildcard %" PRIu32 " requested v2 drop...\n"
         "mid: %d (max: %d), pt: %d (%d), area: %d (%d), quest: %" PRIu32
         "section: %d, difficulty: %d\n",
         c->guildcard, mid, l->map_enemies->count, req->pt_index,
-        enemy->rt_index, area + 1, rarea, l->qid, section, l->difficulty);
+        team_enemy_rt(l->map_enemies, team_enemy(l->map_enemies, mid)),
+        area + 1, rarea, l->qid, section, l->difficulty);
 
     if(enemy->drop_done) {
         LOGV(l, "Drop already done.\n");
@@ -1755,7 +1761,7 @@ int pt_generate_v2_drop(ship_client_t *c, lobby_t *l, void *r) {
     enemy->drop_done = 1;
 
     /* See if the enemy is going to drop anything at all this time... */
-    rnd = mt19937_genrand_int32(rng) % 100;
+    rnd = mtrand_int32(rng) % 100;
 
     if(rnd >= ent->enemy_dar[req->pt_index]) {
         /* Nope. You get nothing! */
@@ -1874,7 +1880,7 @@ int pt_generate_v2_drop(ship_client_t *c, lobby_t *l, void *r) {
     }
 
     /* Figure out what type to drop... */
-    rnd = mt19937_genrand_int32(rng) % 3;
+    rnd = mtrand_int32(rng) % 3;
     switch(rnd) {
         case 0:
             /* Drop the enemy's designated type of item. */
@@ -1962,13 +1968,13 @@ int pt_generate_v2_boxdrop(ship_client_t *c, lobby_t *l, void *r) {
     int section = l->clients[l->leader_id]->pl->v1.section;
     pt_v2_entry_t *ent;
     uint16_t obj_id;
-    game_object_t *gobj;
-    map_object_t *obj;
-    uint32_t rnd, t1, t2;
-    int area, do_rare = 1;
+    const game_object_t *gobj;
+    const map_object_t *obj;
+    uint32_t t1, t2;
+    int area, do_rare = 1, type;
     uint32_t item[4];
     float f1, f2;
-    struct mt19937_state *rng = &c->cur_block->rng;
+    mtrand_t *rng = block_rng(c->cur_block);
     int csr = 0;
     uint32_t qdrop = 0xFFFFFFFF;
 
@@ -1985,15 +1991,15 @@ int pt_generate_v2_boxdrop(ship_client_t *c, lobby_t *l, void *r) {
 
     /* Grab the object ID and make sure its sane, then grab the object itself */
     obj_id = LE16(req->req);
-    if(obj_id > l->map_objs->count) {
+    if(obj_id >= l->map_objs->count) {
         debug(DBG_WARN, "Guildard %u requested drop from invalid box\n",
               c->guildcard);
         return -1;
     }
 
     /* Don't bother if the box has already been opened */
-    gobj = &l->map_objs->objs[obj_id];
-    if(gobj->flags & 0x00000001)
+    gobj = team_object(l->map_objs, obj_id);
+    if(l->map_objs->flags[obj_id] & TEAM_OBJ_FLAG_DROPPED)
         return 0;
 
     obj = &gobj->data;
@@ -2027,7 +2033,7 @@ int pt_generate_v2_boxdrop(ship_client_t *c, lobby_t *l, void *r) {
     --area;
 
     /* Mark the box as spent now... */
-    gobj->flags |= 0x00000001;
+    l->map_objs->flags[obj_id] |= TEAM_OBJ_FLAG_DROPPED;
 
     /* See if we'll do a rare roll. */
     if(l->qid) {
@@ -2181,9 +2187,9 @@ int pt_generate_v2_boxdrop(ship_client_t *c, lobby_t *l, void *r) {
     }
 
     /* Generate an item, according to the PT data */
-    rnd = mt19937_genrand_int32(rng) % 100;
+    type = alias_pick(&ent->tables.box[area], rng);
 
-    if((rnd -= ent->box_drop[BOX_TYPE_WEAPON][area]) > 100) {
+    if(type == BOX_TYPE_WEAPON) {
 generate_weapon:
         /* Generate a weapon */
         if(generate_weapon_v2(ent, area, item, rng, 0,
@@ -2192,7 +2198,7 @@ generate_weapon:
 
         return check_and_send(c, l, item, c->cur_area, req, csr);
     }
-    else if((rnd -= ent->box_drop[BOX_TYPE_ARMOR][area]) > 100) {
+    else if(type == BOX_TYPE_ARMOR) {
 generate_armor:
         /* Generate an armor */
         if(generate_armor_v2(ent, area, item, rng, 0, l))
@@ -2200,21 +2206,21 @@ generate_armor:
 
         return check_and_send(c, l, item, c->cur_area, req, csr);
     }
-    else if((rnd -= ent->box_drop[BOX_TYPE_SHIELD][area]) > 100) {
+    else if(type == BOX_TYPE_SHIELD) {
         /* Generate a shield */
         if(generate_shield_v2(ent, area, item, rng, 0, l))
             return 0;
 
         return check_and_send(c, l, item, c->cur_area, req, csr);
     }
-    else if((rnd -= ent->box_drop[BOX_TYPE_UNIT][area]) > 100) {
+    else if(type == BOX_TYPE_UNIT) {
         /* Generate a unit */
         if(pmt_random_unit_v2(ent->unit_level[area], item, rng, l))
             return 0;
 
         return check_and_send(c, l, item, c->cur_area, req, csr);
     }
-    else if((rnd -= ent->box_drop[BOX_TYPE_TOOL][area]) > 100) {
+    else if(type == BOX_TYPE_TOOL) {
 generate_tool:
         /* Generate a tool */
         if(generate_tool_v2(ent, area, item, rng, l))
@@ -2222,7 +2228,7 @@ generate_tool:
 
         return check_and_send(c, l, item, c->cur_area, req, csr);
     }
-    else if((rnd -= ent->box_drop[BOX_TYPE_MESETA][area]) > 100) {
+    else if(type == BOX_TYPE_MESETA) {
 generate_meseta:
         /* Generate money! */
         if(generate_meseta(ent->box_meseta[area][0], ent->box_meseta[area][1],
@@ -2245,9 +2251,9 @@ int pt_generate_gc_drop(ship_client_t *c, lobby_t *l, void *r) {
     uint32_t rnd;
     uint32_t item[4];
     int area, darea, do_rare = 1;
-    struct mt19937_state *rng = &c->cur_block->rng;
+    mtrand_t *rng = block_rng(c->cur_block);
     uint16_t mid;
-    game_enemy_t *enemy;
+    game_enemy_state_t *enemy;
     int csr = 0;
 
     /* Make sure the PT index in the packet is sane */
@@ -2348,7 +2354,7 @@ int pt_generate_gc_drop(ship_client_t *c, lobby_t *l, void *r) {
     /* We only really need this separate for debugging... */
     area = darea;
 
-    if(mid > l->map_enemies->count) {
+    if(mid >= l->map_enemies->count) {
 #ifdef DEBUG
         debug(DBG_WARN, "Guildcard %" PRIu32 " requested GC drop for invalid "
               "enemy (%d -- max: %d, quest=%" PRIu32 ")!\n", c->guildcard, mid,
@@ -2365,7 +2371,7 @@ int pt_generate_gc_drop(ship_client_t *c, lobby_t *l, void *r) {
     }
 
     /* Grab the map enemy to make sure it hasn't already dropped something. */
-    enemy = &l->map_enemies->enemies[mid];
+    enemy = &l->map_enemies->state[mid];
     if(enemy->drop_done) {
 #ifdef DEBUG
         if(l->flags & LOBBY_FLAG_DBG_SDROPS)
@@ -2377,7 +2383,7 @@ int pt_generate_gc_drop(ship_client_t *c, lobby_t *l, void *r) {
     enemy->drop_done = 1;
 
     /* See if the enemy is going to drop anything at all this time... */
-    rnd = mt19937_genrand_int32(rng) % 100;
+    rnd = mtrand_int32(rng) % 100;
 
 #ifdef DEBUG
     if(l->flags & LOBBY_FLAG_DBG_SDROPS)
@@ -2487,7 +2493,7 @@ int pt_generate_gc_drop(ship_client_t *c, lobby_t *l, void *r) {
     }
 
     /* Figure out what type to drop... */
-    rnd = mt19937_genrand_int32(rng) % 3;
+    rnd = mtrand_int32(rng) % 3;
 
 #ifdef DEBUG
     if(l->flags & LOBBY_FLAG_DBG_SDROPS) {
@@ -2594,13 +2600,13 @@ int pt_generate_gc_boxdrop(ship_client_t *c, lobby_t *l, void *r) {
     int section = l->clients[l->leader_id]->pl->v1.section;
     pt_v3_entry_t *ent;
     uint16_t obj_id;
-    game_object_t *gobj;
-    map_object_t *obj;
-    uint32_t rnd, t1, t2;
-    int area, darea, do_rare = 1;
+    const game_object_t *gobj;
+    const map_object_t *obj;
+    uint32_t t1, t2;
+    int area, darea, do_rare = 1, type;
     uint32_t item[4];
     float f1, f2;
-    struct mt19937_state *rng = &c->cur_block->rng;
+    mtrand_t *rng = block_rng(c->cur_block);
     int csr = 0;
 
     /* Make sure this is actually a box drop... */
@@ -2616,15 +2622,15 @@ int pt_generate_gc_boxdrop(ship_client_t *c, lobby_t *l, void *r) {
 
     /* Grab the object ID and make sure its sane, then grab the object itself */
     obj_id = LE16(req->req);
-    if(obj_id > l->map_objs->count) {
+    if(obj_id >= l->map_objs->count) {
         debug(DBG_WARN, "Guildard %u requested drop from invalid box\n",
               c->guildcard);
         return -1;
     }
 
     /* Don't bother if the box has already been opened */
-    gobj = &l->map_objs->objs[obj_id];
-    if(gobj->flags & 0x00000001) {
+    gobj = team_object(l->map_objs, obj_id);
+    if(l->map_objs->flags[obj_id] & TEAM_OBJ_FLAG_DROPPED) {
 #ifdef DEBUG
         if(l->flags & LOBBY_FLAG_DBG_SDROPS)
             debug(DBG_LOG, "Requested drop from opened box: %d\n", obj_id);
@@ -2694,7 +2700,7 @@ int pt_generate_gc_boxdrop(ship_client_t *c, lobby_t *l, void *r) {
     --darea;
 
     /* Mark the box as spent now... */
-    gobj->flags |= 0x00000001;
+    l->map_objs->flags[obj_id] |= TEAM_OBJ_FLAG_DROPPED;
 
 #ifdef DEBUG
     if(l->flags & LOBBY_FLAG_DBG_SDROPS) {
@@ -2875,14 +2881,14 @@ int pt_generate_gc_boxdrop(ship_client_t *c, lobby_t *l, void *r) {
     }
 
     /* Generate an item, according to the PT data */
-    rnd = mt19937_genrand_int32(rng) % 100;
+    type = alias_pick(&ent->tables.box[area], rng);
 
 #ifdef DEBUG
     if(l->flags & LOBBY_FLAG_DBG_SDROPS)
-        debug(DBG_LOG, "RNG generated %d\n", rnd);
+        debug(DBG_LOG, "Box drop type picked: %d\n", type);
 #endif
 
-    if((rnd -= ent->box_drop[BOX_TYPE_WEAPON][area]) > 100) {
+    if(type == BOX_TYPE_WEAPON) {
 generate_weapon:
         /* Generate a weapon */
         if(generate_weapon_v3(ent, area, item, rng, 0, 0, l))
@@ -2891,7 +2897,7 @@ generate_weapon:
         return check_and_send(c, l, item, c->cur_area, (subcmd_itemreq_t *)req,
                               csr);
     }
-    else if((rnd -= ent->box_drop[BOX_TYPE_ARMOR][area]) > 100) {
+    else if(type == BOX_TYPE_ARMOR) {
 generate_armor:
         /* Generate an armor */
         if(generate_armor_v3(ent, area, item, rng, 0, 0, l))
@@ -2900,7 +2906,7 @@ generate_armor:
         return check_and_send(c, l, item, c->cur_area, (subcmd_itemreq_t *)req,
                               csr);
     }
-    else if((rnd -= ent->box_drop[BOX_TYPE_SHIELD][area]) > 100) {
+    else if(type == BOX_TYPE_SHIELD) {
         /* Generate a shield */
         if(generate_shield_v3(ent, area, item, rng, 0, 0, l))
             return 0;
@@ -2908,7 +2914,7 @@ generate_armor:
         return check_and_send(c, l, item, c->cur_area, (subcmd_itemreq_t *)req,
                               csr);
     }
-    else if((rnd -= ent->box_drop[BOX_TYPE_UNIT][area]) > 100) {
+    else if(type == BOX_TYPE_UNIT) {
         /* Generate a unit */
         if(pmt_random_unit_gc(ent->unit_level[area], item, rng, l))
             return 0;
@@ -2916,7 +2922,7 @@ generate_armor:
         return check_and_send(c, l, item, c->cur_area, (subcmd_itemreq_t *)req,
                               csr);
     }
-    else if((rnd -= ent->box_drop[BOX_TYPE_TOOL][area]) > 100) {
+    else if(type == BOX_TYPE_TOOL) {
 generate_tool:
         /* Generate a tool */
         if(generate_tool_v3(ent, area, item, rng, l))
@@ -2925,7 +2931,7 @@ generate_tool:
         return check_and_send(c, l, item, c->cur_area, (subcmd_itemreq_t *)req,
                               csr);
     }
-    else if((rnd -= ent->box_drop[BOX_TYPE_MESETA][area]) > 100) {
+    else if(type == BOX_TYPE_MESETA) {
 generate_meseta:
         /* Generate money! */
         if(generate_meseta(ent->box_meseta[area][0], ent->box_meseta[area][1],
@@ -2947,9 +2953,9 @@ int pt_generate_bb_drop(ship_client_t *c, lobby_t *l, void *r) {
     uint32_t rnd;
     uint32_t item[4];
     int area, do_rare = 1;
-    struct mt19937_state *rng = &c->cur_block->rng;
+    mtrand_t *rng = block_rng(c->cur_block);
     uint16_t mid;
-    game_enemy_t *enemy;
+    game_enemy_state_t *enemy;
     int csr = 0;
 
     /* XXXX: Handle Episode 4 */
@@ -3025,7 +3031,7 @@ int pt_generate_bb_drop(ship_client_t *c, lobby_t *l, void *r) {
 
     /* Make sure the enemy's id is sane... */
     mid = LE16(req->req);
-    if(mid > l->map_enemies->count) {
+    if(mid >= l->map_enemies->count) {
         debug(DBG_WARN, "Guildcard %" PRIu32 " requested drop for invalid "
               "enemy (%d -- max: %d, quest=%" PRIu32 ")!\n", c->guildcard, mid,
               l->map_enemies->count, l->qid);
@@ -3033,14 +3039,14 @@ int pt_generate_bb_drop(ship_client_t *c, lobby_t *l, void *r) {
     }
 
     /* Grab the map enemy to make sure it hasn't already dropped something. */
-    enemy = &l->map_enemies->enemies[mid];
+    enemy = &l->map_enemies->state[mid];
     if(enemy->drop_done)
         return 0;
 
     enemy->drop_done = 1;
 
     /* See if the enemy is going to drop anything at all this time... */
-    rnd = mt19937_genrand_int32(rng) % 100;
+    rnd = mtrand_int32(rng) % 100;
 
     if(rnd >= ent->enemy_dar[req->pt_index])
         /* Nope. You get nothing! */
@@ -3116,7 +3122,7 @@ int pt_generate_bb_drop(ship_client_t *c, lobby_t *l, void *r) {
     }
 
     /* Figure out what type to drop... */
-    rnd = mt19937_genrand_int32(rng) % 3;
+    rnd = mtrand_int32(rng) % 3;
     switch(rnd) {
         case 0:
             /* Drop the enemy's designated type of item. */
@@ -3196,13 +3202,13 @@ int pt_generate_bb_boxdrop(ship_client_t *c, lobby_t *l, void *r) {
     int section = l->clients[l->leader_id]->pl->bb.character.section;
     pt_v3_entry_t *ent;
     uint16_t obj_id;
-    game_object_t *gobj;
-    map_object_t *obj;
-    uint32_t rnd, t1, t2;
-    int area, do_rare = 1;
+    const game_object_t *gobj;
+    const map_object_t *obj;
+    uint32_t t1, t2;
+    int area, do_rare = 1, type;
     uint32_t item[4];
     float f1, f2;
-    struct mt19937_state *rng = &c->cur_block->rng;
+    mtrand_t *rng = block_rng(c->cur_block);
     int csr = 0;
 
     /* XXXX: Handle Episode 4 */
@@ -3217,15 +3223,15 @@ int pt_generate_bb_boxdrop(ship_client_t *c, lobby_t *l, void *r) {
 
     /* Grab the object ID and make sure its sane, then grab the object itself */
     obj_id = LE16(req->req);
-    if(obj_id > l->map_objs->count) {
+    if(obj_id >= l->map_objs->count) {
         debug(DBG_WARN, "Guildard %u requested drop from invalid box\n",
               c->guildcard);
         return -1;
     }
 
     /* Don't bother if the box has already been opened */
-    gobj = &l->map_objs->objs[obj_id];
-    if(gobj->flags & 0x00000001)
+    gobj = team_object(l->map_objs, obj_id);
+    if(l->map_objs->flags[obj_id] & TEAM_OBJ_FLAG_DROPPED)
         return 0;
 
     obj = &gobj->data;
@@ -3289,7 +3295,7 @@ int pt_generate_bb_boxdrop(ship_client_t *c, lobby_t *l, void *r) {
     --area;
 
     /* Mark the box as spent now... */
-    gobj->flags |= 0x00000001;
+    l->map_objs->flags[obj_id] |= TEAM_OBJ_FLAG_DROPPED;
 
     /* See if we'll do a rare roll. */
     if(l->qid) {
@@ -3411,9 +3417,9 @@ int pt_generate_bb_boxdrop(ship_client_t *c, lobby_t *l, void *r) {
     }
 
     /* Generate an item, according to the PT data */
-    rnd = mt19937_genrand_int32(rng) % 100;
+    type = alias_pick(&ent->tables.box[area], rng);
 
-    if((rnd -= ent->box_drop[BOX_TYPE_WEAPON][area]) > 100) {
+    if(type == BOX_TYPE_WEAPON) {
 generate_weapon:
         /* Generate a weapon */
         if(generate_weapon_v3(ent, area, item, rng, 0, 1, l))
@@ -3422,7 +3428,7 @@ generate_weapon:
         return check_and_send_bb(c, l, item, c->cur_area,
                                  (subcmd_bb_itemreq_t *)req, csr);
     }
-    else if((rnd -= ent->box_drop[BOX_TYPE_ARMOR][area]) > 100) {
+    else if(type == BOX_TYPE_ARMOR) {
 generate_armor:
         /* Generate an armor */
         if(generate_armor_v3(ent, area, item, rng, 0, 1, l))
@@ -3431,7 +3437,7 @@ generate_armor:
         return check_and_send_bb(c, l, item, c->cur_area,
                                  (subcmd_bb_itemreq_t *)req, csr);
     }
-    else if((rnd -= ent->box_drop[BOX_TYPE_SHIELD][area]) > 100) {
+    else if(type == BOX_TYPE_SHIELD) {
         /* Generate a shield */
         if(generate_shield_v3(ent, area, item, rng, 0, 1, l))
             return 0;
@@ -3439,7 +3445,7 @@ generate_armor:
         return check_and_send_bb(c, l, item, c->cur_area,
                                  (subcmd_bb_itemreq_t *)req, csr);
     }
-    else if((rnd -= ent->box_drop[BOX_TYPE_UNIT][area]) > 100) {
+    else if(type == BOX_TYPE_UNIT) {
         /* Generate a unit */
         if(pmt_random_unit_bb(ent->unit_level[area], item, rng, l))
             return 0;
@@ -3447,7 +3453,7 @@ generate_armor:
         return check_and_send_bb(c, l, item, c->cur_area,
                                  (subcmd_bb_itemreq_t *)req, csr);
     }
-    else if((rnd -= ent->box_drop[BOX_TYPE_TOOL][area]) > 100) {
+    else if(type == BOX_TYPE_TOOL) {
 generate_tool:
         /* Generate a tool */
         if(generate_tool_v3(ent, area, item, rng, l))
@@ -3456,7 +3462,7 @@ generate_tool:
         return check_and_send_bb(c, l, item, c->cur_area,
                                  (subcmd_bb_itemreq_t *)req, csr);
     }
-    else if((rnd -= ent->box_drop[BOX_TYPE_MESETA][area]) > 100) {
+    else if(type == BOX_TYPE_MESETA) {
 generate_meseta:
         /* Generate money! */
         if(generate_meseta(ent->box_meseta[area][0], ent->box_meseta[area][1],
@@ -1,6 +1,6 @@
 /*
     Sylverant Ship Server
-    Copyright (C) 2012, 2013, 2022 Lawrence Sebald
+    Copyright (C) 2012, 2013, 2022, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -21,6 +21,7 @@
 #include <stdint.h>
 
 #include "lobby.h"
+#include "ptalias.h"
 
 #ifdef PACKED
 #undef PACKED
@@ -34,6 +35,22 @@
 #define BOX_TYPE_MESETA     5
 #define BOX_TYPE_NOTHING    6
 
+/* All of the alias tables for one ItemPT entry. */
+typedef struct pt_tables {
+    pt_alias_t weapon[10];                  /* Weapon type, by area. */
+    uint8_t weapon_rank[10][12];            /* Rank, by area and type. */
+    uint8_t weapon_grind[10][12];           /* Grind pattern, by area/type. */
+    int8_t weapon_bad[10];                  /* Invalid type, by area (or -1). */
+    pt_alias_t power[4];                    /* Grind, by grind pattern. */
+    pt_alias_t percent[6];                  /* Percentage, by area pattern. */
+    pt_alias_t attachment[10];              /* Percent type, by area. */
+    pt_alias_t armor;                       /* Armor/shield slot. */
+    pt_alias_t slot;                        /* Number of unit slots. */
+    pt_alias_t tool[10];                    /* Tool type, by area. */
+    pt_alias_t tech[10];                    /* Technique, by area. */
+    pt_alias_t box[10];                     /* Box drop type, by area. */
+} pt_tables_t;
+
 /* Clean (non-packed) version of the v3 ItemPT entry structure. */
 typedef struct pt_v3_entry {
     int8_t weapon_ratio[12];                /* 0x0000 */
@@ -57,6 +74,7 @@ typedef struct pt_v3_entry {
     uint16_t box_meseta[10][2];             /* 0x08A0 */
     uint8_t box_drop[7][10];                /* 0x08C8 */
     int32_t armor_level;                    /* 0x0958 */
+    pt_tables_t tables;
 } pt_v3_entry_t;
 
 /* Clean (non-packed) version of the v2 ItemPT entry structure. */
@@ -82,6 +100,7 @@ typedef struct pt_v2_entry {
     uint16_t box_meseta[10][2];             /* 0x0800 */
     uint8_t box_drop[7][10];                /* 0x0828 */
     int32_t armor_level;                    /* 0x08B8 */
+    pt_tables_t tables;
 } pt_v2_entry_t;
 
 /* Read the ItemPT data from a v2-style (ItemPT.afs) file. */
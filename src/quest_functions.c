@@ -1,6 +1,6 @@
 /*
     Sylverant Ship Server
-    Copyright (C) 2019, 2020, 2021, 2025 Lawrence Sebald
+    Copyright (C) 2019, 2020, 2021, 2025, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -34,57 +34,57 @@
              l->block->b, l->lobby_id, c->guildcard, ##__VA_ARGS__)
 
 static uint32_t get_section_id(ship_client_t *c, lobby_t *l) {
-    if(c->q_stack[1] != 1)
+    if(c->cold->q_stack[1] != 1)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
     /* Are we requesting everyone or just one person? */
-    if(c->q_stack[3] == 0xFFFFFFFF) {
-        if(c->q_stack[2] != 4)
+    if(c->cold->q_stack[3] == 0xFFFFFFFF) {
+        if(c->cold->q_stack[2] != 4)
             return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-        if(c->q_stack[4] > 255 || c->q_stack[5] > 255 ||
-           c->q_stack[6] > 255 || c->q_stack[7] > 255)
+        if(c->cold->q_stack[4] > 255 || c->cold->q_stack[5] > 255 ||
+           c->cold->q_stack[6] > 255 || c->cold->q_stack[7] > 255)
             return QUEST_FUNC_RET_INVALID_REGISTER;
 
         if(l->clients[0])
-            send_sync_register(c, c->q_stack[4],
+            send_sync_register(c, c->cold->q_stack[4],
                                l->clients[0]->pl->v1.section);
         else
-            send_sync_register(c, c->q_stack[4], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4], 0xFFFFFFFF);
 
         if(l->clients[1])
-            send_sync_register(c, c->q_stack[5],
+            send_sync_register(c, c->cold->q_stack[5],
                                l->clients[1]->pl->v1.section);
         else
-            send_sync_register(c, c->q_stack[5], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[5], 0xFFFFFFFF);
 
         if(l->clients[2])
-            send_sync_register(c, c->q_stack[6],
+            send_sync_register(c, c->cold->q_stack[6],
                                l->clients[2]->pl->v1.section);
         else
-            send_sync_register(c, c->q_stack[6], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[6], 0xFFFFFFFF);
 
         if(l->clients[3])
-            send_sync_register(c, c->q_stack[7],
+            send_sync_register(c, c->cold->q_stack[7],
                                l->clients[3]->pl->v1.section);
         else
-            send_sync_register(c, c->q_stack[7], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[7], 0xFFFFFFFF);
 
         /* Done. */
         return QUEST_FUNC_RET_NO_ERROR;
     }
-    else if(c->q_stack[3] < 4) {
-        if(c->q_stack[2] != 1)
+    else if(c->cold->q_stack[3] < 4) {
+        if(c->cold->q_stack[2] != 1)
             return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-        if(c->q_stack[4] > 255)
+        if(c->cold->q_stack[4] > 255)
             return QUEST_FUNC_RET_INVALID_REGISTER;
 
-        if(l->clients[c->q_stack[3]])
-            send_sync_register(c, c->q_stack[4],
-                               l->clients[c->q_stack[3]]->pl->v1.section);
+        if(l->clients[c->cold->q_stack[3]])
+            send_sync_register(c, c->cold->q_stack[4],
+                               l->clients[c->cold->q_stack[3]]->pl->v1.section);
         else
-            send_sync_register(c, c->q_stack[4], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4], 0xFFFFFFFF);
 
         /* Done. */
         return QUEST_FUNC_RET_NO_ERROR;
@@ -97,94 +97,94 @@ static uint32_t get_section_id(ship_client_t *c, lobby_t *l) {
 uint32_t get_time(ship_client_t *c, lobby_t *l) {
     time_t now;
 
-    if(c->q_stack[1] != 0)
+    if(c->cold->q_stack[1] != 0)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
-    if(c->q_stack[2] != 1)
+    if(c->cold->q_stack[2] != 1)
         return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-    if(c->q_stack[3] > 255)
+    if(c->cold->q_stack[3] > 255)
         return QUEST_FUNC_RET_INVALID_REGISTER;
 
     now = time(NULL);
     LOG(l, c, "quest_function get_time: %" PRIu32 " -> r%d\n", (uint32_t)now,
-        c->q_stack[3]);
-    send_sync_register(c, c->q_stack[3], (uint32_t)now);
+        c->cold->q_stack[3]);
+    send_sync_register(c, c->cold->q_stack[3], (uint32_t)now);
     return QUEST_FUNC_RET_NO_ERROR;
 }
 
 uint32_t get_client_count(ship_client_t *c, lobby_t *l, int which) {
-    if(c->q_stack[1] != 0)
+    if(c->cold->q_stack[1] != 0)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
-    if(c->q_stack[2] != 1)
+    if(c->cold->q_stack[2] != 1)
         return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-    if(c->q_stack[3] > 255)
+    if(c->cold->q_stack[3] > 255)
         return QUEST_FUNC_RET_INVALID_REGISTER;
 
     if(which == 0)      /* Team clients */
-        send_sync_register(c, c->q_stack[3], l->num_clients);
+        send_sync_register(c, c->cold->q_stack[3], l->num_clients);
     else if(which == 1) /* Ship clients */
-        send_sync_register(c, c->q_stack[3], ship->num_clients);
+        send_sync_register(c, c->cold->q_stack[3], ship->num_clients);
     else if(which == 2) /* Block clients */
-        send_sync_register(c, c->q_stack[3], c->cur_block->num_clients);
+        send_sync_register(c, c->cold->q_stack[3], c->cur_block->num_clients);
 
     return QUEST_FUNC_RET_NO_ERROR;
 }
 
 static uint32_t get_char_class(ship_client_t *c, lobby_t *l) {
-    if(c->q_stack[1] != 1)
+    if(c->cold->q_stack[1] != 1)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
     /* Are we requesting everyone or just one person? */
-    if(c->q_stack[3] == 0xFFFFFFFF) {
-        if(c->q_stack[2] != 4)
+    if(c->cold->q_stack[3] == 0xFFFFFFFF) {
+        if(c->cold->q_stack[2] != 4)
             return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-        if(c->q_stack[4] > 255 || c->q_stack[5] > 255 ||
-           c->q_stack[6] > 255 || c->q_stack[7] > 255)
+        if(c->cold->q_stack[4] > 255 || c->cold->q_stack[5] > 255 ||
+           c->cold->q_stack[6] > 255 || c->cold->q_stack[7] > 255)
             return QUEST_FUNC_RET_INVALID_REGISTER;
 
         if(l->clients[0])
-            send_sync_register(c, c->q_stack[4],
+            send_sync_register(c, c->cold->q_stack[4],
                                l->clients[0]->pl->v1.ch_class);
         else
-            send_sync_register(c, c->q_stack[4], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4], 0xFFFFFFFF);
 
         if(l->clients[1])
-            send_sync_register(c, c->q_stack[5],
+            send_sync_register(c, c->cold->q_stack[5],
                                l->clients[1]->pl->v1.ch_class);
         else
-            send_sync_register(c, c->q_stack[5], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[5], 0xFFFFFFFF);
 
         if(l->clients[2])
-            send_sync_register(c, c->q_stack[6],
+            send_sync_register(c, c->cold->q_stack[6],
                                l->clients[2]->pl->v1.ch_class);
         else
-            send_sync_register(c, c->q_stack[6], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[6], 0xFFFFFFFF);
 
         if(l->clients[3])
-            send_sync_register(c, c->q_stack[7],
+            send_sync_register(c, c->cold->q_stack[7],
                                l->clients[3]->pl->v1.ch_class);
         else
-            send_sync_register(c, c->q_stack[7], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[7], 0xFFFFFFFF);
 
         /* Done. */
         return QUEST_FUNC_RET_NO_ERROR;
     }
-    else if(c->q_stack[3] < 4) {
-        if(c->q_stack[2] != 1)
+    else if(c->cold->q_stack[3] < 4) {
+        if(c->cold->q_stack[2] != 1)
             return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-        if(c->q_stack[4] > 255)
+        if(c->cold->q_stack[4] > 255)
             return QUEST_FUNC_RET_INVALID_REGISTER;
 
-        if(l->clients[c->q_stack[3]])
-            send_sync_register(c, c->q_stack[4],
-                               l->clients[c->q_stack[3]]->pl->v1.ch_class);
+        if(l->clients[c->cold->q_stack[3]])
+            send_sync_register(c, c->cold->q_stack[4],
+                               l->clients[c->cold->q_stack[3]]->pl->v1.ch_class);
         else
-            send_sync_register(c, c->q_stack[4], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4], 0xFFFFFFFF);
 
         /* Done. */
         return QUEST_FUNC_RET_NO_ERROR;
@@ -204,59 +204,59 @@ static int jobs[12] = { 0, 0, 0, 1, 1, 1, 2, 2, 2, 0, 2, 1 };
 #define JOB(x) ATTR((x), jobs)
 
 static uint32_t get_char_gender(ship_client_t *c, lobby_t *l) {
-    if(c->q_stack[1] != 1)
+    if(c->cold->q_stack[1] != 1)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
     /* Are we requesting everyone or just one person? */
-    if(c->q_stack[3] == 0xFFFFFFFF) {
-        if(c->q_stack[2] != 4)
+    if(c->cold->q_stack[3] == 0xFFFFFFFF) {
+        if(c->cold->q_stack[2] != 4)
             return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-        if(c->q_stack[4] > 255 || c->q_stack[5] > 255 ||
-           c->q_stack[6] > 255 || c->q_stack[7] > 255)
+        if(c->cold->q_stack[4] > 255 || c->cold->q_stack[5] > 255 ||
+           c->cold->q_stack[6] > 255 || c->cold->q_stack[7] > 255)
             return QUEST_FUNC_RET_INVALID_REGISTER;
 
         if(l->clients[0])
-            send_sync_register(c, c->q_stack[4],
+            send_sync_register(c, c->cold->q_stack[4],
                                GENDER(l->clients[0]->pl->v1.ch_class));
         else
-            send_sync_register(c, c->q_stack[4], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4], 0xFFFFFFFF);
 
         if(l->clients[1])
-            send_sync_register(c, c->q_stack[5],
+            send_sync_register(c, c->cold->q_stack[5],
                                GENDER(l->clients[1]->pl->v1.ch_class));
         else
-            send_sync_register(c, c->q_stack[5], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[5], 0xFFFFFFFF);
 
         if(l->clients[2])
-            send_sync_register(c, c->q_stack[6],
+            send_sync_register(c, c->cold->q_stack[6],
                                GENDER(l->clients[2]->pl->v1.ch_class));
         else
-            send_sync_register(c, c->q_stack[6], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[6], 0xFFFFFFFF);
 
         if(l->clients[3])
-            send_sync_register(c, c->q_stack[7],
+            send_sync_register(c, c->cold->q_stack[7],
                                GENDER(l->clients[3]->pl->v1.ch_class));
         else
-            send_sync_register(c, c->q_stack[7], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[7], 0xFFFFFFFF);
 
         /* Done. */
         return QUEST_FUNC_RET_NO_ERROR;
     }
-    else if(c->q_stack[3] < 4) {
-        int cl = c->q_stack[3];
+    else if(c->cold->q_stack[3] < 4) {
+        int cl = c->cold->q_stack[3];
 
-        if(c->q_stack[2] != 1)
+        if(c->cold->q_stack[2] != 1)
             return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-        if(c->q_stack[4] > 255)
+        if(c->cold->q_stack[4] > 255)
             return QUEST_FUNC_RET_INVALID_REGISTER;
 
         if(l->clients[cl])
-            send_sync_register(c, c->q_stack[4],
+            send_sync_register(c, c->cold->q_stack[4],
                                GENDER(l->clients[cl]->pl->v1.ch_class));
         else
-            send_sync_register(c, c->q_stack[4], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4], 0xFFFFFFFF);
 
         /* Done. */
         return QUEST_FUNC_RET_NO_ERROR;
@@ -267,59 +267,59 @@ static uint32_t get_char_gender(ship_client_t *c, lobby_t *l) {
 }
 
 static uint32_t get_char_race(ship_client_t *c, lobby_t *l) {
-    if(c->q_stack[1] != 1)
+    if(c->cold->q_stack[1] != 1)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
     /* Are we requesting everyone or just one person? */
-    if(c->q_stack[3] == 0xFFFFFFFF) {
-        if(c->q_stack[2] != 4)
+    if(c->cold->q_stack[3] == 0xFFFFFFFF) {
+        if(c->cold->q_stack[2] != 4)
             return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-        if(c->q_stack[4] > 255 || c->q_stack[5] > 255 ||
-           c->q_stack[6] > 255 || c->q_stack[7] > 255)
+        if(c->cold->q_stack[4] > 255 || c->cold->q_stack[5] > 255 ||
+           c->cold->q_stack[6] > 255 || c->cold->q_stack[7] > 255)
             return QUEST_FUNC_RET_INVALID_REGISTER;
 
         if(l->clients[0])
-            send_sync_register(c, c->q_stack[4],
+            send_sync_register(c, c->cold->q_stack[4],
                                RACE(l->clients[0]->pl->v1.ch_class));
         else
-            send_sync_register(c, c->q_stack[4], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4], 0xFFFFFFFF);
 
         if(l->clients[1])
-            send_sync_register(c, c->q_stack[5],
+            send_sync_register(c, c->cold->q_stack[5],
                                RACE(l->clients[1]->pl->v1.ch_class));
         else
-            send_sync_register(c, c->q_stack[5], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[5], 0xFFFFFFFF);
 
         if(l->clients[2])
-            send_sync_register(c, c->q_stack[6],
+            send_sync_register(c, c->cold->q_stack[6],
                                RACE(l->clients[2]->pl->v1.ch_class));
         else
-            send_sync_register(c, c->q_stack[6], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[6], 0xFFFFFFFF);
 
         if(l->clients[3])
-            send_sync_register(c, c->q_stack[7],
+            send_sync_register(c, c->cold->q_stack[7],
                                RACE(l->clients[3]->pl->v1.ch_class));
         else
-            send_sync_register(c, c->q_stack[7], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[7], 0xFFFFFFFF);
 
         /* Done. */
         return QUEST_FUNC_RET_NO_ERROR;
     }
-    else if(c->q_stack[3] < 4) {
-        int cl = c->q_stack[3];
+    else if(c->cold->q_stack[3] < 4) {
+        int cl = c->cold->q_stack[3];
 
-        if(c->q_stack[2] != 1)
+        if(c->cold->q_stack[2] != 1)
             return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-        if(c->q_stack[4] > 255)
+        if(c->cold->q_stack[4] > 255)
             return QUEST_FUNC_RET_INVALID_REGISTER;
 
         if(l->clients[cl])
-            send_sync_register(c, c->q_stack[4],
+            send_sync_register(c, c->cold->q_stack[4],
                                RACE(l->clients[cl]->pl->v1.ch_class));
         else
-            send_sync_register(c, c->q_stack[4], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4], 0xFFFFFFFF);
 
         /* Done. */
         return QUEST_FUNC_RET_NO_ERROR;
@@ -330,59 +330,59 @@ static uint32_t get_char_race(ship_client_t *c, lobby_t *l) {
 }
 
 static uint32_t get_char_job(ship_client_t *c, lobby_t *l) {
-    if(c->q_stack[1] != 1)
+    if(c->cold->q_stack[1] != 1)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
     /* Are we requesting everyone or just one person? */
-    if(c->q_stack[3] == 0xFFFFFFFF) {
-        if(c->q_stack[2] != 4)
+    if(c->cold->q_stack[3] == 0xFFFFFFFF) {
+        if(c->cold->q_stack[2] != 4)
             return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-        if(c->q_stack[4] > 255 || c->q_stack[5] > 255 ||
-           c->q_stack[6] > 255 || c->q_stack[7] > 255)
+        if(c->cold->q_stack[4] > 255 || c->cold->q_stack[5] > 255 ||
+           c->cold->q_stack[6] > 255 || c->cold->q_stack[7] > 255)
             return QUEST_FUNC_RET_INVALID_REGISTER;
 
         if(l->clients[0])
-            send_sync_register(c, c->q_stack[4],
+            send_sync_register(c, c->cold->q_stack[4],
                                JOB(l->clients[0]->pl->v1.ch_class));
         else
-            send_sync_register(c, c->q_stack[4], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4], 0xFFFFFFFF);
 
         if(l->clients[1])
-            send_sync_register(c, c->q_stack[5],
+            send_sync_register(c, c->cold->q_stack[5],
                                JOB(l->clients[1]->pl->v1.ch_class));
         else
-            send_sync_register(c, c->q_stack[5], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[5], 0xFFFFFFFF);
 
         if(l->clients[2])
-            send_sync_register(c, c->q_stack[6],
+            send_sync_register(c, c->cold->q_stack[6],
                                JOB(l->clients[2]->pl->v1.ch_class));
         else
-            send_sync_register(c, c->q_stack[6], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[6], 0xFFFFFFFF);
 
         if(l->clients[3])
-            send_sync_register(c, c->q_stack[7],
+            send_sync_register(c, c->cold->q_stack[7],
                                JOB(l->clients[3]->pl->v1.ch_class));
         else
-            send_sync_register(c, c->q_stack[7], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[7], 0xFFFFFFFF);
 
         /* Done. */
         return QUEST_FUNC_RET_NO_ERROR;
     }
-    else if(c->q_stack[3] < 4) {
-        int cl = c->q_stack[3];
+    else if(c->cold->q_stack[3] < 4) {
+        int cl = c->cold->q_stack[3];
 
-        if(c->q_stack[2] != 1)
+        if(c->cold->q_stack[2] != 1)
             return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-        if(c->q_stack[4] > 255)
+        if(c->cold->q_stack[4] > 255)
             return QUEST_FUNC_RET_INVALID_REGISTER;
 
         if(l->clients[cl])
-            send_sync_register(c, c->q_stack[4],
+            send_sync_register(c, c->cold->q_stack[4],
                                JOB(l->clients[cl]->pl->v1.ch_class));
         else
-            send_sync_register(c, c->q_stack[4], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4], 0xFFFFFFFF);
 
         /* Done. */
         return QUEST_FUNC_RET_NO_ERROR;
@@ -393,54 +393,54 @@ static uint32_t get_char_job(ship_client_t *c, lobby_t *l) {
 }
 
 static uint32_t get_client_floor(ship_client_t *c, lobby_t *l) {
-    if(c->q_stack[1] != 1)
+    if(c->cold->q_stack[1] != 1)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
     /* Are we requesting everyone or just one person? */
-    if(c->q_stack[3] == 0xFFFFFFFF) {
-        if(c->q_stack[2] != 4)
+    if(c->cold->q_stack[3] == 0xFFFFFFFF) {
+        if(c->cold->q_stack[2] != 4)
             return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-        if(c->q_stack[4] > 255 || c->q_stack[5] > 255 ||
-           c->q_stack[6] > 255 || c->q_stack[7] > 255)
+        if(c->cold->q_stack[4] > 255 || c->cold->q_stack[5] > 255 ||
+           c->cold->q_stack[6] > 255 || c->cold->q_stack[7] > 255)
             return QUEST_FUNC_RET_INVALID_REGISTER;
 
         if(l->clients[0])
-            send_sync_register(c, c->q_stack[4], l->clients[0]->cur_area);
+            send_sync_register(c, c->cold->q_stack[4], l->clients[0]->cur_area);
         else
-            send_sync_register(c, c->q_stack[4], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4], 0xFFFFFFFF);
 
         if(l->clients[1])
-            send_sync_register(c, c->q_stack[5], l->clients[1]->cur_area);
+            send_sync_register(c, c->cold->q_stack[5], l->clients[1]->cur_area);
         else
-            send_sync_register(c, c->q_stack[5], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[5], 0xFFFFFFFF);
 
         if(l->clients[2])
-            send_sync_register(c, c->q_stack[6], l->clients[2]->cur_area);
+            send_sync_register(c, c->cold->q_stack[6], l->clients[2]->cur_area);
         else
-            send_sync_register(c, c->q_stack[6], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[6], 0xFFFFFFFF);
 
         if(l->clients[3])
-            send_sync_register(c, c->q_stack[7], l->clients[3]->cur_area);
+            send_sync_register(c, c->cold->q_stack[7], l->clients[3]->cur_area);
         else
-            send_sync_register(c, c->q_stack[7], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[7], 0xFFFFFFFF);
 
         /* Done. */
         return QUEST_FUNC_RET_NO_ERROR;
     }
-    else if(c->q_stack[3] < 4) {
-        int cl = c->q_stack[3];
+    else if(c->cold->q_stack[3] < 4) {
+        int cl = c->cold->q_stack[3];
 
-        if(c->q_stack[2] != 1)
+        if(c->cold->q_stack[2] != 1)
             return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-        if(c->q_stack[4] > 255)
+        if(c->cold->q_stack[4] > 255)
             return QUEST_FUNC_RET_INVALID_REGISTER;
 
         if(l->clients[cl])
-            send_sync_register(c, c->q_stack[4], l->clients[cl]->cur_area);
+            send_sync_register(c, c->cold->q_stack[4], l->clients[cl]->cur_area);
         else
-            send_sync_register(c, c->q_stack[4], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4], 0xFFFFFFFF);
 
         /* Done. */
         return QUEST_FUNC_RET_NO_ERROR;
@@ -451,93 +451,93 @@ static uint32_t get_client_floor(ship_client_t *c, lobby_t *l) {
 }
 
 static uint32_t get_client_position(ship_client_t *c, lobby_t *l) {
-    if(c->q_stack[1] != 1)
+    if(c->cold->q_stack[1] != 1)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
     /* Are we requesting everyone or just one person? */
-    if(c->q_stack[3] == 0xFFFFFFFF) {
-        if(c->q_stack[2] != 4)
+    if(c->cold->q_stack[3] == 0xFFFFFFFF) {
+        if(c->cold->q_stack[2] != 4)
             return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-        if(c->q_stack[4] > 255 || c->q_stack[5] > 255 ||
-           c->q_stack[6] > 255 || c->q_stack[7] > 255)
+        if(c->cold->q_stack[4] > 255 || c->cold->q_stack[5] > 255 ||
+           c->cold->q_stack[6] > 255 || c->cold->q_stack[7] > 255)
             return QUEST_FUNC_RET_INVALID_REGISTER;
 
         if(l->clients[0]) {
-            send_sync_register(c, c->q_stack[4], (uint32_t)l->clients[0]->x);
-            send_sync_register(c, c->q_stack[4] + 1,
+            send_sync_register(c, c->cold->q_stack[4], (uint32_t)l->clients[0]->x);
+            send_sync_register(c, c->cold->q_stack[4] + 1,
                                (uint32_t)l->clients[0]->y);
-            send_sync_register(c, c->q_stack[4] + 2,
+            send_sync_register(c, c->cold->q_stack[4] + 2,
                                (uint32_t)l->clients[0]->z);
         }
         else {
-            send_sync_register(c, c->q_stack[4], 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[4] + 1, 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[4] + 2, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4] + 1, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4] + 2, 0xFFFFFFFF);
         }
 
         if(l->clients[1]) {
-            send_sync_register(c, c->q_stack[5], (uint32_t)l->clients[1]->x);
-            send_sync_register(c, c->q_stack[5] + 1,
+            send_sync_register(c, c->cold->q_stack[5], (uint32_t)l->clients[1]->x);
+            send_sync_register(c, c->cold->q_stack[5] + 1,
                                (uint32_t)l->clients[1]->y);
-            send_sync_register(c, c->q_stack[5] + 2,
+            send_sync_register(c, c->cold->q_stack[5] + 2,
                                (uint32_t)l->clients[1]->z);
         }
         else {
-            send_sync_register(c, c->q_stack[5], 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[5] + 1, 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[5] + 2, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[5], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[5] + 1, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[5] + 2, 0xFFFFFFFF);
         }
 
         if(l->clients[2]) {
-            send_sync_register(c, c->q_stack[6], (uint32_t)l->clients[2]->x);
-            send_sync_register(c, c->q_stack[6] + 1,
+            send_sync_register(c, c->cold->q_stack[6], (uint32_t)l->clients[2]->x);
+            send_sync_register(c, c->cold->q_stack[6] + 1,
                                (uint32_t)l->clients[2]->y);
-            send_sync_register(c, c->q_stack[6] + 2,
+            send_sync_register(c, c->cold->q_stack[6] + 2,
                                (uint32_t)l->clients[2]->z);
         }
         else {
-            send_sync_register(c, c->q_stack[6], 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[6] + 1, 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[6] + 2, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[6], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[6] + 1, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[6] + 2, 0xFFFFFFFF);
         }
 
         if(l->clients[3]) {
-            send_sync_register(c, c->q_stack[7], (uint32_t)l->clients[3]->x);
-            send_sync_register(c, c->q_stack[7] + 1,
+            send_sync_register(c, c->cold->q_stack[7], (uint32_t)l->clients[3]->x);
+            send_sync_register(c, c->cold->q_stack[7] + 1,
                                (uint32_t)l->clients[3]->y);
-            send_sync_register(c, c->q_stack[7] + 2,
+            send_sync_register(c, c->cold->q_stack[7] + 2,
                                (uint32_t)l->clients[3]->z);
         }
         else {
-            send_sync_register(c, c->q_stack[7], 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[7] + 1, 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[7] + 2, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[7], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[7] + 1, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[7] + 2, 0xFFFFFFFF);
         }
 
         /* Done. */
         return QUEST_FUNC_RET_NO_ERROR;
     }
-    else if(c->q_stack[3] < 4) {
-        int cl = c->q_stack[3];
+    else if(c->cold->q_stack[3] < 4) {
+        int cl = c->cold->q_stack[3];
 
-        if(c->q_stack[2] != 1)
+        if(c->cold->q_stack[2] != 1)
             return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-        if(c->q_stack[4] > 255)
+        if(c->cold->q_stack[4] > 255)
             return QUEST_FUNC_RET_INVALID_REGISTER;
 
         if(l->clients[cl]) {
-            send_sync_register(c, c->q_stack[4], (uint32_t)l->clients[cl]->x);
-            send_sync_register(c, c->q_stack[4] + 1,
+            send_sync_register(c, c->cold->q_stack[4], (uint32_t)l->clients[cl]->x);
+            send_sync_register(c, c->cold->q_stack[4] + 1,
                                (uint32_t)l->clients[cl]->y);
-            send_sync_register(c, c->q_stack[4] + 2,
+            send_sync_register(c, c->cold->q_stack[4] + 2,
                                (uint32_t)l->clients[cl]->z);
         }
         else {
-            send_sync_register(c, c->q_stack[4], 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[4] + 1, 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[4] + 2, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4] + 1, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4] + 2, 0xFFFFFFFF);
         }
 
         /* Done. */
@@ -551,44 +551,44 @@ static uint32_t get_client_position(ship_client_t *c, lobby_t *l) {
 static uint32_t get_random_integer(ship_client_t *c, lobby_t *l) {
     uint32_t min, max, rnd;
 
-    if(c->q_stack[1] != 2)
+    if(c->cold->q_stack[1] != 2)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
-    if(c->q_stack[2] != 1)
+    if(c->cold->q_stack[2] != 1)
         return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-    if(c->q_stack[5] > 255)
+    if(c->cold->q_stack[5] > 255)
         return QUEST_FUNC_RET_INVALID_REGISTER;
 
-    min = c->q_stack[3];
-    max = c->q_stack[4];
+    min = c->cold->q_stack[3];
+    max = c->cold->q_stack[4];
 
     if(min >= max)
         return QUEST_FUNC_RET_INVALID_ARG;
 
     max -= min;
 
-    rnd = (uint32_t)(mt19937_genrand_int32(&l->block->rng) %
+    rnd = (uint32_t)(mtrand_int32(block_rng(l->block)) %
                      ((uint64_t)max + 1) + min);
 
     LOG(l, c, "quest_function get_random_integer: %" PRIu32 " -> r%d\n", rnd,
-        c->q_stack[3]);
-    send_sync_register(c, c->q_stack[5], rnd);
+        c->cold->q_stack[3]);
+    send_sync_register(c, c->cold->q_stack[5], rnd);
     return QUEST_FUNC_RET_NO_ERROR;
 }
 
 static uint32_t get_quest_sflag(ship_client_t *c, lobby_t *l) {
-    if(c->q_stack[1] != 1)
+    if(c->cold->q_stack[1] != 1)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
-    if(c->q_stack[2] != 1)
+    if(c->cold->q_stack[2] != 1)
         return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-    if(c->q_stack[4] > 255)
+    if(c->cold->q_stack[4] > 255)
         return QUEST_FUNC_RET_INVALID_REGISTER;
 
     /* Send the request to the shipgate... */
-    if(shipgate_send_qflag(&ship->sg, c, 0, c->q_stack[3], l->qid, 0, 0))
+    if(shipgate_send_qflag(&ship->sg, c, 0, c->cold->q_stack[3], l->qid, 0, 0))
         return QUEST_FUNC_RET_SHIPGATE_ERR;
 
     /* Set the lock and make sure that we don't return to the client yet. */
@@ -597,21 +597,21 @@ static uint32_t get_quest_sflag(ship_client_t *c, lobby_t *l) {
 }
 
 static uint32_t set_quest_sflag(ship_client_t *c, lobby_t *l) {
-    if(c->q_stack[1] != 2)
+    if(c->cold->q_stack[1] != 2)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
-    if(c->q_stack[2] != 1)
+    if(c->cold->q_stack[2] != 1)
         return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-    if(c->q_stack[4] & 0xFFFF0000)
+    if(c->cold->q_stack[4] & 0xFFFF0000)
         return QUEST_FUNC_RET_INVALID_ARG;
 
-    if(c->q_stack[5] > 255)
+    if(c->cold->q_stack[5] > 255)
         return QUEST_FUNC_RET_INVALID_REGISTER;
 
     /* Send the request to the shipgate... */
-    if(shipgate_send_qflag(&ship->sg, c, 1, c->q_stack[3], l->qid,
-                           c->q_stack[4], 0))
+    if(shipgate_send_qflag(&ship->sg, c, 1, c->cold->q_stack[3], l->qid,
+                           c->cold->q_stack[4], 0))
         return QUEST_FUNC_RET_SHIPGATE_ERR;
 
     /* Set the lock and make sure that we don't return to the client yet. */
@@ -620,17 +620,17 @@ static uint32_t set_quest_sflag(ship_client_t *c, lobby_t *l) {
 }
 
 static uint32_t get_quest_lflag(ship_client_t *c, lobby_t *l) {
-    if(c->q_stack[1] != 1)
+    if(c->cold->q_stack[1] != 1)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
-    if(c->q_stack[2] != 1)
+    if(c->cold->q_stack[2] != 1)
         return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-    if(c->q_stack[4] > 255)
+    if(c->cold->q_stack[4] > 255)
         return QUEST_FUNC_RET_INVALID_REGISTER;
 
     /* Send the request to the shipgate... */
-    if(shipgate_send_qflag(&ship->sg, c, 0, c->q_stack[3], l->qid, 0,
+    if(shipgate_send_qflag(&ship->sg, c, 0, c->cold->q_stack[3], l->qid, 0,
                            QFLAG_LONG_FLAG))
         return QUEST_FUNC_RET_SHIPGATE_ERR;
 
@@ -640,18 +640,18 @@ static uint32_t get_quest_lflag(ship_client_t *c, lobby_t *l) {
 }
 
 static uint32_t set_quest_lflag(ship_client_t *c, lobby_t *l) {
-    if(c->q_stack[1] != 2)
+    if(c->cold->q_stack[1] != 2)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
-    if(c->q_stack[2] != 1)
+    if(c->cold->q_stack[2] != 1)
         return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-    if(c->q_stack[5] > 255)
+    if(c->cold->q_stack[5] > 255)
         return QUEST_FUNC_RET_INVALID_REGISTER;
 
     /* Send the request to the shipgate... */
-    if(shipgate_send_qflag(&ship->sg, c, 1, c->q_stack[3], l->qid,
-                           c->q_stack[4], QFLAG_LONG_FLAG))
+    if(shipgate_send_qflag(&ship->sg, c, 1, c->cold->q_stack[3], l->qid,
+                           c->cold->q_stack[4], QFLAG_LONG_FLAG))
         return QUEST_FUNC_RET_SHIPGATE_ERR;
 
     /* Set the lock and make sure that we don't return to the client yet. */
@@ -660,21 +660,21 @@ static uint32_t set_quest_lflag(ship_client_t *c, lobby_t *l) {
 }
 
 static uint32_t del_quest_sflag(ship_client_t *c, lobby_t *l) {
-    if(c->q_stack[1] != 1)
+    if(c->cold->q_stack[1] != 1)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
-    if(c->q_stack[2] != 1)
+    if(c->cold->q_stack[2] != 1)
         return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-    if(c->q_stack[3] > 255)
+    if(c->cold->q_stack[3] > 255)
         return QUEST_FUNC_RET_INVALID_ARG;
 
-    if(c->q_stack[5] > 255)
+    if(c->cold->q_stack[5] > 255)
         return QUEST_FUNC_RET_INVALID_REGISTER;
 
     /* Send the request to the shipgate... */
-    if(shipgate_send_qflag(&ship->sg, c, 1, c->q_stack[3], l->qid,
-                           c->q_stack[4], QFLAG_DELETE_FLAG))
+    if(shipgate_send_qflag(&ship->sg, c, 1, c->cold->q_stack[3], l->qid,
+                           c->cold->q_stack[4], QFLAG_DELETE_FLAG))
         return QUEST_FUNC_RET_SHIPGATE_ERR;
 
     /* Set the lock and make sure that we don't return to the client yet. */
@@ -683,21 +683,21 @@ static uint32_t del_quest_sflag(ship_client_t *c, lobby_t *l) {
 }
 
 static uint32_t del_quest_lflag(ship_client_t *c, lobby_t *l) {
-    if(c->q_stack[1] != 1)
+    if(c->cold->q_stack[1] != 1)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
-    if(c->q_stack[2] != 1)
+    if(c->cold->q_stack[2] != 1)
         return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-    if(c->q_stack[3] > 255)
+    if(c->cold->q_stack[3] > 255)
         return QUEST_FUNC_RET_INVALID_ARG;
 
-    if(c->q_stack[5] > 255)
+    if(c->cold->q_stack[5] > 255)
         return QUEST_FUNC_RET_INVALID_REGISTER;
 
     /* Send the request to the shipgate... */
-    if(shipgate_send_qflag(&ship->sg, c, 1, c->q_stack[3], l->qid,
-                           c->q_stack[4], QFLAG_LONG_FLAG | QFLAG_DELETE_FLAG))
+    if(shipgate_send_qflag(&ship->sg, c, 1, c->cold->q_stack[3], l->qid,
+                           c->cold->q_stack[4], QFLAG_LONG_FLAG | QFLAG_DELETE_FLAG))
         return QUEST_FUNC_RET_SHIPGATE_ERR;
 
     /* Set the lock and make sure that we don't return to the client yet. */
@@ -710,35 +710,35 @@ static uint32_t word_censor_check(ship_client_t *c, lobby_t *l, int sr) {
     uint32_t i;
     int rv;
 
-    if(c->q_stack[1] < 1 || c->q_stack[1] > 24)
+    if(c->cold->q_stack[1] < 1 || c->cold->q_stack[1] > 24)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
-    if(c->q_stack[2] != 1)
+    if(c->cold->q_stack[2] != 1)
         return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-    if(c->q_stack[c->q_stack[1] + 3] > 255)
+    if(c->cold->q_stack[c->cold->q_stack[1] + 3] > 255)
         return QUEST_FUNC_RET_INVALID_REGISTER;
 
     /* Read in the string... */
     if(!sr) {
-        for(i = 0; i < c->q_stack[1]; ++i) {
-            if(c->q_stack[i + 3] > 127)
+        for(i = 0; i < c->cold->q_stack[1]; ++i) {
+            if(c->cold->q_stack[i + 3] > 127)
                 return QUEST_FUNC_RET_INVALID_ARG;
 
-            str[i] = (char)c->q_stack[i + 3];
+            str[i] = (char)c->cold->q_stack[i + 3];
         }
     }
     else {
-        for(i = 0; i < c->q_stack[1]; ++i) {
-            if(c->q_stack[i + 3] > 26)
+        for(i = 0; i < c->cold->q_stack[1]; ++i) {
+            if(c->cold->q_stack[i + 3] > 26)
                 return QUEST_FUNC_RET_INVALID_ARG;
 
-            if(c->q_stack[i + 3] == 0) {
+            if(c->cold->q_stack[i + 3] == 0) {
                 str[i] = 0;
                 break;
             }
 
-            str[i] = (char)(c->q_stack[i + 3] + 64);
+            str[i] = (char)(c->cold->q_stack[i + 3] + 64);
         }
     }
 
@@ -746,137 +746,137 @@ static uint32_t word_censor_check(ship_client_t *c, lobby_t *l, int sr) {
 
     /* Check it against the censor. */
     rv = smutdata_check_string(str, SMUTDATA_WEST);
-    send_sync_register(c, c->q_stack[c->q_stack[1] + 3], (uint32_t)rv);
+    send_sync_register(c, c->cold->q_stack[c->cold->q_stack[1] + 3], (uint32_t)rv);
 
     return QUEST_FUNC_RET_NO_ERROR;
 }
 
 static uint32_t get_team_seed(ship_client_t *c, lobby_t *l) {
-    if(c->q_stack[1] != 0)
+    if(c->cold->q_stack[1] != 0)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
-    if(c->q_stack[2] != 1)
+    if(c->cold->q_stack[2] != 1)
         return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-    if(c->q_stack[3] > 255)
+    if(c->cold->q_stack[3] > 255)
         return QUEST_FUNC_RET_INVALID_REGISTER;
 
     LOG(l, c, "quest_function get_team_seed: %" PRIu32 " -> r%d\n",
-        l->rand_seed, c->q_stack[3]);
-    send_sync_register(c, c->q_stack[3], l->rand_seed);
+        l->rand_seed, c->cold->q_stack[3]);
+    send_sync_register(c, c->cold->q_stack[3], l->rand_seed);
     return QUEST_FUNC_RET_NO_ERROR;
 }
 
 static uint32_t get_pos_updates(ship_client_t *c, lobby_t *l) {
-    if(c->q_stack[1] != 1)
+    if(c->cold->q_stack[1] != 1)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
     /* Are we requesting everyone or just one person? */
-    if(c->q_stack[3] == 0xFFFFFFFF) {
-        if(c->q_stack[2] != 4)
+    if(c->cold->q_stack[3] == 0xFFFFFFFF) {
+        if(c->cold->q_stack[2] != 4)
             return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-        if(c->q_stack[4] > 255 || c->q_stack[5] > 255 ||
-           c->q_stack[6] > 255 || c->q_stack[7] > 255)
+        if(c->cold->q_stack[4] > 255 || c->cold->q_stack[5] > 255 ||
+           c->cold->q_stack[6] > 255 || c->cold->q_stack[7] > 255)
             return QUEST_FUNC_RET_INVALID_REGISTER;
 
-        l->qpos_regs[0][c->client_id] = c->q_stack[4];
-        l->qpos_regs[1][c->client_id] = c->q_stack[5];
-        l->qpos_regs[2][c->client_id] = c->q_stack[6];
-        l->qpos_regs[3][c->client_id] = c->q_stack[7];
+        l->qpos_regs[0][c->client_id] = c->cold->q_stack[4];
+        l->qpos_regs[1][c->client_id] = c->cold->q_stack[5];
+        l->qpos_regs[2][c->client_id] = c->cold->q_stack[6];
+        l->qpos_regs[3][c->client_id] = c->cold->q_stack[7];
 
         if(l->clients[0]) {
-            send_sync_register(c, c->q_stack[4], (uint32_t)l->clients[0]->x);
-            send_sync_register(c, c->q_stack[4] + 1,
+            send_sync_register(c, c->cold->q_stack[4], (uint32_t)l->clients[0]->x);
+            send_sync_register(c, c->cold->q_stack[4] + 1,
                                (uint32_t)l->clients[0]->y);
-            send_sync_register(c, c->q_stack[4] + 2,
+            send_sync_register(c, c->cold->q_stack[4] + 2,
                                (uint32_t)l->clients[0]->z);
-            send_sync_register(c, c->q_stack[4] + 3,
+            send_sync_register(c, c->cold->q_stack[4] + 3,
                                (uint32_t)l->clients[0]->cur_area);
         }
         else {
-            send_sync_register(c, c->q_stack[4], 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[4] + 1, 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[4] + 2, 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[4] + 3, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4] + 1, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4] + 2, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4] + 3, 0xFFFFFFFF);
         }
 
         if(l->clients[1]) {
-            send_sync_register(c, c->q_stack[5], (uint32_t)l->clients[1]->x);
-            send_sync_register(c, c->q_stack[5] + 1,
+            send_sync_register(c, c->cold->q_stack[5], (uint32_t)l->clients[1]->x);
+            send_sync_register(c, c->cold->q_stack[5] + 1,
                                (uint32_t)l->clients[1]->y);
-            send_sync_register(c, c->q_stack[5] + 2,
+            send_sync_register(c, c->cold->q_stack[5] + 2,
                                (uint32_t)l->clients[1]->z);
-            send_sync_register(c, c->q_stack[5] + 3,
+            send_sync_register(c, c->cold->q_stack[5] + 3,
                                (uint32_t)l->clients[1]->cur_area);
         }
         else {
-            send_sync_register(c, c->q_stack[5], 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[5] + 1, 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[5] + 2, 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[5] + 3, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[5], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[5] + 1, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[5] + 2, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[5] + 3, 0xFFFFFFFF);
         }
 
         if(l->clients[2]) {
-            send_sync_register(c, c->q_stack[6], (uint32_t)l->clients[2]->x);
-            send_sync_register(c, c->q_stack[6] + 1,
+            send_sync_register(c, c->cold->q_stack[6], (uint32_t)l->clients[2]->x);
+            send_sync_register(c, c->cold->q_stack[6] + 1,
                                (uint32_t)l->clients[2]->y);
-            send_sync_register(c, c->q_stack[6] + 2,
+            send_sync_register(c, c->cold->q_stack[6] + 2,
                                (uint32_t)l->clients[2]->z);
-            send_sync_register(c, c->q_stack[6] + 3,
+            send_sync_register(c, c->cold->q_stack[6] + 3,
                                (uint32_t)l->clients[2]->cur_area);
         }
         else {
-            send_sync_register(c, c->q_stack[6], 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[6] + 1, 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[6] + 2, 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[6] + 3, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[6], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[6] + 1, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[6] + 2, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[6] + 3, 0xFFFFFFFF);
         }
 
         if(l->clients[3]) {
-            send_sync_register(c, c->q_stack[7], (uint32_t)l->clients[3]->x);
-            send_sync_register(c, c->q_stack[7] + 1,
+            send_sync_register(c, c->cold->q_stack[7], (uint32_t)l->clients[3]->x);
+            send_sync_register(c, c->cold->q_stack[7] + 1,
                                (uint32_t)l->clients[3]->y);
-            send_sync_register(c, c->q_stack[7] + 2,
+            send_sync_register(c, c->cold->q_stack[7] + 2,
                                (uint32_t)l->clients[3]->z);
-            send_sync_register(c, c->q_stack[7] + 3,
+            send_sync_register(c, c->cold->q_stack[7] + 3,
                                (uint32_t)l->clients[3]->cur_area);
         }
         else {
-            send_sync_register(c, c->q_stack[7], 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[7] + 1, 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[7] + 2, 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[7] + 3, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[7], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[7] + 1, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[7] + 2, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[7] + 3, 0xFFFFFFFF);
         }
 
         /* Done. */
         return QUEST_FUNC_RET_NO_ERROR;
     }
-    else if(c->q_stack[3] < 4) {
-        int cl = c->q_stack[3];
+    else if(c->cold->q_stack[3] < 4) {
+        int cl = c->cold->q_stack[3];
 
-        if(c->q_stack[2] != 1)
+        if(c->cold->q_stack[2] != 1)
             return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-        if(c->q_stack[4] > 255)
+        if(c->cold->q_stack[4] > 255)
             return QUEST_FUNC_RET_INVALID_REGISTER;
 
-        l->qpos_regs[cl][c->client_id] = c->q_stack[4];
+        l->qpos_regs[cl][c->client_id] = c->cold->q_stack[4];
 
         if(l->clients[cl]) {
-            send_sync_register(c, c->q_stack[4], (uint32_t)l->clients[cl]->x);
-            send_sync_register(c, c->q_stack[4] + 1,
+            send_sync_register(c, c->cold->q_stack[4], (uint32_t)l->clients[cl]->x);
+            send_sync_register(c, c->cold->q_stack[4] + 1,
                                (uint32_t)l->clients[cl]->y);
-            send_sync_register(c, c->q_stack[4] + 2,
+            send_sync_register(c, c->cold->q_stack[4] + 2,
                                (uint32_t)l->clients[cl]->z);
-            send_sync_register(c, c->q_stack[4] + 3,
+            send_sync_register(c, c->cold->q_stack[4] + 3,
                                (uint32_t)l->clients[cl]->cur_area);
         }
         else {
-            send_sync_register(c, c->q_stack[4], 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[4] + 1, 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[4] + 2, 0xFFFFFFFF);
-            send_sync_register(c, c->q_stack[4] + 3, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4] + 1, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4] + 2, 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4] + 3, 0xFFFFFFFF);
         }
 
         /* Done. */
@@ -888,57 +888,57 @@ static uint32_t get_pos_updates(ship_client_t *c, lobby_t *l) {
 }
 
 static uint32_t get_level(ship_client_t *c, lobby_t *l) {
-    if(c->q_stack[1] != 1)
+    if(c->cold->q_stack[1] != 1)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
     /* Are we requesting everyone or just one person? */
-    if(c->q_stack[3] == 0xFFFFFFFF) {
-        if(c->q_stack[2] != 4)
+    if(c->cold->q_stack[3] == 0xFFFFFFFF) {
+        if(c->cold->q_stack[2] != 4)
             return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-        if(c->q_stack[4] > 255 || c->q_stack[5] > 255 ||
-           c->q_stack[6] > 255 || c->q_stack[7] > 255)
+        if(c->cold->q_stack[4] > 255 || c->cold->q_stack[5] > 255 ||
+           c->cold->q_stack[6] > 255 || c->cold->q_stack[7] > 255)
             return QUEST_FUNC_RET_INVALID_REGISTER;
 
         if(l->clients[0])
-            send_sync_register(c, c->q_stack[4],
+            send_sync_register(c, c->cold->q_stack[4],
                                l->clients[0]->pl->v1.level + 1);
         else
-            send_sync_register(c, c->q_stack[4], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4], 0xFFFFFFFF);
 
         if(l->clients[1])
-            send_sync_register(c, c->q_stack[5],
+            send_sync_register(c, c->cold->q_stack[5],
                                l->clients[1]->pl->v1.level + 1);
         else
-            send_sync_register(c, c->q_stack[5], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[5], 0xFFFFFFFF);
 
         if(l->clients[2])
-            send_sync_register(c, c->q_stack[6],
+            send_sync_register(c, c->cold->q_stack[6],
                                l->clients[2]->pl->v1.level + 1);
         else
-            send_sync_register(c, c->q_stack[6], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[6], 0xFFFFFFFF);
 
         if(l->clients[3])
-            send_sync_register(c, c->q_stack[7],
+            send_sync_register(c, c->cold->q_stack[7],
                                l->clients[3]->pl->v1.level + 1);
         else
-            send_sync_register(c, c->q_stack[7], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[7], 0xFFFFFFFF);
 
         /* Done. */
         return QUEST_FUNC_RET_NO_ERROR;
     }
-    else if(c->q_stack[3] < 4) {
-        if(c->q_stack[2] != 1)
+    else if(c->cold->q_stack[3] < 4) {
+        if(c->cold->q_stack[2] != 1)
             return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-        if(c->q_stack[4] > 255)
+        if(c->cold->q_stack[4] > 255)
             return QUEST_FUNC_RET_INVALID_REGISTER;
 
-        if(l->clients[c->q_stack[3]])
-            send_sync_register(c, c->q_stack[4],
-                               l->clients[c->q_stack[3]]->pl->v1.level + 1);
+        if(l->clients[c->cold->q_stack[3]])
+            send_sync_register(c, c->cold->q_stack[4],
+                               l->clients[c->cold->q_stack[3]]->pl->v1.level + 1);
         else
-            send_sync_register(c, c->q_stack[4], 0xFFFFFFFF);
+            send_sync_register(c, c->cold->q_stack[4], 0xFFFFFFFF);
 
         /* Done. */
         return QUEST_FUNC_RET_NO_ERROR;
@@ -952,13 +952,13 @@ static uint32_t get_ship_name(ship_client_t *c, lobby_t *l) {
     uint32_t tmp;
     uint8_t tmpname[12] = { 0 };
 
-    if(c->q_stack[1] != 0)
+    if(c->cold->q_stack[1] != 0)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
-    if(c->q_stack[2] != 1)
+    if(c->cold->q_stack[2] != 1)
         return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-    if(c->q_stack[3] > 253)
+    if(c->cold->q_stack[3] > 253)
         return QUEST_FUNC_RET_INVALID_REGISTER;
 
     if(strlen(ship->cfg->name) < 12)
@@ -969,15 +969,15 @@ static uint32_t get_ship_name(ship_client_t *c, lobby_t *l) {
     /* Send the ship's name in 3 registers... */
     tmp = tmpname[0] | ((tmpname[1]) << 8) | (tmpname[2] << 16) |
           (tmpname[3] << 24);
-    send_sync_register(c, c->q_stack[3], LE32(tmp));
+    send_sync_register(c, c->cold->q_stack[3], LE32(tmp));
 
     tmp = tmpname[4] | (tmpname[5] << 8) | (tmpname[6] << 16) |
           (tmpname[7] << 24);
-    send_sync_register(c, c->q_stack[3] + 1, LE32(tmp));
+    send_sync_register(c, c->cold->q_stack[3] + 1, LE32(tmp));
 
     tmp = tmpname[8] | (tmpname[9] << 8) | (tmpname[10] << 16) |
           (tmpname[11] << 24);
-    send_sync_register(c, c->q_stack[3] + 2, LE32(tmp));
+    send_sync_register(c, c->cold->q_stack[3] + 2, LE32(tmp));
 
     return QUEST_FUNC_RET_NO_ERROR;
 }
@@ -986,13 +986,13 @@ static uint32_t get_ship_name_utf16(ship_client_t *c, lobby_t *l) {
     uint32_t tmp;
     uint8_t tmpname[12] = { 0 };
 
-    if(c->q_stack[1] != 0)
+    if(c->cold->q_stack[1] != 0)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
-    if(c->q_stack[2] != 1)
+    if(c->cold->q_stack[2] != 1)
         return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-    if(c->q_stack[3] > 250)
+    if(c->cold->q_stack[3] > 250)
         return QUEST_FUNC_RET_INVALID_REGISTER;
 
     if(strlen(ship->cfg->name) < 12)
@@ -1002,58 +1002,58 @@ static uint32_t get_ship_name_utf16(ship_client_t *c, lobby_t *l) {
 
     /* Send the ship's name in 6 registers... */
     tmp = tmpname[0] | (tmpname[1] << 16);
-    send_sync_register(c, c->q_stack[3], LE32(tmp));
+    send_sync_register(c, c->cold->q_stack[3], LE32(tmp));
 
     tmp = tmpname[2] | (tmpname[3] << 16);
-    send_sync_register(c, c->q_stack[3] + 1, LE32(tmp));
+    send_sync_register(c, c->cold->q_stack[3] + 1, LE32(tmp));
 
     tmp = tmpname[4] | (tmpname[5] << 16);
-    send_sync_register(c, c->q_stack[3] + 2, LE32(tmp));
+    send_sync_register(c, c->cold->q_stack[3] + 2, LE32(tmp));
 
     tmp = tmpname[6] | (tmpname[7] << 16);
-    send_sync_register(c, c->q_stack[3] + 3, LE32(tmp));
+    send_sync_register(c, c->cold->q_stack[3] + 3, LE32(tmp));
 
     tmp = tmpname[8] | (tmpname[9] << 16);
-    send_sync_register(c, c->q_stack[3] + 4, LE32(tmp));
+    send_sync_register(c, c->cold->q_stack[3] + 4, LE32(tmp));
 
     tmp = tmpname[10] | (tmpname[11] << 16);
-    send_sync_register(c, c->q_stack[3] + 5, LE32(tmp));
+    send_sync_register(c, c->cold->q_stack[3] + 5, LE32(tmp));
 
     return QUEST_FUNC_RET_NO_ERROR;
 }
 
 static uint32_t get_max_function(ship_client_t *c, lobby_t *l) {
-    if(c->q_stack[1] != 0)
+    if(c->cold->q_stack[1] != 0)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
-    if(c->q_stack[2] != 1)
+    if(c->cold->q_stack[2] != 1)
         return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-    if(c->q_stack[3] > 255)
+    if(c->cold->q_stack[3] > 255)
         return QUEST_FUNC_RET_INVALID_REGISTER;
 
     LOG(l, c, "quest_function get_max_function: %d -> r%d\n", QUEST_FUNC_MAX,
-        c->q_stack[3]);
-    send_sync_register(c, c->q_stack[3], QUEST_FUNC_MAX);
+        c->cold->q_stack[3]);
+    send_sync_register(c, c->cold->q_stack[3], QUEST_FUNC_MAX);
     return QUEST_FUNC_RET_NO_ERROR;
 }
 
 static uint32_t get_client_count_updates(ship_client_t *c, lobby_t *l) {
-    if(c->q_stack[1] != 0)
+    if(c->cold->q_stack[1] != 0)
         return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
-    if(c->q_stack[2] != 1)
+    if(c->cold->q_stack[2] != 1)
         return QUEST_FUNC_RET_BAD_RET_COUNT;
 
-    if(c->q_stack[3] > 255)
+    if(c->cold->q_stack[3] > 255)
         return QUEST_FUNC_RET_INVALID_REGISTER;
 
-    l->qcount_reg[c->client_id] = c->q_stack[3];
+    l->qcount_reg[c->client_id] = c->cold->q_stack[3];
 
     /* Send the current count along now. */
     LOG(l, c, "quest_function get_client_count_updates: %" PRIu32 " -> r%d\n",
-        l->num_clients, c->q_stack[3]);
-    send_sync_register(c, c->q_stack[3], l->num_clients);
+        l->num_clients, c->cold->q_stack[3]);
+    send_sync_register(c, c->cold->q_stack[3], l->num_clients);
 
     /* Done. */
     return QUEST_FUNC_RET_NO_ERROR;
@@ -1061,15 +1061,15 @@ static uint32_t get_client_count_updates(ship_client_t *c, lobby_t *l) {
 
 uint32_t quest_function_dispatch(ship_client_t *c, lobby_t *l) {
     LOG(l, c, "quest_function_dispatch: %d (args %d, returns %d)\n",
-        c->q_stack[0], c->q_stack[1], c->q_stack[2]);
+        c->cold->q_stack[0], c->cold->q_stack[1], c->cold->q_stack[2]);
 
-    if(c->q_stack[0] > QUEST_SCRIPT_START) {
+    if(c->cold->q_stack[0] > QUEST_SCRIPT_START) {
         LOG(l, c, "quest_function_dispatch: handing off to script handler\n");
         return script_execute_qfunc(c, l);
     }
 
     /* Call the requested function... */
-    switch(c->q_stack[0]) {
+    switch(c->cold->q_stack[0]) {
         case QUEST_FUNC_GET_SECTION:
             return get_section_id(c, l);
 
@@ -1167,13 +1167,13 @@ int quest_flag_reply(ship_client_t *c, uint32_t reason, uint32_t value) {
     l = c->cur_lobby;
 
     if((reason & QFLAG_REPLY_SET)) {
-        regnum = c->q_stack[5];
+        regnum = c->cold->q_stack[5];
 
         if(!(reason & QFLAG_REPLY_ERROR))
             value = 0;
     }
     else {
-        regnum = c->q_stack[4];
+        regnum = c->cold->q_stack[4];
     }
 
     /* Send the response... */
@@ -1189,7 +1189,7 @@ int quest_flag_reply(ship_client_t *c, uint32_t reason, uint32_t value) {
     pthread_mutex_unlock(&l->mutex);
 
     /* Reset the stack and release the lock. */
-    c->q_stack_top = 0;
+    c->cold->q_stack_top = 0;
     c->flags &= ~CLIENT_FLAG_QSTACK_LOCK;
 
     return 0;
@@ -1,6 +1,6 @@
 /*
     Sylverant Ship Server
-    Copyright (C) 2012, 2013, 2014 Lawrence Sebald
+    Copyright (C) 2012, 2013, 2014, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -20,10 +20,10 @@
 #include <string.h>
 
 #include <sylverant/debug.h>
-#include <sylverant/mtwist.h>
 
 #include "rtdata.h"
 #include "ship_packets.h"
+#include "mtrand.h"
 
 /* Our internal representation of the ItemRT entry. This way, we don't have to
    expand it every time we want to use it. */
@@ -33,11 +33,24 @@ typedef struct rt_data {
     uint32_t area;                      /* Unused for enemies */
 } rt_data_t;
 
+/* One of the box rares that can drop in a given area. Rather than the chance of
+   this item by itself, this holds the chance that any of the box rares for the
+   area up to and including this one would have dropped, if they were each
+   rolled for in turn. */
+typedef struct rt_box {
+    double thresh;
+    uint32_t item_data;
+} rt_box_t;
+
 /* A set of rare item data. We store one of these for each (difficulty, section)
-   pair. */
+   pair. The box rares are also indexed by area, with the ones for each area
+   stored together (in their original order) in box_index, starting at
+   box_start[area] and ending right before box_start[area + 1]. */
 typedef struct rt_set {
     rt_data_t enemy_rares[101];
     rt_data_t box_rares[30];
+    rt_box_t box_index[30];
+    uint8_t box_start[257];
 } rt_set_t;
 
 static int have_v2rt = 0;
@@ -58,6 +71,60 @@ static double expand_rate(uint8_t rate) {
     return (double)expd / (double)0x100000000ULL;
 }
 
+/* Build the index of box rares by area for a set. */
+static void build_box_index(rt_set_t *set) {
+    int i, pos[256];
+    double none[256];
+    uint32_t area;
+
+    memset(set->box_start, 0, sizeof(set->box_start));
+
+    for(i = 0; i < 30; ++i) {
+        ++set->box_start[(set->box_rares[i].area & 0xFF) + 1];
+    }
+
+    for(i = 0; i < 256; ++i) {
+        set->box_start[i + 1] += set->box_start[i];
+        pos[i] = set->box_start[i];
+        none[i] = 1.0;
+    }
+
+    /* Keep track of the chance that nothing before each entry would have
+       dropped, so that one random number can stand in for the roll for each of
+       them. */
+    for(i = 0; i < 30; ++i) {
+        area = set->box_rares[i].area & 0xFF;
+        none[area] *= 1.0 - set->box_rares[i].prob;
+        set->box_index[pos[area]].thresh = 1.0 - none[area];
+        set->box_index[pos[area]++].item_data = set->box_rares[i].item_data;
+    }
+}
+
+/* Roll for a box rare in the given area. */
+static uint32_t generate_box_rare(const rt_set_t *set, int area,
+                                  mtrand_t *rng) {
+    int i, end;
+    double rnd;
+
+    if(area < 0 || area > 0xFF)
+        return 0;
+
+    i = set->box_start[area];
+    end = set->box_start[area + 1];
+
+    if(i == end)
+        return 0;
+
+    rnd = mtrand_real1(rng);
+
+    for(; i < end; ++i) {
+        if(rnd < set->box_index[i].thresh)
+            return set->box_index[i].item_data;
+    }
+
+    return 0;
+}
+
 int rt_read_v2(const char *fn) {
     FILE *fp;
     uint8_t buf[30];
@@ -168,6 +235,8 @@ int rt_read_v2(const char *fn) {
                 v2_rtdata[i][j].box_rares[k].item_data = tmp;
                 v2_rtdata[i][j].box_rares[k].area = buf[k];
             }
+
+            build_box_index(&v2_rtdata[i][j]);
         }
     }
 
@@ -282,6 +351,8 @@ int rt_read_gc(const char *fn) {
                     gc_rtdata[i][j][k].box_rares[l].item_data = tmp;
                     gc_rtdata[i][j][k].box_rares[l].area = buf[k];
                 }
+
+                build_box_index(&gc_rtdata[i][j][k]);
             }
         }
     }
@@ -303,10 +374,9 @@ int rt_gc_enabled(void) {
 
 uint32_t rt_generate_v2_rare(ship_client_t *c, lobby_t *l, int rt_index,
                              int area) {
-    struct mt19937_state *rng = &c->cur_block->rng;
+    mtrand_t *rng = block_rng(c->cur_block);
     double rnd;
     rt_set_t *set;
-    int i;
     int section = l->clients[l->leader_id]->pl->v1.section;
 
     /* Make sure we read in a rare table and we have a sane index */
@@ -321,20 +391,13 @@ uint32_t rt_generate_v2_rare(ship_client_t *c, lobby_t *l, int rt_index,
 
     /* Are we doing a drop for an enemy or a box? */
     if(rt_index >= 0) {
-        rnd = mt19937_genrand_real1(rng);
+        rnd = mtrand_real1(rng);
 
         if(rnd < set->enemy_rares[rt_index].prob)
             return set->enemy_rares[rt_index].item_data;
     }
     else {
-        for(i = 0; i < 30; ++i) {
-            if(set->box_rares[i].area == area) {
-                rnd = mt19937_genrand_real1(rng);
-
-                if(rnd < set->box_rares[i].prob)
-                    return set->box_rares[i].item_data;
-            }
-        }
+        return generate_box_rare(set, area, rng);
     }
 
     return 0;
@@ -342,10 +405,9 @@ uint32_t rt_generate_v2_rare(ship_client_t *c, lobby_t *l, int rt_index,
 
 uint32_t rt_generate_gc_rare(ship_client_t *c, lobby_t *l, int rt_index,
                              int area) {
-    struct mt19937_state *rng = &c->cur_block->rng;
+    mtrand_t *rng = block_rng(c->cur_block);
     double rnd;
     rt_set_t *set;
-    int i;
     int section = l->clients[l->leader_id]->pl->v1.section;
 
     /* Make sure we read in a rare table and we have a sane index */
@@ -360,20 +422,13 @@ uint32_t rt_generate_gc_rare(ship_client_t *c, lobby_t *l, int rt_index,
 
     /* Are we doing a drop for an enemy or a box? */
     if(rt_index >= 0) {
-        rnd = mt19937_genrand_real1(rng);
+        rnd = mtrand_real1(rng);
 
         if(rnd < set->enemy_rares[rt_index].prob)
             return set->enemy_rares[rt_index].item_data;
     }
     else {
-        for(i = 0; i < 30; ++i) {
-            if(set->box_rares[i].area == area) {
-                rnd = mt19937_genrand_real1(rng);
-
-                if(rnd < set->box_rares[i].prob)
-                    return set->box_rares[i].item_data;
-            }
-        }
+        return generate_box_rare(set, area, rng);
     }
 
     return 0;
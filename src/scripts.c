@@ -827,17 +827,17 @@ uint32_t script_execute_qfunc(ship_client_t *c, lobby_t *l) {
 
     /* Look for the requested function. */
     SLIST_FOREACH(i, &l->qfunc_list, entry) {
-        if(i->func_id == c->q_stack[0]) {
+        if(i->func_id == c->cold->q_stack[0]) {
             /* Check that the argument count and return value count match */
-            if(c->q_stack[1] != i->nargs)
+            if(c->cold->q_stack[1] != i->nargs)
                 return QUEST_FUNC_RET_BAD_ARG_COUNT;
 
-            if(c->q_stack[2] != i->nretvals)
+            if(c->cold->q_stack[2] != i->nretvals)
                 return QUEST_FUNC_RET_BAD_RET_COUNT;
 
             /* Check all return value registers for validity */
             for(j = 3 + i->nargs; j < 3 + i->nargs + i->nretvals; ++j) {
-                if(c->q_stack[j] > 255)
+                if(c->cold->q_stack[j] > 255)
                     return QUEST_FUNC_RET_INVALID_REGISTER;
             }
 
@@ -859,7 +859,7 @@ uint32_t script_execute_qfunc(ship_client_t *c, lobby_t *l) {
 
             for(j = 0; j < i->nargs; ++j) {
                 lua_pushinteger(lstate, j + 1);
-                lua_pushinteger(lstate, c->q_stack[j + 3]);
+                lua_pushinteger(lstate, c->cold->q_stack[j + 3]);
                 lua_settable(lstate, -3);
             }
 
@@ -868,7 +868,7 @@ uint32_t script_execute_qfunc(ship_client_t *c, lobby_t *l) {
 
             for(j = 0; j < i->nretvals; ++j) {
                 lua_pushinteger(lstate, j + 1);
-                lua_pushinteger(lstate, c->q_stack[j + i->nargs + 3]);
+                lua_pushinteger(lstate, c->cold->q_stack[j + i->nargs + 3]);
                 lua_settable(lstate, -3);
             }
 
@@ -0,0 +1,213 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+
+#include "sendq.h"
+#include "mempool.h"
+
+/* How many chunks to allocate at once when the pool runs dry. */
+#define CHUNKS_PER_SLAB     32
+
+static mempool_t *chunk_pool = NULL;
+
+int sendq_init(void) {
+    if(!(chunk_pool = mempool_create(sizeof(sendq_chunk_t), CHUNKS_PER_SLAB)))
+        return -1;
+
+    return 0;
+}
+
+void sendq_shutdown(void) {
+    mempool_destroy(chunk_pool);
+    chunk_pool = NULL;
+}
+
+int sendq_append(sendq_t *q, const void *data, size_t len) {
+    const uint8_t *ptr = (const uint8_t *)data;
+    sendq_chunk_t *c = q->tail;
+    size_t amt;
+
+    while(len) {
+        /* Start a new chunk if there's no room left in the last one. */
+        if(!c || c->end == SENDQ_CHUNK_SIZE) {
+            if(!(c = (sendq_chunk_t *)mempool_alloc(chunk_pool)))
+                return -1;
+
+            c->next = NULL;
+            c->start = c->end = 0;
+
+            if(q->tail)
+                q->tail->next = c;
+            else
+                q->head = c;
+
+            q->tail = c;
+        }
+
+        amt = SENDQ_CHUNK_SIZE - c->end;
+
+        if(amt > len)
+            amt = len;
+
+        memcpy(c->data + c->end, ptr, amt);
+        c->end += amt;
+        q->bytes += amt;
+        ptr += amt;
+        len -= amt;
+    }
+
+    return 0;
+}
+
+int sendq_append_units(sendq_t *q, const void *data, size_t len, size_t unit,
+                       sendq_fn fn, void *arg) {
+    const uint8_t *ptr = (const uint8_t *)data;
+    sendq_chunk_t *c = q->tail;
+    size_t amt;
+
+    while(len) {
+        /* Start a new chunk if there isn't room for a whole piece in the last
+           one. */
+        amt = c ? SENDQ_CHUNK_SIZE - c->end : 0;
+
+        if(amt < unit && amt < len) {
+            if(!(c = (sendq_chunk_t *)mempool_alloc(chunk_pool)))
+                return -1;
+
+            c->next = NULL;
+            c->start = c->end = 0;
+
+            if(q->tail)
+                q->tail->next = c;
+            else
+                q->head = c;
+
+            q->tail = c;
+            amt = SENDQ_CHUNK_SIZE;
+        }
+
+        if(amt > len)
+            amt = len;
+        else
+            amt -= amt % unit;
+
+        memcpy(c->data + c->end, ptr, amt);
+
+        if(fn)
+            fn(arg, c->data + c->end, amt);
+
+        c->end += amt;
+        q->bytes += amt;
+        ptr += amt;
+        len -= amt;
+    }
+
+    return 0;
+}
+
+void sendq_move(sendq_t *to, sendq_t *from) {
+    if(!from->head)
+        return;
+
+    if(to->tail)
+        to->tail->next = from->head;
+    else
+        to->head = from->head;
+
+    to->tail = from->tail;
+    to->bytes += from->bytes;
+
+    from->head = from->tail = NULL;
+    from->bytes = 0;
+}
+
+int sendq_flush(sendq_t *q, int sock) {
+    struct iovec iov[SENDQ_MAX_IOV];
+    struct msghdr msg;
+    sendq_chunk_t *c;
+    ssize_t sent;
+    size_t amt;
+    int i;
+
+    while(q->bytes) {
+        /* Gather up as much as we can hand over at once. */
+        for(i = 0, c = q->head; c && i < SENDQ_MAX_IOV; c = c->next, ++i) {
+            iov[i].iov_base = c->data + c->start;
+            iov[i].iov_len = c->end - c->start;
+        }
+
+        /* The sockets aren't set non-blocking, so use sendmsg() rather than
+           writev() to be able to pass MSG_DONTWAIT. */
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = i;
+
+        if((sent = sendmsg(sock, &msg, MSG_DONTWAIT)) < 0) {
+            if(errno == EINTR)
+                continue;
+            else if(errno == EAGAIN || errno == EWOULDBLOCK)
+                return 0;
+
+            return -1;
+        }
+
+        q->bytes -= sent;
+
+        /* Release any chunks that have been completely sent. */
+        while(sent) {
+            c = q->head;
+            amt = c->end - c->start;
+
+            if((size_t)sent < amt) {
+                c->start += sent;
+                break;
+            }
+
+            sent -= amt;
+            q->head = c->next;
+            mempool_free(chunk_pool, c);
+        }
+
+        if(!q->head) {
+            q->tail = NULL;
+        }
+        /* If the kernel didn't take everything we gave it, its full. */
+        else if(i < SENDQ_MAX_IOV || q->head->start) {
+            return 0;
+        }
+    }
+
+    return 0;
+}
+
+void sendq_clear(sendq_t *q) {
+    sendq_chunk_t *c = q->head, *tmp;
+
+    while(c) {
+        tmp = c->next;
+        mempool_free(chunk_pool, c);
+        c = tmp;
+    }
+
+    q->head = q->tail = NULL;
+    q->bytes = 0;
+}
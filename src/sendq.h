@@ -0,0 +1,81 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SENDQ_H
+#define SENDQ_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/* Size of the data area of each chunk of an output queue. */
+#define SENDQ_CHUNK_SIZE    8192
+
+/* The most chunks that will be handed to the kernel in one go. */
+#define SENDQ_MAX_IOV       16
+
+/* Queue of data waiting to be written to a socket. Data is stored in a list of
+   fixed size chunks that come from a shared pool, so appending never has to
+   move anything that's already queued, and the whole thing can be written out
+   with a single gathered send. */
+typedef struct sendq_chunk {
+    struct sendq_chunk *next;
+    uint32_t start;
+    uint32_t end;
+    uint8_t data[SENDQ_CHUNK_SIZE];
+} sendq_chunk_t;
+
+typedef struct sendq {
+    sendq_chunk_t *head;
+    sendq_chunk_t *tail;
+    size_t bytes;
+} sendq_t;
+
+#define SENDQ_EMPTY(q) ((q)->bytes == 0)
+
+/* Set up and tear down the pool that chunks are allocated from. */
+int sendq_init(void);
+void sendq_shutdown(void);
+
+/* Add data to the end of a queue. Returns -1 if memory couldn't be allocated
+   for it. */
+int sendq_append(sendq_t *q, const void *data, size_t len);
+
+/* Something to do to data once it has been copied into a queue. */
+typedef void (*sendq_fn)(void *arg, uint8_t *data, size_t len);
+
+/* Add data to the end of a queue, without splitting any of the unit sized
+   pieces it is made up of between two chunks (leaving a bit of the last chunk
+   unused if need be). If fn is not NULL, it is called on each piece of the
+   data as it is copied in, so that it can be changed in place (encrypted, for
+   instance). The data should be a multiple of unit bytes long. Returns -1 if
+   memory couldn't be allocated for it. */
+int sendq_append_units(sendq_t *q, const void *data, size_t len, size_t unit,
+                       sendq_fn fn, void *arg);
+
+/* Move everything in one queue onto the end of another, leaving the first one
+   empty. Nothing is copied. */
+void sendq_move(sendq_t *to, sendq_t *from);
+
+/* Write out as much of the queue as the socket will take without blocking.
+   Returns -1 on a socket error, or 0 otherwise (even if nothing was sent). */
+int sendq_flush(sendq_t *q, int sock);
+
+/* Throw away everything in a queue. */
+void sendq_clear(sendq_t *q);
+
+#endif /* !SENDQ_H */
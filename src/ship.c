@@ -1,7 +1,7 @@
 /*
     Sylverant Ship Server
     Copyright (C) 2009, 2010, 2011, 2012, 2013, 2016, 2018, 2019,
-                  2020 Lawrence Sebald
+                  2020, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -36,6 +36,7 @@
 #include "bans.h"
 #include "scripts.h"
 #include "admin.h"
+#include "epoch.h"
 
 #ifdef ENABLE_LUA
 #include <lua.h>
@@ -131,7 +132,6 @@ static void *ship_thd(void *d) {
     struct sockaddr *addr_p = (struct sockaddr *)&addr;
     char ipstr[INET6_ADDRSTRLEN];
     int sock, rv;
-    ssize_t sent;
     time_t now;
     time_t last_ban_sweep = time(NULL);
     int numsocks = 1;
@@ -208,26 +208,10 @@ static void *ship_thd(void *d) {
 
         /* Fill the sockets into the fd_sets so we can use select below. */
         TAILQ_FOREACH(it, s->clients, qentry) {
-            /* If we haven't heard from a client in 2 minutes, its dead.
-               Disconnect it. */
-            if(now > it->last_message + 120) {
-                it->flags |= CLIENT_FLAG_DISCONNECTED;
-                continue;
-            }
-            /* Otherwise, if we haven't heard from them in a minute, ping it. */
-            else if(now > it->last_message + 60 && now > it->last_sent + 10) {
-                if(send_simple(it, PING_TYPE, 0)) {
-                    it->flags |= CLIENT_FLAG_DISCONNECTED;
-                    continue;
-                }
-
-                it->last_sent = now;
-            }
-
             FD_SET(it->sock, &readfds);
 
             /* Only add to the write fd set if we have something to send out. */
-            if(it->sendbuf_cur) {
+            if(!SENDQ_EMPTY(&it->sendq)) {
                 FD_SET(it->sock, &writefds);
             }
 
@@ -270,6 +254,9 @@ static void *ship_thd(void *d) {
             timeout.tv_sec = s->shutdown_time - now;
         }
 
+        /* Don't sleep past when the next client timer is due either. */
+        timeout.tv_sec = timer_wheel_next(&s->timers, (int)timeout.tv_sec);
+
         /* Wait for some activity... */
         if(select(nfds + 1, &readfds, &writefds, NULL, &timeout) > 0) {
             /* Clear anything written to the pipe */
@@ -302,7 +289,7 @@ static void *ship_thd(void *d) {
                                             "shutdown."),
                                          __(tmp, "Please try another ship."),
                                          __(tmp, "Disconnecting."));
-                        tmp->flags |= CLIENT_FLAG_DISCONNECTED;
+                        client_disconnect(tmp);
                     }
                 }
 
@@ -329,7 +316,7 @@ static void *ship_thd(void *d) {
                                             "shutdown."),
                                          __(tmp, "Please try another ship."),
                                          __(tmp, "Disconnecting."));
-                        tmp->flags |= CLIENT_FLAG_DISCONNECTED;
+                        client_disconnect(tmp);
                     }
                 }
 
@@ -356,7 +343,7 @@ static void *ship_thd(void *d) {
                                             "shutdown."),
                                          __(tmp, "Please try another ship."),
                                          __(tmp, "Disconnecting."));
-                        tmp->flags |= CLIENT_FLAG_DISCONNECTED;
+                        client_disconnect(tmp);
                     }
                 }
 
@@ -384,7 +371,7 @@ static void *ship_thd(void *d) {
                                             "shutdown."),
                                          __(tmp, "Please try another ship."),
                                          __(tmp, "Disconnecting."));
-                        tmp->flags |= CLIENT_FLAG_DISCONNECTED;
+                        client_disconnect(tmp);
                     }
                 }
 
@@ -412,7 +399,7 @@ static void *ship_thd(void *d) {
                                             "shutdown."),
                                          __(tmp, "Please try another ship."),
                                          __(tmp, "Disconnecting."));
-                        tmp->flags |= CLIENT_FLAG_DISCONNECTED;
+                        client_disconnect(tmp);
                     }
                 }
 
@@ -440,7 +427,7 @@ static void *ship_thd(void *d) {
                                             "shutdown."),
                                          __(tmp, "Please try another ship."),
                                          __(tmp, "Disconnecting."));
-                        tmp->flags |= CLIENT_FLAG_DISCONNECTED;
+                        client_disconnect(tmp);
                     }
                 }
             }
@@ -483,42 +470,24 @@ static void *ship_thd(void *d) {
                 /* Check if this connection was trying to send us something. */
                 if(FD_ISSET(it->sock, &readfds)) {
                     if(client_process_pkt(it)) {
-                        it->flags |= CLIENT_FLAG_DISCONNECTED;
+                        client_disconnect(it);
                         continue;
                     }
                 }
 
                 /* If we have anything to write, check if we can right now. */
                 if(FD_ISSET(it->sock, &writefds)) {
-                    if(it->sendbuf_cur) {
-                        sent = send(it->sock, it->sendbuf + it->sendbuf_start,
-                                    it->sendbuf_cur - it->sendbuf_start, 0);
-
-                        /* If we fail to send, and the error isn't EAGAIN,
-                           bail. */
-                        if(sent == -1) {
-                            if(errno != EAGAIN) {
-                                it->flags |= CLIENT_FLAG_DISCONNECTED;
-                                continue;
-                            }
-                        }
-                        else {
-                            it->sendbuf_start += sent;
-
-                            /* If we've sent everything, free the buffer. */
-                            if(it->sendbuf_start == it->sendbuf_cur) {
-                                free(it->sendbuf);
-                                it->sendbuf = NULL;
-                                it->sendbuf_cur = 0;
-                                it->sendbuf_size = 0;
-                                it->sendbuf_start = 0;
-                            }
-                        }
+                    if(client_send_buffered(it)) {
+                        client_disconnect(it);
+                        continue;
                     }
                 }
             }
         }
 
+        /* Deal with any pings and timeouts that are due. */
+        timer_wheel_run(&s->timers, time(NULL));
+
         /* Clean up any dead connections (its not safe to do a TAILQ_REMOVE in
            the middle of a TAILQ_FOREACH, and destroy_connection does indeed
            use TAILQ_REMOVE). */
@@ -564,7 +533,6 @@ static void *ship_thd(void *d) {
     cleanup_scripts(s);
     pthread_rwlock_destroy(&s->banlock);
     pthread_rwlock_destroy(&s->qlock);
-    pthread_rwlock_destroy(&s->llock);
     ship_free_limits(s);
     shipgate_cleanup(&s->sg);
     free(s->gm_list);
@@ -588,6 +556,7 @@ static void *ship_thd(void *d) {
     close(s->pcsock[0]);
     close(s->dcsock[0]);
     clean_shiplist(s);
+    client_pools_destroy(s->client_pools);
     free(s->clients);
     free(s->blocks);
     free(s);
@@ -703,6 +672,11 @@ ship_t *ship_server_start(sylverant_ship_t *s) {
         goto err_blocks;
     }
 
+    if(!(rv->client_pools = client_pools_create(0))) {
+        debug(DBG_ERROR, "%s: Cannot allocate memory for clients!\n", s->name);
+        goto err_clients;
+    }
+
     /* Attempt to read the quest list in. */
     if(s->quests_file && s->quests_file[0]) {
         debug(DBG_WARN, "%s: Ignoring old quests configuration!\n", s->name);
@@ -721,12 +695,15 @@ ship_t *ship_server_start(sylverant_ship_t *s) {
             goto err_quests;
         }
 
-        debug(DBG_LOG, "%s: Read %d Local GMs\n", s->name, rv->gm_count);
+        debug(DBG_LOG, "%s: Read %d Local GMs\n", s->name,
+              rv->gm_list->count);
     }
 
     /* Read in all limits files. */
-    TAILQ_INIT(&rv->all_limits);
-    pthread_rwlock_init(&rv->llock, NULL);
+    if(!(rv->limits = ship_alloc_limits())) {
+        debug(DBG_ERROR, "%s: Cannot allocate memory for limits!\n", s->name);
+        goto err_limits;
+    }
 
     for(i = 0; i < s->limits_count; ++i) {
         debug(DBG_LOG, "%s: Parsing /legit list %d...\n", s->name, i);
@@ -767,10 +744,10 @@ ship_t *ship_server_start(sylverant_ship_t *s) {
         }
 
         ent->limits = l;
-        TAILQ_INSERT_TAIL(&rv->all_limits, ent, qentry);
+        TAILQ_INSERT_TAIL(&rv->limits->all, ent, qentry);
 
         if(s->limits_default == i)
-            rv->def_limits = l;
+            rv->limits->def = l;
     }
 
     /* Fill in the structure. */
@@ -813,7 +790,10 @@ ship_t *ship_server_start(sylverant_ship_t *s) {
     }
 
     /* Create the random number generator state */
-    mt19937_init(&rv->rng, (uint32_t)time(NULL));
+    mtrand_init(&rv->rng, (uint32_t)time(NULL));
+
+    /* Set up the timer wheel used for client pings/timeouts. */
+    timer_wheel_init(&rv->timers, time(NULL));
 
     /* Connect to the shipgate. */
     if(shipgate_connect(rv, &rv->sg)) {
@@ -837,11 +817,12 @@ err_bans_locks:
     cleanup_scripts(rv);
 err_limits:
     ship_free_limits(rv);
-    pthread_rwlock_destroy(&rv->llock);
     free(rv->gm_list);
 err_quests:
     pthread_rwlock_destroy(&rv->qlock);
     clean_quests(rv);
+    client_pools_destroy(rv->client_pools);
+err_clients:
     free(rv->clients);
 err_blocks:
     free(rv->blocks);
@@ -902,10 +883,14 @@ void ship_check_cfg(sylverant_ship_t *s) {
     /* Clear it out */
     memset(rv, 0, sizeof(ship_t));
     TAILQ_INIT(&rv->qmap);
-    TAILQ_INIT(&rv->all_limits);
-    pthread_rwlock_init(&rv->llock, NULL);
     rv->cfg = s;
 
+    if(!(rv->limits = ship_alloc_limits())) {
+        debug(DBG_ERROR, "%s: Cannot allocate memory!\n", s->name);
+        free(rv);
+        return;
+    }
+
     /* Attempt to read the quest list in. */
     if(s->quests_file && s->quests_file[0]) {
         debug(DBG_WARN, "%s: Ignoring old quest configuration. Please update "
@@ -940,7 +925,8 @@ void ship_check_cfg(sylverant_ship_t *s) {
             debug(DBG_ERROR, "%s: Couldn't read GM file!\n", s->name);
         }
 
-        debug(DBG_LOG, "%s: Read %d Local GMs\n", s->name, rv->gm_count);
+        debug(DBG_LOG, "%s: Read %d Local GMs\n", s->name,
+              rv->gm_list ? rv->gm_list->count : 0);
     }
 
     /* Read in all limits files. */
@@ -992,10 +978,10 @@ void ship_check_cfg(sylverant_ship_t *s) {
         }
 
         ent->limits = l;
-        TAILQ_INSERT_TAIL(&rv->all_limits, ent, qentry);
+        TAILQ_INSERT_TAIL(&rv->limits->all, ent, qentry);
 
         if(s->limits_default == i)
-            rv->def_limits = l;
+            rv->limits->def = l;
     }
 
     /* Initialize scripting support */
@@ -1010,7 +996,6 @@ void ship_check_cfg(sylverant_ship_t *s) {
 
     ban_list_clear(rv);
     ship_free_limits(rv);
-    pthread_rwlock_destroy(&rv->llock);
     free(rv->gm_list);
     clean_quests(rv);
     free(rv);
@@ -1045,7 +1030,7 @@ static int dcnte_process_login(ship_client_t *c, dcnte_login_8b_pkt *pkt) {
     if((ship->cfg->shipgate_flags & SHIPGATE_FLAG_NODCNTE)) {
         send_message_box(c, "%s", __(c, "\tEPSO NTE is not supported on\n"
                                      "this ship.\n\nDisconnecting."));
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         return 0;
     }
 
@@ -1056,13 +1041,13 @@ static int dcnte_process_login(ship_client_t *c, dcnte_login_8b_pkt *pkt) {
     /* See if the user is banned */
     if(is_guildcard_banned(ship, c->guildcard, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
-    else if(is_ip_banned(ship, &c->ip_addr, &ban_reason, &ban_end)) {
+    else if(is_ip_banned(ship, &c->cold->ip_addr, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
@@ -1086,7 +1071,7 @@ static int dc_process_login(ship_client_t *c, dc_login_93_pkt *pkt) {
     if((ship->cfg->shipgate_flags & SHIPGATE_FLAG_NOV1)) {
         send_message_box(c, "%s", __(c, "\tEPSO Version 1 is not supported on\n"
                                      "this ship.\n\nDisconnecting."));
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         return 0;
     }
 
@@ -1096,13 +1081,13 @@ static int dc_process_login(ship_client_t *c, dc_login_93_pkt *pkt) {
     /* See if the user is banned */
     if(is_guildcard_banned(ship, c->guildcard, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
-    else if(is_ip_banned(ship, &c->ip_addr, &ban_reason, &ban_end)) {
+    else if(is_ip_banned(ship, &c->cold->ip_addr, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
@@ -1139,7 +1124,7 @@ static int dcv2_process_login(ship_client_t *c, dcv2_login_9d_pkt *pkt) {
         if((ship->cfg->shipgate_flags & SHIPGATE_FLAG_NOV2)) {
             send_message_box(c, "%s", __(c, "\tEPSO Version 2 is not supported "
                                          "on\nthis ship.\n\nDisconnecting."));
-            c->flags |= CLIENT_FLAG_DISCONNECTED;
+            client_disconnect(c);
             return 0;
         }
     }
@@ -1147,7 +1132,7 @@ static int dcv2_process_login(ship_client_t *c, dcv2_login_9d_pkt *pkt) {
         if((ship->cfg->shipgate_flags & SHIPGATE_FLAG_NOPC)) {
             send_message_box(c, "%s", __(c, "\tEPSO for PC is not supported "
                                          "on\nthis ship.\n\nDisconnecting."));
-            c->flags |= CLIENT_FLAG_DISCONNECTED;
+            client_disconnect(c);
             return 0;
         }
 
@@ -1159,7 +1144,7 @@ static int dcv2_process_login(ship_client_t *c, dcv2_login_9d_pkt *pkt) {
                 send_message_box(c, "%s", __(c, "\tEPSO for PC Network Trial "
                                              "Edition\nis not supported on "
                                              "this ship.\n\nDisconnecting."));
-                c->flags |= CLIENT_FLAG_DISCONNECTED;
+                client_disconnect(c);
                 return 0;
             }
         }
@@ -1171,13 +1156,13 @@ static int dcv2_process_login(ship_client_t *c, dcv2_login_9d_pkt *pkt) {
     /* See if the user is banned */
     if(is_guildcard_banned(ship, c->guildcard, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
-    else if(is_ip_banned(ship, &c->ip_addr, &ban_reason, &ban_end)) {
+    else if(is_ip_banned(ship, &c->cold->ip_addr, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
@@ -1203,7 +1188,7 @@ static int gc_process_login(ship_client_t *c, gc_login_9e_pkt *pkt) {
             send_message_box(c, "%s", __(c, "\tEPSO Episode 1 & 2 is not "
                                          "supported on\nthis ship.\n\n"
                                          "Disconnecting."));
-            c->flags |= CLIENT_FLAG_DISCONNECTED;
+            client_disconnect(c);
             return 0;
         }
     }
@@ -1212,7 +1197,7 @@ static int gc_process_login(ship_client_t *c, gc_login_9e_pkt *pkt) {
             send_message_box(c, "%s", __(c, "\tEPSO Episode 3 is not "
                                          "supported on\nthis ship.\n\n"
                                          "Disconnecting."));
-            c->flags |= CLIENT_FLAG_DISCONNECTED;
+            client_disconnect(c);
             return 0;
         }
     }
@@ -1223,13 +1208,13 @@ static int gc_process_login(ship_client_t *c, gc_login_9e_pkt *pkt) {
     /* See if the user is banned */
     if(is_guildcard_banned(ship, c->guildcard, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
-    else if(is_ip_banned(ship, &c->ip_addr, &ban_reason, &ban_end)) {
+    else if(is_ip_banned(ship, &c->cold->ip_addr, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
@@ -1254,7 +1239,7 @@ static int xb_process_login(ship_client_t *c, xb_login_9e_pkt *pkt) {
         send_message_box(c, "%s", __(c, "\tEPSO Episode 1 & 2 for Xbox "
                                      "is not supported on\nthis ship.\n\n"
                                      "Disconnecting."));
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         return 0;
     }
 
@@ -1264,13 +1249,13 @@ static int xb_process_login(ship_client_t *c, xb_login_9e_pkt *pkt) {
     /* See if the user is banned */
     if(is_guildcard_banned(ship, c->guildcard, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
-    else if(is_ip_banned(ship, &c->ip_addr, &ban_reason, &ban_end)) {
+    else if(is_ip_banned(ship, &c->cold->ip_addr, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
@@ -1296,7 +1281,7 @@ static int bb_process_login(ship_client_t *c, bb_login_93_pkt *pkt) {
         send_message_box(c, "%s", __(c, "\tEPSO Blue Burst is not "
                                         "supported on\nthis ship.\n\n"
                                         "Disconnecting."));
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         return 0;
     }
 
@@ -1306,28 +1291,28 @@ static int bb_process_login(ship_client_t *c, bb_login_93_pkt *pkt) {
     /* See if the user is banned */
     if(is_guildcard_banned(ship, c->guildcard, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
-    else if(is_ip_banned(ship, &c->ip_addr, &ban_reason, &ban_end)) {
+    else if(is_ip_banned(ship, &c->cold->ip_addr, &ban_reason, &ban_end)) {
         send_ban_msg(c, ban_end, ban_reason);
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
         free(ban_reason);
         return 0;
     }
 
     /* Copy in the security data */
-    memcpy(&c->sec_data, pkt->security_data, sizeof(bb_security_data_t));
+    memcpy(&c->cold->sec_data, pkt->security_data, sizeof(bb_security_data_t));
 
-    if(c->sec_data.magic != LE32(0xDEADBEEF)) {
+    if(c->cold->sec_data.magic != LE32(0xDEADBEEF)) {
         send_bb_security(c, 0, LOGIN_93BB_FORCED_DISCONNECT, 0, NULL, 0);
         return -1;
     }
 
     /* Send the security data packet */
     if(send_bb_security(c, c->guildcard, LOGIN_93BB_OK, team_id,
-                        &c->sec_data, sizeof(bb_security_data_t))) {
+                        &c->cold->sec_data, sizeof(bb_security_data_t))) {
         return -2;
     }
 
@@ -1663,16 +1648,33 @@ void ship_dec_games(ship_t *s) {
     shipgate_send_cnt(&s->sg, s->num_clients, s->num_games);
 }
 
+ship_limits_t *ship_alloc_limits(void) {
+    ship_limits_t *rv = (ship_limits_t *)malloc(sizeof(ship_limits_t));
+
+    if(!rv) {
+        debug(DBG_ERROR, "Cannot allocate limits: %s\n", strerror(errno));
+        return NULL;
+    }
+
+    TAILQ_INIT(&rv->all);
+    rv->def = NULL;
+    return rv;
+}
+
+/* Only for use when nobody else can possibly be looking at the limits (i.e, at
+   startup or shutdown). */
 void ship_free_limits(ship_t *s) {
-    pthread_rwlock_wrlock(&s->llock);
-    ship_free_limits_ex(&s->all_limits);
-    pthread_rwlock_unlock(&s->llock);
+    ship_free_limits_ex(s->limits);
+    s->limits = NULL;
 }
 
-void ship_free_limits_ex(struct limits_queue *l) {
+void ship_free_limits_ex(ship_limits_t *l) {
     limits_entry_t *it, *tmp;
 
-    it = TAILQ_FIRST(l);
+    if(!l)
+        return;
+
+    it = TAILQ_FIRST(&l->all);
 
     while(it) {
         tmp = TAILQ_NEXT(it, qentry);
@@ -1682,14 +1684,18 @@ void ship_free_limits_ex(struct limits_queue *l) {
         it = tmp;
     }
 
-    TAILQ_INIT(l);
+    free(l);
 }
 
 sylverant_limits_t *ship_lookup_limits(const char *name) {
+    ship_limits_t *l = EPOCH_DEREF(ship->limits);
     limits_entry_t *it;
 
+    if(!l)
+        return NULL;
+
     /* Not really efficient, but simple. */
-    TAILQ_FOREACH(it, &ship->all_limits, qentry) {
+    TAILQ_FOREACH(it, &l->all, qentry) {
         if(!strcmp(name, it->name))
             return it->limits;
     }
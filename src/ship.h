@@ -1,6 +1,6 @@
 /*
     Sylverant Ship Server
-    Copyright (C) 2009, 2010, 2011, 2016, 2020 Lawrence Sebald
+    Copyright (C) 2009, 2010, 2011, 2016, 2020, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -25,7 +25,6 @@
 #include <sylverant/config.h>
 #include <sylverant/quest.h>
 #include <sylverant/items.h>
-#include <sylverant/mtwist.h>
 
 #ifdef ENABLE_LUA
 #include <lua.h>
@@ -36,6 +35,8 @@
 #include "gm.h"
 #include "block.h"
 #include "shipgate.h"
+#include "timers.h"
+#include "mtrand.h"
 
 #define CLIENTS_H_COUNTS_ONLY
 #include "clients.h"
@@ -46,6 +47,7 @@
 
 /* Forward declarations. */
 struct client_queue;
+struct client_pools;
 struct ship_client;
 struct block;
 
@@ -86,6 +88,13 @@ typedef struct limits_entry {
 
 TAILQ_HEAD(limits_queue, limits_entry);
 
+/* All of the limits lists the ship knows about. Like the GM list, this is
+   never changed once it has been published, only replaced (see epoch.h). */
+typedef struct ship_limits {
+    struct limits_queue all;
+    sylverant_limits_t *def;
+} ship_limits_t;
+
 struct ship {
     sylverant_ship_t *cfg;
 
@@ -114,10 +123,9 @@ struct ship {
 
     shipgate_conn_t sg;
     pthread_rwlock_t qlock;
-    pthread_rwlock_t llock;
 
-    local_gm_t *gm_list;
-    int gm_count;
+    /* Published with epoch_publish(), read with EPOCH_DEREF(). */
+    gm_list_t *gm_list;
 
     pthread_rwlock_t banlock;
     struct gcban_queue guildcard_bans;
@@ -127,10 +135,14 @@ struct ship {
     int mccount;
     uint16_t *menu_codes;
 
-    struct mt19937_state rng;
+    mtrand_t rng;
+
+    /* Timers for ship clients. Only touched by the ship thread. */
+    timer_wheel_t timers;
+    struct client_pools *client_pools;
 
-    struct limits_queue all_limits;
-    sylverant_limits_t *def_limits;
+    /* Published with epoch_publish(), read with EPOCH_DEREF(). */
+    ship_limits_t *limits;
 
 #ifdef ENABLE_LUA
     lua_State *lstate;
@@ -161,10 +173,11 @@ void ship_dec_clients(ship_t *s);
 void ship_inc_games(ship_t *s);
 void ship_dec_games(ship_t *s);
 
+ship_limits_t *ship_alloc_limits(void);
 void ship_free_limits(ship_t *s);
-void ship_free_limits_ex(struct limits_queue *l);
+void ship_free_limits_ex(ship_limits_t *l);
 
-/* This function assumes that you already hold the read lock! */
+/* This function assumes that you are already in an epoch read section! */
 sylverant_limits_t *ship_lookup_limits(const char *name);
 
 #ifdef ENABLE_LUA
@@ -1,7 +1,7 @@
 /*
     Sylverant Ship Server
     Copyright (C) 2009, 2010, 2011, 2012, 2013, 2014, 2015, 2016, 2017, 2018,
-                  2019, 2020, 2021, 2022, 2023, 2025 Lawrence Sebald
+                  2019, 2020, 2021, 2022, 2023, 2025, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <time.h>
 #include <errno.h>
+#include <unistd.h>
 #include <sys/time.h>
 #include <sys/socket.h>
 #include <iconv.h>
@@ -175,19 +176,48 @@ static int send_bb_lobby_arrows(lobby_t *l, ship_client_t *c);
 /* Send a raw packet away. */
 static int send_raw(ship_client_t *c, int len, uint8_t *sendbuf) {
     ssize_t rv, total = 0;
-    void *tmp;
 
-    /* Keep trying until the whole thing's sent. */
-    if(!c->sendbuf_cur) {
+    /* If we're on the thread that owns the client, just queue it up. The
+       worker sends everything queued for each client all at once at the end
+       of each pass through its loop, rather than doing a send for every
+       little packet. */
+    if(c->worker && c->worker == block_current_worker()) {
+        if(c->sendq.bytes + len > CLIENT_SENDQ_MAX) {
+            debug(DBG_WARN, "Output queue full for client %" PRIu32
+                  ", disconnecting\n", c->guildcard);
+            client_disconnect(c);
+            return -1;
+        }
+
+        if(sendq_append(&c->sendq, sendbuf, len)) {
+            return -1;
+        }
+
+        /* Don't let too much pile up though. */
+        if(c->sendq.bytes >= CLIENT_FLUSH_THRESHOLD) {
+            return client_send_buffered(c);
+        }
+
+        client_queue_flush(c);
+        return 0;
+    }
+
+    /* Otherwise, we're on a thread that isn't a block worker (the ship thread,
+       for instance), and the caller must be holding the client's mutex. If
+       nothing's waiting to go out ahead of this, try to send it right away, as
+       long as we can do so without blocking. */
+    if(SENDQ_EMPTY(&c->sendq)) {
         while(total < len) {
-            rv = send(c->sock, sendbuf + total, len - total, 0);
+            rv = send(c->sock, sendbuf + total, len - total, MSG_DONTWAIT);
+
+            if(rv == -1) {
+                if(errno == EINTR)
+                    continue;
+                else if(errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
 
-            if(rv == -1 && errno != EAGAIN) {
                 return -1;
             }
-            else if(rv == -1) {
-                break;
-            }
 
             total += rv;
         }
@@ -196,30 +226,111 @@ static int send_raw(ship_client_t *c, int len, uint8_t *sendbuf) {
     rv = len - total;
 
     if(rv) {
-        /* Move out any already transferred data. */
-        if(c->sendbuf_start) {
-            memmove(c->sendbuf, c->sendbuf + c->sendbuf_start,
-                    c->sendbuf_cur - c->sendbuf_start);
-            c->sendbuf_cur -= c->sendbuf_start;
-            c->sendbuf_start = 0;
+        /* If the client has let too much pile up, it has probably stopped
+           reading from its end. Cut it loose. */
+        if(c->sendq.bytes + rv > CLIENT_SENDQ_MAX) {
+            debug(DBG_WARN, "Output queue full for client %" PRIu32
+                  ", disconnecting\n", c->guildcard);
+            client_disconnect(c);
+            return -1;
         }
 
-        /* See if we need to reallocate the buffer. */
-        if(c->sendbuf_cur + rv > c->sendbuf_size) {
-            tmp = realloc(c->sendbuf, c->sendbuf_cur + rv);
+        /* Queue up what's left of the packet. */
+        if(sendq_append(&c->sendq, sendbuf + total, rv)) {
+            return -1;
+        }
 
-            /* If we can't allocate the space, bail. */
-            if(tmp == NULL) {
-                return -1;
-            }
+        /* Make sure we find out when we can send the rest of it. */
+        client_update_events(c);
+    }
+
+    return 0;
+}
+
+/* Queue up a packet for a client that belongs to another worker. The packet
+   must already be padded out. */
+static int pend_send(ship_client_t *c, const uint8_t *pkt, int len) {
+    block_worker_t *w = c->worker;
+    ship_client_t *head;
+    int rv = 0;
+
+    if(c->cold->logfile) {
+        fprint_packet(c->cold->logfile, pkt, len, 0);
+    }
+
+    /* Keep whole packets together in each chunk, so that the owner can encrypt
+       the chunks one at a time. */
+    pthread_mutex_lock(&c->pend_mutex);
+
+    if(c->pendq.bytes + len > CLIENT_SENDQ_MAX) {
+        debug(DBG_WARN, "Output queue full for client %" PRIu32
+              ", disconnecting\n", c->guildcard);
+        client_disconnect(c);
+        rv = -1;
+    }
+    else {
+        rv = sendq_append_units(&c->pendq, pkt, len, c->hdr_size, NULL, NULL);
+    }
+
+    pthread_mutex_unlock(&c->pend_mutex);
+
+    /* Put the client on its worker's list, if it isn't there already. */
+    if(rv || __atomic_exchange_n(&c->pend_queued, 1, __ATOMIC_ACQ_REL))
+        return rv;
 
-            c->sendbuf_size = c->sendbuf_cur + rv;
-            c->sendbuf = (unsigned char *)tmp;
+    head = __atomic_load_n(&w->pend_list, __ATOMIC_RELAXED);
+
+    do {
+        c->pend_next = head;
+    } while(!__atomic_compare_exchange_n(&w->pend_list, &head, c, 1,
+                                         __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    if(!head)
+        write(w->pipes[1], "\x01", 1);
+
+    return 0;
+}
+
+int crypt_send_pending(ship_client_t *c) {
+    sendq_t q = { NULL, NULL, 0 };
+    sendq_chunk_t *i;
+
+    pthread_mutex_lock(&c->pend_mutex);
+    sendq_move(&q, &c->pendq);
+    pthread_mutex_unlock(&c->pend_mutex);
+
+    if(SENDQ_EMPTY(&q)) {
+        return 0;
+    }
+
+    /* Every chunk holds a whole number of blocks, so they can each be
+       encrypted right where they are. */
+    for(i = q.head; i; i = i->next) {
+        cipher_crypt(&c->skey, &c->skey_ks, i->data + i->start,
+                     (int)(i->end - i->start), 1);
+    }
+
+    client_queue_refill(c);
+
+    if(c->sendq.bytes + q.bytes > CLIENT_SENDQ_MAX) {
+        debug(DBG_WARN, "Output queue full for client %" PRIu32
+              ", disconnecting\n", c->guildcard);
+        sendq_clear(&q);
+        client_disconnect(c);
+        return -1;
+    }
+
+    sendq_move(&c->sendq, &q);
+
+    if(c->worker && c->worker == block_current_worker()) {
+        if(c->sendq.bytes >= CLIENT_FLUSH_THRESHOLD) {
+            return client_send_buffered(c);
         }
 
-        /* Copy what's left of the packet into the output buffer. */
-        memcpy(c->sendbuf + c->sendbuf_cur, sendbuf + total, rv);
-        c->sendbuf_cur += rv;
+        client_queue_flush(c);
+    }
+    else {
+        client_update_events(c);
     }
 
     return 0;
@@ -227,18 +338,37 @@ static int send_raw(ship_client_t *c, int len, uint8_t *sendbuf) {
 
 /* Encrypt and send a packet away. */
 int crypt_send(ship_client_t *c, int len, uint8_t *sendbuf) {
+    block_worker_t *w = block_current_worker();
+
     /* Expand it to be a multiple of 8/4 bytes long */
     while(len & (c->hdr_size - 1)) {
         sendbuf[len++] = 0;
     }
 
+    /* If the client is being served by another worker (which happens all the
+       time in lobbies and teams, since clients are spread between the workers
+       as they connect), then that worker is the only one that can touch its
+       encryption state and its output queue without holding its lock. Leave
+       the packet on the client's pending queue for that worker to take care
+       of. */
+    if(w && c->worker && c->worker != w) {
+        return pend_send(c, sendbuf, len);
+    }
+
+    /* Anything other workers have left for the client goes out first. */
+    if(__atomic_load_n(&c->pend_queued, __ATOMIC_ACQUIRE) &&
+       crypt_send_pending(c)) {
+        return -1;
+    }
+
     /* If we're logging the client, write into the log */
-    if(c->logfile) {
-        fprint_packet(c->logfile, sendbuf, len, 0);
+    if(c->cold->logfile) {
+        fprint_packet(c->cold->logfile, sendbuf, len, 0);
     }
 
     /* Encrypt the packet */
-    CRYPT_CryptData(&c->skey, sendbuf, len, 1);
+    cipher_crypt(&c->skey, &c->skey_ks, sendbuf, len, 1);
+    client_queue_refill(c);
 
     return send_raw(c, len, sendbuf);
 }
@@ -299,8 +429,8 @@ int send_dc_welcome(ship_client_t *c, uint32_t svect, uint32_t cvect) {
     pkt->svect = LE32(svect);
     pkt->cvect = LE32(cvect);
 
-    if(c->logfile) {
-        fprint_packet(c->logfile, sendbuf, DC_WELCOME_LENGTH, 0);
+    if(c->cold->logfile) {
+        fprint_packet(c->cold->logfile, sendbuf, DC_WELCOME_LENGTH, 0);
     }
 
     /* Send the packet away */
@@ -332,8 +462,8 @@ int send_bb_welcome(ship_client_t *c, const uint8_t svect[48],
     memcpy(pkt->svect, svect, 48);
     memcpy(pkt->cvect, cvect, 48);
 
-    if(c->logfile) {
-        fprint_packet(c->logfile, sendbuf, BB_WELCOME_LENGTH, 0);
+    if(c->cold->logfile) {
+        fprint_packet(c->cold->logfile, sendbuf, BB_WELCOME_LENGTH, 0);
     }
 
     /* Send the packet away */
@@ -1620,6 +1750,178 @@ int send_lobby_join(ship_client_t *c, lobby_t *l) {
     return 0;
 }
 
+/* Retrieve the thread-specific buffer that packets for pkt_fanout_t are put
+   together in. */
+static uint8_t *get_fanoutbuf(void) {
+    uint8_t *buf = (uint8_t *)pthread_getspecific(fanoutbuf_key);
+
+    if(!buf) {
+        buf = (uint8_t *)malloc(PKT_FANOUT_BUF_SIZE * 3);
+
+        if(!buf) {
+            perror("malloc");
+            return NULL;
+        }
+
+        if(pthread_setspecific(fanoutbuf_key, buf)) {
+            perror("pthread_setspecific");
+            free(buf);
+            return NULL;
+        }
+    }
+
+    return buf;
+}
+
+/* Fill in the data and padding of one version of a prepared packet, with the
+   header already in place. */
+static void pkt_fanout_finish(pkt_fanout_t *f, int v, uint8_t *buf, int hdr_len,
+                              const uint8_t *data, int data_len, int align) {
+    int len = hdr_len + data_len;
+
+    memcpy(buf + hdr_len, data, data_len);
+
+    while(len & (align - 1)) {
+        buf[len++] = 0;
+    }
+
+    f->pkt[v] = buf;
+    f->len[v] = len;
+}
+
+int pkt_fanout_init_dc(pkt_fanout_t *f, const dc_pkt_hdr_t *pkt) {
+    uint8_t *buf = get_fanoutbuf();
+    const uint8_t *data = ((const uint8_t *)pkt) + 4;
+    int len = (int)LE16(pkt->pkt_len);
+    pc_pkt_hdr_t *pc;
+    bb_pkt_hdr_t *bb;
+
+    if(!buf) {
+        return -1;
+    }
+
+    /* DC, GC, Episode 3 and Xbox get the header exactly as-is. */
+    memcpy(buf, pkt, 4);
+    pkt_fanout_finish(f, PKT_FANOUT_DC, buf, 4, data, len - 4, 4);
+    buf += PKT_FANOUT_BUF_SIZE;
+
+    pc = (pc_pkt_hdr_t *)buf;
+    pc->pkt_len = pkt->pkt_len;
+    pc->flags = pkt->flags;
+    pc->pkt_type = pkt->pkt_type;
+    pkt_fanout_finish(f, PKT_FANOUT_PC, buf, 4, data, len - 4, 4);
+    buf += PKT_FANOUT_BUF_SIZE;
+
+    bb = (bb_pkt_hdr_t *)buf;
+    bb->pkt_len = LE16((len + 4));
+    bb->flags = LE32(pkt->flags);
+    bb->pkt_type = LE16(pkt->pkt_type);
+    pkt_fanout_finish(f, PKT_FANOUT_BB, buf, 8, data, len - 4, 8);
+
+    return 0;
+}
+
+int pkt_fanout_init_bb(pkt_fanout_t *f, const bb_pkt_hdr_t *pkt) {
+    uint8_t *buf = get_fanoutbuf();
+    const uint8_t *data = ((const uint8_t *)pkt) + 8;
+    int len = (int)LE16(pkt->pkt_len);
+    dc_pkt_hdr_t *dc;
+    pc_pkt_hdr_t *pc;
+
+    if(!buf) {
+        return -1;
+    }
+
+    dc = (dc_pkt_hdr_t *)buf;
+    dc->pkt_len = LE16(len - 4);
+    dc->flags = (uint8_t)pkt->flags;
+    dc->pkt_type = (uint8_t)pkt->pkt_type;
+    pkt_fanout_finish(f, PKT_FANOUT_DC, buf, 4, data, len - 8, 4);
+    buf += PKT_FANOUT_BUF_SIZE;
+
+    pc = (pc_pkt_hdr_t *)buf;
+    pc->pkt_len = LE16(len - 4);
+    pc->flags = (uint8_t)pkt->flags;
+    pc->pkt_type = (uint8_t)pkt->pkt_type;
+    pkt_fanout_finish(f, PKT_FANOUT_PC, buf, 4, data, len - 8, 4);
+    buf += PKT_FANOUT_BUF_SIZE;
+
+    memcpy(buf, pkt, 8);
+    pkt_fanout_finish(f, PKT_FANOUT_BB, buf, 8, data, len - 8, 8);
+
+    return 0;
+}
+
+/* Encrypt part of a packet in place, once it's been copied into the output
+   queue of the client in arg. */
+static void crypt_queued(void *arg, uint8_t *data, size_t len) {
+    ship_client_t *c = (ship_client_t *)arg;
+
+    cipher_crypt(&c->skey, &c->skey_ks, data, (int)len, 1);
+}
+
+int send_pkt_fanout(ship_client_t *c, const pkt_fanout_t *f) {
+    block_worker_t *w = block_current_worker();
+    uint8_t *sendbuf;
+    int v = PKT_FANOUT_DC, len;
+
+    if(c->version == CLIENT_VERSION_PC)
+        v = PKT_FANOUT_PC;
+    else if(c->version == CLIENT_VERSION_BB)
+        v = PKT_FANOUT_BB;
+
+    len = f->len[v];
+
+    /* Clients on other workers get the packet the same way as with
+       crypt_send(), since it's their worker that encrypts it. */
+    if(w && c->worker && c->worker != w) {
+        return pend_send(c, f->pkt[v], len);
+    }
+
+    /* Anything that isn't the client's block worker doesn't own its output
+       queue, so it has to go the long way around. */
+    if(!w || c->worker != w) {
+        if(!(sendbuf = get_sendbuf())) {
+            return -1;
+        }
+
+        memcpy(sendbuf, f->pkt[v], len);
+        return crypt_send(c, len, sendbuf);
+    }
+
+    if(__atomic_load_n(&c->pend_queued, __ATOMIC_ACQUIRE) &&
+       crypt_send_pending(c)) {
+        return -1;
+    }
+
+    if(c->cold->logfile) {
+        fprint_packet(c->cold->logfile, f->pkt[v], len, 0);
+    }
+
+    if(c->sendq.bytes + len > CLIENT_SENDQ_MAX) {
+        debug(DBG_WARN, "Output queue full for client %" PRIu32
+              ", disconnecting\n", c->guildcard);
+        client_disconnect(c);
+        return -1;
+    }
+
+    /* Otherwise, the client is ours, so encrypt the packet as it's copied
+       straight into the client's output queue. */
+    if(sendq_append_units(&c->sendq, f->pkt[v], len, c->hdr_size,
+                          &crypt_queued, c)) {
+        return -1;
+    }
+
+    client_queue_refill(c);
+
+    if(c->sendq.bytes >= CLIENT_FLUSH_THRESHOLD) {
+        return client_send_buffered(c);
+    }
+
+    client_queue_flush(c);
+    return 0;
+}
+
 /* Send a prepared packet to the given client. */
 int send_pkt_dc(ship_client_t *c, const dc_pkt_hdr_t *pkt) {
     uint8_t *sendbuf = get_sendbuf();
@@ -4006,18 +4308,17 @@ int send_game_join(ship_client_t *c, lobby_t *l) {
     return -1;
 }
 
-/* Send a packet to a client giving them the list of games on the block. */
-static int send_dc_game_list(ship_client_t *c, block_t *b) {
-    uint8_t *sendbuf = get_sendbuf();
+/* Build the list of games on the block, as seen by the given class of client,
+   in the buffer provided. These return the length of the packet. The caller
+   must hold the block's lobby_lock. */
+static int build_dc_game_list(block_t *b, uint8_t *sendbuf, int list) {
     dc_game_list_pkt *pkt = (dc_game_list_pkt *)sendbuf;
     int entries = 1, len = 0x20;
+    int v1 = (list == BLOCK_GAME_LIST_DCV1 || list == BLOCK_GAME_LIST_DCV1_NTE);
+    int nte = (list == BLOCK_GAME_LIST_DCV1_NTE ||
+               list == BLOCK_GAME_LIST_DCV2_NTE);
     lobby_t *l;
 
-    /* Verify we got the sendbuf. */
-    if(!sendbuf) {
-        return -1;
-    }
-
     /* Clear out the packet and the first entry */
     memset(pkt, 0, 0x20);
 
@@ -4030,27 +4331,30 @@ static int send_dc_game_list(ship_client_t *c, block_t *b) {
     pkt->entries[0].flags = 0x04;
     strcpy(pkt->entries[0].name, b->ship->cfg->name);
 
-    pthread_rwlock_rdlock(&b->lobby_lock);
+    TAILQ_FOREACH(l, &b->games, gentry) {
+        /* Ignore Episode 3 games. The type of a lobby never changes, so this
+           doesn't need the lock. */
+        if(l->type != LOBBY_TYPE_GAME) {
+            continue;
+        }
 
-    TAILQ_FOREACH(l, &b->lobbies, qentry) {
         /* Lock the lobby */
         pthread_mutex_lock(&l->mutex);
 
-        /* Ignore default lobbies and Gamecube/Blue Burst games */
-        if(l->type != LOBBY_TYPE_GAME || l->episode) {
+        /* Ignore Gamecube/Blue Burst games */
+        if(l->episode) {
             pthread_mutex_unlock(&l->mutex);
             continue;
         }
 
         /* Don't show v2-only lobbies to v1 players */
-        if(c->version == CLIENT_VERSION_DCV1 && l->v2) {
+        if(v1 && l->v2) {
             pthread_mutex_unlock(&l->mutex);
             continue;
         }
 
         /* Don't show v1-only lobbies to v2 players */
-        if(c->version == CLIENT_VERSION_DCV2 &&
-           (l->flags & LOBBY_FLAG_V1ONLY)) {
+        if(!v1 && (l->flags & LOBBY_FLAG_V1ONLY)) {
             pthread_mutex_unlock(&l->mutex);
             continue;
         }
@@ -4069,7 +4373,7 @@ static int send_dc_game_list(ship_client_t *c, block_t *b) {
 
         /* Is the client on the NTE? If not, don't show NTE teams. If they
            are on the NTE, then only show NTE teams. */
-        if(!(c->flags & CLIENT_FLAG_IS_NTE)) {
+        if(!nte) {
             /* Don't show DC NTE teams... */
             if((l->flags & LOBBY_FLAG_NTE)) {
                 pthread_mutex_unlock(&l->mutex);
@@ -4118,27 +4422,19 @@ static int send_dc_game_list(ship_client_t *c, block_t *b) {
         len += 0x1C;
     }
 
-    pthread_rwlock_unlock(&b->lobby_lock);
-
     /* Fill in the rest of the header */
     pkt->hdr.flags = entries - 1;
     pkt->hdr.pkt_len = LE16(len);
 
-    /* Send it away */
-    return crypt_send(c, len, sendbuf);
+    return len;
 }
 
-static int send_pc_game_list(ship_client_t *c, block_t *b) {
-    uint8_t *sendbuf = get_sendbuf();
+static int build_pc_game_list(block_t *b, uint8_t *sendbuf, int list) {
     pc_game_list_pkt *pkt = (pc_game_list_pkt *)sendbuf;
     int entries = 1, len = 0x30;
+    int nte = (list == BLOCK_GAME_LIST_PC_NTE);
     lobby_t *l;
 
-    /* Verify we got the sendbuf. */
-    if(!sendbuf) {
-        return -1;
-    }
-
     /* Clear out the packet and the first entry */
     memset(pkt, 0, 0x30);
 
@@ -4153,14 +4449,18 @@ static int send_pc_game_list(ship_client_t *c, block_t *b) {
     istrncpy(ic_8859_to_utf16, (char *)pkt->entries[0].name, ship->cfg->name,
              0x20);
 
-    pthread_rwlock_rdlock(&b->lobby_lock);
+    TAILQ_FOREACH(l, &b->games, gentry) {
+        /* Ignore Episode 3 games. The type of a lobby never changes, so this
+           doesn't need the lock. */
+        if(l->type != LOBBY_TYPE_GAME) {
+            continue;
+        }
 
-    TAILQ_FOREACH(l, &b->lobbies, qentry) {
         /* Lock the lobby */
         pthread_mutex_lock(&l->mutex);
 
-        /* Ignore default lobbies and Gamecube/Blue Burst games */
-        if(l->type != LOBBY_TYPE_GAME || l->episode) {
+        /* Ignore Gamecube/Blue Burst games */
+        if(l->episode) {
             pthread_mutex_unlock(&l->mutex);
             continue;
         }
@@ -4179,7 +4479,7 @@ static int send_pc_game_list(ship_client_t *c, block_t *b) {
 
         /* Is the client on the NTE? If not, don't show NTE teams. If they
            are on the NTE, then only show NTE teams. */
-        if(!(c->flags & CLIENT_FLAG_IS_NTE)) {
+        if(!nte) {
             /* Don't show NTE teams... */
             if((l->flags & LOBBY_FLAG_NTE)) {
                 pthread_mutex_unlock(&l->mutex);
@@ -4221,27 +4521,19 @@ static int send_pc_game_list(ship_client_t *c, block_t *b) {
         len += 0x2C;
     }
 
-    pthread_rwlock_unlock(&b->lobby_lock);
-
     /* Fill in the rest of the header */
     pkt->hdr.flags = entries - 1;
     pkt->hdr.pkt_len = LE16(len);
 
-    /* Send it away */
-    return crypt_send(c, len, sendbuf);
+    return len;
 }
 
-static int send_gc_game_list(ship_client_t *c, block_t *b) {
-    uint8_t *sendbuf = get_sendbuf();
+static int build_gc_game_list(block_t *b, uint8_t *sendbuf, int list) {
     dc_game_list_pkt *pkt = (dc_game_list_pkt *)sendbuf;
     int entries = 1, len = 0x20;
+    int show_dcpc = (list == BLOCK_GAME_LIST_GC_DCPC);
     lobby_t *l;
 
-    /* Verify we got the sendbuf. */
-    if(!sendbuf) {
-        return -1;
-    }
-
     /* Clear out the packet and the first entry */
     memset(pkt, 0, 0x20);
 
@@ -4254,18 +4546,16 @@ static int send_gc_game_list(ship_client_t *c, block_t *b) {
     pkt->entries[0].flags = 0x04;
     strcpy(pkt->entries[0].name, b->ship->cfg->name);
 
-    pthread_rwlock_rdlock(&b->lobby_lock);
-
-    TAILQ_FOREACH(l, &b->lobbies, qentry) {
-        /* Lock the lobby */
-        pthread_mutex_lock(&l->mutex);
-
-        /* Ignore default lobbies */
+    TAILQ_FOREACH(l, &b->games, gentry) {
+        /* Ignore Episode 3 games. The type of a lobby never changes, so this
+           doesn't need the lock. */
         if(l->type != LOBBY_TYPE_GAME) {
-            pthread_mutex_unlock(&l->mutex);
             continue;
         }
 
+        /* Lock the lobby */
+        pthread_mutex_lock(&l->mutex);
+
         /* Ignore Blue Burst lobbies */
         if(l->version == CLIENT_VERSION_BB) {
             pthread_mutex_unlock(&l->mutex);
@@ -4274,8 +4564,7 @@ static int send_gc_game_list(ship_client_t *c, block_t *b) {
 
         /* Ignore DC/PC games if the user hasn't set the flag to show them or
            the lobby doesn't have the right flag set */
-        if(!l->episode && (!(c->flags & CLIENT_FLAG_SHOW_DCPC_ON_GC) ||
-                           !(l->flags & LOBBY_FLAG_GC_ALLOWED))) {
+        if(!l->episode && (!show_dcpc || !(l->flags & LOBBY_FLAG_GC_ALLOWED))) {
             pthread_mutex_unlock(&l->mutex);
             continue;
         }
@@ -4320,27 +4609,18 @@ static int send_gc_game_list(ship_client_t *c, block_t *b) {
         len += 0x1C;
     }
 
-    pthread_rwlock_unlock(&b->lobby_lock);
-
     /* Fill in the rest of the header */
     pkt->hdr.flags = entries - 1;
     pkt->hdr.pkt_len = LE16(len);
 
-    /* Send it away */
-    return crypt_send(c, len, sendbuf);
+    return len;
 }
 
-static int send_ep3_game_list(ship_client_t *c, block_t *b) {
-    uint8_t *sendbuf = get_sendbuf();
+static int build_ep3_game_list(block_t *b, uint8_t *sendbuf) {
     dc_game_list_pkt *pkt = (dc_game_list_pkt *)sendbuf;
     int entries = 1, len = 0x20;
     lobby_t *l;
 
-    /* Verify we got the sendbuf. */
-    if(!sendbuf) {
-        return -1;
-    }
-
     /* Clear out the packet and the first entry */
     memset(pkt, 0, 0x20);
 
@@ -4353,18 +4633,16 @@ static int send_ep3_game_list(ship_client_t *c, block_t *b) {
     pkt->entries[0].flags = 0x04;
     strcpy(pkt->entries[0].name, b->ship->cfg->name);
 
-    pthread_rwlock_rdlock(&b->lobby_lock);
-
-    TAILQ_FOREACH(l, &b->lobbies, qentry) {
-        /* Lock the lobby */
-        pthread_mutex_lock(&l->mutex);
-
-        /* Ignore non-Episode 3 and default lobbies */
+    TAILQ_FOREACH(l, &b->games, gentry) {
+        /* Ignore non-Episode 3 games. The type of a lobby never changes, so
+           this doesn't need the lock. */
         if(l->type != LOBBY_TYPE_EP3_GAME) {
-            pthread_mutex_unlock(&l->mutex);
             continue;
         }
 
+        /* Lock the lobby */
+        pthread_mutex_lock(&l->mutex);
+
         /* Clear the entry */
         memset(pkt->entries + entries, 0, 0x1C);
 
@@ -4393,27 +4671,18 @@ static int send_ep3_game_list(ship_client_t *c, block_t *b) {
         len += 0x1C;
     }
 
-    pthread_rwlock_unlock(&b->lobby_lock);
-
     /* Fill in the rest of the header */
     pkt->hdr.flags = entries - 1;
     pkt->hdr.pkt_len = LE16(len);
 
-    /* Send it away */
-    return crypt_send(c, len, sendbuf);
+    return len;
 }
 
-static int send_bb_game_list(ship_client_t *c, block_t *b) {
-    uint8_t *sendbuf = get_sendbuf();
+static int build_bb_game_list(block_t *b, uint8_t *sendbuf) {
     bb_game_list_pkt *pkt = (bb_game_list_pkt *)sendbuf;
     int entries = 1, len = 0x34;
     lobby_t *l;
 
-    /* Verify we got the sendbuf. */
-    if(!sendbuf) {
-        return -1;
-    }
-
     /* Clear out the packet and the first entry */
     memset(pkt, 0, 0x34);
 
@@ -4428,14 +4697,18 @@ static int send_bb_game_list(ship_client_t *c, block_t *b) {
     istrncpy(ic_8859_to_utf16, (char *)pkt->entries[0].name, ship->cfg->name,
              0x20);
 
-    pthread_rwlock_rdlock(&b->lobby_lock);
+    TAILQ_FOREACH(l, &b->games, gentry) {
+        /* Ignore Episode 3 games. The type of a lobby never changes, so this
+           doesn't need the lock. */
+        if(l->type != LOBBY_TYPE_GAME) {
+            continue;
+        }
 
-    TAILQ_FOREACH(l, &b->lobbies, qentry) {
         /* Lock the lobby */
         pthread_mutex_lock(&l->mutex);
 
-        /* Ignore default lobbies and non-bb games */
-        if(l->type != LOBBY_TYPE_GAME || l->version != CLIENT_VERSION_BB) {
+        /* Ignore non-bb games */
+        if(l->version != CLIENT_VERSION_BB) {
             pthread_mutex_unlock(&l->mutex);
             continue;
         }
@@ -4465,40 +4738,139 @@ static int send_bb_game_list(ship_client_t *c, block_t *b) {
         len += 0x2C;
     }
 
-    pthread_rwlock_unlock(&b->lobby_lock);
-
     /* Fill in the rest of the header */
     pkt->hdr.flags = LE32(entries - 1);
     pkt->hdr.pkt_len = LE16(len);
 
-    /* Send it away */
-    return crypt_send(c, len, sendbuf);
+    return len;
 }
 
-int send_game_list(ship_client_t *c, block_t *b) {
-    /* Call the appropriate function. */
+/* Figure out which version of the game list the client should see. */
+static int game_list_class(ship_client_t *c) {
+    int nte = !!(c->flags & CLIENT_FLAG_IS_NTE);
+
     switch(c->version) {
         case CLIENT_VERSION_DCV1:
+            return nte ? BLOCK_GAME_LIST_DCV1_NTE : BLOCK_GAME_LIST_DCV1;
+
         case CLIENT_VERSION_DCV2:
-            return send_dc_game_list(c, b);
+            return nte ? BLOCK_GAME_LIST_DCV2_NTE : BLOCK_GAME_LIST_DCV2;
 
         case CLIENT_VERSION_PC:
-            return send_pc_game_list(c, b);
+            return nte ? BLOCK_GAME_LIST_PC_NTE : BLOCK_GAME_LIST_PC;
 
         case CLIENT_VERSION_GC:
         case CLIENT_VERSION_XBOX:
-            return send_gc_game_list(c, b);
+            if(c->flags & CLIENT_FLAG_SHOW_DCPC_ON_GC)
+                return BLOCK_GAME_LIST_GC_DCPC;
+
+            return BLOCK_GAME_LIST_GC;
 
         case CLIENT_VERSION_EP3:
-            return send_ep3_game_list(c, b);
+            return BLOCK_GAME_LIST_EP3;
 
         case CLIENT_VERSION_BB:
-            return send_bb_game_list(c, b);
+            return BLOCK_GAME_LIST_BB;
+    }
+
+    return -1;
+}
+
+static int build_game_list(block_t *b, uint8_t *sendbuf, int list) {
+    switch(list) {
+        case BLOCK_GAME_LIST_DCV1:
+        case BLOCK_GAME_LIST_DCV1_NTE:
+        case BLOCK_GAME_LIST_DCV2:
+        case BLOCK_GAME_LIST_DCV2_NTE:
+            return build_dc_game_list(b, sendbuf, list);
+
+        case BLOCK_GAME_LIST_PC:
+        case BLOCK_GAME_LIST_PC_NTE:
+            return build_pc_game_list(b, sendbuf, list);
+
+        case BLOCK_GAME_LIST_GC:
+        case BLOCK_GAME_LIST_GC_DCPC:
+            return build_gc_game_list(b, sendbuf, list);
+
+        case BLOCK_GAME_LIST_EP3:
+            return build_ep3_game_list(b, sendbuf);
+
+        case BLOCK_GAME_LIST_BB:
+            return build_bb_game_list(b, sendbuf);
     }
 
     return -1;
 }
 
+/* Copy a cached game list into the sendbuf, if it is still current. Returns the
+   length copied, or 0 if the cached copy is out of date. The caller must hold
+   the block's game_list_lock. */
+static int copy_game_list(block_game_list_t *gl, uint8_t *sendbuf,
+                          uint32_t gen) {
+    if(!gl->pkt || gl->gen != gen)
+        return 0;
+
+    memcpy(sendbuf, gl->pkt, gl->len);
+    return gl->len;
+}
+
+int send_game_list(ship_client_t *c, block_t *b) {
+    uint8_t *sendbuf = get_sendbuf();
+    int list = game_list_class(c), len;
+    block_game_list_t *gl;
+    uint32_t gen;
+    uint8_t *tmp;
+
+    /* Verify we got the sendbuf. */
+    if(!sendbuf || list < 0) {
+        return -1;
+    }
+
+    gl = &b->game_lists[list];
+
+    /* Most of the time nothing has changed since the last time anyone asked for
+       this list, so just copy it out of the cache. */
+    pthread_rwlock_rdlock(&b->game_list_lock);
+    gen = __atomic_load_n(&b->game_list_gen, __ATOMIC_ACQUIRE);
+    len = copy_game_list(gl, sendbuf, gen);
+    pthread_rwlock_unlock(&b->game_list_lock);
+
+    if(len)
+        return crypt_send(c, len, sendbuf);
+
+    /* Otherwise, rebuild it (unless someone beat us to it). The generation is
+       read before looking at any of the games, so anything that changes while
+       the list is being built will leave it marked as out of date. */
+    pthread_rwlock_wrlock(&b->game_list_lock);
+    gen = __atomic_load_n(&b->game_list_gen, __ATOMIC_ACQUIRE);
+
+    if(!(len = copy_game_list(gl, sendbuf, gen))) {
+        pthread_rwlock_rdlock(&b->lobby_lock);
+        len = build_game_list(b, sendbuf, list);
+        pthread_rwlock_unlock(&b->lobby_lock);
+
+        /* Save a copy for next time. If we can't, that's not the end of the
+           world, it'll just get rebuilt again next time. */
+        if(len > gl->size) {
+            if((tmp = (uint8_t *)realloc(gl->pkt, len))) {
+                gl->pkt = tmp;
+                gl->size = len;
+            }
+        }
+
+        if(len <= gl->size) {
+            memcpy(gl->pkt, sendbuf, len);
+            gl->len = len;
+            gl->gen = gen;
+        }
+    }
+
+    pthread_rwlock_unlock(&b->game_list_lock);
+
+    /* Send it away */
+    return crypt_send(c, len, sendbuf);
+}
+
 /* Send the list of lobby info items to the client. */
 static int send_dc_info_list(ship_client_t *c, ship_t *s, uint32_t v) {
     uint8_t *sendbuf = get_sendbuf();
@@ -7264,7 +7636,7 @@ int send_quest(lobby_t *l, uint32_t qid, int lc) {
 
                     /* Unfortunately, we're going to have to disconnect the user
                        if this happens, since we really have no recourse. */
-                    c->flags |= CLIENT_FLAG_DISCONNECTED;
+                    client_disconnect(c);
                     continue;
                 }
             }
@@ -7272,7 +7644,7 @@ int send_quest(lobby_t *l, uint32_t qid, int lc) {
             /* Set the counter we'll use to prevent v1 from sending silly
                packets to change other players' positions. */
             if(c->version == CLIENT_VERSION_DCV1)
-                c->autoreply_len = l->num_clients - 1;
+                c->cold->autoreply_len = l->num_clients - 1;
 
             if(q->format == SYLVERANT_QUEST_BINDAT) {
                 /* Call the appropriate function. */
@@ -7311,7 +7683,7 @@ int send_quest(lobby_t *l, uint32_t qid, int lc) {
                                  "this problem!\nInclude your guildcard\n"
                                  "number and the approximate\ntime in your "
                                  "error report.");
-                c->flags |= CLIENT_FLAG_DISCONNECTED;
+                client_disconnect(c);
             }
         }
     }
@@ -7374,7 +7746,7 @@ int send_quest_one(lobby_t *l, ship_client_t *c, uint32_t qid, int lc) {
 
             /* Unfortunately, we're going to have to disconnect the user
                if this happens, since we really have no recourse. */
-            c->flags |= CLIENT_FLAG_DISCONNECTED;
+            client_disconnect(c);
             return -1;
         }
     }
@@ -7382,7 +7754,7 @@ int send_quest_one(lobby_t *l, ship_client_t *c, uint32_t qid, int lc) {
     /* Set the counter we'll use to prevent v1 from sending silly
        packets to change other players' positions. */
     if(c->version == CLIENT_VERSION_DCV1)
-        c->autoreply_len = l->num_clients - 1;
+        c->cold->autoreply_len = l->num_clients - 1;
 
     if(q->format == SYLVERANT_QUEST_BINDAT) {
         /* Call the appropriate function. */
@@ -7421,7 +7793,7 @@ int send_quest_one(lobby_t *l, ship_client_t *c, uint32_t qid, int lc) {
                          "this problem!\nInclude your guildcard\n"
                          "number and the approximate\ntime in your "
                          "error report.");
-        c->flags |= CLIENT_FLAG_DISCONNECTED;
+        client_disconnect(c);
     }
 
     return 0;
@@ -8239,28 +8611,52 @@ int send_warp(ship_client_t *c, uint8_t area) {
     return -1;
 }
 
+static void send_lobby_warp_client(ship_client_t *c, uint8_t area) {
+    pthread_mutex_lock(&c->mutex);
+
+    /* Call the appropriate function. */
+    switch(c->version) {
+        case CLIENT_VERSION_DCV2:
+        case CLIENT_VERSION_GC:
+        case CLIENT_VERSION_EP3:
+        case CLIENT_VERSION_XBOX:
+            send_dc_warp(c, area);
+            break;
+
+        case CLIENT_VERSION_PC:
+            send_pc_warp(c, area);
+            break;
+    }
+
+    pthread_mutex_unlock(&c->mutex);
+}
+
+/* Warp a member of a team that is being served by another worker thread. This
+   runs on that worker's thread. */
+static void lobby_warp_worker(block_worker_t *w, block_msg_t *m) {
+    ship_client_t *c;
+
+    if((c = block_msg_target(w, m)))
+        send_lobby_warp_client(c, (uint8_t)m->arg);
+}
+
 int send_lobby_warp(lobby_t *l, uint8_t area) {
     int i;
+    ship_client_t *c;
+    block_worker_t *w = block_current_worker();
+    block_msg_t *m;
 
     for(i = 0; i < l->max_clients; ++i) {
-        if(l->clients[i] != NULL) {
-            pthread_mutex_lock(&l->clients[i]->mutex);
-
-            /* Call the appropriate function. */
-            switch(l->clients[i]->version) {
-                case CLIENT_VERSION_DCV2:
-                case CLIENT_VERSION_GC:
-                case CLIENT_VERSION_EP3:
-                case CLIENT_VERSION_XBOX:
-                    send_dc_warp(l->clients[i], area);
-                    break;
-
-                case CLIENT_VERSION_PC:
-                    send_pc_warp(l->clients[i], area);
-                    break;
-            }
+        if(!(c = l->clients[i]))
+            continue;
 
-            pthread_mutex_unlock(&l->clients[i]->mutex);
+        /* Leave anyone on another worker to that worker to deal with. */
+        if(c->worker == w) {
+            send_lobby_warp_client(c, area);
+        }
+        else if((m = block_msg_alloc(&lobby_warp_worker, c->guildcard, area,
+                                     NULL, 0))) {
+            block_msg_post(c->worker, m);
         }
     }
 
@@ -9267,7 +9663,7 @@ int send_mail_autoreply(ship_client_t *d, ship_client_t *s) {
             }
 
             /* Copy the message */
-            memcpy(p.stuff, s->autoreply, s->autoreply_len);
+            memcpy(p.stuff, s->cold->autoreply, s->cold->autoreply_len);
 
             /* Send it */
             send_simple_mail(s->version, d, dc);
@@ -9291,7 +9687,7 @@ int send_mail_autoreply(ship_client_t *d, ship_client_t *s) {
 
             /* Copy the name and message */
             memcpy(p.name, s->pl->v1.name, 16);
-            memcpy(p.stuff, s->autoreply, s->autoreply_len);
+            memcpy(p.stuff, s->cold->autoreply, s->cold->autoreply_len);
 
             /* Send it */
             send_simple_mail(s->version, d, dc);
@@ -9312,7 +9708,7 @@ int send_mail_autoreply(ship_client_t *d, ship_client_t *s) {
 
             /* Copy the name, date/time, and message */
             memcpy(p.name, s->pl->bb.character.name, 32);
-            memcpy(p.message, s->autoreply, s->autoreply_len);
+            memcpy(p.message, s->cold->autoreply, s->cold->autoreply_len);
 
             /* Send it */
             send_bb_simple_mail(d, &p);
@@ -96,6 +96,10 @@ const static char bb_welcome_copyright[] =
 /* Encrypt and send a packet away. */
 int crypt_send(ship_client_t *c, int len, uint8_t *sendbuf);
 
+/* Encrypt and queue up anything other workers have sent the client. This must
+   be called from wherever crypt_send() could be called for the client. */
+int crypt_send_pending(ship_client_t *c);
+
 /* Retrieve the thread-specific sendbuf for the current thread. */
 uint8_t *get_sendbuf();
 
@@ -146,6 +150,33 @@ int send_lobby_join(ship_client_t *c, lobby_t *l);
 int send_pkt_dc(ship_client_t *c, const dc_pkt_hdr_t *pkt);
 int send_pkt_bb(ship_client_t *c, const bb_pkt_hdr_t *pkt);
 
+/* A prepared packet that is to be sent to a bunch of clients, possibly on
+   different versions. The whole packet (header, data and padding) is put
+   together for each wire format once up front, so all that's left to do for
+   each client is to encrypt it on its way into the client's output queue. */
+#define PKT_FANOUT_DC   0                   /* DCv1, DCv2, GC, Ep3, Xbox */
+#define PKT_FANOUT_PC   1
+#define PKT_FANOUT_BB   2
+
+/* Room for the biggest packet in each format, plus padding. */
+#define PKT_FANOUT_BUF_SIZE     (65536 + 8)
+
+typedef struct pkt_fanout {
+    const uint8_t *pkt[3];
+    int len[3];
+} pkt_fanout_t;
+
+/* Prepare a packet in DC or BB format for sending to multiple clients. The
+   prepared packets are kept in a buffer belonging to the current thread, so
+   they're only good until the next one is prepared on the same thread. The
+   original packet can be thrown away as soon as this returns. Returns -1 if
+   the buffer couldn't be allocated. */
+int pkt_fanout_init_dc(pkt_fanout_t *f, const dc_pkt_hdr_t *pkt);
+int pkt_fanout_init_bb(pkt_fanout_t *f, const bb_pkt_hdr_t *pkt);
+
+/* Send a prepared packet to one client. */
+int send_pkt_fanout(ship_client_t *c, const pkt_fanout_t *f);
+
 /* Send a packet to all clients in the lobby when a new player joins. */
 int send_lobby_add_player(lobby_t *l, ship_client_t *c);
 
@@ -1,7 +1,7 @@
 /*
     Sylverant Ship Server
     Copyright (C) 2009, 2010, 2011, 2012, 2013, 2014, 2016, 2018, 2019, 2020,
-                  2021, 2022, 2023, 2024, 2025 Lawrence Sebald
+                  2021, 2022, 2023, 2024, 2025, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -77,6 +77,8 @@ int pidfile_fileno(struct pidfh *pfh);
 /* The actual ship structures. */
 ship_t *ship;
 int enable_ipv6 = 1;
+int block_workers = 1;
+int prefill_keystream = 0;
 int restart_on_shutdown = 0;
 uint32_t ship_ip4;
 uint8_t ship_ip6[16];
@@ -127,6 +129,12 @@ static void print_help(const char *bin) {
 #ifdef SYLVERANT_ENABLE_IPV6
            "--no-ipv6       Disable IPv6 support for incoming connections\n"
 #endif
+           "--block-threads n\n"
+           "                Serve each block with n threads instead of just\n"
+           "                one (requires SO_REUSEPORT support).\n"
+           "--prefill-keystream\n"
+           "                Generate encryption keystream for PC/DC/GC clients\n"
+           "                ahead of time when a block thread is idle.\n"
            "--check-config  Load and parse the configuration, but do not\n"
            "                actually start the ship server. This implies the\n"
            "                --nodaemon option as well.\n"
@@ -190,6 +198,33 @@ static void parse_command_line(int argc, char *argv[]) {
         else if(!strcmp(argv[i], "--no-ipv6")) {
             enable_ipv6 = 0;
         }
+        else if(!strcmp(argv[i], "--block-threads")) {
+            if(i == argc - 1) {
+                printf("--block-threads requires an argument!\n\n");
+                print_help(argv[0]);
+                exit(EXIT_FAILURE);
+            }
+
+            block_workers = atoi(argv[++i]);
+
+            if(block_workers < 1 || block_workers > BLOCK_MAX_WORKERS) {
+                printf("--block-threads must be between 1 and %d!\n\n",
+                       BLOCK_MAX_WORKERS);
+                print_help(argv[0]);
+                exit(EXIT_FAILURE);
+            }
+
+#ifndef SO_REUSEPORT
+            if(block_workers > 1) {
+                printf("--block-threads requires SO_REUSEPORT, which is not "
+                       "supported on this system!\n");
+                exit(EXIT_FAILURE);
+            }
+#endif
+        }
+        else if(!strcmp(argv[i], "--prefill-keystream")) {
+            prefill_keystream = 1;
+        }
         else if(!strcmp(argv[i], "--check-config")) {
             check_only = 1;
             dont_daemonize = 1;
@@ -964,6 +999,11 @@ restart:
             free(tmp);
             pthread_setspecific(recvbuf_key, NULL);
         }
+
+        if((tmp = pthread_getspecific(fanoutbuf_key))) {
+            free(tmp);
+            pthread_setspecific(fanoutbuf_key, NULL);
+        }
     }
     else {
         ship_check_cfg(cfg);
@@ -1,7 +1,7 @@
 /*
     Sylverant Ship Server
     Copyright (C) 2009, 2010, 2011, 2012, 2014, 2015, 2016, 2018, 2019, 2021,
-                  2022, 2024 Lawrence Sebald
+                  2022, 2024, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -40,6 +40,7 @@
 #include "ship_packets.h"
 #include "scripts.h"
 #include "quest_functions.h"
+#include "gcindex.h"
 #include "version.h"
 
 /* TLS stuff -- from ship_server.c */
@@ -300,48 +301,27 @@ void shipgate_cleanup(shipgate_conn_t *c) {
 }
 
 static int handle_dc_greply(shipgate_conn_t *conn, dc_guild_reply_pkt *pkt) {
-    int i;
-    ship_t *s = conn->ship;
     block_t *b;
     ship_client_t *c;
     uint32_t dest = LE32(pkt->gc_search);
-    int done = 0, rv = 0;
-
-    for(i = 0; i < s->cfg->blocks && !done; ++i) {
-        if(s->blocks[i]) {
-            b = s->blocks[i];
-            pthread_rwlock_rdlock(&b->lock);
 
-            TAILQ_FOREACH(c, b->clients, qentry) {
-                pthread_mutex_lock(&c->mutex);
-
-                if(c->guildcard == dest) {
+    if((c = gcindex_find_any(dest, &b))) {
+        pthread_mutex_lock(&c->mutex);
 #ifdef SYLVERANT_ENABLE_IPV6
-                    if(pkt->hdr.flags != 6) {
-                        send_guild_reply_sg(c, pkt);
-                    }
-                    else {
-                        send_guild_reply6_sg(c, (dc_guild_reply6_pkt *)pkt);
-                    }
+        if(pkt->hdr.flags != 6) {
+            send_guild_reply_sg(c, pkt);
+        }
+        else {
+            send_guild_reply6_sg(c, (dc_guild_reply6_pkt *)pkt);
+        }
 #else
-                    send_guild_reply_sg(c, pkt);
+        send_guild_reply_sg(c, pkt);
 #endif
-
-                    done = 1;
-                }
-
-                pthread_mutex_unlock(&c->mutex);
-
-                if(done) {
-                    break;
-                }
-            }
-
-            pthread_rwlock_unlock(&b->lock);
-        }
+        pthread_mutex_unlock(&c->mutex);
+        pthread_rwlock_unlock(&b->lock);
     }
 
-    return rv;
+    return 0;
 }
 
 static int handle_bb_greply(shipgate_conn_t *conn, bb_guild_reply_pkt *pkt,
@@ -351,7 +331,7 @@ static int handle_bb_greply(shipgate_conn_t *conn, bb_guild_reply_pkt *pkt,
     uint32_t dest = LE32(pkt->gc_search);
 
     /* Make sure the block given is sane */
-    if(block > ship->cfg->blocks || !ship->blocks[block - 1]) {
+    if(!block || block > ship->cfg->blocks || !ship->blocks[block - 1]) {
         return 0;
     }
 
@@ -359,16 +339,9 @@ static int handle_bb_greply(shipgate_conn_t *conn, bb_guild_reply_pkt *pkt,
     pthread_rwlock_rdlock(&b->lock);
 
     /* Look for the client */
-    TAILQ_FOREACH(c, b->clients, qentry) {
+    if((c = gcindex_find(b, dest))) {
         pthread_mutex_lock(&c->mutex);
-
-        if(c->guildcard == dest) {
-            send_pkt_bb(c, (bb_pkt_hdr_t *)pkt);
-            pthread_mutex_unlock(&c->mutex);
-            pthread_rwlock_unlock(&b->lock);
-            return 0;
-        }
-
+        send_pkt_bb(c, (bb_pkt_hdr_t *)pkt);
         pthread_mutex_unlock(&c->mutex);
     }
 
@@ -401,7 +374,7 @@ static void handle_mail_autoreply(shipgate_conn_t *c, ship_client_t *s,
             }
 
             /* Copy the message */
-            memcpy(p.stuff, s->autoreply, s->autoreply_len);
+            memcpy(p.stuff, s->cold->autoreply, s->cold->autoreply_len);
 
             /* Send it */
             shipgate_fw_pc(c, dc, 0, s);
@@ -425,7 +398,7 @@ static void handle_mail_autoreply(shipgate_conn_t *c, ship_client_t *s,
 
             /* Copy the name and message */
             memcpy(p.name, s->pl->v1.name, 16);
-            memcpy(p.stuff, s->autoreply, s->autoreply_len);
+            memcpy(p.stuff, s->cold->autoreply, s->cold->autoreply_len);
 
             /* Send it */
             shipgate_fw_dc(c, dc, 0, s);
@@ -434,180 +407,90 @@ static void handle_mail_autoreply(shipgate_conn_t *c, ship_client_t *s,
 
         case CLIENT_VERSION_BB:
         {
-            bb_simple_mail_pkt p;
+            /* The packet on the wire is a bit longer than the structure, so
+               build it in a buffer that's big enough for the whole thing. */
+            uint8_t buf[BB_SIMPLE_MAIL_LENGTH];
+            bb_simple_mail_pkt *p = (bb_simple_mail_pkt *)buf;
 
             /* Build the packet up */
-            memset(&p, 0, sizeof(bb_simple_mail_pkt));
-            p.hdr.pkt_type = LE16(SIMPLE_MAIL_TYPE);
-            p.hdr.pkt_len = LE16(BB_SIMPLE_MAIL_LENGTH);
-            p.tag = LE32(0x00010000);
-            p.gc_sender = LE32(s->guildcard);
-            p.gc_dest = LE32(dest);
+            memset(buf, 0, BB_SIMPLE_MAIL_LENGTH);
+            p->hdr.pkt_type = LE16(SIMPLE_MAIL_TYPE);
+            p->hdr.pkt_len = LE16(BB_SIMPLE_MAIL_LENGTH);
+            p->tag = LE32(0x00010000);
+            p->gc_sender = LE32(s->guildcard);
+            p->gc_dest = LE32(dest);
 
             /* Copy the name, date/time, and message */
-            memcpy(p.name, s->pl->bb.character.name, 32);
-            memcpy(p.message, s->autoreply, s->autoreply_len);
+            memcpy(p->name, s->pl->bb.character.name, 32);
+            memcpy(p->message, s->cold->autoreply, s->cold->autoreply_len);
 
             /* Send it */
-            shipgate_fw_bb(c, (bb_pkt_hdr_t *)&p, 0, s);
+            shipgate_fw_bb(c, (bb_pkt_hdr_t *)buf, 0, s);
             break;
         }
     }
 }
 
-static int handle_dc_mail(shipgate_conn_t *conn, dc_simple_mail_pkt *pkt) {
-    int i;
-    ship_t *s = conn->ship;
-    block_t *b;
+/* Deliver a simple mail that came in from the shipgate to its recipient. This
+   runs on the thread of the block worker that owns the recipient. */
+static void mail_worker(block_worker_t *w, block_msg_t *m) {
     ship_client_t *c;
-    uint32_t dest = LE32(pkt->gc_dest);
-    uint32_t sender = LE32(pkt->gc_sender);
-    int done = 0, rv = 0;
-
-    for(i = 0; i < s->cfg->blocks && !done; ++i) {
-        if(s->blocks[i]) {
-            b = s->blocks[i];
-            pthread_rwlock_rdlock(&b->lock);
-
-            TAILQ_FOREACH(c, b->clients, qentry) {
-                pthread_mutex_lock(&c->mutex);
-
-                if(c->guildcard == dest && c->pl) {
-                    /* Make sure the user hasn't blacklisted the sender. */
-                    if(client_has_blacklisted(c, sender) ||
-                       client_has_ignored(c, sender)) {
-                        done = 1;
-                        pthread_mutex_unlock(&c->mutex);
-                        rv = 0;
-                        break;
-                    }
-
-                    /* Check if the user has an autoreply set. */
-                    if(c->autoreply_on) {
-                        handle_mail_autoreply(conn, c, sender);
-                    }
+    uint32_t sender;
+    int autoreply;
 
-                    /* Forward the packet there. */
-                    rv = send_simple_mail(CLIENT_VERSION_DCV1, c,
-                                          (dc_pkt_hdr_t *)pkt);
-                    done = 1;
-                }
+    if(!(c = block_msg_target(w, m))) {
+        return;
+    }
 
-                pthread_mutex_unlock(&c->mutex);
+    pthread_mutex_lock(&c->mutex);
 
-                if(done) {
-                    break;
-                }
-            }
+    if(m->arg == CLIENT_VERSION_BB) {
+        sender = LE32(((bb_simple_mail_pkt *)m->data)->gc_sender);
+        autoreply = c->cold->autoreply != NULL;
+    }
+    else if(m->arg == CLIENT_VERSION_PC) {
+        sender = LE32(((pc_simple_mail_pkt *)m->data)->gc_sender);
+        autoreply = c->cold->autoreply != NULL;
+    }
+    else {
+        sender = LE32(((dc_simple_mail_pkt *)m->data)->gc_sender);
+        autoreply = c->cold->autoreply_on;
+    }
 
-            pthread_rwlock_unlock(&b->lock);
+    /* Make sure the user hasn't blacklisted the sender. */
+    if(c->pl && !client_has_blacklisted(c, sender) &&
+       !client_has_ignored(c, sender)) {
+        /* Check if the user has an autoreply set. */
+        if(autoreply) {
+            handle_mail_autoreply(&ship->sg, c, sender);
         }
+
+        /* Forward the packet there. */
+        if(m->arg == CLIENT_VERSION_BB)
+            send_bb_simple_mail(c, (bb_simple_mail_pkt *)m->data);
+        else
+            send_simple_mail(m->arg, c, (dc_pkt_hdr_t *)m->data);
     }
 
-    return rv;
+    pthread_mutex_unlock(&c->mutex);
 }
 
-static int handle_pc_mail(shipgate_conn_t *conn, pc_simple_mail_pkt *pkt) {
-    int i;
-    ship_t *s = conn->ship;
-    block_t *b;
-    ship_client_t *c;
-    uint32_t dest = LE32(pkt->gc_dest);
-    uint32_t sender = LE32(pkt->gc_sender);
-    int done = 0, rv = 0;
-
-    for(i = 0; i < s->cfg->blocks && !done; ++i) {
-        if(s->blocks[i]) {
-            b = s->blocks[i];
-            pthread_rwlock_rdlock(&b->lock);
-
-            TAILQ_FOREACH(c, b->clients, qentry) {
-                pthread_mutex_lock(&c->mutex);
-
-                if(c->guildcard == dest && c->pl) {
-                    /* Make sure the user hasn't blacklisted the sender. */
-                    if(client_has_blacklisted(c, sender) ||
-                       client_has_ignored(c, sender)) {
-                        done = 1;
-                        pthread_mutex_unlock(&c->mutex);
-                        rv = 0;
-                        break;
-                    }
-
-                    /* Check if the user has an autoreply set. */
-                    if(c->autoreply) {
-                        handle_mail_autoreply(conn, c, sender);
-                    }
-
-                    /* Forward the packet there. */
-                    rv = send_simple_mail(CLIENT_VERSION_PC, c,
-                                          (dc_pkt_hdr_t *)pkt);
-                    done = 1;
-                }
-
-                pthread_mutex_unlock(&c->mutex);
-
-                if(done) {
-                    break;
-                }
-            }
-
-            pthread_rwlock_unlock(&b->lock);
-        }
-    }
+static int handle_dc_mail(shipgate_conn_t *conn, dc_simple_mail_pkt *pkt) {
+    block_msg_send(NULL, LE32(pkt->gc_dest), &mail_worker,
+                   CLIENT_VERSION_DCV1, pkt, sizeof(dc_simple_mail_pkt));
+    return 0;
+}
 
-    return rv;
+static int handle_pc_mail(shipgate_conn_t *conn, pc_simple_mail_pkt *pkt) {
+    block_msg_send(NULL, LE32(pkt->gc_dest), &mail_worker, CLIENT_VERSION_PC,
+                   pkt, sizeof(pc_simple_mail_pkt));
+    return 0;
 }
 
 static int handle_bb_mail(shipgate_conn_t *conn, bb_simple_mail_pkt *pkt) {
-    int i;
-    ship_t *s = conn->ship;
-    block_t *b;
-    ship_client_t *c;
-    uint32_t dest = LE32(pkt->gc_dest);
-    uint32_t sender = LE32(pkt->gc_sender);
-    int done = 0, rv = 0;
-
-    for(i = 0; i < s->cfg->blocks && !done; ++i) {
-        if(s->blocks[i]) {
-            b = s->blocks[i];
-            pthread_rwlock_rdlock(&b->lock);
-
-            TAILQ_FOREACH(c, b->clients, qentry) {
-                pthread_mutex_lock(&c->mutex);
-
-                if(c->guildcard == dest && c->pl) {
-                    /* Make sure the user hasn't blacklisted the sender. */
-                    if(client_has_blacklisted(c, sender) ||
-                       client_has_ignored(c, sender)) {
-                        done = 1;
-                        pthread_mutex_unlock(&c->mutex);
-                        rv = 0;
-                        break;
-                    }
-
-                    /* Check if the user has an autoreply set. */
-                    if(c->autoreply) {
-                        handle_mail_autoreply(conn, c, sender);
-                    }
-
-                    /* Forward the packet there. */
-                    rv = send_bb_simple_mail(c, pkt);
-                    done = 1;
-                }
-
-                pthread_mutex_unlock(&c->mutex);
-
-                if(done) {
-                    break;
-                }
-            }
-
-            pthread_rwlock_unlock(&b->lock);
-        }
-    }
-
-    return rv;
+    block_msg_send(NULL, LE32(pkt->gc_dest), &mail_worker, CLIENT_VERSION_BB,
+                   pkt, sizeof(bb_simple_mail_pkt));
+    return 0;
 }
 
 static int handle_dc(shipgate_conn_t *conn, shipgate_fw_9_pkt *pkt) {
@@ -912,7 +795,7 @@ static int handle_usrlogin(shipgate_conn_t *conn,
     }
 
     /* Check the block number first. */
-    if(block > s->cfg->blocks) {
+    if(!block || block > s->cfg->blocks) {
         return 0;
     }
 
@@ -920,14 +803,11 @@ static int handle_usrlogin(shipgate_conn_t *conn,
     pthread_rwlock_rdlock(&b->lock);
 
     /* Find the requested client. */
-    TAILQ_FOREACH(i, b->clients, qentry) {
-        if(i->guildcard == gc) {
-            i->privilege |= ntohl(pkt->priv);
-            i->flags |= CLIENT_FLAG_LOGGED_IN;
-            i->flags &= ~CLIENT_FLAG_GC_PROTECT;
-            send_txt(i, "%s", __(i, "\tE\tC7Login Successful."));
-            break;
-        }
+    if((i = gcindex_find(b, gc))) {
+        i->privilege |= ntohl(pkt->priv);
+        i->flags |= CLIENT_FLAG_LOGGED_IN;
+        i->flags &= ~CLIENT_FLAG_GC_PROTECT;
+        send_txt(i, "%s", __(i, "\tE\tC7Login Successful."));
     }
 
     pthread_rwlock_unlock(&b->lock);
@@ -1053,7 +933,7 @@ static int handle_ban(shipgate_conn_t *conn, shipgate_ban_err_pkt *pkt) {
                     if(flags & SHDR_FAILURE) {
                         /* If the not gm flag is set, disconnect the user. */
                         if(ntohl(pkt->base.error_code) == ERR_BAN_NOT_GM) {
-                            c->flags |= CLIENT_FLAG_DISCONNECTED;
+                            client_disconnect(c);
                         }
 
                         send_txt(c, "%s", __(c, "\tE\tC7Error setting ban."));
@@ -1157,7 +1037,7 @@ static int handle_usrlogin_err(shipgate_conn_t *conn,
     }
 
     /* Check the block number first. */
-    if(block > s->cfg->blocks) {
+    if(!block || block > s->cfg->blocks) {
         return 0;
     }
 
@@ -1185,7 +1065,7 @@ static int handle_blogin_err(shipgate_conn_t *c, shipgate_blogin_err_pkt *pkt) {
     ship_client_t *i;
 
     /* Grab the block first */
-    if(block > s->cfg->blocks || !(b = s->blocks[block - 1])) {
+    if(!block || block > s->cfg->blocks || !(b = s->blocks[block - 1])) {
         return 0;
     }
 
@@ -1195,7 +1075,7 @@ static int handle_blogin_err(shipgate_conn_t *c, shipgate_blogin_err_pkt *pkt) {
        for now) */
     TAILQ_FOREACH(i, b->clients, qentry) {
         if(i->guildcard == gc) {
-            i->flags |= CLIENT_FLAG_DISCONNECTED;
+            client_disconnect(i);
         }
     }
 
@@ -1269,7 +1149,7 @@ static int handle_friend(shipgate_conn_t *c, shipgate_friend_login_pkt *pkt) {
     fbl = ntohl(pkt->friend_block);
 
     /* Grab the block structure where the user is */
-    if(ubl > s->cfg->blocks || !(b = s->blocks[ubl - 1])) {
+    if(!ubl || ubl > s->cfg->blocks || !(b = s->blocks[ubl - 1])) {
         return 0;
     }
 
@@ -1288,13 +1168,10 @@ static int handle_friend(shipgate_conn_t *c, shipgate_friend_login_pkt *pkt) {
     /* Find the user in question */
     pthread_rwlock_rdlock(&b->lock);
 
-    TAILQ_FOREACH(cl, b->clients, qentry) {
-        if(cl->guildcard == ugc) {
-            /* The rest is easy */
-            client_send_friendmsg(cl, on, pkt->friend_name, ms->name, fbl,
-                                  pkt->friend_nick);
-            break;
-        }
+    if((cl = gcindex_find(b, ugc))) {
+        /* The rest is easy */
+        client_send_friendmsg(cl, on, pkt->friend_name, ms->name, fbl,
+                              pkt->friend_nick);
     }
 
     pthread_rwlock_unlock(&b->lock);
@@ -1420,7 +1297,7 @@ static int handle_kick(shipgate_conn_t *conn, shipgate_kick_pkt *pkt) {
     ship_client_t *i;
 
     /* Check the block number first. */
-    if(block > s->cfg->blocks) {
+    if(!block || block > s->cfg->blocks) {
         return 0;
     }
 
@@ -1428,22 +1305,19 @@ static int handle_kick(shipgate_conn_t *conn, shipgate_kick_pkt *pkt) {
     pthread_rwlock_rdlock(&b->lock);
 
     /* Find the requested client. */
-    TAILQ_FOREACH(i, b->clients, qentry) {
-        if(i->guildcard == gc) {
-            /* Found them, send the message and disconnect the client */
-            if(strlen(pkt->reason) > 0) {
-                send_message_box(i, "%s\n\n%s\n%s",
-                                 __(i, "\tEYou have been kicked by a GM."),
-                                 __(i, "Reason:"), pkt->reason);
-            }
-            else {
-                send_message_box(i, "%s",
-                                 __(i, "\tEYou have been kicked by a GM."));
-            }
-
-            i->flags |= CLIENT_FLAG_DISCONNECTED;
-            break;
+    if((i = gcindex_find(b, gc))) {
+        /* Found them, send the message and disconnect the client */
+        if(strlen(pkt->reason) > 0) {
+            send_message_box(i, "%s\n\n%s\n%s",
+                             __(i, "\tEYou have been kicked by a GM."),
+                             __(i, "Reason:"), pkt->reason);
         }
+        else {
+            send_message_box(i, "%s",
+                             __(i, "\tEYou have been kicked by a GM."));
+        }
+
+        client_disconnect(i);
     }
 
     pthread_rwlock_unlock(&b->lock);
@@ -1462,7 +1336,7 @@ static int handle_frlist(shipgate_conn_t *c, shipgate_friend_list_pkt *pkt) {
     size_t len = 0;
 
     /* Check the block number first. */
-    if(block > s->cfg->blocks)
+    if(!block || block > s->cfg->blocks)
         return 0;
 
     b = s->blocks[block - 1];
@@ -1518,7 +1392,7 @@ static int handle_frlist(shipgate_conn_t *c, shipgate_friend_list_pkt *pkt) {
 
             /* Send the message to the user */
             if(send_message_box(i, "%s", msg)) {
-                i->flags |= CLIENT_FLAG_DISCONNECTED;
+                client_disconnect(i);
             }
 
             pthread_mutex_unlock(&i->mutex);
@@ -1531,12 +1405,28 @@ static int handle_frlist(shipgate_conn_t *c, shipgate_friend_list_pkt *pkt) {
     return 0;
 }
 
+/* Send a global message to everyone on a block worker. This runs on the
+   worker's own thread. */
+static void globalmsg_worker(block_worker_t *w, block_msg_t *m) {
+    ship_client_t *i2;
+
+    TAILQ_FOREACH(i2, w->block->clients, qentry) {
+        if(i2->worker != w)
+            continue;
+
+        pthread_mutex_lock(&i2->mutex);
+
+        if(i2->pl) {
+            send_txt(i2, "%s\n%s", __(i2, "\tE\tC7Global Message:"),
+                     (const char *)m->data);
+        }
+
+        pthread_mutex_unlock(&i2->mutex);
+    }
+}
+
 static int handle_globalmsg(shipgate_conn_t *c, shipgate_global_msg_pkt *pkt) {
     uint16_t text_len;
-    ship_t *s = c->ship;
-    int i;
-    block_t *b;
-    ship_client_t *i2;
 
     /* Make sure the message looks sane */
     text_len = ntohs(pkt->hdr.pkt_len) - sizeof(shipgate_global_msg_pkt);
@@ -1547,148 +1437,139 @@ static int handle_globalmsg(shipgate_conn_t *c, shipgate_global_msg_pkt *pkt) {
         return 0;
     }
 
-    /* Go through each block and send the message to anyone that is alive. */
-    for(i = 0; i < s->cfg->blocks; ++i) {
-        b = s->blocks[i];
+    /* Have each block's workers send the message to anyone that is alive. */
+    block_msg_broadcast(&globalmsg_worker, 0, pkt->text, text_len);
+    return 0;
+}
 
-        if(b && b->run) {
-            pthread_rwlock_rdlock(&b->lock);
+/* Apply the options the shipgate sent for a user. This runs on the thread of
+   the block worker that owns the user. */
+static void useropt_worker(block_worker_t *w, block_msg_t *m) {
+    ship_client_t *i;
+    uint8_t *optptr = m->data;
+    uint8_t *endptr = m->data + m->len;
+    shipgate_user_opt_t *opt = (shipgate_user_opt_t *)optptr;
+    uint32_t option, length;
+
+    if(!(i = block_msg_target(w, m))) {
+        return;
+    }
+
+    pthread_mutex_lock(&i->mutex);
+
+    /* Deal with the options. The message only holds the options themselves,
+       so make sure not to read past the end of it. */
+    while(optptr + sizeof(shipgate_user_opt_t) <= endptr &&
+          opt->option != 0) {
+        option = ntohl(opt->option);
+        length = ntohl(opt->length);
+
+        /* An option that's too short (or claims to be longer than what's
+           left) would have us going around in circles or off the end. */
+        if(length < sizeof(shipgate_user_opt_t) ||
+           length > (size_t)(endptr - optptr))
+            break;
+
+        switch(option) {
+            case USER_OPT_QUEST_LANG:
+                /* Make sure the length is right */
+                if(length != 16)
+                    break;
+
+                /* The only byte of the data that's used is the first
+                   one. It has the language code in it. */
+                i->q_lang = opt->data[0];
+                break;
+
+            case USER_OPT_ENABLE_BACKUP:
+                /* Make sure the length is right */
+                if(length != 16)
+                    break;
+
+                /* The only byte of the data that's used is the first
+                   one. It is a boolean saying whether or not to enable
+                   the auto backup feature. */
+                if(opt->data[0])
+                    i->flags |= CLIENT_FLAG_AUTO_BACKUP;
+                break;
 
-            /* Send the message to each player. */
-            TAILQ_FOREACH(i2, b->clients, qentry) {
-                pthread_mutex_lock(&i2->mutex);
+            case USER_OPT_GC_PROTECT:
+                /* Make sure the length is right */
+                if(length != 16)
+                    break;
 
-                if(i2->pl) {
-                    send_txt(i2, "%s\n%s", __(i2, "\tE\tC7Global Message:"),
-                             pkt->text);
+                /* The only byte of the data that's used is the first
+                   one. It is a boolean saying whether or not to enable
+                   the guildcard protection feature. */
+                if(opt->data[0]) {
+                    i->flags |= CLIENT_FLAG_GC_PROTECT;
+                    send_txt(i, __(i, "\tE\tC7Guildcard is "
+                                   "protected.\nYou will be kicked\n"
+                                   "if you do not login."));
+                    i->join_time = time(NULL);
                 }
+                break;
 
-                pthread_mutex_unlock(&i2->mutex);
-            }
+            case USER_OPT_TRACK_KILLS:
+                /* Make sure the length is right */
+                if(length != 16)
+                    break;
 
-            pthread_rwlock_unlock(&b->lock);
+                /* The only byte of the data that's used is the first
+                   one. It is a boolean saying whether or not to enable
+                   kill tracking. */
+                if(opt->data[0])
+                    i->flags |= CLIENT_FLAG_TRACK_KILLS;
+                break;
+
+            case USER_OPT_LEGIT_ALWAYS:
+                /* Make sure the length is right */
+                if(length != 16)
+                    break;
+
+                /* The only byte of the data that's used is the first
+                   one. It is a boolean saying whether or not to always
+                   enable /legit automatically. */
+                if(opt->data[0])
+                    i->flags |= CLIENT_FLAG_ALWAYS_LEGIT;
+                break;
+
+            case USER_OPT_WORD_CENSOR:
+                /* Make sure the length is right */
+                if(length != 16)
+                    break;
+
+                /* The only byte of the data that's used is the first
+                   one. It is a boolean saying whether or not to enable
+                   the word censor. */
+                if(opt->data[0])
+                    i->flags |= CLIENT_FLAG_WORD_CENSOR;
+                break;
         }
+
+        /* Adjust the pointers to the next option */
+        optptr = optptr + length;
+        opt = (shipgate_user_opt_t *)optptr;
     }
 
-    return 0;
+    pthread_mutex_unlock(&i->mutex);
 }
 
 static int handle_useropt(shipgate_conn_t *c, shipgate_user_opt_pkt *pkt) {
     ship_t *s = c->ship;
-    block_t *b;
-    ship_client_t *i;
     uint32_t gc = ntohl(pkt->guildcard), block = ntohl(pkt->block);
     uint8_t *optptr = (uint8_t *)pkt->options;
     uint8_t *endptr = ((uint8_t *)pkt) + ntohs(pkt->hdr.pkt_len);
-    shipgate_user_opt_t *opt = (shipgate_user_opt_t *)optptr;
-    uint32_t option, length;
 
     /* Check the block number first. */
-    if(block > s->cfg->blocks) {
+    if(!block || block > s->cfg->blocks || !s->blocks[block - 1] ||
+       endptr <= optptr) {
         return 0;
     }
 
-    b = s->blocks[block - 1];
-    pthread_rwlock_rdlock(&b->lock);
-
-    /* Find the requested client. */
-    TAILQ_FOREACH(i, b->clients, qentry) {
-        if(i->guildcard == gc) {
-            pthread_mutex_lock(&i->mutex);
-
-            /* Deal with the options */
-            while(optptr < endptr && opt->option != 0) {
-                option = ntohl(opt->option);
-                length = ntohl(opt->length);
-
-                switch(option) {
-                    case USER_OPT_QUEST_LANG:
-                        /* Make sure the length is right */
-                        if(length != 16)
-                            break;
-
-                        /* The only byte of the data that's used is the first
-                           one. It has the language code in it. */
-                        i->q_lang = opt->data[0];
-                        break;
-
-                    case USER_OPT_ENABLE_BACKUP:
-                        /* Make sure the length is right */
-                        if(length != 16)
-                            break;
-
-                        /* The only byte of the data that's used is the first
-                           one. It is a boolean saying whether or not to enable
-                           the auto backup feature. */
-                        if(opt->data[0])
-                            i->flags |= CLIENT_FLAG_AUTO_BACKUP;
-                        break;
-
-                    case USER_OPT_GC_PROTECT:
-                        /* Make sure the length is right */
-                        if(length != 16)
-                            break;
-
-                        /* The only byte of the data that's used is the first
-                           one. It is a boolean saying whether or not to enable
-                           the guildcard protection feature. */
-                        if(opt->data[0]) {
-                            i->flags |= CLIENT_FLAG_GC_PROTECT;
-                            send_txt(i, __(i, "\tE\tC7Guildcard is "
-                                           "protected.\nYou will be kicked\n"
-                                           "if you do not login."));
-                            i->join_time = time(NULL);
-                        }
-                        break;
-
-                    case USER_OPT_TRACK_KILLS:
-                        /* Make sure the length is right */
-                        if(length != 16)
-                            break;
-
-                        /* The only byte of the data that's used is the first
-                           one. It is a boolean saying whether or not to enable
-                           kill tracking. */
-                        if(opt->data[0])
-                            i->flags |= CLIENT_FLAG_TRACK_KILLS;
-                        break;
-
-                    case USER_OPT_LEGIT_ALWAYS:
-                        /* Make sure the length is right */
-                        if(length != 16)
-                            break;
-
-                        /* The only byte of the data that's used is the first
-                           one. It is a boolean saying whether or not to always
-                           enable /legit automatically. */
-                        if(opt->data[0])
-                            i->flags |= CLIENT_FLAG_ALWAYS_LEGIT;
-                        break;
-
-                    case USER_OPT_WORD_CENSOR:
-                        /* Make sure the length is right */
-                        if(length != 16)
-                            break;
-
-                        /* The only byte of the data that's used is the first
-                           one. It is a boolean saying whether or not to enable
-                           the word censor. */
-                        if(opt->data[0])
-                            i->flags |= CLIENT_FLAG_WORD_CENSOR;
-                        break;
-                }
-
-                /* Adjust the pointers to the next option */
-                optptr = optptr + ntohl(opt->length);
-                opt = (shipgate_user_opt_t *)optptr;
-            }
-
-            pthread_mutex_unlock(&i->mutex);
-            break;
-        }
-    }
-
-    pthread_rwlock_unlock(&b->lock);
+    /* Hand the options off to whoever is taking care of the user. */
+    block_msg_send(s->blocks[block - 1], gc, &useropt_worker, 0, optptr,
+                   endptr - optptr);
     return 0;
 }
 
@@ -1699,7 +1580,7 @@ static int handle_bbopts(shipgate_conn_t *c, shipgate_bb_opts_pkt *pkt) {
     uint32_t gc = ntohl(pkt->guildcard), block = ntohl(pkt->block);
 
     /* Check the block number first. */
-    if(block > s->cfg->blocks) {
+    if(!block || block > s->cfg->blocks) {
         return 0;
     }
 
@@ -1947,7 +1828,7 @@ static int handle_sdata(shipgate_conn_t *c, shipgate_sdata_pkt *pkt) {
     uint32_t gc = ntohl(pkt->guildcard), block = ntohl(pkt->block);
 
     /* Check the block number first. */
-    if(block > s->cfg->blocks)
+    if(!block || block > s->cfg->blocks)
         return 0;
 
     b = s->blocks[block - 1];
@@ -1989,7 +1870,7 @@ static int handle_qflag(shipgate_conn_t *c, shipgate_qflag_pkt *pkt) {
     }
 
     /* Check the block number for sanity... */
-    if(block > s->cfg->blocks)
+    if(!block || block > s->cfg->blocks)
         return -1;
 
     b = s->blocks[block - 1];
@@ -2069,7 +1950,7 @@ static int handle_qflag_err(shipgate_conn_t *c, shipgate_qflag_err_pkt *pkt) {
     uint8_t flag_reg;
 
     /* Grab the block first */
-    if(block > s->cfg->blocks || !(b = s->blocks[block - 1])) {
+    if(!block || block > s->cfg->blocks || !(b = s->blocks[block - 1])) {
         return 0;
     }
 
@@ -2323,7 +2204,7 @@ static int handle_ubl(shipgate_conn_t *c, shipgate_user_blocklist_pkt *pkt) {
     if(len < sizeof(shipgate_user_blocklist_pkt) + 8 * count)
         return -1;
 
-    if(block > s->cfg->blocks)
+    if(!block || block > s->cfg->blocks)
         return 0;
 
     b = s->blocks[block - 1];
@@ -2349,11 +2230,11 @@ static int handle_ubl(shipgate_conn_t *c, shipgate_user_blocklist_pkt *pkt) {
                 list[j].flags = ntohl(pkt->entries[j].flags);
             }
 
-            if(i->blocklist)
-                free(i->blocklist);
+            if(i->cold->blocklist)
+                free(i->cold->blocklist);
 
-            i->blocklist_size = count;
-            i->blocklist = list;
+            i->cold->blocklist_size = count;
+            i->cold->blocklist = list;
 
             pthread_mutex_unlock(&i->mutex);
             break;
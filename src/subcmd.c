@@ -1,7 +1,7 @@
 /*
     Sylverant Ship Server
     Copyright (C) 2009, 2010, 2011, 2012, 2013, 2015, 2016, 2018, 2019, 2020,
-                  2021, 2022, 2023 Lawrence Sebald
+                  2021, 2022, 2023, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -22,7 +22,6 @@
 #include <pthread.h>
 
 #include <sylverant/debug.h>
-#include <sylverant/mtwist.h>
 #include <sylverant/items.h>
 
 #include "subcmd.h"
@@ -34,6 +33,7 @@
 #include "scripts.h"
 #include "shipgate.h"
 #include "quest_functions.h"
+#include "mtrand.h"
 
 /* Forward declarations */
 static int subcmd_send_shop_inv(ship_client_t *c, subcmd_bb_shop_req_t *req);
@@ -982,10 +982,10 @@ static int handle_gm_itemreq(ship_client_t *c, subcmd_itemreq_t *req) {
     gen.y = req->y;
     gen.unk1 = LE32(0x00000010);
 
-    gen.item[0] = LE32(c->next_item[0]);
-    gen.item[1] = LE32(c->next_item[1]);
-    gen.item[2] = LE32(c->next_item[2]);
-    gen.item2[0] = LE32(c->next_item[3]);
+    gen.item[0] = LE32(c->cold->next_item[0]);
+    gen.item[1] = LE32(c->cold->next_item[1]);
+    gen.item[2] = LE32(c->cold->next_item[2]);
+    gen.item2[0] = LE32(c->cold->next_item[3]);
     gen.item2[1] = LE32(0x00000002);
 
     /* Obviously not "right", but it works though, so we'll go with it. */
@@ -999,7 +999,7 @@ static int handle_gm_itemreq(ship_client_t *c, subcmd_itemreq_t *req) {
     }
 
     /* Clear this out. */
-    c->next_item[0] = c->next_item[1] = c->next_item[2] = c->next_item[3] = 0;
+    c->cold->next_item[0] = c->cold->next_item[1] = c->cold->next_item[2] = c->cold->next_item[3] = 0;
 
     return 0;
 }
@@ -1167,16 +1167,16 @@ static int handle_take_item(ship_client_t *c, subcmd_take_item_t *pkt) {
     /* See if its a stackable item, since we have to treat them differently. */
     if(item_is_stackable(v)) {
         /* Its stackable, so see if we have any in the inventory already */
-        for(i = 0; i < c->item_count; ++i) {
+        for(i = 0; i < c->cold->item_count; ++i) {
             /* Found it, add what we're adding in */
-            if(c->items[i].data_l[0] == pkt->data_l[0]) {
-                c->items[i].data_l[1] += pkt->data_l[1];
+            if(c->cold->items[i].data_l[0] == pkt->data_l[0]) {
+                c->cold->items[i].data_l[1] += pkt->data_l[1];
                 goto send_pkt;
             }
         }
     }
 
-    memcpy(&c->items[c->item_count++].data_l[0], &pkt->data_l[0],
+    memcpy(&c->cold->items[c->cold->item_count++].data_l[0], &pkt->data_l[0],
            sizeof(uint32_t) * 5);
 
 send_pkt:
@@ -1467,8 +1467,8 @@ static int handle_set_area(ship_client_t *c, subcmd_set_area_t *pkt) {
 
         /* Clear the list of dropped items. */
         if(c->cur_area == 0) {
-            memset(c->p2_drops, 0, sizeof(c->p2_drops));
-            c->p2_drops_max = 0;
+            memset(c->cold->p2_drops, 0, sizeof(c->cold->p2_drops));
+            c->cold->p2_drops_max = 0;
         }
 
         c->cur_area = pkt->area;
@@ -1517,7 +1517,7 @@ static int handle_set_pos(ship_client_t *c, subcmd_set_pos_t *pkt) {
     }
 
     /* Clear this, in case we're at the lobby counter */
-    c->last_info_req = 0;
+    c->cold->last_info_req = 0;
 
     return subcmd_send_lobby_dc(l, c, (subcmd_pkt_t *)pkt, 0);
 }
@@ -1590,8 +1590,8 @@ static int handle_delete_inv(ship_client_t *c, subcmd_destroy_item_t *pkt) {
            they can't possibly have it in their inventory. */
         item_id = LE32(pkt->item_id);
 
-        for(i = 0; i < c->p2_drops_max; ++i) {
-            if(c->p2_drops[i] == item_id) {
+        for(i = 0; i < c->cold->p2_drops_max; ++i) {
+            if(c->cold->p2_drops[i] == item_id) {
                 debug(DBG_WARN, "Guildcard %" PRIu32 " appears to be duping "
                       "item with id %" PRIu32 "!\n", c->guildcard, item_id);
             }
@@ -1604,13 +1604,13 @@ static int handle_delete_inv(ship_client_t *c, subcmd_destroy_item_t *pkt) {
     /* Ignore meseta */
     if(pkt->item_id != 0xFFFFFFFF) {
         /* Remove the item from the user's inventory */
-        num = item_remove_from_inv(c->items, c->item_count, pkt->item_id,
+        num = item_remove_from_inv(c->cold->items, c->cold->item_count, pkt->item_id,
                                    LE32(pkt->amount));
         if(num < 0) {
             debug(DBG_WARN, "Couldn't remove item from inventory!\n");
         }
         else {
-            c->item_count -= num;
+            c->cold->item_count -= num;
         }
     }
 
@@ -1644,18 +1644,18 @@ static int handle_buy(ship_client_t *c, subcmd_buy_t *pkt) {
     /* See if its a stackable item, since we have to treat them differently. */
     if(item_is_stackable(ic)) {
         /* Its stackable, so see if we have any in the inventory already */
-        for(i = 0; i < c->item_count; ++i) {
+        for(i = 0; i < c->cold->item_count; ++i) {
             /* Found it, add what we're adding in */
-            if(c->items[i].data_l[0] == pkt->item[0]) {
-                c->items[i].data_l[1] += pkt->item[1];
+            if(c->cold->items[i].data_l[0] == pkt->item[0]) {
+                c->cold->items[i].data_l[1] += pkt->item[1];
                 goto send_pkt;
             }
         }
     }
 
-    memcpy(&c->items[c->item_count].data_l[0], &pkt->item[0],
+    memcpy(&c->cold->items[c->cold->item_count].data_l[0], &pkt->item[0],
            sizeof(uint32_t) * 4);
-    c->items[c->item_count++].data2_l = 0;
+    c->cold->items[c->cold->item_count++].data2_l = 0;
 
 send_pkt:
     return subcmd_send_lobby_dc(c->cur_lobby, c, (subcmd_pkt_t *)pkt, 0);
@@ -1682,11 +1682,11 @@ static int handle_use_item(ship_client_t *c, subcmd_use_item_t *pkt) {
         goto send_pkt;
 
     /* Remove the item from the user's inventory */
-    num = item_remove_from_inv(c->items, c->item_count, pkt->item_id, 1);
+    num = item_remove_from_inv(c->cold->items, c->cold->item_count, pkt->item_id, 1);
     if(num < 0)
         debug(DBG_WARN, "Couldn't remove item from inventory!\n");
     else
-        c->item_count -= num;
+        c->cold->item_count -= num;
 
 send_pkt:
     return subcmd_send_lobby_dc(l, c, (subcmd_pkt_t *)pkt, 0);
@@ -1825,11 +1825,11 @@ static int handle_bb_drop_pos(ship_client_t *c, subcmd_bb_drop_pos_t *pkt) {
 
     /* We have the item... Record the information for use with the subcommand
        0x29 that should follow. */
-    c->drop_x = pkt->x;
-    c->drop_z = pkt->z;
-    c->drop_area = pkt->area;
-    c->drop_item = pkt->item_id;
-    c->drop_amt = pkt->amount;
+    c->cold->drop_x = pkt->x;
+    c->cold->drop_z = pkt->z;
+    c->cold->drop_area = pkt->area;
+    c->cold->drop_item = pkt->item_id;
+    c->cold->drop_amt = pkt->amount;
 
     /* Done. Send the packet on to the lobby. */
     return subcmd_send_lobby_bb(l, c, (bb_subcmd_pkt_t *)pkt, 0);
@@ -1877,7 +1877,7 @@ static int handle_bb_drop_stack(ship_client_t *c,
         }
 
         /* Grab the item from the client's inventory and set up the split */
-        item_data = c->items[found];
+        item_data = c->cold->items[found];
         item_data.item_id = LE32((++l->highest_item[c->client_id]));
         item_data.data_b[5] = (uint8_t)(LE32(pkt->amount));
     }
@@ -1889,7 +1889,7 @@ static int handle_bb_drop_stack(ship_client_t *c,
     }
 
     /* Make sure the item id and amount match the most recent 0xC3. */
-    if(pkt->item_id != c->drop_item || pkt->amount != c->drop_amt) {
+    if(pkt->item_id != c->cold->drop_item || pkt->amount != c->cold->drop_amt) {
         debug(DBG_WARN, "Guildcard %" PRIu32 " dropped different item stack!\n",
               c->guildcard);
         return -1;
@@ -1934,7 +1934,7 @@ static int handle_bb_drop_stack(ship_client_t *c,
        that there's an item dropped. Then, send the one removing the item from
        the client's inventory. The first must go to everybody, the second to
        everybody except the person who sent this packet in the first place. */
-    subcmd_send_drop_stack(c, c->drop_area, c->drop_x, c->drop_z, it);
+    subcmd_send_drop_stack(c, c->cold->drop_area, c->cold->drop_x, c->cold->drop_z, it);
 
     /* Done. Send the packet on to the lobby. */
     return subcmd_send_lobby_bb(l, c, (bb_subcmd_pkt_t *)pkt, 0);
@@ -2284,7 +2284,8 @@ static int handle_bb_bank(ship_client_t *c, subcmd_bb_bank_open_t *req) {
     pkt->type = SUBCMD_BANK_INV;
     pkt->unused[0] = pkt->unused[1] = pkt->unused[2] = 0;
     pkt->size = LE32(size);
-    pkt->checksum = mt19937_genrand_int32(&b->rng); /* Client doesn't care */
+    /* Client doesn't care */
+    pkt->checksum = mtrand_int32(block_rng(b));
     memcpy(&pkt->item_count, &c->bb_pl->bank, sizeof(sylverant_bank_t));
 
     return crypt_send(c, (int)size, sendbuf);
@@ -2715,8 +2716,10 @@ static int handle_bb_sort_inv(ship_client_t *c, subcmd_bb_sort_inv_t *pkt) {
 static int handle_mhit(ship_client_t *c, subcmd_mhit_pkt_t *pkt) {
     lobby_t *l = c->cur_lobby;
     uint16_t mid, mid2, dmg;
-    game_enemy_t *en;
-    uint32_t flags;
+    const game_enemy_t *en;
+    game_enemy_state_t *st;
+    uint32_t flags, bp;
+    uint8_t rt;
 
     /* We can't get these in a lobby without someone messing with something that
        they shouldn't be... Disconnect anyone that tries. */
@@ -2758,7 +2761,7 @@ static int handle_mhit(ship_client_t *c, subcmd_mhit_pkt_t *pkt) {
     }
 
     /* Make sure the enemy is in range. */
-    if(mid > l->map_enemies->count) {
+    if(!(en = team_enemy(l->map_enemies, mid))) {
 #ifdef DEBUG
         debug(DBG_WARN, "Guild card %" PRIu32 " hit invalid enemy (%d -- max: "
               "%d)!\n"
@@ -2801,22 +2804,22 @@ static int handle_mhit(ship_client_t *c, subcmd_mhit_pkt_t *pkt) {
     /* XXXX: There are some issues still with Episode 2, so only spit this out
        for now on Episode 1. */
 #ifdef DEBUG
-    if(c->cur_area != l->map_enemies->enemies[mid].area && l->episode == 1 &&
+    if(c->cur_area != en->area && l->episode == 1 &&
        !(l->flags & LOBBY_FLAG_QUESTING)) {
         debug(DBG_WARN, "Guild card %" PRIu32 " hit enemy in wrong area "
               "(%d -- max: %d)!\n Episode: %d, Area: %d, Enemy Area: %d "
               "Map: (%d, %d)\n", c->guildcard, mid, l->map_enemies->count,
-              l->episode, c->cur_area, l->map_enemies->enemies[mid].area,
+              l->episode, c->cur_area, en->area,
               l->maps[c->cur_area << 1], l->maps[(c->cur_area << 1) + 1]);
     }
 #endif
 
-    if(l->logfp && c->cur_area != l->map_enemies->enemies[mid].area &&
+    if(l->logfp && c->cur_area != en->area &&
        !(l->flags & LOBBY_FLAG_QUESTING)) {
         fdebug(l->logfp, DBG_WARN, "Guild card %" PRIu32 " hit enemy in wrong "
                "area (%d -- max: %d)!\n Episode: %d, Area: %d, Enemy Area: %d "
                "Map: (%d, %d)\n", c->guildcard, mid, l->map_enemies->count,
-               l->episode, c->cur_area, l->map_enemies->enemies[mid].area,
+               l->episode, c->cur_area, en->area,
                l->maps[c->cur_area << 1], l->maps[(c->cur_area << 1) + 1]);
     }
 
@@ -2836,28 +2839,30 @@ static int handle_mhit(ship_client_t *c, subcmd_mhit_pkt_t *pkt) {
     }
 
     /* Save the hit, assuming the enemy isn't already dead. */
-    en = &l->map_enemies->enemies[mid];
-    if(!(en->clients_hit & 0x80)) {
-        en->clients_hit |= (1 << c->client_id);
-        en->last_client = c->client_id;
+    st = &l->map_enemies->state[mid];
+    if(!(st->clients_hit & 0x80)) {
+        st->clients_hit |= (1 << c->client_id);
+        st->last_client = c->client_id;
+        bp = team_enemy_bp(l->map_enemies, en);
+        rt = team_enemy_rt(l->map_enemies, en);
 
         script_execute(ScriptActionEnemyHit, c, SCRIPT_ARG_PTR, c,
-                       SCRIPT_ARG_UINT16, mid, SCRIPT_ARG_UINT32, en->bp_entry,
-                       SCRIPT_ARG_UINT8, en->rt_index, SCRIPT_ARG_UINT8,
-                       en->clients_hit, SCRIPT_ARG_END);
+                       SCRIPT_ARG_UINT16, mid, SCRIPT_ARG_UINT32, bp,
+                       SCRIPT_ARG_UINT8, rt, SCRIPT_ARG_UINT8,
+                       st->clients_hit, SCRIPT_ARG_END);
 
         /* If the kill flag is set, mark it as dead and update the client's
            counter. */
         if(flags & 0x00000800) {
-            en->clients_hit |= 0x80;
+            st->clients_hit |= 0x80;
 
             script_execute(ScriptActionEnemyKill, c, SCRIPT_ARG_PTR, c,
                            SCRIPT_ARG_UINT16, mid, SCRIPT_ARG_UINT32,
-                           en->bp_entry, SCRIPT_ARG_UINT8, en->rt_index,
-                           SCRIPT_ARG_UINT8, en->clients_hit, SCRIPT_ARG_END);
+                           bp, SCRIPT_ARG_UINT8, rt,
+                           SCRIPT_ARG_UINT8, st->clients_hit, SCRIPT_ARG_END);
 
-            if(en->bp_entry < 0x60 && !(l->flags & LOBBY_FLAG_HAS_NPC))
-                ++c->enemy_kills[en->bp_entry];
+            if(bp < 0x60 && !(l->flags & LOBBY_FLAG_HAS_NPC))
+                ++c->enemy_kills[bp];
         }
     }
 
@@ -2867,6 +2872,7 @@ static int handle_mhit(ship_client_t *c, subcmd_mhit_pkt_t *pkt) {
 static int handle_bb_mhit(ship_client_t *c, subcmd_bb_mhit_pkt_t *pkt) {
     lobby_t *l = c->cur_lobby;
     uint16_t mid;
+    game_enemy_state_t *st;
 
     /* We can't get these in a lobby without someone messing with something that
        they shouldn't be... Disconnect anyone that tries. */
@@ -2886,16 +2892,17 @@ static int handle_bb_mhit(ship_client_t *c, subcmd_bb_mhit_pkt_t *pkt) {
 
     /* Make sure the enemy is in range. */
     mid = LE16(pkt->enemy_id);
-    if(mid > l->map_enemies->count) {
+    if(mid >= l->map_enemies->count) {
         debug(DBG_WARN, "Guildcard %" PRIu32 " hit invalid enemy (%d -- max: "
               "%d)!\n", c->guildcard, mid, l->map_enemies->count);
         return -1;
     }
 
     /* Save the hit, assuming the enemy isn't already dead. */
-    if(!(l->map_enemies->enemies[mid].clients_hit & 0x80)) {
-        l->map_enemies->enemies[mid].clients_hit |= (1 << c->client_id);
-        l->map_enemies->enemies[mid].last_client = c->client_id;
+    st = &l->map_enemies->state[mid];
+    if(!(st->clients_hit & 0x80)) {
+        st->clients_hit |= (1 << c->client_id);
+        st->last_client = c->client_id;
     }
 
     return subcmd_send_lobby_bb(l, c, (bb_subcmd_pkt_t *)pkt, 0);
@@ -2910,7 +2917,7 @@ static void handle_objhit_common(ship_client_t *c, lobby_t *l, uint16_t bid) {
         bid &= 0x0FFF;
 
         /* Make sure the object is in range. */
-        if(bid > l->map_objs->count) {
+        if(bid >= l->map_objs->count) {
             debug(DBG_WARN, "Guild card %" PRIu32 " hit invalid object "
                   "(%d -- max: %d)!\n"
                   "Episode: %d, Floor: %d, Map: (%d, %d)\n", c->guildcard,
@@ -2928,11 +2935,11 @@ static void handle_objhit_common(ship_client_t *c, lobby_t *l, uint16_t bid) {
         }
 
         /* Make sure it isn't marked as hit already. */
-        if((l->map_objs->objs[bid].flags & 0x80000000))
+        if((l->map_objs->flags[bid] & TEAM_OBJ_FLAG_HIT))
             return;
 
         /* Now, see if we care about the type of the object that was hit. */
-        obj_type = l->map_objs->objs[bid].data.skin & 0xFFFF;
+        obj_type = team_object(l->map_objs, bid)->data.skin & 0xFFFF;
 
         /* We'll probably want to do a bit more with this at some point, but
            for now this will do. */
@@ -2951,7 +2958,7 @@ static void handle_objhit_common(ship_client_t *c, lobby_t *l, uint16_t bid) {
         }
 
         /* Mark it as hit. */
-        l->map_objs->objs[bid].flags |= 0x80000000;
+        l->map_objs->flags[bid] |= TEAM_OBJ_FLAG_HIT;
     }
     else if((bid & 0xF000) == 0x1000) {
         /* An enemy was hit. We don't really do anything with these here,
@@ -3098,31 +3105,31 @@ static int handle_objhit_tech(ship_client_t *c, subcmd_objhit_tech_t *pkt) {
            item hit in the packet, and just act in a broken manner in general. We
            have to do some annoying stuff to handle them here. */
         case TECHNIQUE_BARTA:
-            c->aoe_timer = get_ms_time() + BARTA_TIMING;
+            c->cold->aoe_timer = get_ms_time() + BARTA_TIMING;
             break;
 
         case TECHNIQUE_GIBARTA:
-            c->aoe_timer = get_ms_time() + GIBARTA_TIMING;
+            c->cold->aoe_timer = get_ms_time() + GIBARTA_TIMING;
             break;
 
         case TECHNIQUE_GIFOIE:
-            c->aoe_timer = get_ms_time() + gifoie_timing[tlindex(tech_level)];
+            c->cold->aoe_timer = get_ms_time() + gifoie_timing[tlindex(tech_level)];
             break;
 
         case TECHNIQUE_RAFOIE:
-            c->aoe_timer = get_ms_time() + rafoie_timing[tlindex(tech_level)];
+            c->cold->aoe_timer = get_ms_time() + rafoie_timing[tlindex(tech_level)];
             break;
 
         case TECHNIQUE_GIZONDE:
-            c->aoe_timer = get_ms_time() + gizonde_timing[tlindex(tech_level)];
+            c->cold->aoe_timer = get_ms_time() + gizonde_timing[tlindex(tech_level)];
             break;
 
         case TECHNIQUE_RAZONDE:
-            c->aoe_timer = get_ms_time() + razonde_timing[tlindex(tech_level)];
+            c->cold->aoe_timer = get_ms_time() + razonde_timing[tlindex(tech_level)];
             break;
 
         case TECHNIQUE_RABARTA:
-            c->aoe_timer = get_ms_time() + rabarta_timing[tlindex(tech_level)];
+            c->cold->aoe_timer = get_ms_time() + rabarta_timing[tlindex(tech_level)];
             break;
 
         default:
@@ -3149,7 +3156,7 @@ static int handle_objhit(ship_client_t *c, subcmd_bhit_pkt_t *pkt) {
     }
 
     /* We only care about these if the AoE timer is set on the sender. */
-    if(c->aoe_timer < now)
+    if(c->cold->aoe_timer < now)
         return subcmd_send_lobby_dc(l, c, (subcmd_pkt_t *)pkt, 0);
 
     /* Check the type of the object that was hit. As the AoE timer can't be set
@@ -3167,7 +3174,7 @@ static int handle_bb_req_exp(ship_client_t *c, subcmd_bb_req_exp_pkt_t *pkt) {
     lobby_t *l = c->cur_lobby;
     uint16_t mid;
     uint32_t bp, exp;
-    game_enemy_t *en;
+    game_enemy_state_t *st;
 
     /* We can't get these in a lobby without someone messing with something that
        they shouldn't be... Disconnect anyone that tries. */
@@ -3187,7 +3194,7 @@ static int handle_bb_req_exp(ship_client_t *c, subcmd_bb_req_exp_pkt_t *pkt) {
 
     /* Make sure the enemy is in range. */
     mid = LE16(pkt->enemy_id);
-    if(mid > l->map_enemies->count) {
+    if(mid >= l->map_enemies->count) {
         debug(DBG_WARN, "Guildcard %" PRIu32 " killed invalid enemy (%d -- "
               "max: %d)!\n", c->guildcard, mid, l->map_enemies->count);
         return -1;
@@ -3195,18 +3202,18 @@ static int handle_bb_req_exp(ship_client_t *c, subcmd_bb_req_exp_pkt_t *pkt) {
 
     /* Make sure this client actually hit the enemy and that the client didn't
        already claim their experience. */
-    en = &l->map_enemies->enemies[mid];
+    st = &l->map_enemies->state[mid];
 
-    if(!(en->clients_hit & (1 << c->client_id))) {
+    if(!(st->clients_hit & (1 << c->client_id))) {
         return 0;
     }
 
     /* Set that the client already got their experience and that the monster is
        indeed dead. */
-    en->clients_hit = (en->clients_hit & (~(1 << c->client_id))) | 0x80;
+    st->clients_hit = (st->clients_hit & (~(1 << c->client_id))) | 0x80;
 
     /* Give the client their experience! */
-    bp = en->bp_entry;
+    bp = team_enemy_bp(l->map_enemies, team_enemy(l->map_enemies, mid));
     exp = l->bb_params[bp].exp;
 
     if(!pkt->last_hitter) {
@@ -3360,19 +3367,19 @@ static int handle_sync_reg(ship_client_t *c, subcmd_sync_reg_t *pkt) {
     /* Does this quest use server data calls? If so, deal with it... */
     if((l->q_flags & LOBBY_QFLAG_DATA) && !done) {
         if(pkt->reg_num == l->q_data_reg) {
-            if(c->q_stack_top < CLIENT_MAX_QSTACK) {
+            if(c->cold->q_stack_top < CLIENT_MAX_QSTACK) {
                 if(!(c->flags & CLIENT_FLAG_QSTACK_LOCK)) {
-                    c->q_stack[c->q_stack_top++] = val;
+                    c->cold->q_stack[c->cold->q_stack_top++] = val;
 
                     /* Check if we've got everything we expected... */
-                    if(c->q_stack_top >= 3 &&
-                       c->q_stack_top == 3 + c->q_stack[1] + c->q_stack[2]) {
+                    if(c->cold->q_stack_top >= 3 &&
+                       c->cold->q_stack_top == 3 + c->cold->q_stack[1] + c->cold->q_stack[2]) {
                         /* Call the function requested and reset the stack. */
                         ctl = quest_function_dispatch(c, l);
 
                         if(ctl != QUEST_FUNC_RET_NOT_YET) {
                             send_sync_register(c, pkt->reg_num, ctl);
-                            c->q_stack_top = 0;
+                            c->cold->q_stack_top = 0;
                         }
                     }
                 }
@@ -3383,7 +3390,7 @@ static int handle_sync_reg(ship_client_t *c, subcmd_sync_reg_t *pkt) {
                                        QUEST_FUNC_RET_STACK_LOCKED);
                 }
             }
-            else if(c->q_stack_top == CLIENT_MAX_QSTACK) {
+            else if(c->cold->q_stack_top == CLIENT_MAX_QSTACK) {
                 /* Eat the stack push and report an error. */
                 send_sync_register(c, pkt->reg_num,
                                    QUEST_FUNC_RET_STACK_OVERFLOW);
@@ -3395,7 +3402,7 @@ static int handle_sync_reg(ship_client_t *c, subcmd_sync_reg_t *pkt) {
             /* For now, the only reason we'll have one of these is to reset the
                stack. There might be other reasons later, but this will do, for
                the time being... */
-            c->q_stack_top = 0;
+            c->cold->q_stack_top = 0;
             done = 1;
         }
     }
@@ -3432,9 +3439,9 @@ static int handle_set_pos24(ship_client_t *c, subcmd_pkt_t *pkt) {
 
         /* Oh look, misusing other portions of the client structure so that I
            don't have to make a new field... */
-        if(c->autoreply_len && pkt->data[0] != c->client_id) {
+        if(c->cold->autoreply_len && pkt->data[0] != c->client_id) {
             /* Silently drop the packet. */
-            --c->autoreply_len;
+            --c->cold->autoreply_len;
             return 0;
         }
     }
@@ -3451,8 +3458,8 @@ static int handle_talk_shop(ship_client_t *c, subcmd_pkt_t *pkt) {
 
     /* Clear the list of dropped items. */
     if(c->cur_area == 0) {
-        memset(c->p2_drops, 0, sizeof(c->p2_drops));
-        c->p2_drops_max = 0;
+        memset(c->cold->p2_drops, 0, sizeof(c->cold->p2_drops));
+        c->cold->p2_drops_max = 0;
     }
 
     /* Flip the shopping flag, since this packet is sent both for talking to the
@@ -3486,8 +3493,8 @@ static int handle_drop_item(ship_client_t *c, subcmd_drop_item_t *pkt) {
 
     /* Are we on Pioneer 2? If so, record the item they just dropped. */
     if(c->cur_area == 0) {
-        if(c->p2_drops_max < 30) {
-            c->p2_drops[c->p2_drops_max++] = LE32(pkt->item_id);
+        if(c->cold->p2_drops_max < 30) {
+            c->cold->p2_drops[c->cold->p2_drops_max++] = LE32(pkt->item_id);
         }
         else {
             debug(DBG_WARN, "Guildcard %" PRIu32 " dropped too many items!"
@@ -3545,8 +3552,8 @@ static int handle_talk_npc(ship_client_t *c, subcmd_talk_npc_t *pkt) {
 
     /* Clear the list of dropped items. */
     if(pkt->unk == 0xFFFF && c->cur_area == 0) {
-        memset(c->p2_drops, 0, sizeof(c->p2_drops));
-        c->p2_drops_max = 0;
+        memset(c->cold->p2_drops, 0, sizeof(c->cold->p2_drops));
+        c->cold->p2_drops_max = 0;
     }
 
     return subcmd_send_lobby_dc(l, c, (subcmd_pkt_t *)pkt, 0);
@@ -3595,8 +3602,8 @@ static int handle_pick_up(ship_client_t *c, ship_client_t *d,
 
     /* Clear the list of dropped items. */
     if(c->cur_area == 0) {
-        memset(c->p2_drops, 0, sizeof(c->p2_drops));
-        c->p2_drops_max = 0;
+        memset(c->cold->p2_drops, 0, sizeof(c->cold->p2_drops));
+        c->cold->p2_drops_max = 0;
     }
 
     /* Maybe do more in the future with inventory tracking? */
@@ -3797,7 +3804,7 @@ int subcmd_handle_one(ship_client_t *c, subcmd_pkt_t *pkt) {
                the lobby is not in legit mode and a GM has used /item. Second,
                if the lobby has a drop function (for server-side drops). Third,
                if there is a quest going on with modified drops. */
-            if(c->next_item[0] && !(l->flags & LOBBY_FLAG_LEGIT_MODE)) {
+            if(c->cold->next_item[0] && !(l->flags & LOBBY_FLAG_LEGIT_MODE)) {
                 rv = handle_gm_itemreq(c, (subcmd_itemreq_t *)pkt);
             }
             else if(l->dropfunc && (l->flags & LOBBY_FLAG_SERVER_DROPS)) {
@@ -4356,7 +4363,7 @@ static int subcmd_send_shop_inv(ship_client_t *c, subcmd_bb_shop_req_t *req) {
     for(i = 0; i < 0x0B; ++i) {
         shop.items[i].item_data[0] = LE32((0x03 | (i << 8)));
         shop.items[i].reserved = 0xFFFFFFFF;
-        shop.items[i].cost = LE32((mt19937_genrand_int32(&b->rng) % 255));
+        shop.items[i].cost = LE32((mtrand_int32(block_rng(b)) % 255));
     }
 
     return send_pkt_bb(c, (bb_pkt_hdr_t *)&shop);
@@ -0,0 +1,188 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include "timers.h"
+
+/* The number of ticks covered by each level of the wheel. */
+#define LEVEL_SPAN(l)   ((time_t)1 << (TIMER_SLOT_BITS * ((l) + 1)))
+#define MAX_SPAN        LEVEL_SPAN(TIMER_LEVELS - 1)
+
+void timer_wheel_init(timer_wheel_t *w, time_t now) {
+    int i, j;
+
+    memset(w, 0, sizeof(timer_wheel_t));
+    w->now = now;
+
+    for(i = 0; i < TIMER_LEVELS; ++i) {
+        for(j = 0; j < TIMER_SLOTS; ++j) {
+            TAILQ_INIT(&w->slots[i][j]);
+        }
+    }
+}
+
+void timer_init(timer_entry_t *t, timer_cb_t cb, void *data) {
+    memset(t, 0, sizeof(timer_entry_t));
+    t->callback = cb;
+    t->data = data;
+}
+
+static void unlink_timer(timer_wheel_t *w, timer_entry_t *t) {
+    TAILQ_REMOVE(t->slot, t, qentry);
+
+    if(TAILQ_EMPTY(t->slot))
+        w->occupied[t->level] &= ~((uint64_t)1 << t->index);
+
+    t->slot = NULL;
+    --w->count;
+}
+
+/* Put a timer into the right slot relative to the current time. The earliest
+   time it may be placed at is passed in, so that timers being cascaded down can
+   land in the slot that's about to be run. */
+static void place_timer(timer_wheel_t *w, timer_entry_t *t, time_t earliest) {
+    time_t exp = t->expires, delta;
+    int level;
+
+    if(exp < earliest)
+        exp = earliest;
+
+    delta = exp - w->now;
+
+    /* If it's way out there, park it at the furthest point we can. It'll get
+       put in the right place as it cascades down. */
+    if(delta >= MAX_SPAN)
+        exp = w->now + MAX_SPAN - 1;
+
+    for(level = 0; level < TIMER_LEVELS - 1; ++level) {
+        if(delta < LEVEL_SPAN(level))
+            break;
+    }
+
+    t->level = (uint8_t)level;
+    t->index = (uint8_t)((exp >> (TIMER_SLOT_BITS * level)) & TIMER_SLOT_MASK);
+    t->slot = &w->slots[level][t->index];
+    TAILQ_INSERT_TAIL(t->slot, t, qentry);
+    w->occupied[level] |= (uint64_t)1 << t->index;
+    ++w->count;
+}
+
+void timer_schedule(timer_wheel_t *w, timer_entry_t *t, time_t when) {
+    if(t->slot)
+        unlink_timer(w, t);
+
+    t->expires = when;
+    place_timer(w, t, w->now + 1);
+}
+
+void timer_cancel(timer_wheel_t *w, timer_entry_t *t) {
+    if(t->slot)
+        unlink_timer(w, t);
+}
+
+/* Move everything in one slot of a higher level down to where it belongs now
+   that the wheel has moved on. */
+static int cascade(timer_wheel_t *w, int level) {
+    int index = (int)((w->now >> (TIMER_SLOT_BITS * level)) & TIMER_SLOT_MASK);
+    struct timer_queue *q = &w->slots[level][index];
+    timer_entry_t *t;
+
+    while((t = TAILQ_FIRST(q))) {
+        unlink_timer(w, t);
+        place_timer(w, t, w->now);
+    }
+
+    return index;
+}
+
+/* Rotate a slot bitmap so that bit 0 corresponds to the given slot. */
+static uint64_t rotate(uint64_t bits, int n) {
+    if(!n)
+        return bits;
+
+    return (bits >> n) | (bits << (64 - n));
+}
+
+/* How many ticks after the current one will something need to be done? This
+   is either the next slot on the bottom level with anything in it or the next
+   time that the upper levels need to be cascaded down. */
+static time_t ticks_to_work(timer_wheel_t *w) {
+    int base = (int)((w->now + 1) & TIMER_SLOT_MASK);
+    time_t to_cascade = (TIMER_SLOTS - base) & TIMER_SLOT_MASK;
+    uint64_t bits = rotate(w->occupied[0], base);
+    time_t to_slot;
+
+    if(!bits)
+        return to_cascade + 1;
+
+    to_slot = __builtin_ctzll(bits);
+    return (to_slot < to_cascade ? to_slot : to_cascade) + 1;
+}
+
+void timer_wheel_run(timer_wheel_t *w, time_t now) {
+    int level, index;
+    time_t step;
+    struct timer_queue *q;
+    timer_entry_t *t;
+
+    while(w->now < now) {
+        /* If there's nothing on the wheel at all, just jump ahead. */
+        if(!w->count) {
+            w->now = now;
+            break;
+        }
+
+        /* Skip over any ticks that don't have anything to do. */
+        step = ticks_to_work(w);
+
+        if(w->now + step > now) {
+            w->now = now;
+            break;
+        }
+
+        w->now += step;
+        index = (int)(w->now & TIMER_SLOT_MASK);
+
+        /* If we've wrapped around the bottom level, bring down whatever is
+           next up from the levels above it. */
+        if(!index) {
+            for(level = 1; level < TIMER_LEVELS; ++level) {
+                if(cascade(w, level))
+                    break;
+            }
+        }
+
+        /* Fire everything that's due on this tick. */
+        q = &w->slots[0][index];
+
+        while((t = TAILQ_FIRST(q))) {
+            unlink_timer(w, t);
+            t->callback(t, w->now);
+        }
+    }
+}
+
+int timer_wheel_next(timer_wheel_t *w, int max) {
+    time_t rv;
+
+    if(!w->count)
+        return max;
+
+    rv = ticks_to_work(w);
+    return rv < max ? (int)rv : max;
+}
@@ -0,0 +1,89 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TIMERS_H
+#define TIMERS_H
+
+#include <time.h>
+#include <stdint.h>
+#include <sys/queue.h>
+
+/* Hierarchical timer wheel with a resolution of one second. Each level has 64
+   slots, and each level's slots are 64 times as wide as the one below it, so
+   four levels cover a bit over 194 days. Timers further out than that are
+   simply parked in the last level until they get close enough.
+
+   A timer wheel is not thread-safe. Each one is owned by a single thread (a
+   block thread or the ship thread), and only that thread may touch it or any
+   of the timers scheduled on it. */
+#define TIMER_LEVELS        4
+#define TIMER_SLOT_BITS     6
+#define TIMER_SLOTS         (1 << TIMER_SLOT_BITS)
+#define TIMER_SLOT_MASK     (TIMER_SLOTS - 1)
+
+struct timer_entry;
+struct timer_wheel;
+
+typedef void (*timer_cb_t)(struct timer_entry *t, time_t now);
+
+typedef struct timer_entry {
+    TAILQ_ENTRY(timer_entry) qentry;
+
+    time_t expires;
+    timer_cb_t callback;
+    void *data;
+
+    /* Which slot the timer is sitting in, or NULL if it isn't scheduled. */
+    struct timer_queue *slot;
+    uint8_t level;
+    uint8_t index;
+} timer_entry_t;
+
+TAILQ_HEAD(timer_queue, timer_entry);
+
+typedef struct timer_wheel {
+    time_t now;
+    int count;
+
+    uint64_t occupied[TIMER_LEVELS];
+    struct timer_queue slots[TIMER_LEVELS][TIMER_SLOTS];
+} timer_wheel_t;
+
+/* Initialize a timer wheel, with the given time as the current time. */
+void timer_wheel_init(timer_wheel_t *w, time_t now);
+
+/* Set up a timer entry. This does not schedule it. */
+void timer_init(timer_entry_t *t, timer_cb_t cb, void *data);
+
+/* Schedule (or reschedule) a timer to fire at the given time. Times that have
+   already passed fire on the next tick. */
+void timer_schedule(timer_wheel_t *w, timer_entry_t *t, time_t when);
+
+/* Cancel a timer, if it is scheduled. */
+void timer_cancel(timer_wheel_t *w, timer_entry_t *t);
+
+/* Advance the wheel to the given time, firing any timers that expire along the
+   way. Callbacks may schedule or cancel timers freely. */
+void timer_wheel_run(timer_wheel_t *w, time_t now);
+
+/* Figure out how many seconds can pass before the wheel needs to be run again,
+   capped at the given maximum. */
+int timer_wheel_next(timer_wheel_t *w, int max);
+
+#define TIMER_PENDING(t) ((t)->slot != NULL)
+
+#endif /* !TIMERS_H */
@@ -1,7 +1,7 @@
 /*
     Sylverant Ship Server
     Copyright (C) 2009, 2010, 2011, 2012, 2018, 2020, 2021, 2022,
-                  2023 Lawrence Sebald
+                  2023, 2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -298,7 +298,7 @@ int pkt_log_start(ship_client_t *i) {
 
     pthread_mutex_lock(&i->mutex);
 
-    if(i->logfile) {
+    if(i->cold->logfile) {
         pthread_mutex_unlock(&i->mutex);
         return -1;
     }
@@ -336,7 +336,7 @@ int pkt_log_start(ship_client_t *i) {
     str[strlen(str) - 1] = 0;
 
     fprintf(fp, "[%s] Packet log started\n", str);
-    i->logfile = fp;
+    i->cold->logfile = fp;
 
     /* We're done, so clean up */
     pthread_mutex_unlock(&i->mutex);
@@ -350,7 +350,7 @@ int pkt_log_stop(ship_client_t *i) {
 
     pthread_mutex_lock(&i->mutex);
 
-    if(!i->logfile) {
+    if(!i->cold->logfile) {
         pthread_mutex_unlock(&i->mutex);
         return -1;
     }
@@ -360,9 +360,9 @@ int pkt_log_stop(ship_client_t *i) {
     ctime_r(&now, str);
     str[strlen(str) - 1] = 0;
 
-    fprintf(i->logfile, "[%s] Packet log ended\n", str);
-    fclose(i->logfile);
-    i->logfile = NULL;
+    fprintf(i->cold->logfile, "[%s] Packet log ended\n", str);
+    fclose(i->cold->logfile);
+    i->cold->logfile = NULL;
 
     /* We're done, so clean up */
     pthread_mutex_unlock(&i->mutex);
@@ -638,7 +638,7 @@ int my_pton(int family, const char *str, struct sockaddr_storage *addr) {
     return -1;
 }
 
-int open_sock(int family, uint16_t port) {
+static int open_sock_int(int family, uint16_t port, int reuseport) {
     int sock = -1, val;
     struct sockaddr_in addr;
     struct sockaddr_in6 addr6;
@@ -660,6 +660,23 @@ int open_sock(int family, uint16_t port) {
            anyway... */
     }
 
+    /* If we're going to have more than one socket on this port, we need
+       SO_REUSEPORT set on all of them. This one isn't optional. */
+    if(reuseport) {
+#ifdef SO_REUSEPORT
+        val = 1;
+        if(setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &val, sizeof(int))) {
+            perror("setsockopt SO_REUSEPORT");
+            close(sock);
+            return -1;
+        }
+#else
+        debug(DBG_ERROR, "SO_REUSEPORT is not supported\n");
+        close(sock);
+        return -1;
+#endif
+    }
+
     if(family == AF_INET) {
         memset(&addr, 0, sizeof(struct sockaddr_in));
         addr.sin_family = family;
@@ -715,6 +732,14 @@ int open_sock(int family, uint16_t port) {
     return sock;
 }
 
+int open_sock(int family, uint16_t port) {
+    return open_sock_int(family, port, 0);
+}
+
+int open_sock_shared(int family, uint16_t port) {
+    return open_sock_int(family, port, 1);
+}
+
 const char *skip_lang_code(const char *input) {
     if(!input || input[0] == '\0') {
         return NULL;
@@ -1017,6 +1042,7 @@ void make_disp_data(ship_client_t *s, ship_client_t *d, void *buf) {
 
 void update_lobby_event(void) {
     int i, j;
+    uint32_t k;
     block_t *b;
     lobby_t *l;
     ship_client_t *c2;
@@ -1027,34 +1053,28 @@ void update_lobby_event(void) {
         b = ship->blocks[i];
 
         if(b && b->run) {
-            pthread_rwlock_rdlock(&b->lobby_lock);
-
             /* ... and set the event code on each default lobby. */
-            TAILQ_FOREACH(l, &b->lobbies, qentry) {
+            for(k = 0; k < LOBBY_DEFAULT_COUNT; ++k) {
+                l = b->default_lobbies[k];
                 pthread_mutex_lock(&l->mutex);
+                l->event = event;
 
-                if(l->type == LOBBY_TYPE_LOBBY) {
-                    l->event = event;
-
-                    for(j = 0; j < l->max_clients; ++j) {
-                        if(l->clients[j] != NULL) {
-                            c2 = l->clients[j];
-
-                            pthread_mutex_lock(&c2->mutex);
+                for(j = 0; j < l->max_clients; ++j) {
+                    if(l->clients[j] != NULL) {
+                        c2 = l->clients[j];
 
-                            if(c2->version > CLIENT_VERSION_PC) {
-                                send_simple(c2, LOBBY_EVENT_TYPE, event);
-                            }
+                        pthread_mutex_lock(&c2->mutex);
 
-                            pthread_mutex_unlock(&c2->mutex);
+                        if(c2->version > CLIENT_VERSION_PC) {
+                            send_simple(c2, LOBBY_EVENT_TYPE, event);
                         }
+
+                        pthread_mutex_unlock(&c2->mutex);
                     }
                 }
 
                 pthread_mutex_unlock(&l->mutex);
             }
-
-            pthread_rwlock_unlock(&b->lobby_lock);
         }
     }
 }
@@ -1,6 +1,7 @@
 /*
     Sylverant Ship Server
-    Copyright (C) 2009, 2010, 2011, 2012, 2018, 2020, 2021, 2022 Lawrence Sebald
+    Copyright (C) 2009, 2010, 2011, 2012, 2018, 2020, 2021, 2022,
+                  2026 Lawrence Sebald
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU Affero General Public License version 3
@@ -57,6 +58,10 @@ const void *my_ntop(struct sockaddr_storage *addr, char str[INET6_ADDRSTRLEN]);
 int my_pton(int family, const char *str, struct sockaddr_storage *addr);
 int open_sock(int family, uint16_t port);
 
+/* Open a listening socket with SO_REUSEPORT set, so that more than one socket
+   can be bound to the same port. */
+int open_sock_shared(int family, uint16_t port);
+
 const char *skip_lang_code(const char *input);
 
 void make_disp_data(ship_client_t *s, ship_client_t *d, void *buf);
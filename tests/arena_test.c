@@ -0,0 +1,302 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Check the arena allocator that teams keep their map data in: everything it
+   hands out has to be aligned, zeroed when asked, and not overlap anything
+   else, whether it comes out of a shared chunk or gets one of its own. Also
+   check that a team's quest arena can be replaced by one that was built up on
+   the side, the way load_quest_enemies() does it. This is run by
+   "make check".
+
+   Run it with -b to also time a team's worth of small allocations from an
+   arena against doing them with malloc. An optional count after that says how
+   many teams to do (the default is 100000).
+
+   To build it by hand:
+       cc -O2 -I../src -o arena_test arena_test.c ../src/arena.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "arena.h"
+
+#define NUM_ALLOCS      2000
+
+static struct {
+    uint8_t *ptr;
+    size_t len;
+} allocs[NUM_ALLOCS];
+
+/* Sizes that hit all of the cases: tiny, not a multiple of the alignment,
+   just under and over the size that gets a chunk to itself, and bigger than a
+   whole chunk. */
+static size_t pick_len(int i) {
+    static const size_t big[] = {
+        ARENA_CHUNK_SIZE / 4, ARENA_CHUNK_SIZE / 4 + 1, ARENA_CHUNK_SIZE,
+        ARENA_CHUNK_SIZE * 3 + 5
+    };
+
+    if(i % 97 == 96)
+        return big[(i / 97) % 4];
+
+    return (size_t)((i * 37) % 300);
+}
+
+static int count_chunks(const arena_t *a) {
+    const arena_chunk_t *c;
+    int n = 0;
+
+    for(c = a->chunks; c; c = c->next) {
+        ++n;
+    }
+
+    return n;
+}
+
+static int check_allocs(arena_t *a, int zero) {
+    size_t j;
+    int i;
+
+    for(i = 0; i < NUM_ALLOCS; ++i) {
+        allocs[i].len = pick_len(i);
+        allocs[i].ptr = zero ? (uint8_t *)arena_zalloc(a, allocs[i].len) :
+            (uint8_t *)arena_alloc(a, allocs[i].len);
+
+        if(!allocs[i].ptr) {
+            fprintf(stderr, "Allocation %d (%zu bytes) failed\n", i,
+                    allocs[i].len);
+            return -1;
+        }
+
+        if((uintptr_t)allocs[i].ptr & (ARENA_ALIGN - 1)) {
+            fprintf(stderr, "Allocation %d is misaligned\n", i);
+            return -1;
+        }
+
+        for(j = 0; j < allocs[i].len; ++j) {
+            if(zero && allocs[i].ptr[j]) {
+                fprintf(stderr, "Allocation %d isn't zeroed\n", i);
+                return -1;
+            }
+
+            allocs[i].ptr[j] = (uint8_t)(i + j);
+        }
+    }
+
+    /* If anything overlapped, something got written over. */
+    for(i = 0; i < NUM_ALLOCS; ++i) {
+        for(j = 0; j < allocs[i].len; ++j) {
+            if(allocs[i].ptr[j] != (uint8_t)(i + j)) {
+                fprintf(stderr, "Allocation %d was overwritten\n", i);
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* A big allocation gets a chunk of its own, but the small ones after it still
+   come out of the chunk that was already there. */
+static int check_big(void) {
+    arena_t a;
+    uint8_t *p1, *p2;
+
+    arena_init(&a, 0);
+
+    p1 = (uint8_t *)arena_alloc(&a, 16);
+    arena_alloc(&a, ARENA_CHUNK_SIZE);
+    p2 = (uint8_t *)arena_alloc(&a, 16);
+
+    if(count_chunks(&a) != 2 || p2 != p1 + 16) {
+        fprintf(stderr, "Big allocation didn't get its own chunk\n");
+        arena_destroy(&a);
+        return -1;
+    }
+
+    arena_destroy(&a);
+    return 0;
+}
+
+/* Build up a new quest's data in an arena on the side, then throw away the
+   old one and put the new one in its place, like load_quest_enemies(). The
+   new data has to survive the move, and a failed load has to leave the old
+   data alone. */
+static int check_swap(void) {
+    arena_t team, qa;
+    uint32_t *cur, *next;
+    int q, i;
+
+    arena_init(&team, 0);
+    cur = NULL;
+
+    for(q = 0; q < 50; ++q) {
+        arena_init(&qa, 0);
+
+        if(!(next = (uint32_t *)arena_alloc(&qa, 1000 * sizeof(uint32_t)))) {
+            fprintf(stderr, "Quest %d allocation failed\n", q);
+            return -1;
+        }
+
+        for(i = 0; i < 1000; ++i) {
+            next[i] = (uint32_t)(q * 1000 + i);
+        }
+
+        /* Every third quest "fails" to load. */
+        if(q % 3 == 2) {
+            arena_destroy(&qa);
+        }
+        else {
+            arena_destroy(&team);
+            team = qa;
+            cur = next;
+        }
+
+        if(count_chunks(&team) != 1) {
+            fprintf(stderr, "Quest arena has %d chunks after quest %d\n",
+                    count_chunks(&team), q);
+            return -1;
+        }
+
+        for(i = 0; i < 1000; ++i) {
+            if(cur[i] != (uint32_t)((q - (q % 3 == 2)) * 1000 + i)) {
+                fprintf(stderr, "Quest data lost after quest %d\n", q);
+                return -1;
+            }
+        }
+    }
+
+    arena_destroy(&team);
+    return 0;
+}
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* About what a team allocates: the state for a few hundred objects and
+   enemies, in lots of small pieces. */
+#define BENCH_ALLOCS    64
+
+static void bench(long count) {
+    void *ptrs[BENCH_ALLOCS];
+    double t, tmalloc, tarena;
+    uintptr_t sum = 0;
+    arena_t a;
+    long i;
+    int j;
+
+    t = now();
+    for(i = 0; i < count; ++i) {
+        for(j = 0; j < BENCH_ALLOCS; ++j) {
+            ptrs[j] = malloc(pick_len(j) + 1);
+            sum += (uintptr_t)ptrs[j];
+        }
+
+        for(j = 0; j < BENCH_ALLOCS; ++j) {
+            free(ptrs[j]);
+        }
+    }
+    tmalloc = now() - t;
+
+    arena_init(&a, 0);
+
+    t = now();
+    for(i = 0; i < count; ++i) {
+        for(j = 0; j < BENCH_ALLOCS; ++j) {
+            sum += (uintptr_t)arena_alloc(&a, pick_len(j) + 1);
+        }
+
+        arena_destroy(&a);
+    }
+    tarena = now() - t;
+
+    printf("%ld teams of %d allocations: malloc/free %.3fs (%.1f ns each), "
+           "arena %.3fs (%.1f ns each)\n", count, BENCH_ALLOCS, tmalloc,
+           tmalloc * 1e9 / (count * BENCH_ALLOCS), tarena,
+           tarena * 1e9 / (count * BENCH_ALLOCS));
+    printf("(checksum %lx)\n", (unsigned long)sum);
+}
+
+int main(int argc, char *argv[]) {
+    long count = 100000;
+    arena_t a;
+
+    arena_init(&a, 0);
+
+    if(check_allocs(&a, 0)) {
+        arena_destroy(&a);
+        return EXIT_FAILURE;
+    }
+
+    /* Destroying the arena leaves it ready to use again. Do that, and this
+       time make sure everything comes back zeroed. */
+    arena_destroy(&a);
+
+    if(a.chunks) {
+        fprintf(stderr, "Destroyed arena still has chunks\n");
+        return EXIT_FAILURE;
+    }
+
+    if(check_allocs(&a, 1)) {
+        arena_destroy(&a);
+        return EXIT_FAILURE;
+    }
+
+    arena_destroy(&a);
+
+    /* Same thing again with a smaller chunk size. */
+    arena_init(&a, 1024);
+
+    if(check_allocs(&a, 1)) {
+        arena_destroy(&a);
+        return EXIT_FAILURE;
+    }
+
+    arena_destroy(&a);
+
+    if(check_big() || check_swap())
+        return EXIT_FAILURE;
+
+    printf("arena checks passed\n");
+
+    if(argc > 1) {
+        if(strcmp(argv[1], "-b")) {
+            fprintf(stderr, "Usage: %s [-b [count]]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if(argc > 2)
+            count = atol(argv[2]);
+
+        if(count < 1) {
+            fprintf(stderr, "Count must be at least 1\n");
+            return EXIT_FAILURE;
+        }
+
+        bench(count);
+    }
+
+    return 0;
+}
@@ -0,0 +1,231 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Check that cipher_crypt() gives exactly the same results as libsylverant's
+   CRYPT_CryptData() for every type of key, using whatever implementations
+   cipher_init() picks for this CPU. If the two ever disagree, clients just see
+   garbage, so this is run by "make check".
+
+   Run it with -b to also time both of them on packets of a typical size. An
+   optional count after that says how many packets to do (the default is
+   1000000).
+
+   To build it by hand:
+       cc -O2 -pthread -I../src -o cipher_test cipher_test.c ../src/cipher.c \
+           ../src/mempool.c -lsylverant
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <sylverant/encryption.h>
+
+#include "cipher.h"
+
+/* Big enough for the largest packet, plus room to move it around so that it
+   isn't always aligned the same way. */
+#define BUF_SIZE    (0x8000 + 64)
+
+#define BENCH_LEN   256
+
+static uint8_t a[BUF_SIZE], b[BUF_SIZE];
+
+static void make_key(CRYPT_SETUP *key, int type, uint32_t n) {
+    uint8_t seed[48];
+    uint32_t s = n;
+    int i;
+
+    if(type == CRYPT_BLUEBURST) {
+        for(i = 0; i < 48; ++i) {
+            seed[i] = (uint8_t)(i * 73 + n);
+        }
+
+        CRYPT_CreateKeys(key, seed, CRYPT_BLUEBURST);
+    }
+    else {
+        CRYPT_CreateKeys(key, &s, type);
+    }
+}
+
+static int check_pkt(CRYPT_SETUP *ref, CRYPT_SETUP *key, cipher_ks_t *ks,
+                     int len, int off, int enc, uint32_t fill) {
+    int i;
+
+    for(i = 0; i < len; ++i) {
+        a[i] = b[off + i] = (uint8_t)(i * 29 + fill);
+    }
+
+    CRYPT_CryptData(ref, a, len, enc);
+
+    if(cipher_crypt(key, ks, b + off, len, enc)) {
+        fprintf(stderr, "cipher_crypt failed\n");
+        return -1;
+    }
+
+    return memcmp(a, b + off, len) ? -1 : 0;
+}
+
+/* Go through enough data on a stream cipher key for the ring to be refilled
+   and wrap around plenty of times, in pieces of all sorts of sizes. Sometimes
+   top the ring up in between, like an idle worker would, and sometimes let it
+   run dry so that it gets filled on demand. */
+static int check_stream(int type, const char *name, uint32_t n) {
+    CRYPT_SETUP ref, key;
+    cipher_ks_t ks = { NULL, 0, 0 };
+    int i, len, total = 0, rv = 0;
+
+    make_key(&ref, type, n);
+    make_key(&key, type, n);
+
+    for(i = 0; total < CIPHER_KS_SIZE * 8 && !rv; ++i) {
+        /* Mostly small packets, with the odd really big one. */
+        if(i % 37 == 36)
+            len = 0x7C00;
+        else
+            len = ((i * 13) % 160 + 1) * 4;
+
+        if(check_pkt(&ref, &key, &ks, len, i % 16, i & 1, (uint32_t)i)) {
+            fprintf(stderr, "Mismatch: %s key %u, packet %d (%d bytes)\n",
+                    name, (unsigned)n, i, len);
+            rv = -1;
+        }
+
+        if(i % 5 == 4 && cipher_ks_low(&key, &ks) &&
+           cipher_ks_refill(&key, &ks)) {
+            fprintf(stderr, "cipher_ks_refill failed\n");
+            rv = -1;
+        }
+
+        total += len;
+    }
+
+    cipher_ks_clear(&ks);
+    return rv;
+}
+
+/* Blue Burst goes a block at a time, so try every number of blocks up to a
+   few times the number that get done at once, in both directions. */
+static int check_bb(uint32_t n) {
+    CRYPT_SETUP ref, key;
+    cipher_ks_t ks = { NULL, 0, 0 };
+    int i, len;
+
+    make_key(&ref, CRYPT_BLUEBURST, n);
+    make_key(&key, CRYPT_BLUEBURST, n);
+
+    for(i = 0; i < 256; ++i) {
+        len = ((i >> 1) % 64 + 1) << 3;
+
+        if(check_pkt(&ref, &key, &ks, len, i % 8, i & 1, (uint32_t)i)) {
+            fprintf(stderr, "Mismatch: Blue Burst key %u, packet %d (%d "
+                    "bytes)\n", (unsigned)n, i, len);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_one(int type, const char *name, long count) {
+    CRYPT_SETUP ref, key;
+    cipher_ks_t ks = { NULL, 0, 0 };
+    double t, tref, tnew;
+    long i;
+
+    make_key(&ref, type, 1);
+    make_key(&key, type, 1);
+    memset(a, 0, BENCH_LEN);
+    memset(b, 0, BENCH_LEN);
+
+    t = now();
+    for(i = 0; i < count; ++i) {
+        CRYPT_CryptData(&ref, a, BENCH_LEN, 1);
+    }
+    tref = now() - t;
+
+    t = now();
+    for(i = 0; i < count; ++i) {
+        cipher_crypt(&key, &ks, b, BENCH_LEN, 1);
+    }
+    tnew = now() - t;
+
+    printf("%-10s library %.3fs (%.1f ns/packet), cipher_crypt %.3fs "
+           "(%.1f ns/packet)\n", name, tref, tref * 1e9 / count, tnew,
+           tnew * 1e9 / count);
+
+    cipher_ks_clear(&ks);
+}
+
+static void bench(long count) {
+    printf("%ld packets of %d bytes each:\n", count, BENCH_LEN);
+    bench_one(CRYPT_PC, "PC", count);
+    bench_one(CRYPT_GAMECUBE, "GC", count);
+    bench_one(CRYPT_BLUEBURST, "Blue Burst", count);
+    printf("(checksum %02x)\n", (unsigned)(a[0] ^ b[0]));
+}
+
+int main(int argc, char *argv[]) {
+    long count = 1000000;
+    uint32_t n;
+
+    if(cipher_init()) {
+        fprintf(stderr, "cipher_init failed\n");
+        return EXIT_FAILURE;
+    }
+
+    for(n = 0; n < 4; ++n) {
+        if(check_stream(CRYPT_PC, "PC", n) ||
+           check_stream(CRYPT_GAMECUBE, "GC", n) || check_bb(n)) {
+            cipher_shutdown();
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("cipher_crypt matches the library for PC, GC and Blue Burst\n");
+
+    if(argc > 1) {
+        if(strcmp(argv[1], "-b")) {
+            fprintf(stderr, "Usage: %s [-b [count]]\n", argv[0]);
+            cipher_shutdown();
+            return EXIT_FAILURE;
+        }
+
+        if(argc > 2)
+            count = atol(argv[2]);
+
+        if(count < 1) {
+            fprintf(stderr, "Count must be at least 1\n");
+            cipher_shutdown();
+            return EXIT_FAILURE;
+        }
+
+        bench(count);
+    }
+
+    cipher_shutdown();
+    return 0;
+}
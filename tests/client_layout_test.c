@@ -0,0 +1,76 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Check the layout of the client structure: the fields that the workers look
+   at on every pass have to stay together at the front of it, and apart from
+   the cipher state, there shouldn't be much else in there. Anything big that
+   only a few packets need belongs in client_cold_t, which is allocated on its
+   own. This is run by "make check", so that something getting added in the
+   wrong place shows up.
+
+   To build it by hand:
+       cc -I../src -o client_layout_test client_layout_test.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+#include "clients.h"
+
+#define CACHE_LINE      64
+
+/* Everything up to and including the pointer to the cold part. */
+#define MAX_HOT_SIZE    (8 * CACHE_LINE)
+
+/* Everything after that, other than the two CRYPT_SETUPs. */
+#define MAX_REST_SIZE   (4 * CACHE_LINE)
+
+int main(int argc, char *argv[]) {
+    size_t hot, rest;
+
+    (void)argc;
+    (void)argv;
+
+    hot = offsetof(ship_client_t, cold) + sizeof(client_cold_t *);
+    rest = sizeof(ship_client_t) - hot - 2 * sizeof(CRYPT_SETUP);
+
+    printf("ship_client_t: %zu bytes (%zu hot, %zu other, %zu cipher "
+           "state)\nclient_cold_t: %zu bytes\n", sizeof(ship_client_t), hot,
+           rest, 2 * sizeof(CRYPT_SETUP), sizeof(client_cold_t));
+
+    if(hot > MAX_HOT_SIZE) {
+        fprintf(stderr, "Hot part of the client is %zu bytes, more than %d\n",
+                hot, MAX_HOT_SIZE);
+        return EXIT_FAILURE;
+    }
+
+    if(offsetof(ship_client_t, ckey) < hot ||
+       offsetof(ship_client_t, skey) < hot) {
+        fprintf(stderr, "Cipher state is in the hot part of the client\n");
+        return EXIT_FAILURE;
+    }
+
+    if(rest > MAX_REST_SIZE) {
+        fprintf(stderr, "Client has %zu bytes outside of the hot part and "
+                "cipher state, more than %d\n", rest, MAX_REST_SIZE);
+        return EXIT_FAILURE;
+    }
+
+    printf("client layout checks passed\n");
+    return 0;
+}
@@ -0,0 +1,296 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Check the table that games keep their floor items in. Items get added and
+   taken away at random, a lot of the time with ids that all want the same few
+   slots or that wrap around the end of the table, and after every change the
+   table has to hold exactly what a plain array says it should: every item has
+   to be found from its home slot without hitting an empty slot first, and no
+   gaps can be left behind by the backward shifting on removal. This is run by
+   "make check".
+
+   Run it with -b to also time picking up items from a floor with a few hundred
+   on it, against walking a list of them the way it used to be done. An
+   optional count after that says how many pickups to do (the default is
+   10000000).
+
+   To build it by hand:
+       cc -O2 -I../src -o floor_items_test floor_items_test.c \
+           ../src/floor_items.c ../src/mtrand.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "floor_items.h"
+#include "mtrand.h"
+
+#define MAX_ID          1024
+#define NUM_OPS         100000
+
+static lobby_item_t items[MAX_ID];
+static int present[MAX_ID];
+static uint32_t num_present;
+
+/* Same as the table's own hash, so that ids that collide can be picked. */
+static uint32_t home(uint32_t id, uint32_t size) {
+    uint32_t h = id * 0x9E3779B1;
+
+    return (h ^ (h >> 16)) & (size - 1);
+}
+
+static int check_table(lobby_item_table_t *t, int op) {
+    lobby_item_t *it;
+    uint32_t i, j, count = 0;
+
+    if(t->count != num_present) {
+        fprintf(stderr, "Op %d: table has %u items, should have %u\n", op,
+                (unsigned)t->count, (unsigned)num_present);
+        return -1;
+    }
+
+    if(t->size && t->count * 4 > t->size * 3) {
+        fprintf(stderr, "Op %d: table is more than 3/4 full\n", op);
+        return -1;
+    }
+
+    FLOOR_ITEMS_FOREACH(t, i, it) {
+        ++count;
+
+        if(it < items || it >= items + MAX_ID || !present[it - items] ||
+           it->d.item_id != (uint32_t)(it - items)) {
+            fprintf(stderr, "Op %d: slot %u has the wrong item in it\n", op,
+                    (unsigned)i);
+            return -1;
+        }
+
+        /* Nothing between the item's home and where it is can be empty, or
+           looking it up would stop short. */
+        for(j = home(it->d.item_id, t->size); j != i;
+            j = (j + 1) & (t->size - 1)) {
+            if(!t->slots[j]) {
+                fprintf(stderr, "Op %d: gap in front of item %u\n", op,
+                        (unsigned)it->d.item_id);
+                return -1;
+            }
+        }
+    }
+
+    if(count != t->count) {
+        fprintf(stderr, "Op %d: found %u items, table says %u\n", op,
+                (unsigned)count, (unsigned)t->count);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Pick the ids to use. Half of the time, they are chosen from a small group
+   that all have their homes in the same few slots of a 64 slot table, which is
+   what the table starts out as. */
+static uint32_t pick_id(mtrand_t *rng, uint32_t *group, int ngroup) {
+    if(mtrand_int32(rng) & 1)
+        return group[mtrand_int32(rng) % ngroup];
+
+    return mtrand_int32(rng) % MAX_ID;
+}
+
+static int check_random(uint32_t seed, uint32_t lo, uint32_t hi) {
+    lobby_item_table_t t;
+    mtrand_t rng;
+    uint32_t group[40], id;
+    lobby_item_t *it;
+    int ngroup = 0, op, fill;
+
+    memset(&t, 0, sizeof(t));
+    memset(present, 0, sizeof(present));
+    num_present = 0;
+    mtrand_init(&rng, seed);
+
+    for(id = 0; id < MAX_ID && ngroup < 40; ++id) {
+        if(home(id, 64) >= lo && home(id, 64) <= hi)
+            group[ngroup++] = id;
+    }
+
+    for(id = 0; id < MAX_ID; ++id) {
+        items[id].d.item_id = id;
+    }
+
+    for(op = 0; op < NUM_OPS; ++op) {
+        /* Go back and forth between mostly adding and mostly taking away, so
+           that the table grows and empties out a few times. */
+        fill = (op / 5000) & 1 ? 3 : 7;
+        id = pick_id(&rng, group, ngroup);
+
+        if(mtrand_int32(&rng) % 10 < (uint32_t)fill) {
+            if(present[id])
+                continue;
+
+            if(floor_items_insert(&t, &items[id])) {
+                fprintf(stderr, "Op %d: insert failed\n", op);
+                floor_items_reset(&t);
+                return -1;
+            }
+
+            present[id] = 1;
+            ++num_present;
+        }
+        else {
+            it = floor_items_remove(&t, id);
+
+            if(it != (present[id] ? &items[id] : NULL)) {
+                fprintf(stderr, "Op %d: removing item %u gave the wrong "
+                        "result\n", op, (unsigned)id);
+                floor_items_reset(&t);
+                return -1;
+            }
+
+            num_present -= present[id];
+            present[id] = 0;
+        }
+
+        if(check_table(&t, op)) {
+            floor_items_reset(&t);
+            return -1;
+        }
+    }
+
+    floor_items_reset(&t);
+
+    if(t.slots || t.size || t.count) {
+        fprintf(stderr, "Reset table isn't empty\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* About how many items there are on the floor in a busy game. */
+#define BENCH_ITEMS     300
+
+typedef struct list_item {
+    struct list_item *next;
+    lobby_item_t it;
+} list_item_t;
+
+static void bench(long count) {
+    static list_item_t nodes[BENCH_ITEMS];
+    list_item_t *head = NULL, **pp, *n;
+    lobby_item_table_t t;
+    double st, tlist, ttable;
+    uint32_t next_id = BENCH_ITEMS, id;
+    unsigned long sum = 0;
+    lobby_item_t *it;
+    long i;
+    int j;
+
+    /* Each pickup is followed by a drop, so that the floor stays the same
+       size. The item picked up is always one of the older ones. */
+    for(j = 0; j < BENCH_ITEMS; ++j) {
+        nodes[j].it.d.item_id = j;
+        nodes[j].next = head;
+        head = &nodes[j];
+    }
+
+    st = now();
+    for(i = 0; i < count; ++i) {
+        id = next_id - BENCH_ITEMS + (uint32_t)(i % (BENCH_ITEMS / 2));
+
+        for(pp = &head; (n = *pp); pp = &n->next) {
+            if(n->it.d.item_id == id)
+                break;
+        }
+
+        if(n) {
+            *pp = n->next;
+            n->it.d.item_id = next_id++;
+            n->next = head;
+            head = n;
+            sum += id;
+        }
+    }
+    tlist = now() - st;
+
+    memset(&t, 0, sizeof(t));
+    next_id = BENCH_ITEMS;
+
+    for(j = 0; j < BENCH_ITEMS; ++j) {
+        items[j].d.item_id = j;
+        floor_items_insert(&t, &items[j]);
+    }
+
+    st = now();
+    for(i = 0; i < count; ++i) {
+        id = next_id - BENCH_ITEMS + (uint32_t)(i % (BENCH_ITEMS / 2));
+
+        if((it = floor_items_remove(&t, id))) {
+            it->d.item_id = next_id++;
+            floor_items_insert(&t, it);
+            sum += id;
+        }
+    }
+    ttable = now() - st;
+
+    floor_items_reset(&t);
+
+    printf("%ld pickups with %d items on the floor: list %.3fs (%.1f ns "
+           "each), table %.3fs (%.1f ns each)\n", count, BENCH_ITEMS, tlist,
+           tlist * 1e9 / count, ttable, ttable * 1e9 / count);
+    printf("(checksum %lx)\n", sum);
+}
+
+int main(int argc, char *argv[]) {
+    long count = 10000000;
+
+    /* Once with a group of ids that all share a home in the middle of the
+       table, once with a group right at the end of it so that their runs wrap
+       around to the start, and once with a group spread over a few slots. */
+    if(check_random(1, 30, 30) || check_random(2, 62, 63) ||
+       check_random(3, 20, 27))
+        return EXIT_FAILURE;
+
+    printf("floor item table checks passed\n");
+
+    if(argc > 1) {
+        if(strcmp(argv[1], "-b")) {
+            fprintf(stderr, "Usage: %s [-b [count]]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if(argc > 2)
+            count = atol(argv[2]);
+
+        if(count < 1) {
+            fprintf(stderr, "Count must be at least 1\n");
+            return EXIT_FAILURE;
+        }
+
+        bench(count);
+    }
+
+    return 0;
+}
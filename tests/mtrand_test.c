@@ -0,0 +1,161 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Check that mtrand gives exactly the same numbers as libsylverant's mt19937
+   functions for the same seed, since everything from drops to map variations
+   depends on that. This is run by "make check".
+
+   Run it with -b to also time drawing numbers from both generators, which is
+   mostly a measure of how fast each of them refills its state. An optional
+   count after that says how many numbers to draw (the default is 100000000).
+
+   To build it by hand:
+       cc -O2 -I../src -o mtrand_test mtrand_test.c ../src/mtrand.c -lsylverant
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <sylverant/mtwist.h>
+
+#include "mtrand.h"
+
+static const uint32_t seeds[] = {
+    5489, 0, 1, 0xDEADBEEF, 0xFFFFFFFF, 0x12345678
+};
+
+#define NUM_SEEDS   (int)(sizeof(seeds) / sizeof(seeds[0]))
+
+/* Go through the buffer enough times to make sure the refills are right, then
+   check the real numbers too. Throw in a reseed partway through, like the
+   server does when it reuses a generator. */
+static int check_seed(uint32_t seed) {
+    struct mt19937_state ref;
+    mtrand_t rng;
+    int i;
+
+    mt19937_init(&ref, seed);
+    mtrand_init(&rng, seed);
+
+    for(i = 0; i < MTRAND_N * 5 + 7; ++i) {
+        if(mtrand_int32(&rng) != mt19937_genrand_int32(&ref)) {
+            fprintf(stderr, "Mismatch: seed %08x, number %d\n",
+                    (unsigned)seed, i);
+            return -1;
+        }
+    }
+
+    for(i = 0; i < MTRAND_N; ++i) {
+        if(mtrand_real1(&rng) != mt19937_genrand_real1(&ref)) {
+            fprintf(stderr, "Mismatch: seed %08x, real %d\n",
+                    (unsigned)seed, i);
+            return -1;
+        }
+    }
+
+    mt19937_init(&ref, ~seed);
+    mtrand_init(&rng, ~seed);
+
+    for(i = 0; i < MTRAND_N + 1; ++i) {
+        if(mtrand_int32(&rng) != mt19937_genrand_int32(&ref)) {
+            fprintf(stderr, "Mismatch: reseeded %08x, number %d\n",
+                    (unsigned)~seed, i);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(long count) {
+    struct mt19937_state ref;
+    mtrand_t rng;
+    uint32_t sum = 0;
+    double t, tref, tnew;
+    long i;
+
+    mt19937_init(&ref, 5489);
+    mtrand_init(&rng, 5489);
+
+    t = now();
+    for(i = 0; i < count; ++i) {
+        sum += mt19937_genrand_int32(&ref);
+    }
+    tref = now() - t;
+
+    t = now();
+    for(i = 0; i < count; ++i) {
+        sum += mtrand_int32(&rng);
+    }
+    tnew = now() - t;
+
+    /* Time the refills on their own, without anything being drawn. */
+    t = now();
+    for(i = 0; i < count / MTRAND_N; ++i) {
+        mtrand_refill(&rng);
+        sum += rng.buf[0];
+    }
+    t = now() - t;
+
+    printf("%ld numbers: mt19937 %.3fs (%.2f ns each), mtrand %.3fs "
+           "(%.2f ns each)\n", count, tref, tref * 1e9 / count, tnew,
+           tnew * 1e9 / count);
+    printf("mtrand refill: %.0f ns per %d numbers\n",
+           t * 1e9 / (count / MTRAND_N), MTRAND_N);
+    printf("(checksum %08x)\n", (unsigned)sum);
+}
+
+int main(int argc, char *argv[]) {
+    long count = 100000000;
+    int i;
+
+    for(i = 0; i < NUM_SEEDS; ++i) {
+        if(check_seed(seeds[i]))
+            return EXIT_FAILURE;
+    }
+
+    printf("mtrand matches mt19937 for %d seeds\n", NUM_SEEDS);
+
+    if(argc > 1) {
+        if(strcmp(argv[1], "-b")) {
+            fprintf(stderr, "Usage: %s [-b [count]]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if(argc > 2)
+            count = atol(argv[2]);
+
+        if(count < MTRAND_N) {
+            fprintf(stderr, "Count must be at least %d\n", MTRAND_N);
+            return EXIT_FAILURE;
+        }
+
+        bench(count);
+    }
+
+    return 0;
+}
@@ -0,0 +1,318 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Check the alias tables that the drop code picks from against the way it
+   used to pick: take a random number in [0, mod), subtract each weight from it
+   in turn as an unsigned value, and stop at the first one where it goes over
+   mod (or pick nothing if none of them do). For every table, every possible
+   random number is run through both, and each outcome has to come up exactly
+   as often (allowing for the table being a whole number of copies of the
+   range). The weights are made up like the rows of an ItemPT file, along with
+   ones that are negative, that add up to less or more than the modulus, and
+   that leave some of the numbers falling off the end. This is run by
+   "make check".
+
+   Run it with -b to also time picking a tool type both ways. An optional
+   count after that says how many picks to do (the default is 100000000).
+
+   To build it by hand:
+       cc -O2 -I../src -o ptalias_test ptalias_test.c ../src/ptalias.c \
+           ../src/mtrand.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "ptalias.h"
+#include "mtrand.h"
+
+/* The most weights any ItemPT table has (the tool frequencies). */
+#define MAX_WEIGHTS     28
+
+/* One slot for each weight, plus one for nothing being picked. */
+#define NUM_OUTCOMES    (MAX_WEIGHTS + 1)
+
+/* The old way of doing it. */
+static int scan_pick(const int *w, int n, int mod, uint32_t rnd) {
+    int i;
+
+    for(i = 0; i < n; ++i) {
+        if((rnd -= w[i]) > (uint32_t)mod)
+            return i;
+    }
+
+    return PT_ALIAS_NONE;
+}
+
+static int outcome(int pick) {
+    return pick == PT_ALIAS_NONE ? MAX_WEIGHTS : pick;
+}
+
+static int check_weights(const char *name, const int *w, int n, int mod) {
+    uint64_t old[NUM_OUTCOMES], alias[NUM_OUTCOMES];
+    pt_alias_t a;
+    uint32_t rnd;
+    int i, k;
+
+    pt_alias_build(&a, w, n, mod);
+
+    /* Nothing can be picked from an empty range. */
+    if(mod <= 0) {
+        if(pt_alias_pick_rnd(&a, 12345) != PT_ALIAS_NONE) {
+            fprintf(stderr, "%s: picked something out of nothing\n", name);
+            return -1;
+        }
+
+        return 0;
+    }
+
+    if(!a.n || a.n > PT_ALIAS_MAX || a.sum != (uint32_t)mod ||
+       a.total != a.n * a.sum) {
+        fprintf(stderr, "%s: bad table (%d columns, sum %u, total %u)\n",
+                name, a.n, (unsigned)a.sum, (unsigned)a.total);
+        return -1;
+    }
+
+    memset(old, 0, sizeof(old));
+    memset(alias, 0, sizeof(alias));
+
+    for(rnd = 0; rnd < (uint32_t)mod; ++rnd) {
+        ++old[outcome(scan_pick(w, n, mod, rnd))];
+    }
+
+    for(rnd = 0; rnd < a.total; ++rnd) {
+        ++alias[outcome(pt_alias_pick_rnd(&a, rnd))];
+    }
+
+    /* Numbers past the total just wrap around. */
+    if(pt_alias_pick_rnd(&a, a.total + 7) != pt_alias_pick_rnd(&a, 7)) {
+        fprintf(stderr, "%s: doesn't wrap around\n", name);
+        return -1;
+    }
+
+    for(k = 0; k < NUM_OUTCOMES; ++k) {
+        if(alias[k] != old[k] * a.n) {
+            fprintf(stderr, "%s: outcome %d comes up %llu times in %u, "
+                    "should be %llu times in %u\n", name,
+                    k == MAX_WEIGHTS ? -1 : k, (unsigned long long)alias[k],
+                    (unsigned)a.total, (unsigned long long)old[k],
+                    (unsigned)mod);
+
+            for(i = 0; i < n; ++i) {
+                fprintf(stderr, "%s%d", i ? ", " : "    weights: ", w[i]);
+            }
+
+            fprintf(stderr, " (mod %d)\n", mod);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Some cases worth checking no matter what the random rows turn out like. */
+static int check_fixed(void) {
+    static const int all_zero[5] = { 0, 0, 0, 0, 0 };
+    static const int exact[5] = { 10, 20, 30, 25, 15 };
+    static const int under[5] = { 10, 20, 0, 5, 15 };
+    static const int over[5] = { 60, 70, 80, 90, 99 };
+    static const int neg_first[9] = { -5, 20, 30, 0, 10, 10, 10, 10, 15 };
+    static const int neg_middle[9] = { 30, -40, 20, 10, -3, 50, 10, 0, 23 };
+    static const int neg_all[6] = { -10, -20, -30, -5, -5, -30 };
+    static const int back_up[6] = { 50, -50, 50, 25, -100, 100 };
+    static const int one[1] = { 1 };
+    static const int big[2] = { 127, -128 };
+    int tools[MAX_WEIGHTS], i;
+
+    for(i = 0; i < MAX_WEIGHTS; ++i) {
+        tools[i] = (i * 397) % 700;
+    }
+
+    return check_weights("all zero", all_zero, 5, 100) ||
+        check_weights("exact", exact, 5, 100) ||
+        check_weights("under", under, 5, 100) ||
+        check_weights("over", over, 5, 100) ||
+        check_weights("negative first", neg_first, 9, 100) ||
+        check_weights("negative middle", neg_middle, 9, 100) ||
+        check_weights("all negative", neg_all, 6, 100) ||
+        check_weights("back up", back_up, 6, 100) ||
+        check_weights("one", one, 1, 1) ||
+        check_weights("big", big, 2, 100) ||
+        check_weights("tools", tools, MAX_WEIGHTS, 10000) ||
+        check_weights("empty", exact, 5, 0);
+}
+
+/* Rows like the ones in ItemPT: percent patterns and the like are signed bytes
+   out of 100 (or 10000 on v3), technique frequencies are unsigned bytes out of
+   1000 and tool frequencies are 16-bit values out of 10000. Weapon ratios are
+   picked out of their own total. Every so often, make a row that adds up to
+   exactly the modulus, like a good ItemPT file should. */
+static int check_random(long rows) {
+    mtrand_t rng;
+    int w[MAX_WEIGHTS], n, mod, kind, i, sum;
+    long r;
+    char name[64];
+
+    mtrand_init(&rng, 0x1234);
+
+    for(r = 0; r < rows; ++r) {
+        kind = r % 5;
+
+        switch(kind) {
+            case 0:                         /* Signed bytes, out of 100. */
+                n = 1 + mtrand_int32(&rng) % 23;
+                mod = 100;
+
+                for(i = 0; i < n; ++i) {
+                    w[i] = (int8_t)(mtrand_int32(&rng) % (r & 1 ? 256 : 40));
+                }
+                break;
+
+            case 1:                         /* Signed bytes, out of 10000. */
+                n = 23;
+                mod = 10000;
+
+                for(i = 0; i < n; ++i) {
+                    w[i] = (int8_t)mtrand_int32(&rng);
+                }
+                break;
+
+            case 2:                         /* Techniques. */
+                n = 19;
+                mod = 1000;
+
+                for(i = 0; i < n; ++i) {
+                    w[i] = (uint8_t)(mtrand_int32(&rng) % (r & 1 ? 256 : 60));
+                }
+                break;
+
+            case 3:                         /* Tools. */
+                n = MAX_WEIGHTS;
+                mod = 10000;
+
+                for(i = 0; i < n; ++i) {
+                    w[i] = (uint16_t)(mtrand_int32(&rng) % (r & 1 ? 700 : 300));
+                }
+                break;
+
+            default:                        /* Weapons. */
+                n = 12;
+
+                for(i = 0, mod = 0; i < n; ++i) {
+                    w[i] = (int8_t)(mtrand_int32(&rng) % 60) - 10;
+
+                    if(w[i] < 0)
+                        w[i] = 0;
+
+                    mod += w[i];
+                }
+                break;
+        }
+
+        /* Make the last weight take up whatever is left. */
+        if(r % 7 == 3) {
+            for(i = 0, sum = 0; i < n - 1; ++i) {
+                sum += w[i];
+            }
+
+            w[n - 1] = mod - sum;
+        }
+
+        sprintf(name, "Row %ld", r);
+
+        if(check_weights(name, w, n, mod))
+            return -1;
+    }
+
+    return 0;
+}
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(long count) {
+    int w[MAX_WEIGHTS], i;
+    double t, tscan, talias;
+    unsigned long sum = 0;
+    pt_alias_t a;
+    mtrand_t rng;
+    long j;
+
+    /* A tool row that adds up to 10000, with the common stuff at the end the
+       way it tends to be. */
+    for(i = 0; i < MAX_WEIGHTS; ++i) {
+        w[i] = 100 + i * 15;
+    }
+
+    w[MAX_WEIGHTS - 1] = 10000 - 100 * (MAX_WEIGHTS - 1) -
+        15 * (MAX_WEIGHTS - 1) * (MAX_WEIGHTS - 2) / 2;
+    pt_alias_build(&a, w, MAX_WEIGHTS, 10000);
+
+    mtrand_init(&rng, 1);
+    t = now();
+    for(j = 0; j < count; ++j) {
+        sum += scan_pick(w, MAX_WEIGHTS, 10000, mtrand_int32(&rng) % 10000);
+    }
+    tscan = now() - t;
+
+    mtrand_init(&rng, 1);
+    t = now();
+    for(j = 0; j < count; ++j) {
+        sum += pt_alias_pick_rnd(&a, mtrand_int32(&rng));
+    }
+    talias = now() - t;
+
+    printf("%ld tool picks: scan %.3fs (%.1f ns each), alias table %.3fs "
+           "(%.1f ns each)\n", count, tscan, tscan * 1e9 / count, talias,
+           talias * 1e9 / count);
+    printf("(checksum %lx)\n", sum);
+}
+
+int main(int argc, char *argv[]) {
+    long count = 100000000;
+
+    if(check_fixed() || check_random(5000))
+        return EXIT_FAILURE;
+
+    printf("alias tables match the old scan\n");
+
+    if(argc > 1) {
+        if(strcmp(argv[1], "-b")) {
+            fprintf(stderr, "Usage: %s [-b [count]]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if(argc > 2)
+            count = atol(argv[2]);
+
+        if(count < 1) {
+            fprintf(stderr, "Count must be at least 1\n");
+            return EXIT_FAILURE;
+        }
+
+        bench(count);
+    }
+
+    return 0;
+}
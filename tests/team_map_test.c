@@ -0,0 +1,280 @@
+/*
+    Sylverant Ship Server
+    Copyright (C) 2026 Lawrence Sebald
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License version 3
+    as published by the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Check that looking up enemies and objects through a team's sets gives the
+   same thing that the team's own copy of its map used to have in it. Each
+   team used to get all of the sets for its map copied into one array, with
+   Dark Falz' battle parameters and the special Rappies' rare table index
+   patched for the team's difficulty and event. Now the team just points at
+   the shared sets and those changes get made on lookup. Sets of all sorts of
+   sizes (including empty ones) are made up for this, and every id gets looked
+   up, along with the ones just past the end, which have to come back NULL.
+   This is run by "make check".
+
+   Run it with -b to also time setting up a team both ways. An optional count
+   after that says how many teams to set up (the default is 100000).
+
+   To build it by hand:
+       cc -O2 -I../src -o team_map_test team_map_test.c ../src/mtrand.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "mapdata.h"
+#include "mtrand.h"
+
+#define MAX_PER_SET     300
+#define RAPPY_RT        79
+
+static game_enemy_t enemies[TEAM_MAX_SETS][MAX_PER_SET];
+static game_object_t objects[TEAM_MAX_SETS][MAX_PER_SET];
+static game_enemies_t esets[TEAM_MAX_SETS];
+static game_objs_t osets[TEAM_MAX_SETS];
+
+static game_enemy_t flat_en[TEAM_MAX_SETS * MAX_PER_SET];
+static game_object_t flat_obj[TEAM_MAX_SETS * MAX_PER_SET];
+static game_enemy_state_t state[TEAM_MAX_SETS * MAX_PER_SET];
+static uint8_t flags[TEAM_MAX_SETS * MAX_PER_SET];
+
+/* Make up the data for a map. Now and then, a set is empty. Like in the real
+   maps, Dark Falz is never one of the special Rappies. */
+static void make_sets(mtrand_t *rng, int nsets) {
+    uint32_t i, j, k;
+    uint8_t *p;
+
+    for(i = 0; i < (uint32_t)nsets; ++i) {
+        esets[i].count = mtrand_int32(rng) % 4 ? mtrand_int32(rng) %
+            MAX_PER_SET : 0;
+        esets[i].enemies = enemies[i];
+        osets[i].count = mtrand_int32(rng) % 4 ? mtrand_int32(rng) %
+            MAX_PER_SET : 0;
+        osets[i].objs = objects[i];
+
+        for(j = 0; j < esets[i].count; ++j) {
+            k = mtrand_int32(rng);
+            enemies[i][j].bp_entry = k % 20 ? (k >> 8) % 0x30 : 0x37;
+            enemies[i][j].rt_index = k % 15 || k % 20 == 0 ?
+                (uint8_t)(k >> 16) % 0x60 : (uint8_t)-1;
+            enemies[i][j].area = (uint8_t)i;
+        }
+
+        for(j = 0; j < osets[i].count; ++j) {
+            p = (uint8_t *)&objects[i][j].data;
+
+            for(k = 0; k < sizeof(map_object_t); ++k) {
+                p[k] = (uint8_t)mtrand_int32(rng);
+            }
+
+            objects[i][j].area = (uint8_t)i;
+        }
+    }
+}
+
+/* What the old code did: copy everything into the team's own array and then
+   patch it up. Blue Burst and Gamecube teams got their Rappies fixed for the
+   event, v2 ones didn't. */
+static void old_setup(int nsets, int difficulty, int fix_rappies,
+                      uint32_t *ecount, uint32_t *ocount) {
+    uint32_t i, index = 0, index2 = 0;
+
+    for(i = 0; i < (uint32_t)nsets; ++i) {
+        memcpy(&flat_en[index], esets[i].enemies,
+               sizeof(game_enemy_t) * esets[i].count);
+        index += esets[i].count;
+        memcpy(&flat_obj[index2], osets[i].objs,
+               sizeof(game_object_t) * osets[i].count);
+        index2 += osets[i].count;
+    }
+
+    for(i = 0; i < index; ++i) {
+        if(flat_en[i].bp_entry == 0x37 && difficulty)
+            flat_en[i].bp_entry = 0x38;
+        else if(fix_rappies && flat_en[i].rt_index == (uint8_t)-1)
+            flat_en[i].rt_index = RAPPY_RT;
+    }
+
+    *ecount = index;
+    *ocount = index2;
+}
+
+/* The way setup_game_enemies() does it now. */
+static void new_setup(team_enemies_t *en, team_objs_t *ob, int nsets,
+                      int difficulty, int fix_rappies) {
+    uint32_t enemies = 0, objs = 0;
+    int i;
+
+    memset(en, 0, sizeof(team_enemies_t));
+    memset(ob, 0, sizeof(team_objs_t));
+
+    for(i = 0; i < nsets; ++i) {
+        en->start[i] = enemies;
+        en->sets[i] = esets[i].enemies;
+        enemies += esets[i].count;
+
+        ob->start[i] = objs;
+        ob->sets[i] = osets[i].objs;
+        objs += osets[i].count;
+    }
+
+    en->count = enemies;
+    ob->count = objs;
+    en->num_sets = ob->num_sets = nsets;
+    en->falz_bp = difficulty ? 0x38 : 0x37;
+    en->rappy_rt = fix_rappies ? RAPPY_RT : (uint8_t)-1;
+    en->state = state;
+    ob->flags = flags;
+}
+
+static int check_team(int n, int nsets, int difficulty, int fix_rappies) {
+    team_enemies_t en;
+    team_objs_t ob;
+    const game_enemy_t *e;
+    const game_object_t *o;
+    uint32_t i, ecount, ocount;
+
+    old_setup(nsets, difficulty, fix_rappies, &ecount, &ocount);
+    new_setup(&en, &ob, nsets, difficulty, fix_rappies);
+
+    if(en.count != ecount || ob.count != ocount) {
+        fprintf(stderr, "Team %d: %u enemies and %u objects, should be %u "
+                "and %u\n", n, (unsigned)en.count, (unsigned)ob.count,
+                (unsigned)ecount, (unsigned)ocount);
+        return -1;
+    }
+
+    for(i = 0; i < ecount; ++i) {
+        if(!(e = team_enemy(&en, i)) || team_enemy_bp(&en, e) !=
+           flat_en[i].bp_entry || team_enemy_rt(&en, e) !=
+           flat_en[i].rt_index || e->area != flat_en[i].area) {
+            fprintf(stderr, "Team %d: enemy %u doesn't match\n", n,
+                    (unsigned)i);
+            return -1;
+        }
+
+        /* It has to be the shared data, not a copy of it. */
+        if(e < enemies[e->area] || e >= enemies[e->area] + MAX_PER_SET) {
+            fprintf(stderr, "Team %d: enemy %u isn't in the shared data\n", n,
+                    (unsigned)i);
+            return -1;
+        }
+    }
+
+    for(i = 0; i < ocount; ++i) {
+        if(!(o = team_object(&ob, i)) || o->area != flat_obj[i].area ||
+           memcmp(&o->data, &flat_obj[i].data, sizeof(map_object_t))) {
+            fprintf(stderr, "Team %d: object %u doesn't match\n", n,
+                    (unsigned)i);
+            return -1;
+        }
+    }
+
+    for(i = 0; i < 3; ++i) {
+        if(team_enemy(&en, ecount + i) || team_object(&ob, ocount + i)) {
+            fprintf(stderr, "Team %d: id past the end was found\n", n);
+            return -1;
+        }
+    }
+
+    if(team_enemy(&en, 0xFFFFFFFF) || team_object(&ob, 0xFFFFFFFF)) {
+        fprintf(stderr, "Team %d: id 0xFFFFFFFF was found\n", n);
+        return -1;
+    }
+
+    return 0;
+}
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(long count) {
+    team_enemies_t en;
+    team_objs_t ob;
+    double t, told, tnew;
+    uint32_t ecount, ocount;
+    unsigned long sum = 0;
+    mtrand_t rng;
+    long i;
+
+    /* About what a big map looks like. */
+    mtrand_init(&rng, 1);
+    make_sets(&rng, TEAM_MAX_SETS);
+
+    t = now();
+    for(i = 0; i < count; ++i) {
+        old_setup(TEAM_MAX_SETS, i & 3, 1, &ecount, &ocount);
+        sum += flat_en[i % (ecount + 1)].bp_entry;
+    }
+    told = now() - t;
+
+    t = now();
+    for(i = 0; i < count; ++i) {
+        new_setup(&en, &ob, TEAM_MAX_SETS, i & 3, 1);
+        sum += en.count;
+    }
+    tnew = now() - t;
+
+    printf("%ld teams with %u enemies and %u objects: copying %.3fs (%.1f us "
+           "each), sharing %.3fs (%.1f us each)\n", count, (unsigned)ecount,
+           (unsigned)ocount, told, told * 1e6 / count, tnew,
+           tnew * 1e6 / count);
+    printf("(checksum %lx)\n", sum);
+}
+
+int main(int argc, char *argv[]) {
+    long count = 100000;
+    mtrand_t rng;
+    int n, nsets;
+
+    mtrand_init(&rng, 0x5EED);
+
+    for(n = 0; n < 2000; ++n) {
+        nsets = 1 + mtrand_int32(&rng) % TEAM_MAX_SETS;
+        make_sets(&rng, nsets);
+
+        if(check_team(n, nsets, n % 4, n & 1))
+            return EXIT_FAILURE;
+    }
+
+    printf("team map lookups match the old copies\n");
+
+    if(argc > 1) {
+        if(strcmp(argv[1], "-b")) {
+            fprintf(stderr, "Usage: %s [-b [count]]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if(argc > 2)
+            count = atol(argv[2]);
+
+        if(count < 1) {
+            fprintf(stderr, "Count must be at least 1\n");
+            return EXIT_FAILURE;
+        }
+
+        bench(count);
+    }
+
+    return 0;
+}